@@ -0,0 +1,371 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// a64sim.cpp for Simple-XX/SimpleCompiler.
+
+#include "climits"
+#include "cstring"
+#include "sstream"
+#include "a64sim.h"
+
+using namespace std;
+
+// 将低 _bits 位符号扩展
+static int64_t sext(uint64_t _v, int _bits) {
+    return (int64_t)(_v << (64 - _bits)) >> (64 - _bits);
+}
+
+A64Sim::A64Sim(const A64Image &_image, istream &_in, ostream &_out)
+    : mem(_image.mem), base(_image.base), entry(_image.entry),
+      text_end(_image.text_end), stack_size(16 << 20), in(_in), out(_out),
+      sp(0), n(false), z(false), c(false), v(false), steps(0),
+      step_limit(0) {
+    return;
+}
+
+A64Sim::~A64Sim(void) {
+    return;
+}
+
+void A64Sim::set_step_limit(uint64_t _limit) {
+    step_limit = _limit;
+    return;
+}
+
+void A64Sim::set_stack_size(size_t _size) {
+    stack_size = _size;
+    return;
+}
+
+uint64_t A64Sim::get_steps(void) const {
+    return steps;
+}
+
+const string &A64Sim::get_trap(void) const {
+    return trap;
+}
+
+bool A64Sim::check(uint64_t _addr, size_t _size, bool _write) {
+    if (_addr < (_write ? text_end : base) ||
+        _addr - base + _size > mem.size()) {
+        ostringstream os;
+        os << "invalid memory access at 0x" << hex << _addr;
+        trap = os.str();
+        return false;
+    }
+    return true;
+}
+
+uint64_t A64Sim::get(int _reg, bool _sp) const {
+    if (_reg == 31) {
+        return _sp ? sp : 0;
+    }
+    return x[_reg];
+}
+
+void A64Sim::set(int _reg, uint64_t _val, bool _sf, bool _sp) {
+    if (_sf == false) {
+        _val = (uint32_t)_val;
+    }
+    if (_reg != 31) {
+        x[_reg] = _val;
+    }
+    else if (_sp) {
+        sp = _val;
+    }
+    return;
+}
+
+bool A64Sim::cond(int _cond) const {
+    bool r = true;
+    switch (_cond >> 1) {
+        case 0:
+            r = z;
+            break;
+        case 1:
+            r = c;
+            break;
+        case 2:
+            r = n;
+            break;
+        case 3:
+            r = v;
+            break;
+        case 4:
+            r = c && z == false;
+            break;
+        case 5:
+            r = n == v;
+            break;
+        case 6:
+            r = n == v && z == false;
+            break;
+        default:
+            return true;
+    }
+    return (_cond & 1) ? r == false : r;
+}
+
+bool A64Sim::load(uint64_t _addr, int _size, int _reg) {
+    if (check(_addr, _size, false) == false) {
+        return false;
+    }
+    uint64_t val = 0;
+    memcpy(&val, &mem[_addr - base], _size);
+    set(_reg, val, true, false);
+    return true;
+}
+
+bool A64Sim::store(uint64_t _addr, int _size, int _reg) {
+    if (check(_addr, _size, true) == false) {
+        return false;
+    }
+    uint64_t val = get(_reg, false);
+    memcpy(&mem[_addr - base], &val, _size);
+    return true;
+}
+
+int A64Sim::run(void) {
+    mem.resize(mem.size() + stack_size, 0);
+    memset(x, 0, sizeof(x));
+    sp = (base + mem.size()) & ~(uint64_t)15;
+    // 入口的 bl main 返回到入口之后
+    uint64_t pc = entry;
+    while (true) {
+        if (step_limit != 0 && steps >= step_limit) {
+            trap = "step limit exceeded";
+            return -1;
+        }
+        if (pc < base || pc + 4 > text_end || pc % 4 != 0) {
+            ostringstream os;
+            os << "invalid pc 0x" << hex << pc;
+            trap = os.str();
+            return -1;
+        }
+        uint32_t w;
+        memcpy(&w, &mem[pc - base], 4);
+        int      rd = w & 31, rn = w >> 5 & 31, rm = w >> 16 & 31;
+        bool     sf   = w >> 31;
+        int      size = w >> 30;
+        uint64_t next = pc + 4;
+        bool     ok   = true;
+        // 加减立即数，可能左移 12 位
+        if ((w & 0x1f800000) == 0x11000000) {
+            uint64_t a   = get(rn, true);
+            uint64_t imm = (uint64_t)(w >> 10 & 0xfff) << (w >> 22 & 1 ? 12 : 0);
+            bool     sub = w >> 30 & 1, s = w >> 29 & 1;
+            if (s && sub == false) {
+                ok = false;
+            }
+            else if (s) {
+                // subs，只用于比较
+                uint64_t r = a - imm;
+                if (sf == false) {
+                    a = (uint32_t)a;
+                    r = (uint32_t)r;
+                }
+                int top = sf ? 63 : 31;
+                n       = r >> top & 1;
+                z       = r == 0;
+                c       = a >= imm;
+                v       = ((a ^ imm) & (a ^ r)) >> top & 1;
+                set(rd, r, sf, false);
+            }
+            else {
+                set(rd, sub ? a - imm : a + imm, sf, true);
+            }
+        }
+        // 加减寄存器，不移位
+        else if ((w & 0x1f200000) == 0x0b000000) {
+            uint64_t a = get(rn, false), b = get(rm, false);
+            bool     sub = w >> 30 & 1, s = w >> 29 & 1;
+            if ((w >> 10 & 0x3f) != 0 || (w >> 22 & 3) != 0 ||
+                (s && sub == false)) {
+                ok = false;
+            }
+            else if (s) {
+                uint64_t r = a - b;
+                if (sf == false) {
+                    a = (uint32_t)a;
+                    b = (uint32_t)b;
+                    r = (uint32_t)r;
+                }
+                int top = sf ? 63 : 31;
+                n       = r >> top & 1;
+                z       = r == 0;
+                c       = a >= b;
+                v       = ((a ^ b) & (a ^ r)) >> top & 1;
+                set(rd, r, sf, false);
+            }
+            else {
+                set(rd, sub ? a - b : a + b, sf, false);
+            }
+        }
+        // add xd, xn, wm, sxtw #imm3
+        else if ((w & 0xffe0e000) == 0x8b20c000 && (w >> 10 & 7) <= 4) {
+            uint64_t b = (uint64_t)sext(get(rm, false), 32) << (w >> 10 & 7);
+            set(rd, get(rn, true) + b, true, true);
+        }
+        // orr，不移位
+        else if ((w & 0x7fe0fc00) == 0x2a000000) {
+            set(rd, get(rn, false) | get(rm, false), sf, false);
+        }
+        // madd/msub
+        else if ((w & 0x7fe00000) == 0x1b000000) {
+            uint64_t p = get(rn, false) * get(rm, false);
+            uint64_t a = get(w >> 10 & 31, false);
+            set(rd, w >> 15 & 1 ? a - p : a + p, sf, false);
+        }
+        // sdiv，除数为 0 时结果为 0
+        else if ((w & 0x7fe0fc00) == 0x1ac00c00) {
+            int64_t a = get(rn, false), b = get(rm, false), r = 0;
+            if (sf == false) {
+                a = (int32_t)a;
+                b = (int32_t)b;
+            }
+            int64_t min = sf ? INT64_MIN : INT32_MIN;
+            if (b == 0) {
+                r = 0;
+            }
+            else if (a == min && b == -1) {
+                r = min;
+            }
+            else {
+                r = a / b;
+            }
+            set(rd, r, sf, false);
+        }
+        // csel/csinc
+        else if ((w & 0x7fe00800) == 0x1a800000) {
+            uint64_t r = cond(w >> 12 & 15) ? get(rn, false)
+                                            : get(rm, false) + (w >> 10 & 1);
+            set(rd, r, sf, false);
+        }
+        // movn/movz/movk
+        else if ((w & 0x1f800000) == 0x12800000) {
+            int      opc = w >> 29 & 3, hw = w >> 21 & 3;
+            uint64_t imm = (uint64_t)(w >> 5 & 0xffff) << (16 * hw);
+            if (opc == 1 || (sf == false && hw > 1)) {
+                ok = false;
+            }
+            else if (opc == 0) {
+                set(rd, ~imm, sf, false);
+            }
+            else if (opc == 2) {
+                set(rd, imm, sf, false);
+            }
+            else {
+                uint64_t mask = (uint64_t)0xffff << (16 * hw);
+                set(rd, (get(rd, false) & ~mask) | imm, sf, false);
+            }
+        }
+        // 32 与 64 位读写，无符号偏移、9 位有符号偏移与寄存器偏移
+        else if ((w & 0xbf000000) == 0xb9000000 ||
+                 (w & 0xbf200c00) == 0xb8000000 ||
+                 (w & 0xbf200c00) == 0xb8200800) {
+            int      opc  = w >> 22 & 3;
+            uint64_t addr = get(rn, true);
+            if (w >> 24 & 1) {
+                addr += (uint64_t)(w >> 10 & 0xfff) << size;
+            }
+            else if ((w >> 21 & 1) == 0) {
+                addr += sext(w >> 12 & 0x1ff, 9);
+            }
+            else {
+                // 只支持 sxtw 与 lsl
+                int      option = w >> 13 & 7;
+                uint64_t off    = get(rm, false);
+                if (option == 6) {
+                    off = sext(off, 32);
+                }
+                else if (option != 3) {
+                    ok = false;
+                }
+                addr += off << (w >> 12 & 1 ? size : 0);
+            }
+            if (ok && opc > 1) {
+                ok = false;
+            }
+            else if (ok) {
+                if ((opc == 1 ? load(addr, 1 << size, rd)
+                              : store(addr, 1 << size, rd)) == false) {
+                    return -1;
+                }
+            }
+        }
+        // stp 前变址与 ldp 后变址，64 位
+        else if ((w & 0xffc00000) == 0xa9800000 ||
+                 (w & 0xffc00000) == 0xa8c00000) {
+            bool     ld   = w >> 22 & 1;
+            int64_t  off  = sext(w >> 15 & 0x7f, 7) * 8;
+            int      rt2  = w >> 10 & 31;
+            uint64_t addr = get(rn, true) + (ld ? 0 : off);
+            if (ld) {
+                if (load(addr, 8, rd) == false || load(addr + 8, 8, rt2) == false) {
+                    return -1;
+                }
+            }
+            else if (store(addr, 8, rd) == false ||
+                     store(addr + 8, 8, rt2) == false) {
+                return -1;
+            }
+            set(rn, addr + (ld ? off : 0), true, true);
+        }
+        // b/bl
+        else if ((w & 0x7c000000) == 0x14000000) {
+            if (w >> 31) {
+                x[30] = pc + 4;
+            }
+            next = pc + sext(w & 0x3ffffff, 26) * 4;
+        }
+        // b.cond
+        else if ((w & 0xff000010) == 0x54000000) {
+            if (cond(w & 15)) {
+                next = pc + sext(w >> 5 & 0x7ffff, 19) * 4;
+            }
+        }
+        // cbz/cbnz
+        else if ((w & 0x7e000000) == 0x34000000) {
+            uint64_t r = get(rd, false);
+            if (sf == false) {
+                r = (uint32_t)r;
+            }
+            if ((r == 0) != (w >> 24 & 1)) {
+                next = pc + sext(w >> 5 & 0x7ffff, 19) * 4;
+            }
+        }
+        // ret
+        else if ((w & 0xfffffc1f) == 0xd65f0000) {
+            next = get(rn, false);
+        }
+        // adrp
+        else if ((w & 0x9f000000) == 0x90000000) {
+            int64_t imm = sext((w >> 5 & 0x7ffff) << 2 | (w >> 29 & 3), 21);
+            set(rd, (pc & ~(uint64_t)0xfff) + imm * 4096, true, false);
+        }
+        else if (w == 0xd4000001) {
+            if (x[8] == SIM_CALL_EXIT) {
+                steps++;
+                return x[0] & 0xff;
+            }
+            int64_t args[2] = {(int64_t)x[0], (int64_t)x[1]};
+            int64_t ret;
+            if (sim_runtime_call(x[8] - SIM_CALL_RUNTIME, args, ret, mem, base,
+                                 in, out, trap) == false) {
+                return -1;
+            }
+            x[0] = ret;
+        }
+        else {
+            ok = false;
+        }
+        if (ok == false) {
+            ostringstream os;
+            os << "illegal instruction 0x" << hex << w << " at 0x" << pc;
+            trap = os.str();
+            return -1;
+        }
+        pc = next;
+        steps++;
+    }
+}
@@ -0,0 +1,1148 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// aarch64.cpp for Simple-XX/SimpleCompiler.
+
+#include "algorithm"
+#include "cstring"
+#include "sstream"
+#include "unordered_map"
+#include "aarch64.h"
+
+using namespace std;
+
+// 分配给虚拟寄存器的 callee-saved 寄存器为 x19 到 x28
+static const int alloc_cnt = A64_X28 - A64_X19 + 1;
+
+// 参数寄存器个数
+static const int ARG_REGS = 8;
+// 代码的起始地址
+static const uint64_t TEXT_BASE = 0x10000;
+
+static const char *cond_names[] = {"eq", "ne", "hs", "lo", "mi", "pl",
+                                   "vs", "vc", "hi", "ls", "ge", "lt",
+                                   "gt", "le", "al", "nv"};
+
+// 展开后的字节数
+static uint32_t inst_size(const A64Inst &_inst) {
+    switch (_inst.op) {
+        case A64_LABEL:
+            return 0;
+        case A64_LA:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+// 访存指令能否直接使用偏移 _off
+static bool fits_scaled(int64_t _off, int _width) {
+    return _off >= 0 && _off % _width == 0 && _off / _width <= 4095;
+}
+
+static bool fits_unscaled(int64_t _off) {
+    return _off >= -256 && _off <= 255;
+}
+
+class A64Gen {
+private:
+    const IRModule   &module;
+    const IRFunction *fun;
+    A64Function      *af;
+    // 各虚拟寄存器分配到的物理寄存器，0 表示在栈帧中
+    vector<int> home;
+    // 栈帧中的虚拟寄存器相对 sp 的偏移
+    vector<int32_t> slot;
+    // 各虚拟寄存器被读的次数
+    vector<uint32_t> uses;
+    // 各标号被跳转到的次数
+    vector<uint32_t> refs;
+    // 使用了的 callee-saved 寄存器个数
+    int saved;
+    // 保存的寄存器相对 sp 的偏移
+    int32_t saved_base;
+    // 栈上数组相对 sp 的偏移
+    int32_t array_base;
+    // 函数出口
+    int32_t exit_label;
+    // 等待调用的参数
+    vector<IRArg> pending;
+
+    void add(const A64Inst &_inst) {
+        af->code.push_back(_inst);
+        return;
+    }
+    void op(a64_op_t _op, bool _x, int _rd, int _rn, int _rm = 0,
+            int64_t _imm = 0) {
+        add(A64Inst(_op, _x, _rd, _rn, _rm, _imm));
+        return;
+    }
+    // 寄存器之间的移动，mov 不能读写 sp
+    void move(int _rd, int _rn) {
+        if (_rd != _rn) {
+            op(A64_MOV, true, _rd, A64_ZR, _rn);
+        }
+        return;
+    }
+    // 以 movz/movn 加 movk 装入立即数，全 1 的半字较多时用 movn
+    void li(int _rd, bool _x, int64_t _imm);
+    // _rd = _rn + _off，_rd 与 _rn 可以是 sp
+    void add_imm(int _rd, int _rn, int64_t _off);
+    int32_t new_label(void) {
+        return af->label_cnt++;
+    }
+    void label(int32_t _label) {
+        A64Inst i(A64_LABEL);
+        i.label = _label;
+        add(i);
+        return;
+    }
+    void branch(a64_op_t _op, int _rt, int _cond, int32_t _label) {
+        A64Inst i(_op, false, _rt);
+        i.cond  = _cond;
+        i.label = _label;
+        add(i);
+        return;
+    }
+    // 访存，偏移无法编码时先用 x16 算出地址
+    void mem(a64_op_t _op, bool _x, int _rt, int _base, int64_t _off);
+    // 操作数所在的寄存器，不在寄存器中时读入 _tmp
+    // 立即数 0 在 _zr 为 true 时直接使用 zr
+    int use(const IRArg &_arg, int _tmp, bool _zr = true);
+    // 结果写入的寄存器
+    int dst(const IRArg &_res) {
+        return home[_res.val] != 0 ? home[_res.val] : A64_X9;
+    }
+    // 结果在栈帧中时写回
+    void commit(const IRArg &_res, int _reg) {
+        if (home[_res.val] == 0) {
+            mem(A64_STR, true, _reg, A64_SP, slot[_res.val]);
+        }
+        return;
+    }
+    // 比较并设置条件标志，返回条件成立时的条件码
+    int compare(const IRInst &_inst);
+    // 比较结果只被紧接着的条件跳转使用时生成条件分支或 csel
+    size_t fuse_compare(size_t _idx);
+    // 地址只被紧接着的读写使用时折叠进访存指令
+    size_t fuse_access(size_t _idx);
+    // 生成调用，参数为 pending 中的值
+    void call(int _callee);
+    // 生成下标 _idx 处的指令，返回处理了的条数
+    size_t inst(size_t _idx);
+    // 分配寄存器与栈帧，生成序言
+    void prologue(void);
+    void epilogue(void);
+
+public:
+    A64Gen(const IRModule &_module);
+    ~A64Gen(void);
+    void function(const IRFunction &_fun, A64Function &_af);
+};
+
+A64Gen::A64Gen(const IRModule &_module)
+    : module(_module), fun(NULL), af(NULL), saved(0), saved_base(0),
+      array_base(0), exit_label(0) {
+    return;
+}
+
+A64Gen::~A64Gen(void) {
+    return;
+}
+
+void A64Gen::li(int _rd, bool _x, int64_t _imm) {
+    uint64_t v = _x ? (uint64_t)_imm : (uint32_t)_imm;
+    int      n = _x ? 4 : 2;
+    int      zeros = 0, ones = 0;
+    for (int k = 0; k < n; k++) {
+        uint32_t h = v >> (16 * k) & 0xffff;
+        zeros += h == 0;
+        ones += h == 0xffff;
+    }
+    bool inv   = ones > zeros;
+    bool first = true;
+    for (int k = 0; k < n; k++) {
+        uint32_t h = v >> (16 * k) & 0xffff;
+        if (h == (inv ? 0xffffu : 0u)) {
+            continue;
+        }
+        A64Inst i(first ? (inv ? A64_MOVN : A64_MOVZ) : A64_MOVK, _x, _rd);
+        i.imm   = first && inv ? (~h & 0xffff) : h;
+        i.shift = 16 * k;
+        add(i);
+        first = false;
+    }
+    if (first) {
+        add(A64Inst(inv ? A64_MOVN : A64_MOVZ, _x, _rd));
+    }
+    return;
+}
+
+void A64Gen::add_imm(int _rd, int _rn, int64_t _off) {
+    a64_op_t o   = _off < 0 ? A64_SUBI : A64_ADDI;
+    uint64_t off = _off < 0 ? -(uint64_t)_off : _off;
+    bool     any = false;
+    // 每条指令最多加 12 位左移 12 位的立即数
+    while (off > 0xffffff) {
+        A64Inst i(o, true, _rd, _rn, 0, 0xfff);
+        i.shift = 12;
+        add(i);
+        _rn = _rd;
+        off -= 0xfff000;
+        any = true;
+    }
+    if (off >> 12 != 0) {
+        A64Inst i(o, true, _rd, _rn, 0, off >> 12);
+        i.shift = 12;
+        add(i);
+        _rn = _rd;
+        any = true;
+    }
+    if ((off & 0xfff) != 0 || any == false) {
+        if (_rd != _rn || (off & 0xfff) != 0) {
+            op(o, true, _rd, _rn, 0, off & 0xfff);
+        }
+    }
+    return;
+}
+
+void A64Gen::mem(a64_op_t _op, bool _x, int _rt, int _base, int64_t _off) {
+    if (fits_scaled(_off, _x ? 8 : 4)) {
+        op(_op, _x, _rt, _base, 0, _off);
+        return;
+    }
+    if (fits_unscaled(_off)) {
+        op(_op == A64_LDR ? A64_LDUR : A64_STUR, _x, _rt, _base, 0, _off);
+        return;
+    }
+    add_imm(A64_X16, _base, _off);
+    op(_op, _x, _rt, A64_X16, 0, 0);
+    return;
+}
+
+int A64Gen::use(const IRArg &_arg, int _tmp, bool _zr) {
+    switch (_arg.kind) {
+        case ARG_REG:
+            if (home[_arg.val] != 0) {
+                return home[_arg.val];
+            }
+            mem(A64_LDR, true, _tmp, A64_SP, slot[_arg.val]);
+            return _tmp;
+        case ARG_IMM:
+            if (_arg.val == 0 && _zr) {
+                return A64_ZR;
+            }
+            li(_tmp, false, _arg.val);
+            return _tmp;
+        case ARG_GLOBAL: {
+            A64Inst i(A64_LA, true, _tmp);
+            i.sym = module.globals[_arg.val].name;
+            add(i);
+            return _tmp;
+        }
+        case ARG_FRAME:
+            add_imm(_tmp, A64_SP, array_base + _arg.val);
+            return _tmp;
+        default:
+            return A64_ZR;
+    }
+}
+
+int A64Gen::compare(const IRInst &_inst) {
+    static const int conds[] = {A64_GT, A64_GE, A64_LT,
+                                A64_LE, A64_EQ, A64_NE};
+    if (_inst.op == OP_NOT) {
+        op(A64_CMPI, false, A64_ZR, use(_inst.arg1, A64_X9, false));
+        return A64_EQ;
+    }
+    if (_inst.arg2.is_imm() && _inst.arg2.val >= 0 && _inst.arg2.val <= 4095) {
+        op(A64_CMPI, false, A64_ZR, use(_inst.arg1, A64_X9, false), 0,
+           _inst.arg2.val);
+    }
+    else {
+        int a = use(_inst.arg1, A64_X9);
+        op(A64_CMP, false, A64_ZR, a, use(_inst.arg2, A64_X10));
+    }
+    return conds[_inst.op - OP_GT];
+}
+
+size_t A64Gen::fuse_compare(size_t _idx) {
+    const vector<IRInst> &code = fun->code;
+    const IRInst         &i    = code[_idx];
+    if (_idx + 1 >= code.size()) {
+        return 0;
+    }
+    const IRInst &j = code[_idx + 1];
+    if ((j.op != OP_JT && j.op != OP_JF) || (j.arg1 == i.result) == false ||
+        uses[i.result.val] != 1) {
+        return 0;
+    }
+    // 条件跳转跳过对同一个变量的赋值，即 x = c ? v1 : v2 或 if (c) x = v
+    // 跳转条件为真时取 else 一侧的值
+    auto is_as = [&](size_t _k) {
+        return _k < code.size() && code[_k].op == OP_AS &&
+               code[_k].result.is_reg() &&
+               (code[_k].result == i.result) == false &&
+               (code[_k].arg1 == i.result) == false;
+    };
+    auto is_label = [&](size_t _k, int32_t _label) {
+        return _k < code.size() && code[_k].op == OP_LABEL &&
+               code[_k].result.val == _label;
+    };
+    const IRArg *take = NULL, *skip = NULL;
+    size_t       n    = 0;
+    if (is_as(_idx + 2) && _idx + 3 < code.size() &&
+        code[_idx + 3].op == OP_JMP && is_label(_idx + 4, j.result.val) &&
+        refs[j.result.val] == 1 && is_as(_idx + 5) &&
+        code[_idx + 5].result == code[_idx + 2].result &&
+        is_label(_idx + 6, code[_idx + 3].result.val)) {
+        take = &code[_idx + 2].arg1;
+        skip = &code[_idx + 5].arg1;
+        n    = 6;
+    }
+    else if (is_as(_idx + 2) && is_label(_idx + 3, j.result.val)) {
+        take = &code[_idx + 2].arg1;
+        skip = &code[_idx + 2].result;
+        n    = 3;
+    }
+    int cond = compare(i);
+    if (j.op == OP_JT) {
+        cond ^= 1;
+    }
+    if (n != 0) {
+        const IRArg &res = code[_idx + 2].result;
+        int          a   = use(*take, A64_X10);
+        int          b   = use(*skip, A64_X11);
+        int          d   = dst(res);
+        A64Inst      sel(A64_CSEL, fun->reg_ptr[res.val], d, a, b);
+        sel.cond = cond;
+        add(sel);
+        commit(res, d);
+        return n;
+    }
+    // 与 0 比较相等后跳转时去掉比较
+    if (af->code.back().op == A64_CMPI && af->code.back().imm == 0 &&
+        (cond == A64_EQ || cond == A64_NE)) {
+        int r = af->code.back().rn;
+        af->code.pop_back();
+        branch(cond == A64_NE ? A64_CBZ : A64_CBNZ, r, 0, j.result.val);
+        return 2;
+    }
+    // 跳转条件取反，假跳转时恰为比较条件的反面
+    branch(A64_BCOND, 0, cond ^ 1, j.result.val);
+    return 2;
+}
+
+size_t A64Gen::fuse_access(size_t _idx) {
+    const vector<IRInst> &code  = fun->code;
+    size_t                first = _idx;
+    int32_t               scale = 0;
+    // %t = %i * 4 之后以 %t 为偏移时使用 sxtw #2 缩放
+    if (code[_idx].op == OP_MUL) {
+        const IRInst &m = code[_idx];
+        if (_idx + 1 >= code.size() || uses[m.result.val] != 1) {
+            return 0;
+        }
+        const IRInst &o = code[_idx + 1];
+        if (o.op != OP_OFFSET || (o.arg2 == m.result) == false ||
+            o.arg1 == m.result) {
+            return 0;
+        }
+        bool left = m.arg1.is_imm() && m.arg1.val == 4 && m.arg2.is_imm() == false;
+        bool right = m.arg2.is_imm() && m.arg2.val == 4 && m.arg1.is_imm() == false;
+        if (left == false && right == false) {
+            return 0;
+        }
+        scale = 2;
+        _idx++;
+    }
+    const IRInst &o     = code[_idx];
+    const IRArg  &index = scale == 0 ? o.arg2
+                          : code[first].arg2.is_imm() ? code[first].arg1
+                                                      : code[first].arg2;
+    bool fold = _idx + 1 < code.size() && uses[o.result.val] == 1;
+    if (fold) {
+        const IRInst &j = code[_idx + 1];
+        fold = (j.op == OP_GET || j.op == OP_SET) && j.arg1 == o.result &&
+               (j.op == OP_SET && j.result == o.result) == false;
+    }
+    if (fold && o.arg2.is_imm()) {
+        fold = fits_scaled(o.arg2.val, 4) || fits_unscaled(o.arg2.val);
+    }
+    if (fold == false) {
+        if (scale == 0) {
+            return 0;
+        }
+        // 地址还有其他用处时只把乘 4 并入地址计算
+        int     d    = dst(o.result);
+        int     base = use(o.arg1, A64_X10, false);
+        A64Inst a(A64_ADD_SXTW, true, d, base, use(index, A64_X11));
+        a.shift = scale;
+        add(a);
+        commit(o.result, d);
+        return 2;
+    }
+    const IRInst &j    = code[_idx + 1];
+    bool          load = j.op == OP_GET;
+    int64_t       off  = o.arg2.val;
+    int           base = use(o.arg1, A64_X10, false);
+    if (o.arg2.is_imm()) {
+        a64_op_t ld = fits_scaled(off, 4) ? A64_LDR : A64_LDUR;
+        a64_op_t st = fits_scaled(off, 4) ? A64_STR : A64_STUR;
+        if (load) {
+            int d = dst(j.result);
+            op(ld, false, d, base, 0, off);
+            commit(j.result, d);
+        }
+        else {
+            op(st, false, use(j.result, A64_X9), base, 0, off);
+        }
+        return _idx + 2 - first;
+    }
+    int r = use(index, A64_X11);
+    if (load) {
+        int     d = dst(j.result);
+        A64Inst ld(A64_LDR_IDX, false, d, base, r);
+        ld.shift = scale;
+        add(ld);
+        commit(j.result, d);
+    }
+    else {
+        A64Inst st(A64_STR_IDX, false, use(j.result, A64_X9), base, r);
+        st.shift = scale;
+        add(st);
+    }
+    return _idx + 2 - first;
+}
+
+// 超过 8 个的参数放在 sp 开始的参数区
+void A64Gen::call(int _callee) {
+    for (size_t k = ARG_REGS; k < pending.size(); k++) {
+        int r = use(pending[k], A64_X9);
+        mem(A64_STR, true, r, A64_SP, 8 * (k - ARG_REGS));
+    }
+    for (size_t k = 0; k < pending.size() && k < ARG_REGS; k++) {
+        move(A64_X0 + k, use(pending[k], A64_X0 + k));
+    }
+    A64Inst i(A64_CALL);
+    i.sym = module.funs[_callee].name;
+    add(i);
+    pending.clear();
+    return;
+}
+
+size_t A64Gen::inst(size_t _idx) {
+    const IRInst &i = fun->code[_idx];
+    switch (i.op) {
+        case OP_NOP:
+            break;
+        case OP_LABEL:
+            label(i.result.val);
+            break;
+        case OP_AS:
+        case OP_LEA: {
+            int d = dst(i.result);
+            move(d, use(i.arg1, d));
+            commit(i.result, d);
+            break;
+        }
+        case OP_ADD:
+        case OP_SUB:
+        case OP_OFFSET: {
+            if (i.op == OP_OFFSET) {
+                size_t n = fuse_access(_idx);
+                if (n != 0) {
+                    return n;
+                }
+            }
+            int  d = dst(i.result);
+            bool x = i.op == OP_OFFSET;
+            // 加立即数用 add/sub，加法的立即数可以在左边
+            IRArg a = i.arg1, b = i.arg2;
+            if (i.op == OP_ADD && a.is_imm() && b.is_imm() == false) {
+                swap(a, b);
+            }
+            int64_t imm = i.op == OP_SUB ? -(int64_t)b.val : b.val;
+            if (b.is_imm() && imm >= -4095 && imm <= 4095) {
+                op(imm < 0 ? A64_SUBI : A64_ADDI, x, d, use(a, A64_X9, false),
+                   0, imm < 0 ? -imm : imm);
+            }
+            else if (x) {
+                int base = use(a, A64_X9, false);
+                op(A64_ADD_SXTW, true, d, base, use(b, A64_X10));
+            }
+            else {
+                int r = use(a, A64_X9);
+                op(i.op == OP_ADD ? A64_ADD : A64_SUB, false, d, r,
+                   use(b, A64_X10));
+            }
+            commit(i.result, d);
+            break;
+        }
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD: {
+            if (i.op == OP_MUL) {
+                size_t n = fuse_access(_idx);
+                if (n != 0) {
+                    return n;
+                }
+            }
+            int d = dst(i.result);
+            int a = use(i.arg1, A64_X9);
+            int b = use(i.arg2, A64_X10);
+            if (i.op == OP_MUL) {
+                op(A64_MUL, false, d, a, b);
+            }
+            else if (i.op == OP_DIV) {
+                op(A64_SDIV, false, d, a, b);
+            }
+            else {
+                // a - (a / b) * b
+                op(A64_SDIV, false, A64_X17, a, b);
+                A64Inst ms(A64_MSUB, false, d, A64_X17, b);
+                ms.ra = a;
+                add(ms);
+            }
+            commit(i.result, d);
+            break;
+        }
+        case OP_NEG: {
+            int d = dst(i.result);
+            op(A64_SUB, false, d, A64_ZR, use(i.arg1, A64_X9));
+            commit(i.result, d);
+            break;
+        }
+        case OP_GT:
+        case OP_GE:
+        case OP_LT:
+        case OP_LE:
+        case OP_EQU:
+        case OP_NE:
+        case OP_NOT: {
+            size_t n = fuse_compare(_idx);
+            if (n != 0) {
+                return n;
+            }
+            int     c = compare(i);
+            int     d = dst(i.result);
+            A64Inst set(A64_CSET, false, d);
+            set.cond = c;
+            add(set);
+            commit(i.result, d);
+            break;
+        }
+        case OP_SET: {
+            int v = use(i.result, A64_X9);
+            op(A64_STR, false, v, use(i.arg1, A64_X10, false), 0, 0);
+            break;
+        }
+        case OP_GET: {
+            int d = dst(i.result);
+            op(A64_LDR, false, d, use(i.arg1, A64_X10, false), 0, 0);
+            commit(i.result, d);
+            break;
+        }
+        case OP_ZERO: {
+            move(A64_X9, use(i.arg1, A64_X9, false));
+            // 小块直接逐字清零
+            if (i.arg2.is_imm() && i.arg2.val <= 64) {
+                for (int32_t k = 0; k < i.arg2.val; k += 4) {
+                    op(A64_STR, false, A64_ZR, A64_X9, 0, k);
+                }
+                break;
+            }
+            op(A64_ADD, true, A64_X10, A64_X9, use(i.arg2, A64_X10));
+            int32_t loop = new_label(), done = new_label();
+            op(A64_CMP, true, A64_ZR, A64_X9, A64_X10);
+            branch(A64_BCOND, 0, A64_EQ, done);
+            label(loop);
+            op(A64_STR, false, A64_ZR, A64_X9, 0, 0);
+            op(A64_ADDI, true, A64_X9, A64_X9, 0, 4);
+            op(A64_CMP, true, A64_ZR, A64_X9, A64_X10);
+            branch(A64_BCOND, 0, A64_LO, loop);
+            label(done);
+            break;
+        }
+        case OP_JMP:
+            branch(A64_B, 0, 0, i.result.val);
+            break;
+        case OP_JT:
+        case OP_JF:
+            branch(i.op == OP_JT ? A64_CBNZ : A64_CBZ, use(i.arg1, A64_X9), 0,
+                   i.result.val);
+            break;
+        case OP_ARG:
+            pending.push_back(i.arg1);
+            break;
+        case OP_PROC:
+            call(i.arg1.val);
+            break;
+        case OP_CALL: {
+            call(i.arg1.val);
+            int d = dst(i.result);
+            move(d, A64_X0);
+            commit(i.result, d);
+            break;
+        }
+        case OP_RET:
+        case OP_RETV:
+            if (i.op == OP_RETV) {
+                move(A64_X0, use(i.arg1, A64_X0));
+            }
+            // 最后一条返回直接落入出口
+            if (_idx + 1 < fun->code.size()) {
+                branch(A64_B, 0, 0, exit_label);
+            }
+            break;
+    }
+    return 1;
+}
+
+// 栈帧自高向低为：x29、x30、栈上数组、保存的 x19-x28、虚拟寄存器、传参区
+// x29 指向保存的 x29，sp 按 16 字节对齐，函数体中 sp 不变
+void A64Gen::prologue(void) {
+    uint32_t regs = fun->reg_cnt();
+    // 按读写次数分配寄存器
+    vector<uint32_t> count(regs, 0);
+    uses.assign(regs, 0);
+    refs.assign(fun->label_cnt, 0);
+    size_t max_args = 0, args = 0;
+    for (auto &i : fun->code) {
+        if (i.op == OP_ARG) {
+            args++;
+        }
+        else if (i.op == OP_PROC || i.op == OP_CALL) {
+            max_args = max(max_args, args);
+            args     = 0;
+        }
+        else if (i.op == OP_JMP || i.op == OP_JT || i.op == OP_JF) {
+            refs[i.result.val]++;
+        }
+        for (auto a : {&i.arg1, &i.arg2}) {
+            if (a->is_reg()) {
+                uses[a->val]++;
+                count[a->val]++;
+            }
+        }
+        if (i.result.is_reg()) {
+            // SET 的 result 是被写入的值
+            if (i.op == OP_SET) {
+                uses[i.result.val]++;
+            }
+            count[i.result.val]++;
+        }
+    }
+    // 参数在序言中写入
+    for (uint32_t k = 0; k < fun->param_cnt; k++) {
+        count[k]++;
+    }
+    vector<uint32_t> order(regs);
+    for (uint32_t k = 0; k < regs; k++) {
+        order[k] = k;
+    }
+    stable_sort(order.begin(), order.end(), [&count](uint32_t a, uint32_t b) {
+        return count[a] > count[b];
+    });
+    home.assign(regs, 0);
+    saved = 0;
+    for (uint32_t k : order) {
+        if (saved == alloc_cnt || count[k] == 0) {
+            break;
+        }
+        home[k] = A64_X19 + saved++;
+    }
+    int32_t out = 8 * (max_args > ARG_REGS ? max_args - ARG_REGS : 0);
+    int32_t top = out;
+    slot.assign(regs, 0);
+    for (uint32_t k = 0; k < regs; k++) {
+        if (home[k] == 0) {
+            slot[k] = top;
+            top += 8;
+        }
+    }
+    saved_base    = top;
+    array_base    = saved_base + 8 * saved;
+    int64_t frame = array_base + ((fun->frame_size + 7) & ~7);
+    frame         = (frame + 15) & ~15;
+    op(A64_STP_PRE, true, A64_FP, A64_SP, A64_LR, -16);
+    op(A64_ADDI, true, A64_FP, A64_SP, 0, 0);
+    if (frame != 0) {
+        add_imm(A64_SP, A64_SP, -frame);
+    }
+    for (int k = 0; k < saved; k++) {
+        mem(A64_STR, true, A64_X19 + k, A64_SP, saved_base + 8 * k);
+    }
+    // 参数写入 0 号开始的虚拟寄存器，第 9 个起在调用者的传参区
+    for (uint32_t k = 0; k < fun->param_cnt; k++) {
+        int src = A64_X0 + k;
+        if (k >= ARG_REGS) {
+            src = A64_X9;
+            mem(A64_LDR, true, src, A64_FP, 16 + 8 * (k - ARG_REGS));
+        }
+        int d = home[k] != 0 ? home[k] : A64_X9;
+        move(d, src);
+        commit(IRArg(ARG_REG, k), d);
+    }
+    return;
+}
+
+void A64Gen::epilogue(void) {
+    label(exit_label);
+    for (int k = 0; k < saved; k++) {
+        mem(A64_LDR, true, A64_X19 + k, A64_SP, saved_base + 8 * k);
+    }
+    op(A64_ADDI, true, A64_SP, A64_FP, 0, 0);
+    op(A64_LDP_POST, true, A64_FP, A64_SP, A64_LR, 16);
+    op(A64_RET, true, 0, A64_LR);
+    return;
+}
+
+void A64Gen::function(const IRFunction &_fun, A64Function &_af) {
+    fun           = &_fun;
+    af            = &_af;
+    af->name      = _fun.name;
+    af->label_cnt = _fun.label_cnt;
+    exit_label    = new_label();
+    pending.clear();
+    prologue();
+    for (size_t k = 0; k < _fun.code.size();) {
+        k += inst(k);
+    }
+    // 没有以返回结束的函数返回 0
+    if (_fun.code.empty() || (_fun.code.back().op != OP_RET &&
+                              _fun.code.back().op != OP_RETV)) {
+        move(A64_X0, A64_ZR);
+    }
+    epilogue();
+    return;
+}
+
+void aarch64_lower(const IRModule &_module, A64Program &_prog) {
+    A64Gen gen(_module);
+    _prog.globals = _module.globals;
+    for (auto &f : _module.funs) {
+        if (f.extern_flag) {
+            _prog.externs.push_back(f.name);
+            continue;
+        }
+        _prog.funs.push_back(A64Function());
+        gen.function(f, _prog.funs.back());
+    }
+    return;
+}
+
+void aarch64_lower_function(const IRModule &_module, const IRFunction &_fun,
+                            A64Function &_out) {
+    A64Gen gen(_module);
+    gen.function(_fun, _out);
+    return;
+}
+
+// 寄存器名，_sp 为 true 时 31 号为 sp，否则为 zr
+static string reg(int _reg, bool _x, bool _sp = false) {
+    if (_reg == 31) {
+        return _sp ? (_x ? "sp" : "wsp") : (_x ? "xzr" : "wzr");
+    }
+    return (_x ? "x" : "w") + to_string(_reg);
+}
+
+// 输出一条指令
+static void print_inst(ostream &_os, const A64Function &_fun,
+                       const A64Inst &_inst) {
+    string target = ".L" + _fun.name + "_" + to_string(_inst.label);
+    bool   x      = _inst.x;
+    string rd = reg(_inst.rd, x), rn = reg(_inst.rn, x), rm = reg(_inst.rm, x);
+    string base = "[" + reg(_inst.rn, true, true);
+    switch (_inst.op) {
+        case A64_LABEL:
+            _os << target << ":\n";
+            return;
+        case A64_ADDI:
+        case A64_SUBI:
+            if (_inst.op == A64_ADDI && _inst.imm == 0 &&
+                (_inst.rd == A64_SP || _inst.rn == A64_SP)) {
+                _os << "\tmov\t" << reg(_inst.rd, x, true) << ", "
+                    << reg(_inst.rn, x, true) << "\n";
+                return;
+            }
+            _os << (_inst.op == A64_ADDI ? "\tadd\t" : "\tsub\t")
+                << reg(_inst.rd, x, true) << ", " << reg(_inst.rn, x, true)
+                << ", #" << _inst.imm;
+            if (_inst.shift != 0) {
+                _os << ", lsl #12";
+            }
+            break;
+        case A64_CMPI:
+            _os << "\tcmp\t" << reg(_inst.rn, x, true) << ", #" << _inst.imm;
+            break;
+        case A64_ADD:
+            _os << "\tadd\t" << rd << ", " << rn << ", " << rm;
+            break;
+        case A64_SUB:
+            if (_inst.rn == A64_ZR) {
+                _os << "\tneg\t" << rd << ", " << rm;
+                break;
+            }
+            _os << "\tsub\t" << rd << ", " << rn << ", " << rm;
+            break;
+        case A64_CMP:
+            _os << "\tcmp\t" << rn << ", " << rm;
+            break;
+        case A64_MOV:
+            _os << "\tmov\t" << rd << ", " << rm;
+            break;
+        case A64_ADD_SXTW:
+            _os << "\tadd\t" << reg(_inst.rd, true, true) << ", "
+                << reg(_inst.rn, true, true) << ", " << reg(_inst.rm, false)
+                << ", sxtw";
+            if (_inst.shift != 0) {
+                _os << " #" << _inst.shift;
+            }
+            break;
+        case A64_MUL:
+            _os << "\tmul\t" << rd << ", " << rn << ", " << rm;
+            break;
+        case A64_SDIV:
+            _os << "\tsdiv\t" << rd << ", " << rn << ", " << rm;
+            break;
+        case A64_MSUB:
+            _os << "\tmsub\t" << rd << ", " << rn << ", " << rm << ", "
+                << reg(_inst.ra, x);
+            break;
+        case A64_CSEL:
+            _os << "\tcsel\t" << rd << ", " << rn << ", " << rm << ", "
+                << cond_names[_inst.cond];
+            break;
+        case A64_CSET:
+            _os << "\tcset\t" << rd << ", " << cond_names[_inst.cond];
+            break;
+        case A64_MOVZ:
+        case A64_MOVN:
+        case A64_MOVK:
+            _os << (_inst.op == A64_MOVZ   ? "\tmovz\t"
+                    : _inst.op == A64_MOVN ? "\tmovn\t"
+                                           : "\tmovk\t")
+                << rd << ", #" << _inst.imm;
+            if (_inst.shift != 0) {
+                _os << ", lsl #" << _inst.shift;
+            }
+            break;
+        case A64_LDR:
+        case A64_STR:
+        case A64_LDUR:
+        case A64_STUR:
+            _os << (_inst.op == A64_LDR    ? "\tldr\t"
+                    : _inst.op == A64_STR  ? "\tstr\t"
+                    : _inst.op == A64_LDUR ? "\tldur\t"
+                                           : "\tstur\t")
+                << rd << ", " << base;
+            if (_inst.imm != 0) {
+                _os << ", #" << _inst.imm;
+            }
+            _os << "]";
+            break;
+        case A64_LDR_IDX:
+        case A64_STR_IDX:
+            _os << (_inst.op == A64_LDR_IDX ? "\tldr\t" : "\tstr\t") << rd
+                << ", " << base << ", " << reg(_inst.rm, false) << ", sxtw";
+            if (_inst.shift != 0) {
+                _os << " #" << _inst.shift;
+            }
+            _os << "]";
+            break;
+        case A64_STP_PRE:
+            _os << "\tstp\tx29, x30, [sp, #" << _inst.imm << "]!";
+            break;
+        case A64_LDP_POST:
+            _os << "\tldp\tx29, x30, [sp], #" << _inst.imm;
+            break;
+        case A64_B:
+            _os << "\tb\t" << target;
+            break;
+        case A64_BCOND:
+            _os << "\tb." << cond_names[_inst.cond] << "\t" << target;
+            break;
+        case A64_CBZ:
+        case A64_CBNZ:
+            _os << (_inst.op == A64_CBZ ? "\tcbz\t" : "\tcbnz\t") << rd << ", "
+                << target;
+            break;
+        case A64_RET:
+            _os << "\tret";
+            break;
+        case A64_SVC:
+            _os << "\tsvc\t#0";
+            break;
+        case A64_LA:
+            _os << "\tadrp\t" << rd << ", " << _inst.sym << "\n\tadd\t" << rd
+                << ", " << rd << ", :lo12:" << _inst.sym;
+            break;
+        case A64_CALL:
+        case A64_BL:
+            _os << "\tbl\t" << _inst.sym;
+            break;
+        case A64_ADRP:
+            _os << "\tadrp\t" << rd << ", " << _inst.sym;
+            break;
+    }
+    _os << "\n";
+    return;
+}
+
+string aarch64_asm_function(const A64Function &_fun) {
+    ostringstream os;
+    os << "\t.globl " << _fun.name << "\n\t.p2align 2\n\t.type " << _fun.name
+       << ", %function\n"
+       << _fun.name << ":\n";
+    for (auto &i : _fun.code) {
+        print_inst(os, _fun, i);
+    }
+    os << "\t.size " << _fun.name << ", .-" << _fun.name << "\n";
+    return os.str();
+}
+
+string aarch64_asm(const A64Program &_prog) {
+    vector<string> funs;
+    for (auto &f : _prog.funs) {
+        funs.push_back(aarch64_asm_function(f));
+    }
+    return aarch64_asm(_prog, funs);
+}
+
+string aarch64_asm(const A64Program &_prog, const vector<string> &_funs) {
+    ostringstream os;
+    for (auto &g : _prog.globals) {
+        bool bss = g.init.empty() && g.const_flag == false;
+        os << (g.const_flag ? "\t.section .rodata\n"
+               : bss        ? "\t.bss\n"
+                            : "\t.data\n");
+        os << "\t.globl " << g.name << "\n\t.p2align 3\n\t.type " << g.name
+           << ", %object\n\t.size " << g.name << ", " << g.size << "\n"
+           << g.name << ":\n";
+        for (auto v : g.init) {
+            os << "\t.word " << v << "\n";
+        }
+        if (g.size > g.init.size() * 4) {
+            os << "\t.zero " << g.size - g.init.size() * 4 << "\n";
+        }
+    }
+    os << "\t.text\n";
+    for (auto &f : _funs) {
+        os << f;
+    }
+    os << "\t.section .note.GNU-stack,\"\",%progbits\n";
+    return os.str();
+}
+
+// 编码一条真实指令，_off 为分支与跳转相对本指令的偏移
+static uint32_t encode(const A64Inst &_inst, int64_t _off) {
+    uint32_t sf    = _inst.x ? 1u << 31 : 0;
+    uint32_t rd    = _inst.rd, rn = _inst.rn << 5, rm = _inst.rm << 16;
+    uint32_t imm   = _inst.imm;
+    uint32_t off   = _off >> 2;
+    uint32_t width = _inst.x ? 8 : 4;
+    switch (_inst.op) {
+        case A64_ADDI:
+        case A64_SUBI:
+        case A64_CMPI: {
+            static const uint32_t ops[] = {0x11000000, 0x51000000, 0x71000000};
+            return ops[_inst.op - A64_ADDI] | sf | (_inst.shift == 12) << 22 |
+                   (imm & 0xfff) << 10 | rn | rd;
+        }
+        case A64_ADD:
+        case A64_SUB:
+        case A64_CMP: {
+            static const uint32_t ops[] = {0x0b000000, 0x4b000000, 0x6b000000};
+            return ops[_inst.op - A64_ADD] | sf | rm | rn | rd;
+        }
+        case A64_MOV:
+            return 0x2a000000 | sf | rm | A64_ZR << 5 | rd;
+        case A64_ADD_SXTW:
+            return 0x8b200000 | rm | 6 << 13 | (_inst.shift & 7) << 10 | rn |
+                   rd;
+        case A64_MUL:
+            return 0x1b000000 | sf | rm | A64_ZR << 10 | rn | rd;
+        case A64_SDIV:
+            return 0x1ac00c00 | sf | rm | rn | rd;
+        case A64_MSUB:
+            return 0x1b008000 | sf | rm | _inst.ra << 10 | rn | rd;
+        case A64_CSEL:
+            return 0x1a800000 | sf | rm | _inst.cond << 12 | rn | rd;
+        case A64_CSET:
+            // csinc rd, zr, zr, !cond
+            return 0x1a800400 | sf | A64_ZR << 16 | (_inst.cond ^ 1) << 12 |
+                   A64_ZR << 5 | rd;
+        case A64_MOVZ:
+        case A64_MOVN:
+        case A64_MOVK: {
+            static const uint32_t ops[] = {0x52800000, 0x12800000, 0x72800000};
+            return ops[_inst.op - A64_MOVZ] | sf | (_inst.shift / 16) << 21 |
+                   (imm & 0xffff) << 5 | rd;
+        }
+        case A64_LDR:
+            return (_inst.x ? 0xf9400000 : 0xb9400000) | (imm / width) << 10 |
+                   rn | rd;
+        case A64_STR:
+            return (_inst.x ? 0xf9000000 : 0xb9000000) | (imm / width) << 10 |
+                   rn | rd;
+        case A64_LDUR:
+            return (_inst.x ? 0xf8400000 : 0xb8400000) | (imm & 0x1ff) << 12 |
+                   rn | rd;
+        case A64_STUR:
+            return (_inst.x ? 0xf8000000 : 0xb8000000) | (imm & 0x1ff) << 12 |
+                   rn | rd;
+        case A64_LDR_IDX:
+        case A64_STR_IDX:
+            return (_inst.op == A64_LDR_IDX ? 0xb8600800 : 0xb8200800) | rm |
+                   6 << 13 | (_inst.shift != 0) << 12 | rn | rd;
+        case A64_STP_PRE:
+        case A64_LDP_POST:
+            return (_inst.op == A64_STP_PRE ? 0xa9800000 : 0xa8c00000) |
+                   (imm / 8 & 0x7f) << 15 | _inst.rm << 10 | rn | rd;
+        case A64_B:
+            return 0x14000000 | (off & 0x3ffffff);
+        case A64_BL:
+            return 0x94000000 | (off & 0x3ffffff);
+        case A64_BCOND:
+            return 0x54000000 | (off & 0x7ffff) << 5 | _inst.cond;
+        case A64_CBZ:
+            return 0x34000000 | sf | (off & 0x7ffff) << 5 | rd;
+        case A64_CBNZ:
+            return 0x35000000 | sf | (off & 0x7ffff) << 5 | rd;
+        case A64_RET:
+            return 0xd65f0000 | rn;
+        case A64_ADRP:
+            return 0x90000000 | (imm & 3) << 29 | (imm >> 2 & 0x7ffff) << 5 |
+                   rd;
+        case A64_SVC:
+            return 0xd4000001;
+        default:
+            return 0;
+    }
+}
+
+// 代码依次为入口、运行时函数的桩与各函数，之后是全局变量
+// 运行时函数的桩以 svc 交给模拟器
+bool aarch64_link(const A64Program &_prog, A64Image &_image, string &_err) {
+    vector<A64Inst> start;
+    A64Inst         call_main(A64_CALL);
+    call_main.sym = "main";
+    start.push_back(call_main);
+    start.push_back(A64Inst(A64_MOVZ, true, A64_X8, 0, 0, SIM_CALL_EXIT));
+    start.push_back(A64Inst(A64_SVC));
+    unordered_map<string, uint64_t> syms;
+    uint64_t                        pc = TEXT_BASE + start.size() * 4;
+    vector<A64Inst>                 stubs;
+    for (auto &name : _prog.externs) {
+        int rt = sim_runtime_index(name);
+        if (rt < 0) {
+            _err = "undefined function " + name;
+            return false;
+        }
+        syms[name] = pc + stubs.size() * 4;
+        stubs.push_back(
+            A64Inst(A64_MOVZ, true, A64_X8, 0, 0, SIM_CALL_RUNTIME + rt));
+        stubs.push_back(A64Inst(A64_SVC));
+        stubs.push_back(A64Inst(A64_RET, true, 0, A64_LR));
+    }
+    pc += stubs.size() * 4;
+    vector<vector<uint64_t>> labels(_prog.funs.size());
+    for (size_t f = 0; f < _prog.funs.size(); f++) {
+        const A64Function &fun = _prog.funs[f];
+        syms[fun.name]         = pc;
+        labels[f].assign(fun.label_cnt, 0);
+        for (auto &i : fun.code) {
+            if (i.op == A64_LABEL) {
+                labels[f][i.label] = pc;
+            }
+            pc += inst_size(i);
+        }
+    }
+    _image.base     = TEXT_BASE;
+    _image.text_end = pc;
+    for (auto &g : _prog.globals) {
+        pc           = (pc + 7) & ~(uint64_t)7;
+        syms[g.name] = pc;
+        pc += g.size;
+    }
+    if (syms.count("main") == 0) {
+        _err = "undefined function main";
+        return false;
+    }
+    _image.entry = TEXT_BASE;
+    _image.mem.assign(pc - TEXT_BASE, 0);
+    for (auto &g : _prog.globals) {
+        if (g.init.empty() == false) {
+            memcpy(&_image.mem[syms[g.name] - TEXT_BASE], g.init.data(),
+                   g.init.size() * 4);
+        }
+    }
+    // 编码，伪指令展开为真实指令
+    pc        = TEXT_BASE;
+    auto put  = [&](const A64Inst &_inst, int64_t _off) {
+        uint32_t word = encode(_inst, _off);
+        memcpy(&_image.mem[pc - TEXT_BASE], &word, 4);
+        pc += 4;
+    };
+    auto emit = [&](const A64Inst &i, const vector<uint64_t> *_labels) {
+        switch (i.op) {
+            case A64_LABEL:
+                return true;
+            case A64_LA:
+            case A64_CALL: {
+                auto it = syms.find(i.sym);
+                if (it == syms.end()) {
+                    _err = "undefined symbol " + i.sym;
+                    return false;
+                }
+                if (i.op == A64_CALL) {
+                    int64_t off = it->second - pc;
+                    if (off < -(1 << 27) || off >= (1 << 27)) {
+                        _err = "call to " + i.sym + " out of range";
+                        return false;
+                    }
+                    put(A64Inst(A64_BL), off);
+                    return true;
+                }
+                int64_t page = (int64_t)((it->second & ~(uint64_t)0xfff) -
+                                         (pc & ~(uint64_t)0xfff)) >>
+                               12;
+                put(A64Inst(A64_ADRP, true, i.rd, 0, 0, page), 0);
+                put(A64Inst(A64_ADDI, true, i.rd, i.rd, 0, it->second & 0xfff),
+                    0);
+                return true;
+            }
+            case A64_B:
+            case A64_BCOND:
+            case A64_CBZ:
+            case A64_CBNZ: {
+                int64_t off   = (*_labels)[i.label] - pc;
+                int64_t range = i.op == A64_B ? 1 << 27 : 1 << 20;
+                if (off < -range || off >= range) {
+                    _err = "branch out of range";
+                    return false;
+                }
+                put(i, off);
+                return true;
+            }
+            default:
+                put(i, 0);
+                return true;
+        }
+    };
+    for (auto &i : start) {
+        emit(i, NULL);
+    }
+    for (auto &i : stubs) {
+        emit(i, NULL);
+    }
+    for (size_t f = 0; f < _prog.funs.size(); f++) {
+        for (auto &i : _prog.funs[f].code) {
+            if (emit(i, &labels[f]) == false) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
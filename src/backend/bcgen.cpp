@@ -0,0 +1,488 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// bcgen.cpp for Simple-XX/SimpleCompiler.
+
+#include "bytecode.h"
+
+using namespace std;
+
+// 比较运算在各组操作码中的次序：LT、LE、GT、GE、EQ、NE
+static int cmp_index(IROperator _op) {
+    switch (_op) {
+        case OP_LT:
+            return 0;
+        case OP_LE:
+            return 1;
+        case OP_GT:
+            return 2;
+        case OP_GE:
+            return 3;
+        case OP_EQU:
+            return 4;
+        case OP_NE:
+            return 5;
+        default:
+            return -1;
+    }
+}
+
+// 交换操作数后的比较
+static const int cmp_swap[6] = {2, 3, 0, 1, 4, 5};
+// 取反后的比较
+static const int cmp_not[6] = {3, 2, 1, 0, 5, 4};
+
+// 三地址码到字节码的翻译
+// 只在相邻的指令之间合并，被合并掉的中间结果必须只使用一次
+class BCGen {
+private:
+    vector<uint8_t>  &code;
+    const IRFunction *fun;
+    // 临时寄存器
+    uint32_t scratch;
+    // 各寄存器被读的次数
+    vector<uint32_t> uses;
+    // 标号的代码偏移
+    vector<uint32_t> labels;
+    // 待回填的跳转目标，(位置, 标号)
+    vector<pair<size_t, uint32_t>> fixups;
+
+    void op(int _op) {
+        code.push_back(_op);
+        return;
+    }
+    void reg(uint32_t _reg) {
+        bc_put_uint(code, _reg);
+        return;
+    }
+    void imm(int32_t _val) {
+        bc_put_int(code, _val);
+        return;
+    }
+    void target(const IRArg &_label) {
+        fixups.push_back({code.size(), (uint32_t)_label.val});
+        code.insert(code.end(), 4, 0);
+        return;
+    }
+    // 操作数放入寄存器，不是寄存器时使用临时寄存器 _tmp
+    uint32_t to_reg(const IRArg &_arg, uint32_t _tmp) {
+        switch (_arg.kind) {
+            case ARG_REG:
+                return _arg.val;
+            case ARG_GLOBAL:
+                op(BC_LEAG);
+                reg(scratch + _tmp);
+                bc_put_uint(code, _arg.val);
+                break;
+            case ARG_FRAME:
+                op(BC_LEAF);
+                reg(scratch + _tmp);
+                bc_put_uint(code, _arg.val);
+                break;
+            default:
+                op(BC_LI);
+                reg(scratch + _tmp);
+                imm(_arg.val);
+                break;
+        }
+        return scratch + _tmp;
+    }
+    // 比较后跳转，_neg 为 true 时条件取反
+    void branch(const IRInst &_cmp, bool _neg, const IRArg &_label) {
+        int   cc = cmp_index(_cmp.op);
+        IRArg a = _cmp.arg1, b = _cmp.arg2;
+        if (a.is_imm() && b.is_imm() == false) {
+            swap(a, b);
+            cc = cmp_swap[cc];
+        }
+        if (_neg) {
+            cc = cmp_not[cc];
+        }
+        if (b.is_imm()) {
+            uint32_t ra = to_reg(a, 0);
+            op(BC_BLTI + cc);
+            reg(ra);
+            imm(b.val);
+        }
+        else {
+            uint32_t ra = to_reg(a, 0), rb = to_reg(b, 1);
+            op(BC_BLT + cc);
+            reg(ra);
+            reg(rb);
+        }
+        target(_label);
+        return;
+    }
+    // 是否为只使用一次的寄存器 _reg 乘以 4
+    bool scaled(const IRInst &_inst, const IRArg &_reg) {
+        return _inst.op == OP_MUL && _inst.result == _reg &&
+               uses[_reg.val] == 1 &&
+               ((_inst.arg1.is_reg() && _inst.arg2 == IRArg(ARG_IMM, 4)) ||
+                (_inst.arg2.is_reg() && _inst.arg1 == IRArg(ARG_IMM, 4)));
+    }
+    // 合并比较与跳转，返回合并的指令条数，不能合并时返回 0
+    size_t fuse_branch(size_t _idx) {
+        const IRInst &c = fun->code[_idx];
+        if (cmp_index(c.op) < 0 || _idx + 1 >= fun->code.size()) {
+            return 0;
+        }
+        const IRInst &j = fun->code[_idx + 1];
+        if ((j.op != OP_JT && j.op != OP_JF) || j.arg1 != c.result ||
+            uses[c.result.val] != 1) {
+            return 0;
+        }
+        branch(c, j.op == OP_JF, j.result);
+        return 2;
+    }
+    // 合并数组下标的计算与读写，返回合并的指令条数，不能合并时返回 0
+    size_t fuse_access(size_t _idx) {
+        auto &code_ = fun->code;
+        // p = base + idx * 4 后读写 p
+        if (_idx + 1 < code_.size() && code_[_idx + 1].op == OP_OFFSET &&
+            code_[_idx + 1].arg1.is_reg() &&
+            scaled(code_[_idx], code_[_idx + 1].arg2)) {
+            const IRInst &m    = code_[_idx];
+            const IRInst &o    = code_[_idx + 1];
+            uint32_t      idx  = m.arg1.is_reg() ? m.arg1.val : m.arg2.val;
+            uint32_t      base = o.arg1.val;
+            if (_idx + 2 < code_.size() && uses[o.result.val] == 1) {
+                const IRInst &a = code_[_idx + 2];
+                if (a.op == OP_GET && a.arg1 == o.result) {
+                    op(BC_LOADX);
+                    reg(a.result.val);
+                    reg(base);
+                    reg(idx);
+                    return 3;
+                }
+                if (a.op == OP_SET && a.arg1 == o.result) {
+                    uint32_t v = to_reg(a.result, 0);
+                    op(BC_STOREX);
+                    reg(v);
+                    reg(base);
+                    reg(idx);
+                    return 3;
+                }
+            }
+            op(BC_INDEX);
+            reg(o.result.val);
+            reg(base);
+            reg(idx);
+            return 2;
+        }
+        // p = base + imm 后读写 p
+        const IRInst &o = code_[_idx];
+        if (o.op == OP_OFFSET && o.arg1.is_reg() && o.arg2.is_imm() &&
+            _idx + 1 < code_.size() && uses[o.result.val] == 1) {
+            const IRInst &a = code_[_idx + 1];
+            if ((a.op == OP_GET || a.op == OP_SET) && a.arg1 == o.result) {
+                uint32_t v =
+                    a.op == OP_GET ? (uint32_t)a.result.val : to_reg(a.result, 0);
+                op(a.op == OP_GET ? BC_LOAD : BC_STORE);
+                reg(v);
+                reg(o.arg1.val);
+                imm(o.arg2.val);
+                return 2;
+            }
+        }
+        return 0;
+    }
+    void lower(const IRInst &_inst);
+
+public:
+    BCGen(BCModule &_bc) : code(_bc.code), fun(nullptr), scratch(0) {
+        return;
+    }
+    ~BCGen(void) {
+        return;
+    }
+    void lower_fun(const IRFunction &_fun, BCFunction &_out);
+};
+
+void BCGen::lower(const IRInst &_inst) {
+    uint32_t d = _inst.result.val;
+    IRArg    a = _inst.arg1, b = _inst.arg2;
+    switch (_inst.op) {
+        case OP_NOP:
+        case OP_LABEL:
+            break;
+        case OP_AS:
+            if (a.is_reg() == false) {
+                op(BC_LI);
+                reg(d);
+                imm(a.val);
+            }
+            else if ((uint32_t)a.val != d) {
+                op(BC_MOV);
+                reg(d);
+                reg(a.val);
+            }
+            break;
+        case OP_ADD:
+        case OP_MUL:
+        case OP_SUB:
+        case OP_DIV:
+        case OP_MOD: {
+            bool comm = _inst.op == OP_ADD || _inst.op == OP_MUL;
+            if (comm && a.is_imm() && b.is_reg()) {
+                swap(a, b);
+            }
+            // 减去立即数改为加上其相反数，立即数减去寄存器使用 RSUBI
+            if (_inst.op == OP_SUB && a.is_imm() && b.is_reg()) {
+                op(BC_RSUBI);
+                reg(d);
+                reg(b.val);
+                imm(a.val);
+                break;
+            }
+            if (b.is_imm()) {
+                int32_t  v  = _inst.op == OP_SUB ? (int32_t)(0u - (uint32_t)b.val)
+                                                 : b.val;
+                uint32_t ra = to_reg(a, 0);
+                op(_inst.op == OP_ADD || _inst.op == OP_SUB ? BC_ADDI
+                   : _inst.op == OP_MUL                     ? BC_MULI
+                   : _inst.op == OP_DIV                     ? BC_DIVI
+                                                            : BC_MODI);
+                reg(d);
+                reg(ra);
+                imm(v);
+                break;
+            }
+            uint32_t ra = to_reg(a, 0), rb = to_reg(b, 1);
+            op(_inst.op == OP_ADD   ? BC_ADD
+               : _inst.op == OP_SUB ? BC_SUB
+               : _inst.op == OP_MUL ? BC_MUL
+               : _inst.op == OP_DIV ? BC_DIV
+                                    : BC_MOD);
+            reg(d);
+            reg(ra);
+            reg(rb);
+            break;
+        }
+        case OP_NEG:
+        case OP_NOT: {
+            uint32_t ra = to_reg(a, 0);
+            op(_inst.op == OP_NEG ? BC_RSUBI : BC_NOT);
+            reg(d);
+            reg(ra);
+            if (_inst.op == OP_NEG) {
+                imm(0);
+            }
+            break;
+        }
+        case OP_GT:
+        case OP_GE:
+        case OP_LT:
+        case OP_LE:
+        case OP_EQU:
+        case OP_NE: {
+            int cc = cmp_index(_inst.op);
+            if (a.is_imm() && b.is_imm() == false) {
+                swap(a, b);
+                cc = cmp_swap[cc];
+            }
+            uint32_t ra = to_reg(a, 0);
+            if (b.is_imm()) {
+                op(BC_LTI + cc);
+                reg(d);
+                reg(ra);
+                imm(b.val);
+            }
+            else {
+                uint32_t rb = to_reg(b, 1);
+                op(BC_LT + cc);
+                reg(d);
+                reg(ra);
+                reg(rb);
+            }
+            break;
+        }
+        case OP_LEA:
+            op(a.kind == ARG_GLOBAL ? BC_LEAG : BC_LEAF);
+            reg(d);
+            bc_put_uint(code, a.val);
+            break;
+        case OP_OFFSET: {
+            uint32_t ra = to_reg(a, 0);
+            if (b.is_imm()) {
+                op(BC_OFFSETI);
+                reg(d);
+                reg(ra);
+                imm(b.val);
+            }
+            else {
+                uint32_t rb = to_reg(b, 1);
+                op(BC_OFFSET);
+                reg(d);
+                reg(ra);
+                reg(rb);
+            }
+            break;
+        }
+        case OP_SET: {
+            uint32_t v = to_reg(_inst.result, 0), ra = to_reg(a, 1);
+            op(BC_STORE);
+            reg(v);
+            reg(ra);
+            imm(0);
+            break;
+        }
+        case OP_GET: {
+            uint32_t ra = to_reg(a, 0);
+            op(BC_LOAD);
+            reg(d);
+            reg(ra);
+            imm(0);
+            break;
+        }
+        case OP_ZERO: {
+            uint32_t ra = to_reg(a, 0);
+            op(BC_ZERO);
+            reg(ra);
+            bc_put_uint(code, b.val);
+            break;
+        }
+        case OP_JMP:
+            op(BC_JMP);
+            target(_inst.result);
+            break;
+        case OP_JT:
+        case OP_JF:
+            if (a.is_imm()) {
+                if ((a.val != 0) == (_inst.op == OP_JT)) {
+                    op(BC_JMP);
+                    target(_inst.result);
+                }
+                break;
+            }
+            op(_inst.op == OP_JT ? BC_JT : BC_JF);
+            reg(a.val);
+            target(_inst.result);
+            break;
+        case OP_ARG:
+            if (a.is_imm()) {
+                op(BC_ARGI);
+                imm(a.val);
+            }
+            else {
+                uint32_t ra = to_reg(a, 0);
+                op(BC_ARG);
+                reg(ra);
+            }
+            break;
+        case OP_PROC:
+            op(BC_PROC);
+            bc_put_uint(code, a.val);
+            break;
+        case OP_CALL:
+            op(BC_CALL);
+            reg(d);
+            bc_put_uint(code, a.val);
+            break;
+        case OP_RET:
+            op(BC_RET);
+            break;
+        case OP_RETV:
+            if (a.is_imm()) {
+                op(BC_RETI);
+                imm(a.val);
+            }
+            else {
+                op(BC_RETV);
+                reg(a.val);
+            }
+            break;
+    }
+    return;
+}
+
+void BCGen::lower_fun(const IRFunction &_fun, BCFunction &_out) {
+    fun     = &_fun;
+    scratch = _fun.reg_cnt();
+    uses.assign(scratch, 0);
+    labels.assign(_fun.label_cnt, 0);
+    fixups.clear();
+    for (auto &i : _fun.code) {
+        for (auto a : {&i.arg1, &i.arg2}) {
+            if (a->is_reg()) {
+                uses[a->val]++;
+            }
+        }
+        // SET 的 result 是被写入的值
+        if (i.op == OP_SET && i.result.is_reg()) {
+            uses[i.result.val]++;
+        }
+    }
+    _out.reg_cnt    = scratch + 2;
+    _out.frame_size = _fun.frame_size;
+    _out.entry      = code.size();
+    // 标号可能在函数末尾，只有最后一条是无条件跳转或返回时才不补返回
+    bool ended = false;
+    for (size_t i = 0; i < _fun.code.size();) {
+        const IRInst &inst = _fun.code[i];
+        if (inst.op == OP_LABEL) {
+            labels[inst.result.val] = code.size();
+            ended                   = false;
+            i++;
+            continue;
+        }
+        size_t n = fuse_branch(i);
+        if (n == 0) {
+            n = fuse_access(i);
+        }
+        if (n == 0) {
+            lower(inst);
+            n = 1;
+        }
+        IROperator last = _fun.code[i + n - 1].op;
+        if (last != OP_NOP) {
+            ended = last == OP_JMP || last == OP_RET || last == OP_RETV;
+        }
+        i += n;
+    }
+    if (ended == false) {
+        if (_fun.void_flag) {
+            op(BC_RET);
+        }
+        else {
+            op(BC_RETI);
+            imm(0);
+        }
+    }
+    for (auto &f : fixups) {
+        uint32_t t = labels[f.second];
+        for (int k = 0; k < 4; k++) {
+            code[f.first + k] = t >> (8 * k);
+        }
+    }
+    _out.code_size = code.size() - _out.entry;
+    return;
+}
+
+void bc_lower(const IRModule &_module, BCModule &_bc) {
+    BCGen gen(_bc);
+    for (auto &g : _module.globals) {
+        BCGlobal bg;
+        bg.size = g.size;
+        bg.init = g.init;
+        _bc.globals.push_back(bg);
+    }
+    for (auto &f : _module.funs) {
+        BCFunction bf;
+        bf.name        = f.name;
+        bf.extern_flag = f.extern_flag;
+        bf.void_flag   = f.void_flag;
+        bf.param_cnt   = f.param_cnt;
+        bf.reg_cnt     = 0;
+        bf.frame_size  = 0;
+        bf.entry       = 0;
+        bf.code_size   = 0;
+        bf.runtime     = -1;
+        if (f.extern_flag == false) {
+            gen.lower_fun(f, bf);
+        }
+        _bc.funs.push_back(bf);
+    }
+    int main = _module.find_fun("main");
+    _bc.main = main < 0 ? _module.funs.size() : main;
+    return;
+}
@@ -0,0 +1,495 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// bcvm.cpp for Simple-XX/SimpleCompiler.
+
+#include "climits"
+#include "cstring"
+#include "bytecode.h"
+#include "simrt.h"
+
+using namespace std;
+
+// 保留的低地址，空指针落在其中
+static const size_t NULL_GUARD = 16;
+
+// 操作数的解码，代码已由 bc_read 校验
+static inline uint32_t get_u(const uint8_t *&_pc) {
+    uint32_t v = *_pc++;
+    if (v < 0x80) {
+        return v;
+    }
+    v &= 0x7f;
+    for (int shift = 7;; shift += 7) {
+        uint32_t b = *_pc++;
+        v |= (b & 0x7f) << shift;
+        if (b < 0x80) {
+            return v;
+        }
+    }
+}
+
+static inline int32_t get_i(const uint8_t *&_pc) {
+    uint32_t u = get_u(_pc);
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+static inline uint32_t get_t(const uint8_t *&_pc) {
+    uint32_t v = _pc[0] | (uint32_t)_pc[1] << 8 | (uint32_t)_pc[2] << 16 |
+                 (uint32_t)_pc[3] << 24;
+    _pc += 4;
+    return v;
+}
+
+BCVM::BCVM(const BCModule &_bc, istream &_in, ostream &_out)
+    : bc(_bc), in(_in), out(_out) {
+    mem_limit  = 256 << 20;
+    step_limit = 0;
+    memset(counts, 0, sizeof(counts));
+    return;
+}
+
+BCVM::~BCVM(void) {
+    return;
+}
+
+void BCVM::set_step_limit(uint64_t _limit) {
+    step_limit = _limit;
+    return;
+}
+
+void BCVM::set_mem_limit(size_t _limit) {
+    mem_limit = _limit;
+    return;
+}
+
+uint64_t BCVM::get_steps(void) const {
+    uint64_t steps = 0;
+    for (int i = 0; i < BC_CNT; i++) {
+        steps += counts[i];
+    }
+    return steps;
+}
+
+uint64_t BCVM::get_count(int _op) const {
+    return _op >= 0 && _op < BC_CNT ? counts[_op] : 0;
+}
+
+const string &BCVM::get_trap(void) const {
+    return trap;
+}
+
+// 各操作码的处理代码以 computed goto 直接跳转，不经过 switch 的范围检查
+// 寄存器栈扩容会使 r 失效，进入与返回函数后重新取得
+int BCVM::run(void) {
+    // 调用帧
+    struct Frame {
+        // 返回后继续执行的位置
+        const uint8_t *pc;
+        // 寄存器在寄存器栈中的起始位置
+        size_t reg_base;
+        // 栈帧在内存中的起始位置
+        size_t sp;
+        // 返回值写入调用者的寄存器，-1 表示不需要返回值
+        int64_t ret_reg;
+    };
+    static void *const table[] = {
+        &&op_mov,    &&op_li,      &&op_add,    &&op_sub,    &&op_mul,
+        &&op_div,    &&op_mod,     &&op_addi,   &&op_muli,   &&op_divi,
+        &&op_modi,   &&op_rsubi,   &&op_not,    &&op_lt,     &&op_le,
+        &&op_gt,     &&op_ge,      &&op_eq,     &&op_ne,     &&op_lti,
+        &&op_lei,    &&op_gti,     &&op_gei,    &&op_eqi,    &&op_nei,
+        &&op_leag,   &&op_leaf,    &&op_offset, &&op_offseti, &&op_index,
+        &&op_load,   &&op_store,   &&op_loadx,  &&op_storex, &&op_zero,
+        &&op_jmp,    &&op_jt,      &&op_jf,     &&op_blt,    &&op_ble,
+        &&op_bgt,    &&op_bge,     &&op_beq,    &&op_bne,    &&op_blti,
+        &&op_blei,   &&op_bgti,    &&op_bgei,   &&op_beqi,   &&op_bnei,
+        &&op_arg,    &&op_argi,    &&op_call,   &&op_proc,   &&op_ret,
+        &&op_retv,   &&op_reti,
+    };
+    static_assert(sizeof(table) / sizeof(table[0]) == BC_CNT,
+                  "dispatch table does not match bc_op_t");
+    memset(counts, 0, sizeof(counts));
+    trap.clear();
+    // 布置全局变量
+    size_t           top = NULL_GUARD;
+    vector<uint64_t> global_addr;
+    for (auto &g : bc.globals) {
+        global_addr.push_back(top);
+        top += ((size_t)g.size + 7) & ~(size_t)7;
+        if (top > mem_limit) {
+            trap = "out of memory";
+            return -1;
+        }
+    }
+    mem.assign(top, 0);
+    for (size_t i = 0; i < bc.globals.size(); i++) {
+        auto &init = bc.globals[i].init;
+        if (init.empty() == false) {
+            memcpy(&mem[global_addr[i]], init.data(), init.size() * 4);
+        }
+    }
+    const uint8_t  *code = bc.code.data();
+    const uint8_t  *pc   = NULL;
+    int64_t        *r    = NULL;
+    size_t          fp   = 0;
+    vector<Frame>   frames;
+    vector<int64_t> regs;
+    vector<int64_t> args;
+    int64_t         ret      = 0;
+    int64_t         ret_reg  = -1;
+    uint32_t        callee   = bc.main;
+    int64_t         exit_val = 0;
+    uint64_t        fuel     = step_limit != 0 ? step_limit : UINT64_MAX;
+    uint32_t        d, a, b;
+    int32_t         i;
+
+#define NEXT()                                                                 \
+    do {                                                                       \
+        uint8_t op_ = *pc++;                                                   \
+        counts[op_]++;                                                         \
+        goto *table[op_];                                                      \
+    } while (0)
+#define JUMP(_t)                                                               \
+    do {                                                                       \
+        uint32_t t_ = (_t);                                                    \
+        if (--fuel == 0) {                                                     \
+            goto limit;                                                        \
+        }                                                                      \
+        pc = code + t_;                                                        \
+    } while (0)
+#define ARITH(_expr)                                                           \
+    do {                                                                       \
+        d    = get_u(pc);                                                      \
+        a    = get_u(pc);                                                      \
+        b    = get_u(pc);                                                      \
+        r[d] = (int32_t)(uint32_t)(_expr);                                     \
+        NEXT();                                                                \
+    } while (0)
+#define ARITHI(_expr)                                                          \
+    do {                                                                       \
+        d    = get_u(pc);                                                      \
+        a    = get_u(pc);                                                      \
+        i    = get_i(pc);                                                      \
+        r[d] = (int32_t)(uint32_t)(_expr);                                     \
+        NEXT();                                                                \
+    } while (0)
+#define BRANCH(_cond)                                                          \
+    do {                                                                       \
+        a              = get_u(pc);                                            \
+        b              = get_u(pc);                                            \
+        uint32_t tgt_  = get_t(pc);                                            \
+        if (_cond) {                                                           \
+            JUMP(tgt_);                                                        \
+        }                                                                      \
+        NEXT();                                                                \
+    } while (0)
+#define BRANCHI(_cond)                                                         \
+    do {                                                                       \
+        a             = get_u(pc);                                             \
+        i             = get_i(pc);                                             \
+        uint32_t tgt_ = get_t(pc);                                             \
+        if (_cond) {                                                           \
+            JUMP(tgt_);                                                        \
+        }                                                                      \
+        NEXT();                                                                \
+    } while (0)
+#define CHECK(_addr, _size)                                                    \
+    do {                                                                       \
+        if ((_addr) < (int64_t)NULL_GUARD || (size_t)(_addr) + (_size) > top) { \
+            trap = "invalid memory access at " + to_string(_addr);             \
+            return -1;                                                         \
+        }                                                                      \
+    } while (0)
+#define RA ((int32_t)r[a])
+#define RB ((int32_t)r[b])
+
+enter : {
+    // 进入 callee，参数为 args 末尾的 param_cnt 个值
+    const BCFunction &fun = bc.funs[callee];
+    if (args.size() < fun.param_cnt) {
+        trap = "missing arguments to " + fun.name;
+        return -1;
+    }
+    // 寄存器栈与内存共用上限
+    if ((regs.size() + fun.reg_cnt) * sizeof(int64_t) > mem_limit) {
+        trap = "stack overflow";
+        return -1;
+    }
+    Frame frame;
+    frame.pc       = pc;
+    frame.reg_base = regs.size();
+    frame.sp       = top;
+    frame.ret_reg  = ret_reg;
+    regs.resize(regs.size() + fun.reg_cnt, 0);
+    size_t first = args.size() - fun.param_cnt;
+    for (uint32_t k = 0; k < fun.param_cnt; k++) {
+        regs[frame.reg_base + k] = args[first + k];
+    }
+    args.resize(first);
+    top += ((size_t)fun.frame_size + 7) & ~(size_t)7;
+    if (top > mem_limit) {
+        trap = "stack overflow";
+        return -1;
+    }
+    if (top > mem.size()) {
+        mem.resize(max(top, mem.size() * 2), 0);
+    }
+    frames.push_back(frame);
+    r  = &regs[frame.reg_base];
+    fp = frame.sp;
+    pc = code + fun.entry;
+    NEXT();
+}
+
+op_mov:
+    d    = get_u(pc);
+    r[d] = r[get_u(pc)];
+    NEXT();
+op_li:
+    d    = get_u(pc);
+    r[d] = get_i(pc);
+    NEXT();
+op_add:
+    ARITH((uint32_t)r[a] + (uint32_t)r[b]);
+op_sub:
+    ARITH((uint32_t)r[a] - (uint32_t)r[b]);
+op_mul:
+    ARITH((uint32_t)r[a] * (uint32_t)r[b]);
+op_div:
+op_mod: {
+    bool div = pc[-1] == BC_DIV;
+    d        = get_u(pc);
+    a        = get_u(pc);
+    b        = get_u(pc);
+    if (RB == 0 || (RA == INT_MIN && RB == -1)) {
+        trap = "integer division error";
+        return -1;
+    }
+    r[d] = div ? RA / RB : RA % RB;
+    NEXT();
+}
+op_addi:
+    ARITHI((uint32_t)r[a] + (uint32_t)i);
+op_muli:
+    ARITHI((uint32_t)r[a] * (uint32_t)i);
+op_divi:
+op_modi: {
+    bool div = pc[-1] == BC_DIVI;
+    d        = get_u(pc);
+    a        = get_u(pc);
+    i        = get_i(pc);
+    if (i == 0 || (RA == INT_MIN && i == -1)) {
+        trap = "integer division error";
+        return -1;
+    }
+    r[d] = div ? RA / i : RA % i;
+    NEXT();
+}
+op_rsubi:
+    ARITHI((uint32_t)i - (uint32_t)r[a]);
+op_not:
+    d    = get_u(pc);
+    a    = get_u(pc);
+    r[d] = RA == 0;
+    NEXT();
+op_lt:
+    ARITH(RA < RB);
+op_le:
+    ARITH(RA <= RB);
+op_gt:
+    ARITH(RA > RB);
+op_ge:
+    ARITH(RA >= RB);
+op_eq:
+    ARITH(RA == RB);
+op_ne:
+    ARITH(RA != RB);
+op_lti:
+    ARITHI(RA < i);
+op_lei:
+    ARITHI(RA <= i);
+op_gti:
+    ARITHI(RA > i);
+op_gei:
+    ARITHI(RA >= i);
+op_eqi:
+    ARITHI(RA == i);
+op_nei:
+    ARITHI(RA != i);
+op_leag:
+    d    = get_u(pc);
+    r[d] = global_addr[get_u(pc)];
+    NEXT();
+op_leaf:
+    d    = get_u(pc);
+    r[d] = fp + get_u(pc);
+    NEXT();
+op_offset:
+    d    = get_u(pc);
+    a    = get_u(pc);
+    b    = get_u(pc);
+    r[d] = r[a] + RB;
+    NEXT();
+op_offseti:
+    d    = get_u(pc);
+    a    = get_u(pc);
+    r[d] = r[a] + get_i(pc);
+    NEXT();
+op_index:
+    d    = get_u(pc);
+    a    = get_u(pc);
+    b    = get_u(pc);
+    r[d] = r[a] + (int32_t)((uint32_t)r[b] * 4);
+    NEXT();
+op_load:
+op_store:
+op_loadx:
+op_storex: {
+    uint8_t op   = pc[-1];
+    d            = get_u(pc);
+    a            = get_u(pc);
+    int64_t addr = r[a];
+    if (op == BC_LOAD || op == BC_STORE) {
+        addr += get_i(pc);
+    }
+    else {
+        addr += (int32_t)((uint32_t)r[get_u(pc)] * 4);
+    }
+    CHECK(addr, 4);
+    if (op == BC_LOAD || op == BC_LOADX) {
+        int32_t v;
+        memcpy(&v, &mem[addr], 4);
+        r[d] = v;
+    }
+    else {
+        int32_t v = r[d];
+        memcpy(&mem[addr], &v, 4);
+    }
+    NEXT();
+}
+op_zero: {
+    a            = get_u(pc);
+    size_t  size = get_u(pc);
+    int64_t addr = r[a];
+    CHECK(addr, size);
+    memset(&mem[addr], 0, size);
+    NEXT();
+}
+op_jmp:
+    JUMP(get_t(pc));
+    NEXT();
+op_jt:
+op_jf: {
+    bool jt  = pc[-1] == BC_JT;
+    a        = get_u(pc);
+    uint32_t t = get_t(pc);
+    if ((RA != 0) == jt) {
+        JUMP(t);
+    }
+    NEXT();
+}
+op_blt:
+    BRANCH(RA < RB);
+op_ble:
+    BRANCH(RA <= RB);
+op_bgt:
+    BRANCH(RA > RB);
+op_bge:
+    BRANCH(RA >= RB);
+op_beq:
+    BRANCH(RA == RB);
+op_bne:
+    BRANCH(RA != RB);
+op_blti:
+    BRANCHI(RA < i);
+op_blei:
+    BRANCHI(RA <= i);
+op_bgti:
+    BRANCHI(RA > i);
+op_bgei:
+    BRANCHI(RA >= i);
+op_beqi:
+    BRANCHI(RA == i);
+op_bnei:
+    BRANCHI(RA != i);
+op_arg:
+    args.push_back(r[get_u(pc)]);
+    NEXT();
+op_argi:
+    args.push_back(get_i(pc));
+    NEXT();
+op_call:
+    ret_reg = get_u(pc);
+    callee  = get_u(pc);
+    goto call;
+op_proc:
+    ret_reg = -1;
+    callee  = get_u(pc);
+call : {
+    if (--fuel == 0) {
+        goto limit;
+    }
+    const BCFunction &fun = bc.funs[callee];
+    if (fun.extern_flag == false) {
+        goto enter;
+    }
+    if (args.size() < fun.param_cnt) {
+        trap = "missing arguments to " + fun.name;
+        return -1;
+    }
+    size_t  first   = args.size() - fun.param_cnt;
+    int64_t argv[2] = {0, 0};
+    for (uint32_t k = 0; k < fun.param_cnt; k++) {
+        argv[k] = args[first + k];
+    }
+    args.resize(first);
+    if (sim_runtime_call(fun.runtime, argv, ret, mem, 0, in, out, trap) ==
+        false) {
+        return -1;
+    }
+    if (ret_reg >= 0) {
+        r[ret_reg] = (int32_t)ret;
+    }
+    NEXT();
+}
+op_ret:
+    ret = 0;
+    goto leave;
+op_retv:
+    ret = r[get_u(pc)];
+    goto leave;
+op_reti:
+    ret = get_i(pc);
+leave : {
+    Frame frame = frames.back();
+    top         = frame.sp;
+    regs.resize(frame.reg_base);
+    frames.pop_back();
+    if (frames.empty()) {
+        exit_val = ret;
+        out.flush();
+        return exit_val & 0xff;
+    }
+    r  = &regs[frames.back().reg_base];
+    fp = frames.back().sp;
+    pc = frame.pc;
+    if (frame.ret_reg >= 0) {
+        r[frame.ret_reg] = ret;
+    }
+    NEXT();
+}
+limit:
+    trap = "step limit exceeded";
+    return -1;
+
+#undef NEXT
+#undef JUMP
+#undef ARITH
+#undef ARITHI
+#undef BRANCH
+#undef BRANCHI
+#undef CHECK
+#undef RA
+#undef RB
+}
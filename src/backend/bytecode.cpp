@@ -0,0 +1,348 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// bytecode.cpp for Simple-XX/SimpleCompiler.
+
+#include "sstream"
+#include "bytecode.h"
+#include "simrt.h"
+
+using namespace std;
+
+// 文件头
+static const char    BC_MAGIC[4] = {'S', 'C', 'B', 'C'};
+static const uint8_t BC_VERSION  = 1;
+
+// 名字与操作数格式，r 为寄存器，i 为立即数，n 为编号或大小，t 为跳转目标
+static const struct {
+    const char *name;
+    const char *format;
+} bc_info[BC_CNT] = {
+    {"mov", "rr"},      {"li", "ri"},       {"add", "rrr"},
+    {"sub", "rrr"},     {"mul", "rrr"},     {"div", "rrr"},
+    {"mod", "rrr"},     {"addi", "rri"},    {"muli", "rri"},
+    {"divi", "rri"},    {"modi", "rri"},    {"rsubi", "rri"},
+    {"not", "rr"},      {"lt", "rrr"},      {"le", "rrr"},
+    {"gt", "rrr"},      {"ge", "rrr"},      {"eq", "rrr"},
+    {"ne", "rrr"},      {"lti", "rri"},     {"lei", "rri"},
+    {"gti", "rri"},     {"gei", "rri"},     {"eqi", "rri"},
+    {"nei", "rri"},     {"leag", "rn"},     {"leaf", "rn"},
+    {"offset", "rrr"},  {"offseti", "rri"}, {"index", "rrr"},
+    {"load", "rri"},    {"store", "rri"},   {"loadx", "rrr"},
+    {"storex", "rrr"},  {"zero", "rn"},     {"jmp", "t"},
+    {"jt", "rt"},       {"jf", "rt"},       {"blt", "rrt"},
+    {"ble", "rrt"},     {"bgt", "rrt"},     {"bge", "rrt"},
+    {"beq", "rrt"},     {"bne", "rrt"},     {"blti", "rit"},
+    {"blei", "rit"},    {"bgti", "rit"},    {"bgei", "rit"},
+    {"beqi", "rit"},    {"bnei", "rit"},    {"arg", "r"},
+    {"argi", "i"},      {"call", "rn"},     {"proc", "n"},
+    {"ret", ""},        {"retv", "r"},      {"reti", "i"},
+};
+
+const char *bc_name(int _op) {
+    return _op >= 0 && _op < BC_CNT ? bc_info[_op].name : "?";
+}
+
+void bc_put_uint(vector<uint8_t> &_out, uint32_t _val) {
+    while (_val >= 0x80) {
+        _out.push_back((_val & 0x7f) | 0x80);
+        _val >>= 7;
+    }
+    _out.push_back(_val);
+    return;
+}
+
+void bc_put_int(vector<uint8_t> &_out, int32_t _val) {
+    bc_put_uint(_out, ((uint32_t)_val << 1) ^ (uint32_t)(_val >> 31));
+    return;
+}
+
+string bc_write(const BCModule &_bc) {
+    vector<uint8_t> out(BC_MAGIC, BC_MAGIC + 4);
+    out.push_back(BC_VERSION);
+    bc_put_uint(out, _bc.globals.size());
+    for (auto &g : _bc.globals) {
+        bc_put_uint(out, g.size);
+        bc_put_uint(out, g.init.size());
+        for (auto v : g.init) {
+            bc_put_int(out, v);
+        }
+    }
+    bc_put_uint(out, _bc.funs.size());
+    for (auto &f : _bc.funs) {
+        bc_put_uint(out, f.name.size());
+        out.insert(out.end(), f.name.begin(), f.name.end());
+        out.push_back((f.extern_flag ? 1 : 0) | (f.void_flag ? 2 : 0));
+        bc_put_uint(out, f.param_cnt);
+        bc_put_uint(out, f.reg_cnt);
+        bc_put_uint(out, f.frame_size);
+        bc_put_uint(out, f.entry);
+        bc_put_uint(out, f.code_size);
+    }
+    bc_put_uint(out, _bc.main);
+    bc_put_uint(out, _bc.code.size());
+    out.insert(out.end(), _bc.code.begin(), _bc.code.end());
+    return string(out.begin(), out.end());
+}
+
+// 按字节读入，越界时记录错误
+class BCReader {
+private:
+    const uint8_t *data;
+    size_t         size;
+    size_t         pos;
+
+public:
+    bool ok;
+
+    BCReader(const uint8_t *_data, size_t _size)
+        : data(_data), size(_size), pos(0), ok(true) {
+        return;
+    }
+    ~BCReader(void) {
+        return;
+    }
+    size_t get_pos(void) const {
+        return pos;
+    }
+    uint8_t byte(void) {
+        if (pos >= size) {
+            ok = false;
+            return 0;
+        }
+        return data[pos++];
+    }
+    // 最多 5 个字节，超出 32 位时出错
+    uint32_t uint(void) {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t b = byte();
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (b < 0x80) {
+                if (v > UINT32_MAX) {
+                    ok = false;
+                }
+                return v;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+    int32_t sint(void) {
+        uint32_t u = uint();
+        return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+    }
+    uint32_t target(void) {
+        uint32_t v = byte();
+        v |= (uint32_t)byte() << 8;
+        v |= (uint32_t)byte() << 16;
+        v |= (uint32_t)byte() << 24;
+        return v;
+    }
+    const uint8_t *bytes(size_t _len) {
+        if (size - pos < _len) {
+            ok = false;
+            return data;
+        }
+        pos += _len;
+        return data + pos - _len;
+    }
+};
+
+// 校验一个函数的代码，虚拟机依赖校验的结果，执行时不再检查
+static bool check_fun(const BCModule &_bc, const BCFunction &_fun,
+                      string &_err) {
+    BCReader         rd(_bc.code.data() + _fun.entry, _fun.code_size);
+    vector<bool>     start(_fun.code_size + 1, false);
+    vector<uint32_t> targets;
+    int              last = -1;
+    while (rd.ok && rd.get_pos() < _fun.code_size) {
+        start[rd.get_pos()] = true;
+        last                = rd.byte();
+        if (last >= BC_CNT) {
+            _err = "invalid opcode in " + _fun.name;
+            return false;
+        }
+        for (const char *f = bc_info[last].format; *f != '\0'; f++) {
+            switch (*f) {
+                case 'r':
+                    if (rd.uint() >= _fun.reg_cnt) {
+                        _err = "invalid register in " + _fun.name;
+                        return false;
+                    }
+                    break;
+                case 'i':
+                    rd.sint();
+                    break;
+                case 't':
+                    targets.push_back(rd.target());
+                    break;
+                case 'n': {
+                    uint32_t n = rd.uint();
+                    bool     bad =
+                        (last == BC_LEAG && n >= _bc.globals.size()) ||
+                        ((last == BC_CALL || last == BC_PROC) &&
+                         n >= _bc.funs.size());
+                    if (bad) {
+                        _err = "invalid index in " + _fun.name;
+                        return false;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    if (rd.ok == false) {
+        _err = "truncated instruction in " + _fun.name;
+        return false;
+    }
+    // 最后一条指令不能落到函数之外
+    if (last != BC_JMP && last != BC_RET && last != BC_RETV && last != BC_RETI) {
+        _err = "missing return in " + _fun.name;
+        return false;
+    }
+    for (auto t : targets) {
+        if (t < _fun.entry || t - _fun.entry >= _fun.code_size ||
+            start[t - _fun.entry] == false) {
+            _err = "invalid jump target in " + _fun.name;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool bc_read(const string &_data, BCModule &_bc, string &_err) {
+    BCReader rd((const uint8_t *)_data.data(), _data.size());
+    if (_data.compare(0, 4, string(BC_MAGIC, 4)) != 0) {
+        _err = "not a bytecode file";
+        return false;
+    }
+    rd.bytes(4);
+    if (rd.byte() != BC_VERSION) {
+        _err = "unsupported bytecode version";
+        return false;
+    }
+    _bc = BCModule();
+    // 个数来自文件，逐个读入，不预先分配
+    uint32_t cnt = rd.uint();
+    for (uint32_t i = 0; rd.ok && i < cnt; i++) {
+        BCGlobal g;
+        g.size     = rd.uint();
+        uint32_t n = rd.uint();
+        if (n > g.size / 4) {
+            _err = "invalid global initializer";
+            return false;
+        }
+        for (uint32_t k = 0; rd.ok && k < n; k++) {
+            g.init.push_back(rd.sint());
+        }
+        _bc.globals.push_back(g);
+    }
+    cnt = rd.uint();
+    for (uint32_t i = 0; rd.ok && i < cnt; i++) {
+        BCFunction f;
+        uint32_t   len   = rd.uint();
+        const char *name = (const char *)rd.bytes(len);
+        if (rd.ok) {
+            f.name = string(name, len);
+        }
+        uint8_t flags = rd.byte();
+        f.extern_flag = flags & 1;
+        f.void_flag   = flags & 2;
+        f.param_cnt   = rd.uint();
+        f.reg_cnt     = rd.uint();
+        f.frame_size  = rd.uint();
+        f.entry       = rd.uint();
+        f.code_size   = rd.uint();
+        f.runtime     = -1;
+        _bc.funs.push_back(f);
+    }
+    _bc.main        = rd.uint();
+    uint32_t size   = rd.uint();
+    const uint8_t *code = rd.bytes(size);
+    if (rd.ok == false) {
+        _err = "truncated bytecode file";
+        return false;
+    }
+    _bc.code.assign(code, code + size);
+    if (_bc.main >= _bc.funs.size() || _bc.funs[_bc.main].extern_flag) {
+        _err = "undefined function main";
+        return false;
+    }
+    for (auto &f : _bc.funs) {
+        if (f.extern_flag) {
+            f.runtime = sim_runtime_index(f.name);
+            if (f.runtime < 0) {
+                _err = "undefined function " + f.name;
+                return false;
+            }
+            // 运行时函数最多两个参数
+            if (f.param_cnt > 2) {
+                _err = "invalid parameter count of " + f.name;
+                return false;
+            }
+            continue;
+        }
+        if (f.param_cnt > f.reg_cnt || f.entry > size ||
+            f.code_size > size - f.entry) {
+            _err = "invalid function " + f.name;
+            return false;
+        }
+        if (check_fun(_bc, f, _err) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+string bc_dump(const BCModule &_bc) {
+    ostringstream os;
+    for (size_t i = 0; i < _bc.globals.size(); i++) {
+        os << "global @" << i << " [" << _bc.globals[i].size << "]\n";
+    }
+    for (auto &f : _bc.funs) {
+        if (f.extern_flag) {
+            continue;
+        }
+        os << "\nfunction " << f.name << " params " << f.param_cnt << " regs "
+           << f.reg_cnt << " frame " << f.frame_size << "\n";
+        BCReader rd(_bc.code.data() + f.entry, f.code_size);
+        while (rd.ok && rd.get_pos() < f.code_size) {
+            os << "  " << f.entry + rd.get_pos() << ":\t";
+            int op = rd.byte();
+            os << bc_name(op);
+            const char *sep = "\t";
+            for (const char *p = op < BC_CNT ? bc_info[op].format : "";
+                 *p != '\0'; p++, sep = ", ") {
+                os << sep;
+                switch (*p) {
+                    case 'r':
+                        os << "r" << rd.uint();
+                        break;
+                    case 'i':
+                        os << rd.sint();
+                        break;
+                    case 't':
+                        os << "-> " << rd.target();
+                        break;
+                    case 'n': {
+                        uint32_t n = rd.uint();
+                        if ((op == BC_CALL || op == BC_PROC) &&
+                            n < _bc.funs.size()) {
+                            os << _bc.funs[n].name;
+                        }
+                        else if (op == BC_LEAG) {
+                            os << "@" << n;
+                        }
+                        else {
+                            os << n;
+                        }
+                        break;
+                    }
+                }
+            }
+            os << "\n";
+        }
+    }
+    return os.str();
+}
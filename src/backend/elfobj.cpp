@@ -0,0 +1,195 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// elfobj.cpp for Simple-XX/SimpleCompiler.
+
+#include "cstring"
+#include "elf.h"
+#include "elfobj.h"
+
+using namespace std;
+
+// 节头表中的下标，顺序与 elf_section_t 一致
+enum {
+    SH_TEXT = 1,
+    SH_DATA,
+    SH_RODATA,
+    SH_BSS,
+    SH_SYMTAB,
+    SH_STRTAB,
+    SH_RELA,
+    SH_NOTE,
+    SH_SHSTRTAB,
+    SH_CNT,
+};
+
+ElfObject::ElfObject(uint16_t _machine, uint32_t _flags)
+    : machine(_machine), flags(_flags), bss_size(0) {
+    return;
+}
+
+ElfObject::~ElfObject(void) {
+    return;
+}
+
+uint32_t ElfObject::symbol(const string &_name) {
+    auto it = names.find(_name);
+    if (it != names.end()) {
+        return it->second;
+    }
+    syms.push_back({_name, SEC_UNDEF, 0, 0, false, true});
+    names[_name] = syms.size() - 1;
+    return syms.size() - 1;
+}
+
+void ElfObject::define(uint32_t _sym, elf_section_t _section, uint64_t _value,
+                       uint64_t _size, bool _func) {
+    syms[_sym].section = _section;
+    syms[_sym].value   = _value;
+    syms[_sym].size    = _size;
+    syms[_sym].func    = _func;
+    return;
+}
+
+uint32_t ElfObject::local(const string &_name, elf_section_t _section,
+                          uint64_t _value) {
+    syms.push_back({_name, _section, _value, 0, false, false});
+    return syms.size() - 1;
+}
+
+void ElfObject::reloc(uint64_t _offset, uint32_t _sym, uint32_t _type,
+                      int64_t _addend) {
+    relocs.push_back({_offset, _sym, _type, _addend});
+    return;
+}
+
+void ElfObject::align(string &_sec, size_t _align, char _fill) {
+    _sec.append((_align - _sec.size() % _align) % _align, _fill);
+    return;
+}
+
+// 追加一个结构体
+template <class T>
+static void put(string &_out, const T &_val) {
+    _out.append((const char *)&_val, sizeof(T));
+    return;
+}
+
+// 字符串表中追加一个名字，返回其偏移
+static uint32_t add_str(string &_tab, const string &_name) {
+    uint32_t off = _tab.size();
+    _tab += _name;
+    _tab += '\0';
+    return off;
+}
+
+// 布局：ELF 头、各节内容、节头表
+// 符号表中局部符号必须在全局符号之前，输出时重排，重定位中的下标随之改变
+string ElfObject::write(void) const {
+    // 0 号为空符号，之后为局部符号与全局符号
+    vector<uint32_t> order;
+    for (uint32_t i = 0; i < syms.size(); i++) {
+        if (syms[i].global == false) {
+            order.push_back(i);
+        }
+    }
+    uint32_t first_global = order.size() + 1;
+    for (uint32_t i = 0; i < syms.size(); i++) {
+        if (syms[i].global) {
+            order.push_back(i);
+        }
+    }
+    vector<uint32_t> index(syms.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        index[order[i]] = i + 1;
+    }
+    string strtab(1, '\0');
+    string symtab;
+    put(symtab, Elf64_Sym{});
+    for (auto i : order) {
+        const Symbol &s = syms[i];
+        Elf64_Sym     sym;
+        memset(&sym, 0, sizeof(sym));
+        sym.st_name  = add_str(strtab, s.name);
+        sym.st_info  = ELF64_ST_INFO(s.global ? STB_GLOBAL : STB_LOCAL,
+                                    s.section == SEC_UNDEF ? STT_NOTYPE
+                                    : s.func               ? STT_FUNC
+                                    : s.global             ? STT_OBJECT
+                                                           : STT_NOTYPE);
+        sym.st_shndx = s.section;
+        sym.st_value = s.value;
+        sym.st_size  = s.size;
+        put(symtab, sym);
+    }
+    string rela;
+    for (auto &r : relocs) {
+        Elf64_Rela rel;
+        rel.r_offset = r.offset;
+        rel.r_info   = ELF64_R_INFO(index[r.sym], r.type);
+        rel.r_addend = r.addend;
+        put(rela, rel);
+    }
+    string     shstrtab(1, '\0');
+    string     out(sizeof(Elf64_Ehdr), '\0');
+    Elf64_Shdr sh[SH_CNT];
+    memset(sh, 0, sizeof(sh));
+    // 填写一个节头，内容追加到输出中
+    auto add = [&](int _idx, const char *_name, uint32_t _type, uint64_t _flags,
+                   const string *_body, uint64_t _size, uint64_t _align) {
+        ElfObject::align(out, _align);
+        sh[_idx].sh_name      = add_str(shstrtab, _name);
+        sh[_idx].sh_type      = _type;
+        sh[_idx].sh_flags     = _flags;
+        sh[_idx].sh_offset    = out.size();
+        sh[_idx].sh_size      = _body != NULL ? _body->size() : _size;
+        sh[_idx].sh_addralign = _align;
+        if (_body != NULL) {
+            out += *_body;
+        }
+    };
+    add(SH_TEXT, ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, &text, 0, 16);
+    add(SH_DATA, ".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, &data, 0, 8);
+    add(SH_RODATA, ".rodata", SHT_PROGBITS, SHF_ALLOC, &rodata, 0, 8);
+    add(SH_BSS, ".bss", SHT_NOBITS, SHF_ALLOC | SHF_WRITE, NULL, bss_size, 8);
+    add(SH_SYMTAB, ".symtab", SHT_SYMTAB, 0, &symtab, 0, 8);
+    sh[SH_SYMTAB].sh_link    = SH_STRTAB;
+    sh[SH_SYMTAB].sh_info    = first_global;
+    sh[SH_SYMTAB].sh_entsize = sizeof(Elf64_Sym);
+    add(SH_STRTAB, ".strtab", SHT_STRTAB, 0, &strtab, 0, 1);
+    add(SH_RELA, ".rela.text", SHT_RELA, SHF_INFO_LINK, &rela, 0, 8);
+    sh[SH_RELA].sh_link    = SH_SYMTAB;
+    sh[SH_RELA].sh_info    = SH_TEXT;
+    sh[SH_RELA].sh_entsize = sizeof(Elf64_Rela);
+    // 栈不可执行
+    add(SH_NOTE, ".note.GNU-stack", SHT_PROGBITS, 0, NULL, 0, 1);
+    // 名字先加入 .shstrtab 再输出其内容
+    sh[SH_SHSTRTAB].sh_name      = add_str(shstrtab, ".shstrtab");
+    sh[SH_SHSTRTAB].sh_type      = SHT_STRTAB;
+    sh[SH_SHSTRTAB].sh_offset    = out.size();
+    sh[SH_SHSTRTAB].sh_size      = shstrtab.size();
+    sh[SH_SHSTRTAB].sh_addralign = 1;
+    out += shstrtab;
+    ElfObject::align(out, 8);
+    uint64_t shoff = out.size();
+    for (int i = 0; i < SH_CNT; i++) {
+        put(out, sh[i]);
+    }
+    Elf64_Ehdr eh;
+    memset(&eh, 0, sizeof(eh));
+    memcpy(eh.e_ident, ELFMAG, SELFMAG);
+    eh.e_ident[EI_CLASS]   = ELFCLASS64;
+    eh.e_ident[EI_DATA]    = ELFDATA2LSB;
+    eh.e_ident[EI_VERSION] = EV_CURRENT;
+    eh.e_ident[EI_OSABI]   = ELFOSABI_NONE;
+    eh.e_type              = ET_REL;
+    eh.e_machine           = machine;
+    eh.e_version           = EV_CURRENT;
+    eh.e_flags             = flags;
+    eh.e_ehsize            = sizeof(Elf64_Ehdr);
+    eh.e_shoff             = shoff;
+    eh.e_shentsize         = sizeof(Elf64_Shdr);
+    eh.e_shnum             = SH_CNT;
+    eh.e_shstrndx          = SH_SHSTRTAB;
+    memcpy(&out[0], &eh, sizeof(eh));
+    return out;
+}
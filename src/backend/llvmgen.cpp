@@ -0,0 +1,705 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// llvmgen.cpp for Simple-XX/SimpleCompiler.
+
+#include "llvmgen.h"
+#include "irgen.h"
+
+LLVMGen::LLVMGen(SymTab &_symtab)
+    : symtab(_symtab), types(_symtab.get_types()) {
+    in_fun      = false;
+    void_fun    = false;
+    terminated  = false;
+    tmp_cnt     = 0;
+    label_cnt   = 0;
+    need_memset = false;
+    return;
+}
+
+LLVMGen::~LLVMGen(void) {
+    return;
+}
+
+string LLVMGen::generate(MetaAST &_prog) {
+    memo.clear();
+    walk(_prog);
+    if (need_memset) {
+        decls << "declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i1)\n";
+    }
+    string res = globals.str();
+    if (res.empty() == false) {
+        res += "\n";
+    }
+    res += funs.str();
+    if (decls.str().empty() == false) {
+        res += decls.str();
+    }
+    return res;
+}
+
+string &LLVMGen::storage_of(pool_id_t _sym) {
+    if (_sym >= storage.size()) {
+        storage.resize(_sym + 1);
+    }
+    return storage[_sym];
+}
+
+string LLVMGen::new_tmp(void) {
+    return "%t" + to_string(tmp_cnt++);
+}
+
+string LLVMGen::new_label(void) {
+    return "L" + to_string(label_cnt++);
+}
+
+void LLVMGen::inst(const string &_inst) {
+    if (terminated) {
+        label(new_label());
+    }
+    body << "  " << _inst << "\n";
+    return;
+}
+
+void LLVMGen::terminate(const string &_inst) {
+    inst(_inst);
+    terminated = true;
+    return;
+}
+
+void LLVMGen::label(const string &_label) {
+    if (terminated == false) {
+        body << "  br label %" << _label << "\n";
+    }
+    body << _label << ":\n";
+    terminated = false;
+    return;
+}
+
+string LLVMGen::type_of(const TypeInfo &_type, size_t _level) {
+    string res = "i32";
+    for (size_t i = _type.dims.size(); i > _level; i--) {
+        res = "[" + to_string(_type.dims[i - 1]) + " x " + res + "]";
+    }
+    return res;
+}
+
+// 全为 0 的部分用 zeroinitializer
+string LLVMGen::const_array(const TypeInfo &_type, size_t _level,
+                            uint32_t _pos, const vector<int> &_vals) {
+    string   type = type_of(_type, _level);
+    uint32_t len  = _level < _type.dims.size()
+                        ? _type.dims[_level] * _type.strides[_level]
+                        : 1;
+    bool     zero = true;
+    for (uint32_t i = _pos; i < _pos + len && i < _vals.size(); i++) {
+        if (_vals[i] != 0) {
+            zero = false;
+            break;
+        }
+    }
+    if (_level == _type.dims.size()) {
+        return type + " " + to_string(_vals[_pos]);
+    }
+    if (zero) {
+        return type + " zeroinitializer";
+    }
+    string res = type + " [";
+    for (uint32_t i = 0; i < _type.dims[_level]; i++) {
+        if (i != 0) {
+            res += ", ";
+        }
+        res += const_array(_type, _level + 1, _pos + i * _type.strides[_level],
+                           _vals);
+    }
+    return res + "]";
+}
+
+string LLVMGen::param_type(Variable *_param) {
+    if (types.is_array(_param->get_type_id()) == false) {
+        return "i32";
+    }
+    return type_of(types.at(_param->get_type_id()), 1) + "*";
+}
+
+// 求值前先查常量，常量直接得到其文字，不进入子结点
+void LLVMGen::expr(MetaAST &_exp) {
+    int val;
+    if (eval_const(symtab, &_exp, val, &memo)) {
+        value = to_string(val);
+        resume();
+        return;
+    }
+    value = "";
+    descend(_exp);
+    return;
+}
+
+// 生成条件跳转，目标由访问的结点取出
+void LLVMGen::cond(MetaAST &_exp, const string &_true, const string &_false) {
+    conds.push_back({_true, _false});
+    descend(_exp, WALK_COND);
+    return;
+}
+
+bool LLVMGen::const_branch(MetaAST &_exp) {
+    int val;
+    if (eval_const(symtab, &_exp, val, &memo) == false) {
+        return false;
+    }
+    terminate("br label %" + (val ? conds.back().first : conds.back().second));
+    conds.pop_back();
+    return true;
+}
+
+void LLVMGen::branch(MetaAST &_exp) {
+    if (step() == 0) {
+        if (const_branch(_exp) == false) {
+            expr(_exp);
+        }
+        return;
+    }
+    string c = new_tmp();
+    inst(c + " = icmp ne i32 " + value + ", 0");
+    compared(c);
+    return;
+}
+
+// 条件中直接用 icmp 的结果跳转
+void LLVMGen::compared(const string &_cmp) {
+    if (mode() == WALK_COND) {
+        terminate("br i1 " + _cmp + ", label %" + conds.back().first +
+                  ", label %" + conds.back().second);
+        conds.pop_back();
+        return;
+    }
+    value = new_tmp();
+    inst(value + " = zext i1 " + _cmp + " to i32");
+    return;
+}
+
+void LLVMGen::visit(CompUnitAST &ast) {
+    if (step() < ast.get_units().size()) {
+        descend(*ast.get_units()[step()]);
+    }
+    return;
+}
+
+void LLVMGen::visit(StmtAST &ast) {
+    if (step() == 0) {
+        descend(*ast.get_stmt());
+    }
+    return;
+}
+
+void LLVMGen::visit(FuncDefAST &ast) {
+    auto &stmts = static_cast<BlockAST &>(*ast.get_body()).get_stmts();
+    if (step() == 0) {
+        in_fun     = true;
+        void_fun   = ast.get_type() == Type::void_t;
+        terminated = false;
+        tmp_cnt    = 0;
+        label_cnt  = 0;
+        allocas.str("");
+        body.str("");
+        funs << "define " << (void_fun ? "void" : "i32") << " @"
+             << ast.get_name() << "(";
+        // 标量参数存入 alloca，数组参数直接使用传入的指针
+        bool first = true;
+        for (auto &param : ast.get_params()) {
+            IdAST &id  = static_cast<IdAST &>(*param);
+            string arg = "%" + id.get_name() + ".arg";
+            if (first == false) {
+                funs << ", ";
+            }
+            first = false;
+            if (types.is_array(id.get_tid())) {
+                funs << type_of(types.at(id.get_tid()), 1) << "* " << arg;
+                storage_of(id.get_sym()) = arg;
+                continue;
+            }
+            funs << "i32 " << arg;
+            string slot = "%" + id.get_name() + "." + to_string(tmp_cnt++);
+            allocas << "  " << slot << " = alloca i32\n";
+            inst("store i32 " + arg + ", i32* " + slot);
+            storage_of(id.get_sym()) = slot;
+        }
+        funs << ") {\n";
+    }
+    if (step() < stmts.size()) {
+        descend(*stmts[step()]);
+        return;
+    }
+    // 补上返回语句
+    if (terminated == false) {
+        terminate(void_fun ? "ret void" : "ret i32 0");
+    }
+    funs << "entry:\n" << allocas.str() << body.str() << "}\n\n";
+    in_fun = false;
+    memo.clear();
+    return;
+}
+
+// 实参列表在求各实参期间放在 strs 中
+void LLVMGen::visit(FuncCallAST &ast) {
+    if (mode() == WALK_COND) {
+        branch(ast);
+        return;
+    }
+    Function *f    = symtab.fun_at(ast.get_sym());
+    auto     &pars = f->get_paralist();
+    if (step() == 0) {
+        strs.push_back("");
+    }
+    else {
+        if (step() != 1) {
+            strs.back() += ", ";
+        }
+        strs.back() += param_type(pars[step() - 1]) + " " + value;
+    }
+    if (step() < ast.get_args().size()) {
+        expr(*ast.get_args()[step()]);
+        return;
+    }
+    string args = strs.back();
+    strs.pop_back();
+    bool   void_flag = f->get_type() == KW_VOID;
+    string ret       = void_flag ? "void" : "i32";
+    // 外部函数在第一次调用时声明
+    if (f->get_extern_flag()) {
+        if (ast.get_sym() >= declared.size()) {
+            declared.resize(ast.get_sym() + 1, false);
+        }
+        if (declared[ast.get_sym()] == false) {
+            declared[ast.get_sym()] = true;
+            decls << "declare " << ret << " @" << f->get_name() << "(";
+            for (size_t i = 0; i < pars.size(); i++) {
+                decls << (i != 0 ? ", " : "") << param_type(pars[i]);
+            }
+            decls << ")\n";
+        }
+    }
+    string call = "call " + ret + " @" + f->get_name() + "(" + args + ")";
+    if (void_flag) {
+        inst(call);
+        value = "0";
+    }
+    else {
+        value = new_tmp();
+        inst(value + " = " + call);
+    }
+    return;
+}
+
+void LLVMGen::visit(VarDeclAST &ast) {
+    if (step() < ast.get_vars().size()) {
+        descend(*ast.get_vars()[step()]);
+    }
+    return;
+}
+
+// 初始值由 expr 逐个生成
+void LLVMGen::visit(VarDefAST &ast) {
+    IdAST          &id       = static_cast<IdAST &>(*ast.get_var());
+    const TypeInfo &type     = types.at(id.get_tid());
+    bool            is_array = types.is_array(id.get_tid());
+    // 常量标量在使用处直接替换为值
+    if (ast.is_const() && is_array == false) {
+        return;
+    }
+    // 局部标量
+    if (step() > 0 && is_array == false) {
+        inst("store i32 " + value + ", i32* " + storage_of(id.get_sym()));
+        return;
+    }
+    // 局部数组的一个初始值，0 已由清零得到
+    if (step() > 0) {
+        if (value != "0") {
+            string array = type_of(type, 0);
+            string gep   = array + ", " + array + "* " +
+                         storage_of(id.get_sym()) + ", i64 0";
+            uint32_t pos = inits[step() - 1].first;
+            for (size_t d = 0; d < type.dims.size(); d++) {
+                gep += ", i64 " + to_string(pos / type.strides[d] % type.dims[d]);
+            }
+            string addr = new_tmp();
+            inst(addr + " = getelementptr inbounds " + gep);
+            inst("store i32 " + value + ", i32* " + addr);
+        }
+        if (step() < inits.size()) {
+            expr(*inits[step()].second);
+        }
+        return;
+    }
+    inits.clear();
+    if (ast.get_init()) {
+        InitValAST &init = static_cast<InitValAST &>(*ast.get_init());
+        uint32_t    pos  = 0;
+        if (is_array) {
+            flatten_init(init, type, 0, pos, inits);
+        }
+        else if (init.get_values().empty() == false) {
+            inits.push_back({0, init.get_values()[0].get()});
+        }
+    }
+    // 全局变量
+    if (in_fun == false) {
+        vector<int> vals(is_array ? type.size : 1, 0);
+        for (auto &i : inits) {
+            eval_const(symtab, i.second, vals[i.first]);
+        }
+        string name = "@" + id.get_name();
+        globals << name << " = " << (ast.is_const() ? "constant " : "global ")
+                << const_array(type, 0, 0, vals) << "\n";
+        storage_of(id.get_sym()) = name;
+        return;
+    }
+    string slot = "%" + id.get_name() + "." + to_string(tmp_cnt++);
+    allocas << "  " << slot << " = alloca " << type_of(type, 0) << "\n";
+    storage_of(id.get_sym()) = slot;
+    // 局部标量
+    if (is_array == false) {
+        if (inits.empty()) {
+            inst("store i32 0, i32* " + slot);
+            return;
+        }
+        expr(*inits[0].second);
+        return;
+    }
+    // 局部数组先清零再逐个赋值
+    // 没有初始化列表时也清零，否则读到的 undef 会使 LLVM 优化后的结果与其他引擎不同
+    need_memset  = true;
+    string array = type_of(type, 0);
+    string bytes = new_tmp();
+    inst(bytes + " = bitcast " + array + "* " + slot + " to i8*");
+    inst("call void @llvm.memset.p0i8.i64(i8* " + bytes + ", i8 0, i64 " +
+         to_string((uint64_t)type.size * 4) + ", i1 false)");
+    if (inits.empty() == false) {
+        expr(*inits[0].second);
+    }
+    return;
+}
+
+void LLVMGen::visit(IdAST &) {
+    return;
+}
+
+void LLVMGen::visit(InitValAST &) {
+    return;
+}
+
+void LLVMGen::visit(BlockAST &ast) {
+    if (step() < ast.get_stmts().size()) {
+        descend(*ast.get_stmts()[step()]);
+    }
+    return;
+}
+
+// 关系运算直接用 icmp 的结果跳转，左侧的值在求右侧期间放在 strs 中
+void LLVMGen::visit(BinaryAST &ast) {
+    bool logic =
+        ast.get_op() == Operator::and_op || ast.get_op() == Operator::or_op;
+    // 条件中的逻辑与、或直接跳转，右侧沿用本结点的目标
+    if (mode() == WALK_COND && logic) {
+        if (step() == 0) {
+            string next = new_label();
+            strs.push_back(next);
+            if (ast.get_op() == Operator::and_op) {
+                cond(*ast.get_left(), next, string(conds.back().second));
+            }
+            else {
+                cond(*ast.get_left(), string(conds.back().first), next);
+            }
+            return;
+        }
+        if (step() == 1) {
+            label(strs.back());
+            strs.pop_back();
+            descend(*ast.get_right(), WALK_COND);
+        }
+        return;
+    }
+    // 在表达式中出现的逻辑运算按短路求值得到 0 或 1，由 phi 合并
+    if (logic) {
+        if (step() == 0) {
+            string t = new_label(), f = new_label(), end = new_label();
+            strs.insert(strs.end(), {t, f, end});
+            cond(ast, t, f);
+            return;
+        }
+        string t = strs[strs.size() - 3], f = strs[strs.size() - 2],
+               end = strs[strs.size() - 1];
+        strs.resize(strs.size() - 3);
+        label(t);
+        terminate("br label %" + end);
+        label(f);
+        label(end);
+        value = new_tmp();
+        inst(value + " = phi i32 [ 1, %" + t + " ], [ 0, %" + f + " ]");
+        return;
+    }
+    string op, cc;
+    switch (ast.get_op()) {
+        case Operator::add_op:
+            op = "add";
+            break;
+        case Operator::sub_op:
+            op = "sub";
+            break;
+        case Operator::mul_op:
+            op = "mul";
+            break;
+        case Operator::div_op:
+            op = "sdiv";
+            break;
+        case Operator::mod_op:
+            op = "srem";
+            break;
+        case Operator::gt_op:
+            cc = "sgt";
+            break;
+        case Operator::ge_op:
+            cc = "sge";
+            break;
+        case Operator::lt_op:
+            cc = "slt";
+            break;
+        case Operator::le_op:
+            cc = "sle";
+            break;
+        case Operator::equ_op:
+            cc = "eq";
+            break;
+        case Operator::nequ_op:
+            cc = "ne";
+            break;
+        default:
+            break;
+    }
+    if (mode() == WALK_COND && cc.empty()) {
+        branch(ast);
+        return;
+    }
+    switch (step()) {
+        case 0:
+            if (mode() != WALK_COND || const_branch(ast) == false) {
+                expr(*ast.get_left());
+            }
+            return;
+        case 1:
+            strs.push_back(value);
+            expr(*ast.get_right());
+            return;
+    }
+    string l = strs.back();
+    string r = value;
+    strs.pop_back();
+    if (cc.empty()) {
+        value = new_tmp();
+        inst(value + " = " + op + " i32 " + l + ", " + r);
+        return;
+    }
+    string c = new_tmp();
+    inst(c + " = icmp " + cc + " i32 " + l + ", " + r);
+    compared(c);
+    return;
+}
+
+void LLVMGen::visit(UnaryAST &ast) {
+    // 条件中的逻辑非交换本结点的目标
+    if (mode() == WALK_COND && ast.get_op() == Operator::not_op) {
+        if (step() == 0) {
+            swap(conds.back().first, conds.back().second);
+            descend(*ast.get_exp(), WALK_COND);
+        }
+        return;
+    }
+    if (mode() == WALK_COND) {
+        branch(ast);
+        return;
+    }
+    if (step() == 0) {
+        expr(*ast.get_exp());
+        return;
+    }
+    string v = value;
+    if (ast.get_op() == Operator::add_op) {
+        return;
+    }
+    if (ast.get_op() == Operator::sub_op) {
+        value = new_tmp();
+        inst(value + " = sub i32 0, " + v);
+        return;
+    }
+    string c = new_tmp();
+    inst(c + " = icmp eq i32 " + v + ", 0");
+    value = new_tmp();
+    inst(value + " = zext i1 " + c + " to i32");
+    return;
+}
+
+void LLVMGen::visit(NumAST &ast) {
+    if (mode() == WALK_COND) {
+        branch(ast);
+        return;
+    }
+    value = to_string(ast.get_val());
+    return;
+}
+
+// 条件的标号放在 strs 中，有 else 时再加上结尾的标号
+void LLVMGen::visit(IfAST &ast) {
+    switch (step()) {
+        case 0: {
+            string t = new_label(), f = new_label();
+            strs.insert(strs.end(), {t, f});
+            cond(*ast.get_cond(), t, f);
+            return;
+        }
+        case 1:
+            label(strs[strs.size() - 2]);
+            descend(*ast.get_then());
+            return;
+        case 2:
+            if (ast.get_else()) {
+                string end = new_label();
+                if (terminated == false) {
+                    terminate("br label %" + end);
+                }
+                label(strs.back());
+                strs.push_back(end);
+                descend(*ast.get_else());
+                return;
+            }
+            label(strs.back());
+            strs.resize(strs.size() - 2);
+            return;
+    }
+    label(strs.back());
+    strs.resize(strs.size() - 3);
+    return;
+}
+
+void LLVMGen::visit(WhileAST &ast) {
+    switch (step()) {
+        case 0: {
+            string head = new_label(), loop = new_label(), end = new_label();
+            label(head);
+            strs.insert(strs.end(), {head, loop, end});
+            cond(*ast.get_cond(), loop, end);
+            return;
+        }
+        case 1:
+            label(strs[strs.size() - 2]);
+            loops.push_back({strs[strs.size() - 3], strs.back()});
+            descend(*ast.get_body());
+            return;
+    }
+    loops.pop_back();
+    if (terminated == false) {
+        terminate("br label %" + strs[strs.size() - 3]);
+    }
+    label(strs.back());
+    strs.resize(strs.size() - 3);
+    return;
+}
+
+// 之后的语句不可达，由 inst 放到新的基本块中
+void LLVMGen::visit(ControlAST &ast) {
+    switch (ast.get_type()) {
+        case Control::break_c:
+            terminate("br label %" + loops.back().second);
+            break;
+        case Control::continue_c:
+            terminate("br label %" + loops.back().first);
+            break;
+        case Control::return_c:
+            if (void_fun) {
+                terminate("ret void");
+            }
+            else if (ast.get_ret() && step() == 0) {
+                expr(*ast.get_ret());
+            }
+            else {
+                terminate("ret i32 " + (ast.get_ret() ? value : "0"));
+            }
+            break;
+    }
+    return;
+}
+
+// 先求右侧的值，再以 WALK_ADDRESS 计算左侧的地址
+void LLVMGen::visit(AssignAST &ast) {
+    switch (step()) {
+        case 0:
+            expr(*ast.get_right());
+            return;
+        case 1:
+            strs.push_back(value);
+            descend(*ast.get_left(), WALK_ADDRESS);
+            return;
+    }
+    inst("store i32 " + strs.back() + ", i32* " + value);
+    strs.pop_back();
+    return;
+}
+
+// 数组参数是指向第二维的指针，按第二维的类型计算
+// 部分下标得到的子数组退化为指向其首元素的指针，与参数的类型一致
+// 拼接中的 getelementptr 放在 strs 中，非常量的下标转换为 i64
+void LLVMGen::visit(LValAST &ast) {
+    if (mode() == WALK_COND) {
+        branch(ast);
+        return;
+    }
+    Variable       *var  = symtab.var_at(ast.get_sym());
+    const TypeInfo &type = types.at(var->get_type_id());
+    auto           &pos  = ast.get_position();
+    string          addr;
+    if (step() == 0 && pos.empty() &&
+        (type.dims.empty() || type.param_flag)) {
+        addr = storage_of(ast.get_sym());
+    }
+    else {
+        if (step() == 0) {
+            string base = storage_of(ast.get_sym());
+            string t    = type_of(type, type.param_flag ? 1 : 0);
+            strs.push_back(t + ", " + t + "* " + base);
+            if (type.param_flag == false) {
+                strs.back() += ", i64 0";
+            }
+        }
+        else {
+            int    val;
+            string idx = value;
+            if (eval_const(symtab, pos[step() - 1].get(), val, &memo) ==
+                false) {
+                idx = new_tmp();
+                inst(idx + " = sext i32 " + value + " to i64");
+            }
+            strs.back() += ", i64 " + idx;
+        }
+        if (step() < pos.size()) {
+            expr(*pos[step()]);
+            return;
+        }
+        if (pos.size() < type.dims.size()) {
+            strs.back() += ", i64 0";
+        }
+        addr = new_tmp();
+        inst(addr + " = getelementptr inbounds " + strs.back());
+        strs.pop_back();
+    }
+    // 数组本身或部分下标得到子数组首元素的地址
+    if (mode() == WALK_ADDRESS || pos.size() < type.dims.size()) {
+        value = addr;
+        return;
+    }
+    value = new_tmp();
+    inst(value + " = load i32, i32* " + addr);
+    return;
+}
+
+void LLVMGen::visit(EmptyAST &) {
+    return;
+}
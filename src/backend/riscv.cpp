@@ -0,0 +1,963 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// riscv.cpp for Simple-XX/SimpleCompiler.
+
+#include "algorithm"
+#include "cstring"
+#include "sstream"
+#include "unordered_map"
+#include "riscv.h"
+
+using namespace std;
+
+// 指令格式
+enum rv_fmt_t {
+    FMT_R,
+    FMT_I,
+    // 访存与 jalr，汇编写作 imm(rs1)
+    FMT_L,
+    FMT_S,
+    FMT_B,
+    FMT_U,
+    FMT_J,
+    FMT_E,
+};
+
+// 指令的名字与编码，顺序与 rv_op_t 一致
+static const struct {
+    const char *name;
+    rv_fmt_t    fmt;
+    uint32_t    opcode;
+    uint32_t    funct3;
+    uint32_t    funct7;
+} op_info[] = {
+    {"add", FMT_R, 0x33, 0, 0x00},   {"sub", FMT_R, 0x33, 0, 0x20},
+    {"slt", FMT_R, 0x33, 2, 0x00},   {"sltu", FMT_R, 0x33, 3, 0x00},
+    {"xor", FMT_R, 0x33, 4, 0x00},   {"or", FMT_R, 0x33, 6, 0x00},
+    {"and", FMT_R, 0x33, 7, 0x00},   {"addw", FMT_R, 0x3b, 0, 0x00},
+    {"subw", FMT_R, 0x3b, 0, 0x20},  {"mulw", FMT_R, 0x3b, 0, 0x01},
+    {"divw", FMT_R, 0x3b, 4, 0x01},  {"remw", FMT_R, 0x3b, 6, 0x01},
+    {"addi", FMT_I, 0x13, 0, 0},     {"addiw", FMT_I, 0x1b, 0, 0},
+    {"slti", FMT_I, 0x13, 2, 0},     {"sltiu", FMT_I, 0x13, 3, 0},
+    {"xori", FMT_I, 0x13, 4, 0},     {"andi", FMT_I, 0x13, 7, 0},
+    {"lw", FMT_L, 0x03, 2, 0},       {"ld", FMT_L, 0x03, 3, 0},
+    {"jalr", FMT_L, 0x67, 0, 0},     {"sw", FMT_S, 0x23, 2, 0},
+    {"sd", FMT_S, 0x23, 3, 0},       {"beq", FMT_B, 0x63, 0, 0},
+    {"bne", FMT_B, 0x63, 1, 0},      {"blt", FMT_B, 0x63, 4, 0},
+    {"bge", FMT_B, 0x63, 5, 0},      {"bltu", FMT_B, 0x63, 6, 0},
+    {"bgeu", FMT_B, 0x63, 7, 0},     {"lui", FMT_U, 0x37, 0, 0},
+    {"auipc", FMT_U, 0x17, 0, 0},    {"jal", FMT_J, 0x6f, 0, 0},
+    {"ecall", FMT_E, 0x73, 0, 0},
+};
+
+static const char *reg_names[] = {
+    "zero", "ra", "sp", "gp", "tp",  "t0",  "t1", "t2", "s0", "s1", "a0",
+    "a1",   "a2", "a3", "a4", "a5",  "a6",  "a7", "s2", "s3", "s4", "s5",
+    "s6",   "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+};
+
+// 分配给虚拟寄存器的 callee-saved 寄存器
+static const int alloc_regs[] = {RV_S1,  RV_S2,  RV_S2 + 1, RV_S2 + 2,
+                                 RV_S2 + 3, RV_S2 + 4, RV_S2 + 5, RV_S2 + 6,
+                                 RV_S2 + 7, RV_S2 + 8, RV_S11};
+static const int alloc_cnt  = sizeof(alloc_regs) / sizeof(alloc_regs[0]);
+
+// 参数寄存器个数
+static const int ARG_REGS = 8;
+// 代码的起始地址
+static const uint64_t TEXT_BASE = 0x10000;
+
+static bool fits12(int64_t _v) {
+    return _v >= -2048 && _v <= 2047;
+}
+
+// 展开后的字节数
+static uint32_t inst_size(const RVInst &_inst) {
+    switch (_inst.op) {
+        case RV_LABEL:
+            return 0;
+        case RV_LI:
+            return fits12(_inst.imm) ? 4 : 8;
+        case RV_LA:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+class RVGen {
+private:
+    const IRModule   &module;
+    const IRFunction *fun;
+    RVFunction       *rf;
+    // 各虚拟寄存器分配到的物理寄存器，0 表示在栈帧中
+    vector<int> home;
+    // 栈帧中的虚拟寄存器相对 s0 的偏移
+    vector<int32_t> slot;
+    // 各虚拟寄存器被读的次数
+    vector<uint32_t> uses;
+    // 使用了的 callee-saved 寄存器个数
+    int saved;
+    // 栈上数组相对 sp 的偏移
+    int32_t array_base;
+    // 函数出口
+    int32_t exit_label;
+    // 等待调用的参数
+    vector<IRArg> pending;
+
+    void add(const RVInst &_inst) {
+        rf->code.push_back(_inst);
+        return;
+    }
+    void op(rv_op_t _op, int _rd, int _rs1, int _rs2 = 0, int64_t _imm = 0) {
+        add(RVInst(_op, _rd, _rs1, _rs2, _imm));
+        return;
+    }
+    void li(int _rd, int64_t _imm) {
+        add(RVInst(RV_LI, _rd, 0, 0, _imm));
+        return;
+    }
+    void move(int _rd, int _rs) {
+        if (_rd != _rs) {
+            op(RV_ADDI, _rd, _rs);
+        }
+        return;
+    }
+    int32_t new_label(void) {
+        return rf->label_cnt++;
+    }
+    void label(int32_t _label) {
+        RVInst i(RV_LABEL);
+        i.label = _label;
+        add(i);
+        return;
+    }
+    void branch(rv_op_t _op, int _rs1, int _rs2, int32_t _label) {
+        RVInst i(_op, 0, _rs1, _rs2);
+        i.label = _label;
+        add(i);
+        return;
+    }
+    // _rd = _base + _off
+    void addr(int _rd, int _base, int64_t _off) {
+        if (fits12(_off)) {
+            op(RV_ADDI, _rd, _base, 0, _off);
+        }
+        else {
+            li(_rd, _off);
+            op(RV_ADD, _rd, _base, _rd);
+        }
+        return;
+    }
+    // 访存，偏移超出 12 位时先用 t6 算出地址
+    void mem(rv_op_t _op, int _reg, int _base, int64_t _off) {
+        if (fits12(_off) == false) {
+            li(RV_T6, _off);
+            op(RV_ADD, RV_T6, _base, RV_T6);
+            _base = RV_T6;
+            _off  = 0;
+        }
+        if (_op == RV_SW || _op == RV_SD) {
+            op(_op, 0, _base, _reg, _off);
+        }
+        else {
+            op(_op, _reg, _base, 0, _off);
+        }
+        return;
+    }
+    // 操作数所在的寄存器，不在寄存器中时读入 _tmp
+    int use(const IRArg &_arg, int _tmp);
+    // 结果写入的寄存器
+    int dst(const IRArg &_res) {
+        return home[_res.val] != 0 ? home[_res.val] : RV_T0;
+    }
+    // 结果在栈帧中时写回
+    void commit(const IRArg &_res, int _reg) {
+        if (home[_res.val] == 0) {
+            mem(RV_SD, _reg, RV_S0, slot[_res.val]);
+        }
+        return;
+    }
+    // 比较后跳转，_op 为 OP_GT 到 OP_NE 之一
+    void compare_branch(IROperator _op, const IRArg &_a, const IRArg &_b,
+                        int32_t _label);
+    // 生成调用，参数为 pending 中的值
+    void call(int _callee);
+    // 生成下标 _idx 处的指令，返回处理了的条数
+    size_t inst(size_t _idx);
+    // 分配寄存器与栈帧，生成序言
+    void prologue(void);
+    void epilogue(void);
+
+public:
+    RVGen(const IRModule &_module);
+    ~RVGen(void);
+    void function(const IRFunction &_fun, RVFunction &_rf);
+};
+
+RVGen::RVGen(const IRModule &_module)
+    : module(_module), fun(NULL), rf(NULL), saved(0), array_base(0),
+      exit_label(0) {
+    return;
+}
+
+RVGen::~RVGen(void) {
+    return;
+}
+
+int RVGen::use(const IRArg &_arg, int _tmp) {
+    switch (_arg.kind) {
+        case ARG_REG:
+            if (home[_arg.val] != 0) {
+                return home[_arg.val];
+            }
+            mem(RV_LD, _tmp, RV_S0, slot[_arg.val]);
+            return _tmp;
+        case ARG_IMM:
+            if (_arg.val == 0) {
+                return RV_ZERO;
+            }
+            li(_tmp, _arg.val);
+            return _tmp;
+        case ARG_GLOBAL: {
+            RVInst i(RV_LA, _tmp);
+            i.sym = module.globals[_arg.val].name;
+            add(i);
+            return _tmp;
+        }
+        case ARG_FRAME:
+            addr(_tmp, RV_SP, array_base + _arg.val);
+            return _tmp;
+        default:
+            return RV_ZERO;
+    }
+}
+
+void RVGen::compare_branch(IROperator _op, const IRArg &_a, const IRArg &_b,
+                           int32_t _label) {
+    int a = use(_a, RV_T0);
+    int b = use(_b, RV_T1);
+    switch (_op) {
+        case OP_GT:
+            branch(RV_BLT, b, a, _label);
+            break;
+        case OP_GE:
+            branch(RV_BGE, a, b, _label);
+            break;
+        case OP_LT:
+            branch(RV_BLT, a, b, _label);
+            break;
+        case OP_LE:
+            branch(RV_BGE, b, a, _label);
+            break;
+        case OP_EQU:
+            branch(RV_BEQ, a, b, _label);
+            break;
+        default:
+            branch(RV_BNE, a, b, _label);
+            break;
+    }
+    return;
+}
+
+// 超过 8 个的参数放在 sp 开始的参数区
+void RVGen::call(int _callee) {
+    for (size_t k = ARG_REGS; k < pending.size(); k++) {
+        int r = use(pending[k], RV_T0);
+        mem(RV_SD, r, RV_SP, 8 * (k - ARG_REGS));
+    }
+    for (size_t k = 0; k < pending.size() && k < ARG_REGS; k++) {
+        move(RV_A0 + k, use(pending[k], RV_A0 + k));
+    }
+    RVInst i(RV_CALL);
+    i.sym = module.funs[_callee].name;
+    add(i);
+    pending.clear();
+    return;
+}
+
+size_t RVGen::inst(size_t _idx) {
+    const IRInst &i = fun->code[_idx];
+    switch (i.op) {
+        case OP_NOP:
+            break;
+        case OP_LABEL:
+            label(i.result.val);
+            break;
+        case OP_AS:
+        case OP_LEA: {
+            int d = dst(i.result);
+            move(d, use(i.arg1, d));
+            commit(i.result, d);
+            break;
+        }
+        case OP_ADD:
+        case OP_SUB:
+        case OP_OFFSET: {
+            int  d = dst(i.result);
+            bool w = i.op != OP_OFFSET;
+            // 加立即数用 addi，加法的立即数可以在左边
+            IRArg a = i.arg1, b = i.arg2;
+            if (i.op != OP_SUB && a.is_imm() && b.is_imm() == false) {
+                swap(a, b);
+            }
+            int64_t imm = i.op == OP_SUB ? -(int64_t)b.val : b.val;
+            if (b.is_imm() && fits12(imm)) {
+                op(w ? RV_ADDIW : RV_ADDI, d, use(a, RV_T0), 0, imm);
+            }
+            else {
+                rv_op_t o = i.op == OP_OFFSET ? RV_ADD
+                            : i.op == OP_ADD  ? RV_ADDW
+                                              : RV_SUBW;
+                op(o, d, use(a, RV_T0), use(b, RV_T1));
+            }
+            commit(i.result, d);
+            break;
+        }
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD: {
+            int     d = dst(i.result);
+            rv_op_t o = i.op == OP_MUL   ? RV_MULW
+                        : i.op == OP_DIV ? RV_DIVW
+                                         : RV_REMW;
+            op(o, d, use(i.arg1, RV_T0), use(i.arg2, RV_T1));
+            commit(i.result, d);
+            break;
+        }
+        case OP_NEG: {
+            int d = dst(i.result);
+            op(RV_SUBW, d, RV_ZERO, use(i.arg1, RV_T0));
+            commit(i.result, d);
+            break;
+        }
+        case OP_GT:
+        case OP_GE:
+        case OP_LT:
+        case OP_LE:
+        case OP_EQU:
+        case OP_NE:
+        case OP_NOT: {
+            // 只被紧接着的条件跳转使用的比较结果直接生成条件分支
+            if (_idx + 1 < fun->code.size()) {
+                const IRInst &j = fun->code[_idx + 1];
+                if ((j.op == OP_JT || j.op == OP_JF) && j.arg1 == i.result &&
+                    uses[i.result.val] == 1) {
+                    if (i.op == OP_NOT) {
+                        branch(j.op == OP_JT ? RV_BEQ : RV_BNE,
+                               use(i.arg1, RV_T0), RV_ZERO, j.result.val);
+                        return 2;
+                    }
+                    // 假跳转使用相反的比较
+                    static const IROperator inverse[] = {OP_LE, OP_LT, OP_GE,
+                                                         OP_GT, OP_NE, OP_EQU};
+                    IROperator c = j.op == OP_JT ? i.op : inverse[i.op - OP_GT];
+                    compare_branch(c, i.arg1, i.arg2, j.result.val);
+                    return 2;
+                }
+            }
+            int d = dst(i.result);
+            int a = use(i.arg1, RV_T0);
+            if (i.op == OP_NOT) {
+                op(RV_SLTIU, d, a, 0, 1);
+                commit(i.result, d);
+                break;
+            }
+            if (i.op == OP_LT && i.arg2.is_imm() && fits12(i.arg2.val)) {
+                op(RV_SLTI, d, a, 0, i.arg2.val);
+                commit(i.result, d);
+                break;
+            }
+            if ((i.op == OP_EQU || i.op == OP_NE) && i.arg2.is_imm() &&
+                fits12(i.arg2.val)) {
+                op(RV_XORI, d, a, 0, i.arg2.val);
+            }
+            else {
+                int b = use(i.arg2, RV_T1);
+                switch (i.op) {
+                    case OP_GT:
+                    case OP_LE:
+                        op(RV_SLT, d, b, a);
+                        break;
+                    case OP_GE:
+                    case OP_LT:
+                        op(RV_SLT, d, a, b);
+                        break;
+                    default:
+                        op(RV_XOR, d, a, b);
+                        break;
+                }
+            }
+            if (i.op == OP_GE || i.op == OP_LE) {
+                op(RV_XORI, d, d, 0, 1);
+            }
+            else if (i.op == OP_EQU) {
+                op(RV_SLTIU, d, d, 0, 1);
+            }
+            else if (i.op == OP_NE) {
+                op(RV_SLTU, d, RV_ZERO, d);
+            }
+            commit(i.result, d);
+            break;
+        }
+        case OP_SET: {
+            int v = use(i.result, RV_T0);
+            mem(RV_SW, v, use(i.arg1, RV_T1), 0);
+            break;
+        }
+        case OP_GET: {
+            int d = dst(i.result);
+            mem(RV_LW, d, use(i.arg1, RV_T1), 0);
+            commit(i.result, d);
+            break;
+        }
+        case OP_ZERO: {
+            move(RV_T0, use(i.arg1, RV_T0));
+            // 小块直接逐字清零
+            if (i.arg2.is_imm() && i.arg2.val <= 64) {
+                for (int32_t k = 0; k < i.arg2.val; k += 4) {
+                    op(RV_SW, 0, RV_T0, RV_ZERO, k);
+                }
+                break;
+            }
+            op(RV_ADD, RV_T1, RV_T0, use(i.arg2, RV_T1));
+            int32_t loop = new_label(), done = new_label();
+            branch(RV_BEQ, RV_T0, RV_T1, done);
+            label(loop);
+            op(RV_SW, 0, RV_T0, RV_ZERO, 0);
+            op(RV_ADDI, RV_T0, RV_T0, 0, 4);
+            branch(RV_BLTU, RV_T0, RV_T1, loop);
+            label(done);
+            break;
+        }
+        case OP_JMP: {
+            RVInst j(RV_J);
+            j.label = i.result.val;
+            add(j);
+            break;
+        }
+        case OP_JT:
+        case OP_JF:
+            branch(i.op == OP_JT ? RV_BNE : RV_BEQ, use(i.arg1, RV_T0),
+                   RV_ZERO, i.result.val);
+            break;
+        case OP_ARG:
+            pending.push_back(i.arg1);
+            break;
+        case OP_PROC:
+            call(i.arg1.val);
+            break;
+        case OP_CALL: {
+            call(i.arg1.val);
+            int d = dst(i.result);
+            move(d, RV_A0);
+            commit(i.result, d);
+            break;
+        }
+        case OP_RET:
+        case OP_RETV:
+            if (i.op == OP_RETV) {
+                move(RV_A0, use(i.arg1, RV_A0));
+            }
+            // 最后一条返回直接落入出口
+            if (_idx + 1 < fun->code.size()) {
+                RVInst j(RV_J);
+                j.label = exit_label;
+                add(j);
+            }
+            break;
+    }
+    return 1;
+}
+
+// 栈帧自高向低为：ra、s0、保存的 s 寄存器、虚拟寄存器、栈上数组、传参区
+// s0 指向栈帧顶部，sp 按 16 字节对齐
+void RVGen::prologue(void) {
+    uint32_t regs = fun->reg_cnt();
+    // 按读写次数分配寄存器
+    vector<uint32_t> count(regs, 0);
+    uses.assign(regs, 0);
+    size_t max_args = 0, args = 0;
+    for (auto &i : fun->code) {
+        if (i.op == OP_ARG) {
+            args++;
+        }
+        else if (i.op == OP_PROC || i.op == OP_CALL) {
+            max_args = max(max_args, args);
+            args     = 0;
+        }
+        for (auto a : {&i.arg1, &i.arg2}) {
+            if (a->is_reg()) {
+                uses[a->val]++;
+                count[a->val]++;
+            }
+        }
+        if (i.result.is_reg()) {
+            // SET 的 result 是被写入的值
+            if (i.op == OP_SET) {
+                uses[i.result.val]++;
+            }
+            count[i.result.val]++;
+        }
+    }
+    // 参数在序言中写入
+    for (uint32_t k = 0; k < fun->param_cnt; k++) {
+        count[k]++;
+    }
+    vector<uint32_t> order(regs);
+    for (uint32_t k = 0; k < regs; k++) {
+        order[k] = k;
+    }
+    stable_sort(order.begin(), order.end(), [&count](uint32_t a, uint32_t b) {
+        return count[a] > count[b];
+    });
+    home.assign(regs, 0);
+    saved = 0;
+    for (uint32_t k : order) {
+        if (saved == alloc_cnt || count[k] == 0) {
+            break;
+        }
+        home[k] = alloc_regs[saved++];
+    }
+    slot.assign(regs, 0);
+    int32_t top = 16 + 8 * saved;
+    for (uint32_t k = 0; k < regs; k++) {
+        if (home[k] == 0) {
+            top += 8;
+            slot[k] = -top;
+        }
+    }
+    int32_t out   = 8 * (max_args > ARG_REGS ? max_args - ARG_REGS : 0);
+    array_base    = out;
+    int64_t frame = top + ((fun->frame_size + 7) & ~7) + out;
+    frame         = (frame + 15) & ~15;
+    if (frame < 2048) {
+        op(RV_ADDI, RV_SP, RV_SP, 0, -frame);
+        op(RV_SD, 0, RV_SP, RV_RA, frame - 8);
+        op(RV_SD, 0, RV_SP, RV_S0, frame - 16);
+        op(RV_ADDI, RV_S0, RV_SP, 0, frame);
+    }
+    else {
+        op(RV_ADDI, RV_SP, RV_SP, 0, -16);
+        op(RV_SD, 0, RV_SP, RV_RA, 8);
+        op(RV_SD, 0, RV_SP, RV_S0, 0);
+        op(RV_ADDI, RV_S0, RV_SP, 0, 16);
+        li(RV_T0, frame - 16);
+        op(RV_SUB, RV_SP, RV_SP, RV_T0);
+    }
+    for (int k = 0; k < saved; k++) {
+        op(RV_SD, 0, RV_S0, alloc_regs[k], -24 - 8 * k);
+    }
+    // 参数写入 0 号开始的虚拟寄存器，第 9 个起在调用者的传参区
+    for (uint32_t k = 0; k < fun->param_cnt; k++) {
+        int src = RV_A0 + k;
+        if (k >= ARG_REGS) {
+            src = RV_T0;
+            mem(RV_LD, src, RV_S0, 8 * (k - ARG_REGS));
+        }
+        int d = home[k] != 0 ? home[k] : RV_T0;
+        // 整数参数只有低 32 位有效
+        if (fun->reg_ptr[k] == false) {
+            op(RV_ADDIW, d, src, 0, 0);
+        }
+        else {
+            move(d, src);
+        }
+        commit(IRArg(ARG_REG, k), d);
+    }
+    return;
+}
+
+void RVGen::epilogue(void) {
+    label(exit_label);
+    for (int k = 0; k < saved; k++) {
+        op(RV_LD, alloc_regs[k], RV_S0, 0, -24 - 8 * k);
+    }
+    move(RV_SP, RV_S0);
+    op(RV_LD, RV_RA, RV_SP, 0, -8);
+    op(RV_LD, RV_S0, RV_SP, 0, -16);
+    op(RV_JALR, RV_ZERO, RV_RA, 0, 0);
+    return;
+}
+
+void RVGen::function(const IRFunction &_fun, RVFunction &_rf) {
+    fun           = &_fun;
+    rf            = &_rf;
+    rf->name      = _fun.name;
+    rf->label_cnt = _fun.label_cnt;
+    exit_label    = new_label();
+    pending.clear();
+    prologue();
+    for (size_t k = 0; k < _fun.code.size();) {
+        k += inst(k);
+    }
+    // 没有以返回结束的函数返回 0
+    if (_fun.code.empty() || (_fun.code.back().op != OP_RET &&
+                              _fun.code.back().op != OP_RETV)) {
+        li(RV_A0, 0);
+    }
+    epilogue();
+    return;
+}
+
+// 条件分支只能跳转 ±4KiB，超出时改为反向分支跳过一条 j
+static void relax(RVFunction &_fun) {
+    while (true) {
+        vector<int64_t> pos(_fun.label_cnt, 0);
+        vector<int64_t> at(_fun.code.size(), 0);
+        int64_t         pc = 0;
+        for (size_t k = 0; k < _fun.code.size(); k++) {
+            at[k] = pc;
+            if (_fun.code[k].op == RV_LABEL) {
+                pos[_fun.code[k].label] = pc;
+            }
+            pc += inst_size(_fun.code[k]);
+        }
+        vector<RVInst> code;
+        bool           changed = false;
+        for (size_t k = 0; k < _fun.code.size(); k++) {
+            const RVInst &i = _fun.code[k];
+            if (i.op < RV_BEQ || i.op > RV_BGEU) {
+                code.push_back(i);
+                continue;
+            }
+            int64_t off = pos[i.label] - at[k];
+            if (off >= -4096 && off < 4096) {
+                code.push_back(i);
+                continue;
+            }
+            // beq/bne、blt/bge、bltu/bgeu 两两互为反向
+            RVInst b = i;
+            b.op     = (rv_op_t)(RV_BEQ + ((i.op - RV_BEQ) ^ 1));
+            b.label  = _fun.label_cnt++;
+            RVInst j(RV_J);
+            j.label = i.label;
+            RVInst l(RV_LABEL);
+            l.label = b.label;
+            code.push_back(b);
+            code.push_back(j);
+            code.push_back(l);
+            changed = true;
+        }
+        _fun.code.swap(code);
+        if (changed == false) {
+            break;
+        }
+    }
+    return;
+}
+
+void riscv_lower(const IRModule &_module, RVProgram &_prog) {
+    RVGen gen(_module);
+    _prog.globals = _module.globals;
+    for (auto &f : _module.funs) {
+        if (f.extern_flag) {
+            _prog.externs.push_back(f.name);
+            continue;
+        }
+        _prog.funs.push_back(RVFunction());
+        gen.function(f, _prog.funs.back());
+        relax(_prog.funs.back());
+    }
+    return;
+}
+
+void riscv_lower_function(const IRModule &_module, const IRFunction &_fun,
+                          RVFunction &_out) {
+    RVGen gen(_module);
+    gen.function(_fun, _out);
+    relax(_out);
+    return;
+}
+
+// 输出一条指令
+static void print_inst(ostream &_os, const RVFunction &_fun,
+                       const RVInst &_inst) {
+    const char *rd = reg_names[_inst.rd], *rs1 = reg_names[_inst.rs1],
+               *rs2 = reg_names[_inst.rs2];
+    string target   = ".L" + _fun.name + "_" + to_string(_inst.label);
+    switch (_inst.op) {
+        case RV_LABEL:
+            _os << target << ":\n";
+            return;
+        case RV_LI:
+            _os << "\tli\t" << rd << ", " << _inst.imm << "\n";
+            return;
+        case RV_LA:
+            _os << "\tla\t" << rd << ", " << _inst.sym << "\n";
+            return;
+        case RV_CALL:
+            _os << "\tcall\t" << _inst.sym << "\n";
+            return;
+        case RV_J:
+            _os << "\tj\t" << target << "\n";
+            return;
+        case RV_ADDI:
+            if (_inst.imm == 0) {
+                _os << "\tmv\t" << rd << ", " << rs1 << "\n";
+                return;
+            }
+            break;
+        case RV_JALR:
+            if (_inst.rd == RV_ZERO && _inst.rs1 == RV_RA && _inst.imm == 0) {
+                _os << "\tret\n";
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+    _os << "\t" << op_info[_inst.op].name;
+    switch (op_info[_inst.op].fmt) {
+        case FMT_R:
+            _os << "\t" << rd << ", " << rs1 << ", " << rs2;
+            break;
+        case FMT_I:
+            _os << "\t" << rd << ", " << rs1 << ", " << _inst.imm;
+            break;
+        case FMT_L:
+            _os << "\t" << rd << ", " << _inst.imm << "(" << rs1 << ")";
+            break;
+        case FMT_S:
+            _os << "\t" << rs2 << ", " << _inst.imm << "(" << rs1 << ")";
+            break;
+        case FMT_B:
+            _os << "\t" << rs1 << ", " << rs2 << ", " << target;
+            break;
+        case FMT_U:
+            _os << "\t" << rd << ", " << _inst.imm;
+            break;
+        case FMT_J:
+            _os << "\t" << rd << ", " << target;
+            break;
+        case FMT_E:
+            break;
+    }
+    _os << "\n";
+    return;
+}
+
+string riscv_asm_function(const RVFunction &_fun) {
+    ostringstream os;
+    os << "\t.globl " << _fun.name << "\n\t.align 2\n\t.type " << _fun.name
+       << ", @function\n"
+       << _fun.name << ":\n";
+    for (auto &i : _fun.code) {
+        print_inst(os, _fun, i);
+    }
+    os << "\t.size " << _fun.name << ", .-" << _fun.name << "\n";
+    return os.str();
+}
+
+string riscv_asm(const RVProgram &_prog) {
+    vector<string> funs;
+    for (auto &f : _prog.funs) {
+        funs.push_back(riscv_asm_function(f));
+    }
+    return riscv_asm(_prog, funs);
+}
+
+string riscv_asm(const RVProgram &_prog, const vector<string> &_funs) {
+    ostringstream os;
+    os << "\t.option nopic\n";
+    for (auto &g : _prog.globals) {
+        bool bss = g.init.empty() && g.const_flag == false;
+        os << (g.const_flag ? "\t.section .rodata\n"
+               : bss        ? "\t.bss\n"
+                            : "\t.data\n");
+        os << "\t.globl " << g.name << "\n\t.align 3\n\t.type " << g.name
+           << ", @object\n\t.size " << g.name << ", " << g.size << "\n"
+           << g.name << ":\n";
+        for (auto v : g.init) {
+            os << "\t.word " << v << "\n";
+        }
+        if (g.size > g.init.size() * 4) {
+            os << "\t.zero " << g.size - g.init.size() * 4 << "\n";
+        }
+    }
+    os << "\t.text\n";
+    for (auto &f : _funs) {
+        os << f;
+    }
+    os << "\t.section .note.GNU-stack,\"\",@progbits\n";
+    return os.str();
+}
+
+// 低 12 位，符号扩展
+static int64_t lo12(int64_t _v) {
+    return ((_v & 0xfff) ^ 0x800) - 0x800;
+}
+
+// 编码一条真实指令，_off 为分支与跳转相对本指令的偏移
+static uint32_t encode(const RVInst &_inst, int64_t _off) {
+    uint32_t op  = op_info[_inst.op].opcode;
+    uint32_t f3  = op_info[_inst.op].funct3 << 12;
+    uint32_t rd  = _inst.rd << 7;
+    uint32_t rs1 = _inst.rs1 << 15;
+    uint32_t rs2 = _inst.rs2 << 20;
+    uint32_t imm = _inst.imm;
+    uint32_t off = _off;
+    switch (op_info[_inst.op].fmt) {
+        case FMT_R:
+            return (op_info[_inst.op].funct7 << 25) | rs2 | rs1 | f3 | rd | op;
+        case FMT_I:
+        case FMT_L:
+            return (imm << 20) | rs1 | f3 | rd | op;
+        case FMT_S:
+            return ((imm >> 5 & 0x7f) << 25) | rs2 | rs1 | f3 |
+                   ((imm & 0x1f) << 7) | op;
+        case FMT_B:
+            return ((off >> 12 & 1) << 31) | ((off >> 5 & 0x3f) << 25) | rs2 |
+                   rs1 | f3 | ((off >> 1 & 0xf) << 8) | ((off >> 11 & 1) << 7) |
+                   op;
+        case FMT_U:
+            return (imm << 12) | rd | op;
+        case FMT_J:
+            return ((off >> 20 & 1) << 31) | ((off >> 1 & 0x3ff) << 21) |
+                   ((off >> 11 & 1) << 20) | (off & 0xff000) | rd | op;
+        case FMT_E:
+            return op;
+    }
+    return 0;
+}
+
+// 代码依次为入口、运行时函数的桩与各函数，之后是全局变量
+// 运行时函数的桩以 ecall 交给模拟器，call 按链接器松弛后的 jal 编码
+bool riscv_link(const RVProgram &_prog, RVImage &_image, string &_err) {
+    vector<RVInst> start;
+    RVInst         call_main(RV_CALL);
+    call_main.sym = "main";
+    start.push_back(call_main);
+    start.push_back(RVInst(RV_LI, RV_A7, 0, 0, SIM_CALL_EXIT));
+    start.push_back(RVInst(RV_ECALL));
+    unordered_map<string, uint64_t> syms;
+    uint64_t                        pc = TEXT_BASE;
+    for (auto &i : start) {
+        pc += inst_size(i);
+    }
+    vector<RVInst> stubs;
+    for (auto &name : _prog.externs) {
+        int rt = sim_runtime_index(name);
+        if (rt < 0) {
+            _err = "undefined function " + name;
+            return false;
+        }
+        syms[name] = pc + stubs.size() * 4;
+        stubs.push_back(RVInst(RV_ADDI, RV_A7, RV_ZERO, 0, SIM_CALL_RUNTIME + rt));
+        stubs.push_back(RVInst(RV_ECALL));
+        stubs.push_back(RVInst(RV_JALR, RV_ZERO, RV_RA, 0, 0));
+    }
+    pc += stubs.size() * 4;
+    vector<vector<uint64_t>> labels(_prog.funs.size());
+    for (size_t f = 0; f < _prog.funs.size(); f++) {
+        const RVFunction &fun = _prog.funs[f];
+        syms[fun.name]        = pc;
+        labels[f].assign(fun.label_cnt, 0);
+        for (auto &i : fun.code) {
+            if (i.op == RV_LABEL) {
+                labels[f][i.label] = pc;
+            }
+            pc += inst_size(i);
+        }
+    }
+    _image.base     = TEXT_BASE;
+    _image.text_end = pc;
+    for (auto &g : _prog.globals) {
+        pc         = (pc + 7) & ~(uint64_t)7;
+        syms[g.name] = pc;
+        pc += g.size;
+    }
+    if (syms.count("main") == 0) {
+        _err = "undefined function main";
+        return false;
+    }
+    _image.entry = TEXT_BASE;
+    _image.mem.assign(pc - TEXT_BASE, 0);
+    for (auto &g : _prog.globals) {
+        if (g.init.empty() == false) {
+            memcpy(&_image.mem[syms[g.name] - TEXT_BASE], g.init.data(),
+                   g.init.size() * 4);
+        }
+    }
+    // 编码，伪指令展开为真实指令
+    pc        = TEXT_BASE;
+    auto put  = [&](const RVInst &_inst, int64_t _off) {
+        uint32_t word = encode(_inst, _off);
+        memcpy(&_image.mem[pc - TEXT_BASE], &word, 4);
+        pc += 4;
+    };
+    auto emit = [&](const RVInst &i, const vector<uint64_t> *_labels) {
+        switch (i.op) {
+            case RV_LABEL:
+                return true;
+            case RV_LI:
+                if (fits12(i.imm)) {
+                    put(RVInst(RV_ADDI, i.rd, RV_ZERO, 0, i.imm), 0);
+                }
+                else {
+                    int64_t lo = lo12(i.imm);
+                    put(RVInst(RV_LUI, i.rd, 0, 0, (i.imm - lo) >> 12 & 0xfffff),
+                        0);
+                    put(RVInst(RV_ADDIW, i.rd, i.rd, 0, lo), 0);
+                }
+                return true;
+            case RV_LA:
+            case RV_CALL: {
+                auto it = syms.find(i.sym);
+                if (it == syms.end()) {
+                    _err = "undefined symbol " + i.sym;
+                    return false;
+                }
+                int64_t off = it->second - pc;
+                if (i.op == RV_CALL) {
+                    if (off < -(1 << 20) || off >= (1 << 20)) {
+                        _err = "call to " + i.sym + " out of range";
+                        return false;
+                    }
+                    put(RVInst(RV_JAL, RV_RA), off);
+                    return true;
+                }
+                int64_t lo = lo12(off);
+                put(RVInst(RV_AUIPC, i.rd, 0, 0, (off - lo) >> 12 & 0xfffff), 0);
+                put(RVInst(RV_ADDI, i.rd, i.rd, 0, lo), 0);
+                return true;
+            }
+            case RV_J: {
+                int64_t off = (*_labels)[i.label] - pc;
+                if (off < -(1 << 20) || off >= (1 << 20)) {
+                    _err = "jump out of range";
+                    return false;
+                }
+                put(RVInst(RV_JAL, RV_ZERO), off);
+                return true;
+            }
+            default: {
+                int64_t off = 0;
+                if (op_info[i.op].fmt == FMT_B) {
+                    off = (*_labels)[i.label] - pc;
+                    if (off < -4096 || off >= 4096) {
+                        _err = "branch out of range";
+                        return false;
+                    }
+                }
+                put(i, off);
+                return true;
+            }
+        }
+    };
+    for (auto &i : start) {
+        emit(i, NULL);
+    }
+    for (auto &i : stubs) {
+        emit(i, NULL);
+    }
+    for (size_t f = 0; f < _prog.funs.size(); f++) {
+        for (auto &i : _prog.funs[f].code) {
+            if (emit(i, &labels[f]) == false) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,401 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// rvsim.cpp for Simple-XX/SimpleCompiler.
+
+#include "climits"
+#include "cstring"
+#include "sstream"
+#include "rvsim.h"
+
+using namespace std;
+
+// 将低 _bits 位符号扩展
+static int64_t sext(uint64_t _v, int _bits) {
+    return (int64_t)(_v << (64 - _bits)) >> (64 - _bits);
+}
+
+// 有符号除法与取余，除数为 0 与溢出时的结果由指令集规定
+static int64_t div_s(int64_t _a, int64_t _b, int64_t _min) {
+    if (_b == 0) {
+        return -1;
+    }
+    if (_a == _min && _b == -1) {
+        return _min;
+    }
+    return _a / _b;
+}
+
+static int64_t rem_s(int64_t _a, int64_t _b, int64_t _min) {
+    if (_b == 0) {
+        return _a;
+    }
+    if (_a == _min && _b == -1) {
+        return 0;
+    }
+    return _a % _b;
+}
+
+RVSim::RVSim(const RVImage &_image, istream &_in, ostream &_out)
+    : mem(_image.mem), base(_image.base), entry(_image.entry),
+      text_end(_image.text_end), stack_size(16 << 20), in(_in), out(_out),
+      steps(0), step_limit(0) {
+    return;
+}
+
+RVSim::~RVSim(void) {
+    return;
+}
+
+void RVSim::set_step_limit(uint64_t _limit) {
+    step_limit = _limit;
+    return;
+}
+
+void RVSim::set_stack_size(size_t _size) {
+    stack_size = _size;
+    return;
+}
+
+uint64_t RVSim::get_steps(void) const {
+    return steps;
+}
+
+const string &RVSim::get_trap(void) const {
+    return trap;
+}
+
+bool RVSim::check(uint64_t _addr, size_t _size, bool _write) {
+    if (_addr < (_write ? text_end : base) ||
+        _addr - base + _size > mem.size()) {
+        ostringstream os;
+        os << "invalid memory access at 0x" << hex << _addr;
+        trap = os.str();
+        return false;
+    }
+    return true;
+}
+
+int RVSim::run(void) {
+    mem.resize(mem.size() + stack_size, 0);
+    memset(x, 0, sizeof(x));
+    x[RV_SP] = (base + mem.size()) & ~(uint64_t)15;
+    uint64_t pc = entry;
+    while (true) {
+        if (step_limit != 0 && steps >= step_limit) {
+            trap = "step limit exceeded";
+            return -1;
+        }
+        if (pc < base || pc + 4 > text_end || pc % 4 != 0) {
+            ostringstream os;
+            os << "invalid pc 0x" << hex << pc;
+            trap = os.str();
+            return -1;
+        }
+        uint32_t w;
+        memcpy(&w, &mem[pc - base], 4);
+        uint32_t rd = w >> 7 & 31, f3 = w >> 12 & 7, rs1 = w >> 15 & 31,
+                 rs2 = w >> 20 & 31, f7 = w >> 25;
+        uint64_t a = x[rs1], b = x[rs2];
+        int64_t  imm_i = sext(w >> 20, 12);
+        uint64_t next  = pc + 4;
+        uint64_t res   = 0;
+        bool     write = true;
+        bool     ok    = true;
+        switch (w & 0x7f) {
+            // lui
+            case 0x37:
+                res = sext(w & 0xfffff000, 32);
+                break;
+            // auipc
+            case 0x17:
+                res = pc + sext(w & 0xfffff000, 32);
+                break;
+            // jal
+            case 0x6f:
+                res  = pc + 4;
+                next = pc + sext((w >> 31 << 20) | (w & 0xff000) |
+                                     ((w >> 20 & 1) << 11) |
+                                     ((w >> 21 & 0x3ff) << 1),
+                                 21);
+                break;
+            // jalr
+            case 0x67:
+                res  = pc + 4;
+                next = (a + imm_i) & ~(uint64_t)1;
+                ok   = f3 == 0;
+                break;
+            // 条件分支
+            case 0x63: {
+                bool taken = false;
+                switch (f3) {
+                    case 0:
+                        taken = a == b;
+                        break;
+                    case 1:
+                        taken = a != b;
+                        break;
+                    case 4:
+                        taken = (int64_t)a < (int64_t)b;
+                        break;
+                    case 5:
+                        taken = (int64_t)a >= (int64_t)b;
+                        break;
+                    case 6:
+                        taken = a < b;
+                        break;
+                    case 7:
+                        taken = a >= b;
+                        break;
+                    default:
+                        ok = false;
+                        break;
+                }
+                if (taken) {
+                    next = pc + sext((w >> 31 << 12) | ((w >> 7 & 1) << 11) |
+                                         ((w >> 25 & 0x3f) << 5) |
+                                         ((w >> 8 & 0xf) << 1),
+                                     13);
+                }
+                write = false;
+                break;
+            }
+            // 读内存
+            case 0x03: {
+                static const size_t sizes[] = {1, 2, 4, 8, 1, 2, 4, 0};
+                uint64_t            addr    = a + imm_i;
+                size_t              size    = sizes[f3];
+                if (size == 0) {
+                    ok = false;
+                    break;
+                }
+                if (check(addr, size, false) == false) {
+                    return -1;
+                }
+                memcpy(&res, &mem[addr - base], size);
+                // lb、lh、lw 符号扩展
+                if (f3 < 3) {
+                    res = sext(res, size * 8);
+                }
+                break;
+            }
+            // 写内存
+            case 0x23: {
+                uint64_t addr = a + sext((w >> 25 << 5) | (w >> 7 & 31), 12);
+                if (f3 > 3) {
+                    ok = false;
+                    break;
+                }
+                if (check(addr, (size_t)1 << f3, true) == false) {
+                    return -1;
+                }
+                memcpy(&mem[addr - base], &b, (size_t)1 << f3);
+                write = false;
+                break;
+            }
+            // 立即数运算
+            case 0x13: {
+                uint32_t sh = w >> 20 & 63;
+                switch (f3) {
+                    case 0:
+                        res = a + imm_i;
+                        break;
+                    case 1:
+                        res = a << sh;
+                        ok  = f7 >> 1 == 0;
+                        break;
+                    case 2:
+                        res = (int64_t)a < imm_i;
+                        break;
+                    case 3:
+                        res = a < (uint64_t)imm_i;
+                        break;
+                    case 4:
+                        res = a ^ imm_i;
+                        break;
+                    case 5:
+                        res = f7 >> 1 == 0x10 ? (uint64_t)((int64_t)a >> sh)
+                                              : a >> sh;
+                        ok  = (f7 >> 1 & ~0x10) == 0;
+                        break;
+                    case 6:
+                        res = a | imm_i;
+                        break;
+                    case 7:
+                        res = a & imm_i;
+                        break;
+                }
+                break;
+            }
+            // 32 位立即数运算
+            case 0x1b: {
+                uint32_t sh = w >> 20 & 31;
+                switch (f3) {
+                    case 0:
+                        res = sext(a + imm_i, 32);
+                        break;
+                    case 1:
+                        res = sext((uint32_t)a << sh, 32);
+                        ok  = f7 == 0;
+                        break;
+                    case 5:
+                        res = f7 == 0x20 ? sext((int32_t)a >> sh, 32)
+                                         : sext((uint32_t)a >> sh, 32);
+                        ok  = (f7 & ~0x20) == 0;
+                        break;
+                    default:
+                        ok = false;
+                        break;
+                }
+                break;
+            }
+            // 寄存器运算
+            case 0x33:
+                if (f7 == 0x01) {
+                    __int128 sa = (int64_t)a, sb = (int64_t)b;
+                    switch (f3) {
+                        case 0:
+                            res = a * b;
+                            break;
+                        case 1:
+                            res = (uint64_t)(sa * sb >> 64);
+                            break;
+                        case 2:
+                            res = (uint64_t)(sa * (unsigned __int128)b >> 64);
+                            break;
+                        case 3:
+                            res = (uint64_t)((unsigned __int128)a * b >> 64);
+                            break;
+                        case 4:
+                            res = div_s(a, b, INT64_MIN);
+                            break;
+                        case 5:
+                            res = b == 0 ? UINT64_MAX : a / b;
+                            break;
+                        case 6:
+                            res = rem_s(a, b, INT64_MIN);
+                            break;
+                        case 7:
+                            res = b == 0 ? a : a % b;
+                            break;
+                    }
+                    break;
+                }
+                switch (f3 | f7 << 3) {
+                    case 0:
+                        res = a + b;
+                        break;
+                    case 0x20 << 3:
+                        res = a - b;
+                        break;
+                    case 1:
+                        res = a << (b & 63);
+                        break;
+                    case 2:
+                        res = (int64_t)a < (int64_t)b;
+                        break;
+                    case 3:
+                        res = a < b;
+                        break;
+                    case 4:
+                        res = a ^ b;
+                        break;
+                    case 5:
+                        res = a >> (b & 63);
+                        break;
+                    case 5 | 0x20 << 3:
+                        res = (int64_t)a >> (b & 63);
+                        break;
+                    case 6:
+                        res = a | b;
+                        break;
+                    case 7:
+                        res = a & b;
+                        break;
+                    default:
+                        ok = false;
+                        break;
+                }
+                break;
+            // 32 位寄存器运算
+            case 0x3b: {
+                int32_t  sa = a, sb = b;
+                uint32_t ua = a, ub = b;
+                switch (f3 | f7 << 3) {
+                    case 0:
+                        res = sext(ua + ub, 32);
+                        break;
+                    case 0x20 << 3:
+                        res = sext(ua - ub, 32);
+                        break;
+                    case 1:
+                        res = sext(ua << (ub & 31), 32);
+                        break;
+                    case 5:
+                        res = sext(ua >> (ub & 31), 32);
+                        break;
+                    case 5 | 0x20 << 3:
+                        res = sext(sa >> (ub & 31), 32);
+                        break;
+                    case 0 | 1 << 3:
+                        res = sext(ua * ub, 32);
+                        break;
+                    case 4 | 1 << 3:
+                        res = sext(div_s(sa, sb, INT32_MIN), 32);
+                        break;
+                    case 5 | 1 << 3:
+                        res = sext(ub == 0 ? UINT32_MAX : ua / ub, 32);
+                        break;
+                    case 6 | 1 << 3:
+                        res = sext(rem_s(sa, sb, INT32_MIN), 32);
+                        break;
+                    case 7 | 1 << 3:
+                        res = sext(ub == 0 ? ua : ua % ub, 32);
+                        break;
+                    default:
+                        ok = false;
+                        break;
+                }
+                break;
+            }
+            // fence 不需要做什么
+            case 0x0f:
+                write = false;
+                break;
+            case 0x73:
+                write = false;
+                if (w != 0x73) {
+                    ok = false;
+                    break;
+                }
+                if (x[RV_A7] == SIM_CALL_EXIT) {
+                    steps++;
+                    return x[RV_A0] & 0xff;
+                }
+                else {
+                    int64_t args[2] = {(int64_t)x[RV_A0], (int64_t)x[RV_A0 + 1]};
+                    int64_t ret;
+                    if (sim_runtime_call(x[RV_A7] - SIM_CALL_RUNTIME, args, ret,
+                                         mem, base, in, out, trap) == false) {
+                        return -1;
+                    }
+                    x[RV_A0] = ret;
+                }
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (ok == false) {
+            ostringstream os;
+            os << "illegal instruction 0x" << hex << w << " at 0x" << pc;
+            trap = os.str();
+            return -1;
+        }
+        if (write && rd != 0) {
+            x[rd] = res;
+        }
+        pc = next;
+        steps++;
+    }
+}
@@ -0,0 +1,97 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// simrt.cpp for Simple-XX/SimpleCompiler.
+
+#include "cstring"
+#include "sstream"
+#include "simrt.h"
+
+using namespace std;
+
+static const char *runtime_names[RT_CNT] = {
+    "getint", "getch",   "getarray",  "putint",
+    "putch",  "putarray", "starttime", "stoptime",
+};
+
+int sim_runtime_index(const string &_name) {
+    for (int i = 0; i < RT_CNT; i++) {
+        if (_name == runtime_names[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 检查数组是否在内存中
+static bool check(uint64_t _addr, size_t _size, const vector<uint8_t> &_mem,
+                  uint64_t _base, string &_trap) {
+    if (_addr < _base || _addr - _base + _size > _mem.size()) {
+        ostringstream os;
+        os << "invalid memory access at 0x" << hex << _addr;
+        _trap = os.str();
+        return false;
+    }
+    return true;
+}
+
+bool sim_runtime_call(int64_t _idx, const int64_t _args[2], int64_t &_ret,
+                      vector<uint8_t> &_mem, uint64_t _base, istream &_in,
+                      ostream &_out, string &_trap) {
+    _ret = 0;
+    switch (_idx) {
+        case RT_GETINT: {
+            int32_t v = 0;
+            _in >> v;
+            _ret = v;
+            break;
+        }
+        case RT_GETCH:
+            _ret = _in.get();
+            break;
+        case RT_GETARRAY: {
+            int32_t n = 0;
+            _in >> n;
+            if (n > 0 &&
+                check(_args[0], (size_t)n * 4, _mem, _base, _trap) == false) {
+                return false;
+            }
+            for (int32_t i = 0; i < n; i++) {
+                int32_t v = 0;
+                _in >> v;
+                memcpy(&_mem[_args[0] - _base + i * 4], &v, 4);
+            }
+            _ret = n;
+            break;
+        }
+        case RT_PUTINT:
+            _out << (int32_t)_args[0];
+            break;
+        case RT_PUTCH:
+            _out.put((char)_args[0]);
+            break;
+        case RT_PUTARRAY: {
+            int32_t n = _args[0];
+            _out << n << ":";
+            if (n > 0 &&
+                check(_args[1], (size_t)n * 4, _mem, _base, _trap) == false) {
+                return false;
+            }
+            for (int32_t i = 0; i < n; i++) {
+                int32_t v;
+                memcpy(&v, &_mem[_args[1] - _base + i * 4], 4);
+                _out << " " << v;
+            }
+            _out << "\n";
+            break;
+        }
+        // 计时函数不影响结果
+        case RT_STARTTIME:
+        case RT_STOPTIME:
+            break;
+        default:
+            _trap = "unknown system call " + to_string(_idx + SIM_CALL_RUNTIME);
+            return false;
+    }
+    return true;
+}
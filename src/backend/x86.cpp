@@ -0,0 +1,467 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// x86.cpp for Simple-XX/SimpleCompiler.
+
+#include "elf.h"
+#include "elfobj.h"
+#include "x86.h"
+
+using namespace std;
+
+// 通用寄存器编号
+enum x86_reg_t {
+    RAX,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+};
+
+// 前 6 个整数参数使用的寄存器
+static const x86_reg_t param_regs[] = {RDI, RSI, RDX, RCX, R8, R9};
+
+// 条件码，与 setcc/jcc 操作码的低 4 位一致
+enum x86_cond_t {
+    CC_E  = 0x4,
+    CC_NE = 0x5,
+    CC_L  = 0xc,
+    CC_GE = 0xd,
+    CC_LE = 0xe,
+    CC_G  = 0xf,
+};
+
+// 双操作数运算的操作码，r/m 为目的操作数
+enum x86_alu_t {
+    ALU_ADD  = 0x01,
+    ALU_SUB  = 0x29,
+    ALU_XOR  = 0x31,
+    ALU_CMP  = 0x39,
+    ALU_TEST = 0x85,
+};
+
+class X86Gen {
+private:
+    const IRModule &module;
+    ElfObject       obj;
+    // 代码，即 obj.text
+    string &code;
+    // 当前函数
+    const IRFunction *fun;
+    // 栈上数组相对 rbp 的偏移
+    int32_t frame_base;
+    // 各标号在代码中的位置
+    vector<size_t> labels;
+    // 需要回填的跳转：rel32 的位置与目标标号
+    vector<pair<size_t, int32_t>> fixups;
+    // 等待调用的参数
+    vector<IRArg> pending;
+
+    void byte(uint8_t _b) {
+        code += (char)_b;
+        return;
+    }
+    void dword(uint32_t _d) {
+        code.append((const char *)&_d, 4);
+        return;
+    }
+    // REX 前缀，w 为 64 位操作数，不需要时不输出
+    void rex(bool _w, int _reg, int _base) {
+        uint8_t r = 0x40 | (_w << 3) | ((_reg >> 3) << 2) | (_base >> 3);
+        if (r != 0x40) {
+            byte(r);
+        }
+        return;
+    }
+    // 寄存器间接寻址 [base + disp] 的 ModRM、SIB 与偏移
+    void mem(int _reg, int _base, int32_t _disp) {
+        uint8_t mod = 0x80;
+        if (_disp == 0 && (_base & 7) != RBP) {
+            mod = 0x00;
+        }
+        else if (_disp >= -128 && _disp <= 127) {
+            mod = 0x40;
+        }
+        byte(mod | ((_reg & 7) << 3) | (_base & 7));
+        if ((_base & 7) == RSP) {
+            byte(0x24);
+        }
+        if (mod == 0x40) {
+            byte((uint8_t)_disp);
+        }
+        else if (mod == 0x80) {
+            dword(_disp);
+        }
+        return;
+    }
+    // 寄存器直接寻址的 ModRM
+    void direct(int _reg, int _rm) {
+        byte(0xc0 | ((_reg & 7) << 3) | (_rm & 7));
+        return;
+    }
+    // 带 ModRM 的指令，操作数为寄存器与内存
+    void op_mem(bool _w, uint8_t _op, int _reg, int _base, int32_t _disp) {
+        rex(_w, _reg, _base);
+        byte(_op);
+        mem(_reg, _base, _disp);
+        return;
+    }
+    // 带 ModRM 的指令，两个操作数都为寄存器
+    void op_reg(bool _w, uint8_t _op, int _reg, int _rm) {
+        rex(_w, _reg, _rm);
+        byte(_op);
+        direct(_reg, _rm);
+        return;
+    }
+    // 虚拟寄存器在栈帧中的偏移
+    int32_t slot(int32_t _reg) const {
+        return -8 * (_reg + 1);
+    }
+    // 将操作数的 64 位值读入寄存器，整数为符号扩展后的值
+    void load(x86_reg_t _dst, const IRArg &_arg);
+    // 将 rax 写入虚拟寄存器
+    void store(const IRArg &_res) {
+        op_mem(true, 0x89, RAX, RBP, slot(_res.val));
+        return;
+    }
+    // 将 32 位的 eax 符号扩展到 rax
+    void cdqe(void) {
+        byte(0x48);
+        byte(0x98);
+        return;
+    }
+    // 到标号的 jmp 或 jcc
+    void jump(int _cond, int32_t _label);
+    // 生成一个函数
+    void function(const IRFunction &_fun, uint32_t _sym);
+    // 生成一条指令
+    void inst(const IRInst &_inst);
+    // 生成调用，参数为 pending 中的值
+    void call(int _callee);
+    // 函数返回
+    void epilogue(void) {
+        // leave; ret
+        byte(0xc9);
+        byte(0xc3);
+        return;
+    }
+
+public:
+    X86Gen(const IRModule &_module);
+    ~X86Gen(void);
+    string generate(void);
+};
+
+X86Gen::X86Gen(const IRModule &_module)
+    : module(_module), obj(EM_X86_64), code(obj.text), fun(NULL),
+      frame_base(0) {
+    return;
+}
+
+X86Gen::~X86Gen(void) {
+    return;
+}
+
+void X86Gen::load(x86_reg_t _dst, const IRArg &_arg) {
+    switch (_arg.kind) {
+        case ARG_REG:
+            op_mem(true, 0x8b, _dst, RBP, slot(_arg.val));
+            break;
+        case ARG_IMM:
+            // mov r64, simm32
+            rex(true, 0, _dst);
+            byte(0xc7);
+            direct(0, _dst);
+            dword(_arg.val);
+            break;
+        case ARG_GLOBAL: {
+            // lea r64, [rip + sym]
+            rex(true, _dst, 0);
+            byte(0x8d);
+            byte(((_dst & 7) << 3) | 0x05);
+            uint32_t sym = obj.symbol(module.globals[_arg.val].name);
+            obj.reloc(code.size(), sym, R_X86_64_PC32, -4);
+            dword(0);
+            break;
+        }
+        case ARG_FRAME:
+            op_mem(true, 0x8d, _dst, RBP, frame_base + _arg.val);
+            break;
+        default:
+            break;
+    }
+    return;
+}
+
+void X86Gen::jump(int _cond, int32_t _label) {
+    if (_cond < 0) {
+        byte(0xe9);
+    }
+    else {
+        byte(0x0f);
+        byte(0x80 | _cond);
+    }
+    fixups.push_back({code.size(), _label});
+    dword(0);
+    return;
+}
+
+// 超过 6 个的参数从右到左压栈，调用前 rsp 保持 16 字节对齐
+void X86Gen::call(int _callee) {
+    size_t n     = pending.size();
+    size_t stack = n > 6 ? n - 6 : 0;
+    size_t pad   = stack % 2 * 8;
+    if (pad != 0) {
+        // sub rsp, 8
+        op_reg(true, 0x83, 5, RSP);
+        byte(8);
+    }
+    for (size_t i = n; i > 6; i--) {
+        load(RAX, pending[i - 1]);
+        // push rax
+        byte(0x50);
+    }
+    for (size_t i = 0; i < n && i < 6; i++) {
+        load(param_regs[i], pending[i]);
+    }
+    // 变长参数函数以 al 给出向量寄存器个数
+    op_reg(false, ALU_XOR, RAX, RAX);
+    // call rel32，经 PLT 调用外部函数
+    byte(0xe8);
+    obj.reloc(code.size(), obj.symbol(module.funs[_callee].name),
+              R_X86_64_PLT32, -4);
+    dword(0);
+    if (stack != 0) {
+        // add rsp, imm32
+        op_reg(true, 0x81, 0, RSP);
+        dword(stack * 8 + pad);
+    }
+    pending.clear();
+    return;
+}
+
+void X86Gen::inst(const IRInst &_inst) {
+    switch (_inst.op) {
+        case OP_NOP:
+            break;
+        case OP_LABEL:
+            labels[_inst.result.val] = code.size();
+            break;
+        case OP_AS:
+        case OP_LEA:
+            load(RAX, _inst.arg1);
+            store(_inst.result);
+            break;
+        case OP_ADD:
+        case OP_SUB:
+            load(RAX, _inst.arg1);
+            load(RCX, _inst.arg2);
+            op_reg(false, _inst.op == OP_ADD ? ALU_ADD : ALU_SUB, RCX, RAX);
+            cdqe();
+            store(_inst.result);
+            break;
+        case OP_MUL:
+            load(RAX, _inst.arg1);
+            load(RCX, _inst.arg2);
+            // imul eax, ecx
+            byte(0x0f);
+            byte(0xaf);
+            direct(RAX, RCX);
+            cdqe();
+            store(_inst.result);
+            break;
+        case OP_DIV:
+        case OP_MOD:
+            load(RAX, _inst.arg1);
+            load(RCX, _inst.arg2);
+            // cdq; idiv ecx
+            byte(0x99);
+            op_reg(false, 0xf7, 7, RCX);
+            if (_inst.op == OP_MOD) {
+                // mov eax, edx
+                op_reg(false, 0x89, RDX, RAX);
+            }
+            cdqe();
+            store(_inst.result);
+            break;
+        case OP_NEG:
+            load(RAX, _inst.arg1);
+            // neg eax
+            op_reg(false, 0xf7, 3, RAX);
+            cdqe();
+            store(_inst.result);
+            break;
+        case OP_GT:
+        case OP_GE:
+        case OP_LT:
+        case OP_LE:
+        case OP_EQU:
+        case OP_NE:
+        case OP_NOT: {
+            x86_cond_t cc = CC_E;
+            load(RAX, _inst.arg1);
+            if (_inst.op == OP_NOT) {
+                op_reg(false, ALU_TEST, RAX, RAX);
+            }
+            else {
+                load(RCX, _inst.arg2);
+                op_reg(false, ALU_CMP, RCX, RAX);
+                static const x86_cond_t conds[] = {CC_G,  CC_GE, CC_L,
+                                                   CC_LE, CC_E,  CC_NE};
+                cc = conds[_inst.op - OP_GT];
+            }
+            // setcc al; movzx eax, al
+            byte(0x0f);
+            byte(0x90 | cc);
+            direct(0, RAX);
+            byte(0x0f);
+            byte(0xb6);
+            direct(RAX, RAX);
+            store(_inst.result);
+            break;
+        }
+        case OP_OFFSET:
+            load(RAX, _inst.arg1);
+            load(RCX, _inst.arg2);
+            // movsxd rcx, ecx; add rax, rcx
+            op_reg(true, 0x63, RCX, RCX);
+            op_reg(true, ALU_ADD, RCX, RAX);
+            store(_inst.result);
+            break;
+        case OP_SET:
+            load(RCX, _inst.arg1);
+            load(RAX, _inst.result);
+            // mov [rcx], eax
+            op_mem(false, 0x89, RAX, RCX, 0);
+            break;
+        case OP_GET:
+            load(RCX, _inst.arg1);
+            // movsxd rax, [rcx]
+            op_mem(true, 0x63, RAX, RCX, 0);
+            store(_inst.result);
+            break;
+        case OP_ZERO:
+            load(RDI, _inst.arg1);
+            load(RCX, _inst.arg2);
+            op_reg(false, ALU_XOR, RAX, RAX);
+            // rep stosb
+            byte(0xf3);
+            byte(0xaa);
+            break;
+        case OP_JMP:
+            jump(-1, _inst.result.val);
+            break;
+        case OP_JT:
+        case OP_JF:
+            load(RAX, _inst.arg1);
+            op_reg(false, ALU_TEST, RAX, RAX);
+            jump(_inst.op == OP_JT ? CC_NE : CC_E, _inst.result.val);
+            break;
+        case OP_ARG:
+            pending.push_back(_inst.arg1);
+            break;
+        case OP_PROC:
+            call(_inst.arg1.val);
+            break;
+        case OP_CALL:
+            call(_inst.arg1.val);
+            cdqe();
+            store(_inst.result);
+            break;
+        case OP_RET:
+            epilogue();
+            break;
+        case OP_RETV:
+            load(RAX, _inst.arg1);
+            epilogue();
+            break;
+    }
+    return;
+}
+
+// 栈帧自高向低为：虚拟寄存器、栈上数组，rsp 按 16 字节对齐
+void X86Gen::function(const IRFunction &_fun, uint32_t _sym) {
+    ElfObject::align(code, 16, (char)0x90);
+    size_t start = code.size();
+    fun          = &_fun;
+    frame_base   = -8 * (int32_t)_fun.reg_cnt() - ((_fun.frame_size + 7) & ~7);
+    uint32_t size = (-frame_base + 15) & ~15;
+    labels.assign(_fun.label_cnt, 0);
+    fixups.clear();
+    pending.clear();
+    // push rbp; mov rbp, rsp; sub rsp, size
+    byte(0x55);
+    op_reg(true, 0x89, RSP, RBP);
+    if (size != 0) {
+        op_reg(true, 0x81, 5, RSP);
+        dword(size);
+    }
+    // 参数写入 0 号开始的虚拟寄存器，第 7 个起在调用者的栈上
+    for (uint32_t i = 0; i < _fun.param_cnt; i++) {
+        x86_reg_t src = RAX;
+        if (i < 6) {
+            src = param_regs[i];
+        }
+        else {
+            op_mem(true, 0x8b, RAX, RBP, 16 + 8 * (i - 6));
+        }
+        // 整数参数只有低 32 位有效
+        if (_fun.reg_ptr[i] == false) {
+            op_reg(true, 0x63, RAX, src);
+            src = RAX;
+        }
+        op_mem(true, 0x89, src, RBP, slot(i));
+    }
+    for (auto &i : _fun.code) {
+        inst(i);
+    }
+    // 没有以返回结束的函数补上返回
+    if (_fun.code.empty() || (_fun.code.back().op != OP_RET &&
+                              _fun.code.back().op != OP_RETV)) {
+        op_reg(false, ALU_XOR, RAX, RAX);
+        epilogue();
+    }
+    for (auto &f : fixups) {
+        int32_t rel = labels[f.second] - (f.first + 4);
+        code.replace(f.first, 4, (const char *)&rel, 4);
+    }
+    obj.define(_sym, SEC_TEXT, start, code.size() - start, true);
+    return;
+}
+
+string X86Gen::generate(void) {
+    // 常量放在 .rodata，没有初始值的放在 .bss
+    for (auto &g : module.globals) {
+        uint32_t sym = obj.symbol(g.name);
+        if (g.init.empty() && g.const_flag == false) {
+            obj.bss_size = (obj.bss_size + 7) & ~(uint64_t)7;
+            obj.define(sym, SEC_BSS, obj.bss_size, g.size, false);
+            obj.bss_size += g.size;
+            continue;
+        }
+        string &sec = g.const_flag ? obj.rodata : obj.data;
+        ElfObject::align(sec, 8);
+        obj.define(sym, g.const_flag ? SEC_RODATA : SEC_DATA, sec.size(),
+                   g.size, false);
+        string bytes((const char *)g.init.data(), g.init.size() * 4);
+        bytes.resize(g.size, '\0');
+        sec += bytes;
+    }
+    for (auto &f : module.funs) {
+        uint32_t sym = obj.symbol(f.name);
+        if (f.extern_flag == false) {
+            function(f, sym);
+        }
+    }
+    return obj.write();
+}
+
+string x86_emit(const IRModule &_module) {
+    X86Gen gen(_module);
+    return gen.generate();
+}
@@ -0,0 +1,325 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// compile_bench.cpp for Simple-XX/SimpleCompiler.
+
+// 编译耗时回归检测
+// 将固定的语料编译 N 遍，统计各阶段墙上时间的中位数与中位数绝对偏差 (MAD)，
+// 与仓库中的基线比较，某一阶段的中位数超过基线的 (1 + 阈值) 倍，
+// 且超出量大于噪声 (3 倍 MAD) 时判为变慢，返回值非 0
+// 基线与机器和构建配置有关，更换环境后用 --write-baseline 重新生成
+// 基线记录了构建类型与编译器，与当前构建不同时不做比较
+
+#include "algorithm"
+#include "cmath"
+#include "cstdio"
+#include "cstdlib"
+#include "fstream"
+#include "iostream"
+#include "map"
+#include "regex"
+#include "sstream"
+#include "string"
+#include "vector"
+#include "dirent.h"
+#include "sys/stat.h"
+#include "driver.h"
+#include "ir_tac.h"
+#include "timer.h"
+
+using namespace std;
+
+// 构建类型与编译器，由 CMake 给出
+#ifndef SIMPLE_COMPILER_BUILD_TYPE
+#define SIMPLE_COMPILER_BUILD_TYPE "unknown"
+#endif
+#ifndef SIMPLE_COMPILER_CXX
+#define SIMPLE_COMPILER_CXX "unknown"
+#endif
+
+// 记录基线时的环境
+struct setup_t {
+    int    level;
+    size_t files;
+    string build;
+    string compiler;
+    bool   operator==(const setup_t &o) const {
+        return level == o.level && files == o.files && build == o.build &&
+               compiler == o.compiler;
+    }
+};
+
+// 一个阶段的统计结果，单位为毫秒
+struct summary_t {
+    string name;
+    double median;
+    double mad;
+    // 允许的相对增长，基线中未给出时为 -1
+    double threshold;
+};
+
+// 收集语料，目录中的 .sy 与 .c 文件按名字排序
+static void collect(const string &path, vector<string> &files) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        cout << "Corpus not found: " << path << endl;
+        return;
+    }
+    if (S_ISDIR(st.st_mode) == false) {
+        files.push_back(path);
+        return;
+    }
+    vector<string> names;
+    DIR           *d = opendir(path.c_str());
+    while (dirent *ent = readdir(d)) {
+        string name = ent->d_name;
+        size_t dot  = name.rfind('.');
+        if (dot != string::npos &&
+            (name.substr(dot) == ".sy" || name.substr(dot) == ".c")) {
+            names.push_back(path + "/" + name);
+        }
+    }
+    closedir(d);
+    sort(names.begin(), names.end());
+    files.insert(files.end(), names.begin(), names.end());
+    return;
+}
+
+static double median(vector<double> v) {
+    sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// 中位数绝对偏差
+static double mad(const vector<double> &v, double med) {
+    vector<double> dev;
+    for (auto x : v) {
+        dev.push_back(fabs(x - med));
+    }
+    return median(dev);
+}
+
+// 读取基线，同时取得记录基线时的优化级别、文件数、构建类型与编译器
+// 没有记录构建类型与编译器的旧基线不能比较
+static bool read_baseline(const string &path, vector<summary_t> &base,
+                          setup_t &setup) {
+    ifstream fin(path);
+    if (fin.is_open() == false) {
+        return false;
+    }
+    ostringstream ss;
+    ss << fin.rdbuf();
+    string      text = ss.str();
+    const char *num  = "(-?[0-9.eE+-]+)";
+    smatch      m;
+    regex       head("\"level\": ([0-9]+), \"files\": ([0-9]+)");
+    if (regex_search(text, m, head)) {
+        setup.level = atoi(m[1].str().c_str());
+        setup.files = atoi(m[2].str().c_str());
+    }
+    regex build("\"build\": \"([^\"]*)\", \"compiler\": \"([^\"]*)\"");
+    setup.build    = "";
+    setup.compiler = "";
+    if (regex_search(text, m, build)) {
+        setup.build    = m[1];
+        setup.compiler = m[2];
+    }
+    regex item(string("\\{\"name\": \"([^\"]+)\", \"median_ms\": ") + num +
+               ", \"mad_ms\": " + num + "(, \"threshold\": " + num +
+               ")?\\}");
+    for (sregex_iterator it(text.begin(), text.end(), item), end; it != end;
+         ++it) {
+        summary_t s;
+        s.name      = (*it)[1];
+        s.median    = atof((*it)[2].str().c_str());
+        s.mad       = atof((*it)[3].str().c_str());
+        s.threshold = (*it)[5].matched ? atof((*it)[5].str().c_str()) : -1;
+        base.push_back(s);
+    }
+    return true;
+}
+
+static void write_summary(ostream &os, const vector<summary_t> &sums,
+                          int runs, const setup_t &setup) {
+    char line[256];
+    os << "{\"runs\": " << runs << ", \"level\": " << setup.level
+       << ", \"files\": " << setup.files << ", \"build\": \"" << setup.build
+       << "\", \"compiler\": \"" << setup.compiler << "\", \"phases\": [\n";
+    for (size_t i = 0; i < sums.size(); i++) {
+        auto &s = sums[i];
+        if (s.threshold >= 0) {
+            snprintf(line, sizeof(line),
+                     "{\"name\": \"%s\", \"median_ms\": %.6f, \"mad_ms\": "
+                     "%.6f, \"threshold\": %.3f}",
+                     s.name.c_str(), s.median, s.mad, s.threshold);
+        }
+        else {
+            snprintf(line, sizeof(line),
+                     "{\"name\": \"%s\", \"median_ms\": %.6f, \"mad_ms\": "
+                     "%.6f}",
+                     s.name.c_str(), s.median, s.mad);
+        }
+        os << line << (i + 1 == sums.size() ? "\n" : ",\n");
+    }
+    os << "]}\n";
+    return;
+}
+
+int main(int argc, char **argv) {
+    vector<string> corpus;
+    string         baseline       = "";
+    string         write_baseline = "";
+    string         json           = "";
+    int            runs           = 15;
+    int            level          = 2;
+    double         threshold      = 0.10;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--corpus" && i + 1 < argc) {
+            corpus.push_back(argv[++i]);
+        }
+        else if (arg == "--runs" && i + 1 < argc) {
+            runs = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--level" && i + 1 < argc) {
+            level = atoi(argv[++i]);
+        }
+        else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        }
+        else if (arg == "--baseline" && i + 1 < argc) {
+            baseline = argv[++i];
+        }
+        else if (arg == "--write-baseline" && i + 1 < argc) {
+            write_baseline = argv[++i];
+        }
+        else if (arg == "--json" && i + 1 < argc) {
+            json = argv[++i];
+        }
+        else {
+            cout << "usage: compile_bench --corpus path [--corpus path ...] "
+                    "[--runs 15] [--level 2] [--threshold 0.10]\n"
+                    "                     [--baseline base.json] "
+                    "[--write-baseline base.json] [--json out.json]"
+                 << endl;
+            return 1;
+        }
+    }
+    vector<string> files;
+    for (auto &c : corpus) {
+        collect(c, files);
+    }
+    if (files.empty()) {
+        cout << "No input files" << endl;
+        return 1;
+    }
+    time_report = true;
+    // 第一遍预热，不计入统计
+    map<string, vector<double>> samples;
+    vector<string>              order;
+    for (int run = 0; run <= runs; run++) {
+        time_report_reset();
+        {
+            Phase phase("total");
+            for (auto &f : files) {
+                IRModule module;
+                if (compile_module(f, module, level) != 0) {
+                    cout << "Compile error: " << f << endl;
+                    return 1;
+                }
+            }
+        }
+        if (run == 0) {
+            continue;
+        }
+        for (auto &p : phase_stats()) {
+            if (samples.count(p.name) == 0) {
+                order.push_back(p.name);
+            }
+            samples[p.name].push_back(p.wall / 1e6);
+        }
+    }
+    vector<summary_t> base;
+    setup_t           setup = {level, files.size(), SIMPLE_COMPILER_BUILD_TYPE,
+                               SIMPLE_COMPILER_CXX};
+    setup_t           base_setup = setup;
+    if (baseline.empty() == false &&
+        read_baseline(baseline, base, base_setup) == false) {
+        cout << "Baseline not found: " << baseline << endl;
+        return 1;
+    }
+    // 语料、优化级别或构建配置不同时结果不可比较
+    if ((base_setup == setup) == false) {
+        cout << "Baseline was recorded with -O" << base_setup.level << " on "
+             << base_setup.files << " files, build '" << base_setup.build
+             << "', compiler '" << base_setup.compiler
+             << "'; this run is -O" << setup.level << " on " << setup.files
+             << " files, build '" << setup.build << "', compiler '"
+             << setup.compiler << "', not comparable" << endl;
+        return 1;
+    }
+    vector<summary_t> sums;
+    int               regressions = 0;
+    char              line[256];
+    snprintf(line, sizeof(line), "%-18s %12s %10s %12s %9s %8s\n", "phase",
+             "median(ms)", "mad(ms)", "base(ms)", "change", "status");
+    cout << line;
+    for (auto &name : order) {
+        summary_t s;
+        s.name      = name;
+        s.median    = median(samples[name]);
+        s.mad       = mad(samples[name], s.median);
+        s.threshold = -1;
+        string base_text = "-", change = "-", status = "new";
+        for (auto &b : base) {
+            if (b.name != name) {
+                continue;
+            }
+            double limit = b.threshold >= 0 ? b.threshold : threshold;
+            // 保留基线中为该阶段单独设置的阈值
+            s.threshold  = b.threshold;
+            double delta = s.median - b.median;
+            snprintf(line, sizeof(line), "%.3f", b.median);
+            base_text = line;
+            if (b.median > 0) {
+                snprintf(line, sizeof(line), "%+.1f%%", delta / b.median * 100);
+                change = line;
+            }
+            status       = "ok";
+            if (delta > b.median * limit && delta > 3 * max(s.mad, b.mad)) {
+                status = "SLOWER";
+                regressions++;
+            }
+            else if (-delta > b.median * limit &&
+                     -delta > 3 * max(s.mad, b.mad)) {
+                status = "faster";
+            }
+        }
+        snprintf(line, sizeof(line), "%-18s %12.3f %10.3f %12s %9s %8s\n",
+                 name.c_str(), s.median, s.mad, base_text.c_str(),
+                 change.c_str(), status.c_str());
+        cout << line;
+        sums.push_back(s);
+    }
+    cout << files.size() << " files, " << runs << " runs, -O" << level
+         << ", " << setup.build << " build, " << setup.compiler << endl;
+    if (json.empty() == false) {
+        ofstream fout(json, ios::out | ios::trunc);
+        write_summary(fout, sums, runs, setup);
+    }
+    if (write_baseline.empty() == false) {
+        ofstream fout(write_baseline, ios::out | ios::trunc);
+        if (fout.is_open() == false) {
+            cout << "Output file not open: " << write_baseline << endl;
+            return 1;
+        }
+        write_summary(fout, sums, runs, setup);
+        cout << "Baseline written to " << write_baseline << endl;
+    }
+    if (regressions != 0) {
+        cout << regressions << " phase(s) slower than the baseline" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,286 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// frontend_bench.cpp for Simple-XX/SimpleCompiler.
+
+// 前端基准测试
+// 生成 1KB 到 1GB 的合成 SysY 源文件，分别测量 Scanner::scan、
+// Lexer::lexing、Keywords::get_tag、Parser::parsing 与 AST 析构的吞吐量
+
+#include "cstdio"
+#include "cstdlib"
+#include "cstring"
+#include "fstream"
+#include "iostream"
+#include "string"
+#include "vector"
+#include "time.h"
+#include "common.h"
+#include "init.h"
+#include "timer.h"
+
+using namespace std;
+
+// 一项测量结果
+struct result_t {
+    // 测量项目
+    const char *bench;
+    // 输入大小，单位为字节
+    uint64_t size;
+    // 重复次数
+    uint64_t reps;
+    // 平均每次耗时，单位为秒
+    double seconds;
+    // 每次处理的 token 数
+    uint64_t tokens;
+    // 每次处理的 AST 结点数
+    uint64_t nodes;
+    // 每次的分配次数
+    uint64_t allocs;
+};
+
+static vector<result_t> results;
+
+static double now(void) {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 生成不小于 size 字节的源文件，返回实际大小，文件写不出时返回 0
+// 每个单元包含常量、多维数组与初始化列表、循环、分支、调用与数组参数
+static uint64_t generate(const string &path, uint64_t size) {
+    ofstream fout(path, ios::out | ios::trunc);
+    if (fout.is_open() == false) {
+        return 0;
+    }
+    uint64_t len = 0;
+    for (int i = 0; len < size; i++) {
+        string n    = std::to_string(i);
+        string unit = "const int C" + n + " = " + n + ", D" + n + " = C" + n +
+                      " * 2;\n"
+                      "int g" +
+                      n +
+                      "[4][4] = {{1, 2}, {3}, 4, 5};\n"
+                      "int f" +
+                      n +
+                      "(int a, int b[][4]) {\n"
+                      "    int s = 0, k = 0;\n"
+                      "    // loop\n"
+                      "    while (k != a) {\n"
+                      "        if (k % 2 == 0 && s >= C" +
+                      n +
+                      ")\n"
+                      "            s = s + b[k % 4][1] * 3 - D" +
+                      n +
+                      ";\n"
+                      "        else {\n"
+                      "            s = s - " +
+                      (i == 0 ? string("a") : "f" + std::to_string(i - 1) +
+                                                  "(k, g" + n + ")") +
+                      ";\n"
+                      "        }\n"
+                      "        k = k + 1;\n"
+                      "    }\n"
+                      "    return s;\n"
+                      "}\n";
+        fout << unit;
+        len += unit.size();
+    }
+    fout.close();
+    return fout.fail() ? 0 : len;
+}
+
+static uint64_t allocs_now(void) {
+    uint64_t count, bytes;
+    alloc_stats(count, bytes);
+    return count;
+}
+
+// 重复执行直到累计时间不少于 min_time，返回平均耗时
+template <typename F>
+static result_t measure(const char *bench, uint64_t size, double min_time,
+                        F fun) {
+    result_t res = {bench, size, 0, 0, 0, 0, 0};
+    double   total  = 0;
+    uint64_t allocs = 0;
+    do {
+        uint64_t tokens = stat_counters[STAT_TOKENS];
+        uint64_t nodes  = stat_counters[STAT_AST_NODES];
+        uint64_t a      = allocs_now();
+        double   start  = now();
+        res.tokens      = fun();
+        total += now() - start;
+        allocs += allocs_now() - a;
+        if (res.tokens == 0) {
+            res.tokens = stat_counters[STAT_TOKENS] - tokens;
+        }
+        res.nodes = stat_counters[STAT_AST_NODES] - nodes;
+        res.reps++;
+    } while (total < min_time);
+    res.seconds = total / res.reps;
+    res.allocs  = allocs / res.reps;
+    results.push_back(res);
+    return res;
+}
+
+// 在当前文件上运行全部测量
+static void bench_file(const string &path, uint64_t size, double min_time) {
+    // Scanner::scan
+    measure("scan", size, min_time, [&]() -> uint64_t {
+        error = new Error(path);
+        Scanner scanner(path);
+        while (scanner.is_done() == false) {
+            scanner.scan();
+        }
+        delete error;
+        return 0;
+    });
+    // Lexer::lexing，token 由 Parser::next 计数，这里自行计数
+    measure("lex", size, min_time, [&]() -> uint64_t {
+        error = new Error(path);
+        Scanner  scanner(path);
+        Lexer    lexer(scanner);
+        uint64_t tokens = 0;
+        while (lexer.is_done() == false) {
+            delete lexer.lexing();
+            tokens++;
+        }
+        delete error;
+        return tokens;
+    });
+    // Keywords::get_tag，按源文件中标识符的比例混合关键字与普通标识符
+    static const char *words[] = {"int", "s",     "k",     "while", "if",
+                                  "b",   "f1234", "C1234", "else",  "return",
+                                  "const", "g1234", "a",   "D1234", "void"};
+    uint64_t lookups = size / 8;
+    measure("keywords", size, min_time, [&]() -> uint64_t {
+        Keywords keywords;
+        uint64_t hit = 0;
+        for (uint64_t i = 0; i < lookups; i++) {
+            hit += keywords.get_tag(words[i % 15]) != ID;
+        }
+        // 防止循环被优化掉
+        if (hit == UINT64_MAX) {
+            cout << hit;
+        }
+        return lookups;
+    });
+    // Parser::parsing 与 AST 析构
+    ASTPtr prog;
+    measure("parse", size, min_time, [&]() -> uint64_t {
+        prog.reset();
+        error = new Error(path);
+        Scanner scanner(path);
+        Lexer   lexer(scanner);
+        Parser  parser(lexer);
+        prog = parser.parsing();
+        delete error;
+        return 0;
+    });
+    uint64_t nodes = results.back().nodes;
+    measure("teardown", size, 0, [&]() -> uint64_t {
+        prog.reset();
+        return 0;
+    });
+    results.back().nodes = nodes;
+    error = NULL;
+    return;
+}
+
+static void print_text(ostream &os) {
+    char line[256];
+    snprintf(line, sizeof(line), "%-9s %10s %6s %10s %10s %12s %12s %9s\n",
+             "bench", "size", "reps", "time(ms)", "MB/s", "tokens/s",
+             "nodes/s", "alloc/tok");
+    os << line;
+    for (auto &r : results) {
+        double mb = r.size / 1048576.0;
+        snprintf(line, sizeof(line),
+                 "%-9s %10lu %6lu %10.3f %10.2f %12.0f %12.0f %9.2f\n", r.bench,
+                 r.size, r.reps, r.seconds * 1e3, mb / r.seconds,
+                 r.tokens / r.seconds, r.nodes / r.seconds,
+                 r.tokens ? (double)r.allocs / r.tokens : 0.0);
+        os << line;
+    }
+    return;
+}
+
+static void print_json(ostream &os) {
+    char line[512];
+    os << "{\"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        auto & r  = results[i];
+        double mb = r.size / 1048576.0;
+        snprintf(line, sizeof(line),
+                 "{\"bench\": \"%s\", \"size\": %lu, \"reps\": %lu, "
+                 "\"seconds\": %.9f, \"mb_per_s\": %.3f, \"tokens\": %lu, "
+                 "\"tokens_per_s\": %.1f, \"nodes\": %lu, \"nodes_per_s\": "
+                 "%.1f, \"allocs_per_token\": %.3f}",
+                 r.bench, r.size, r.reps, r.seconds, mb / r.seconds, r.tokens,
+                 r.tokens / r.seconds, r.nodes, r.nodes / r.seconds,
+                 r.tokens ? (double)r.allocs / r.tokens : 0.0);
+        os << line << (i + 1 == results.size() ? "\n" : ",\n");
+    }
+    os << "]}\n";
+    return;
+}
+
+int main(int argc, char **argv) {
+    uint64_t min_size = 1 << 10;
+    // 解析大文件时 AST 与 token 都在内存中，默认只测到 16MB
+    uint64_t max_size = 16 << 20;
+    double   min_time = 0.2;
+    string   dir      = "/tmp";
+    string   json     = "";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--min-size" && i + 1 < argc) {
+            min_size = parse_size(argv[++i]);
+        }
+        else if (arg == "--max-size" && i + 1 < argc) {
+            max_size = parse_size(argv[++i]);
+        }
+        else if (arg == "--min-time" && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        }
+        else if (arg == "--dir" && i + 1 < argc) {
+            dir = argv[++i];
+        }
+        else if (arg == "--json" && i + 1 < argc) {
+            json = argv[++i];
+        }
+        else {
+            cout << "usage: frontend_bench [--min-size 1K] [--max-size 16M] "
+                    "[--min-time 0.2] [--dir /tmp] [--json out.json]"
+                 << endl;
+            return 1;
+        }
+    }
+    // 打开计数器与分配统计
+    time_report = true;
+    // 每次增大 4 倍
+    for (uint64_t size = min_size; size <= max_size; size *= 4) {
+        string   path = dir + "/frontend_bench_" + std::to_string(size) + ".c";
+        uint64_t len  = generate(path, size);
+        // 生成的文件写不出或读不回时结果没有意义，pgo 目标依赖此处的退出码
+        if (len == 0 || Scanner(path).is_open() == false) {
+            cout << "Cannot write " << path << endl;
+            remove(path.c_str());
+            return 1;
+        }
+        bench_file(path, len, min_time);
+        remove(path.c_str());
+    }
+    print_text(cout);
+    if (json.empty() == false) {
+        ofstream fout(json, ios::out | ios::trunc);
+        if (fout.is_open() == false) {
+            cout << "Output file not open: " << json << endl;
+            return 1;
+        }
+        print_json(fout);
+        cout << "Results written to " << json << endl;
+    }
+    return 0;
+}
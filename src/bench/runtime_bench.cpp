@@ -0,0 +1,349 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// runtime_bench.cpp for Simple-XX/SimpleCompiler.
+
+// 运行时基准测试
+// 在各优化级别下编译 kernels 目录中的 SysY 程序，以 NAME.in 为输入执行，
+// 与 NAME.out 比较输出，并报告耗时、执行的指令条数与宿主机指令数
+// 指令数通过 perf_event_open 获得，不可用时只报告耗时
+// 程序默认由三地址码解释器执行，--engine rv64 与 --engine a64 时编译为
+// RV64IM 或 AArch64 并在对应的模拟器中执行，报告的是模拟器退出前执行完的指令条数，
+// --engine bc 时写出字节码并重新读入，在字节码虚拟机中执行，报告的是字节码指令条数
+
+#include "algorithm"
+#include "cstdio"
+#include "cstdlib"
+#include "cstring"
+#include "fstream"
+#include "iostream"
+#include "sstream"
+#include "string"
+#include "vector"
+#include "dirent.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/ioctl.h"
+#include "sys/syscall.h"
+#include "linux/perf_event.h"
+#include "a64sim.h"
+#include "bytecode.h"
+#include "driver.h"
+#include "ir_interp.h"
+#include "rvsim.h"
+
+using namespace std;
+
+// 一项测量结果
+struct result_t {
+    // 程序名
+    string kernel;
+    // 优化级别
+    int level;
+    // 输出是否正确
+    bool ok;
+    // 编译耗时，单位为秒
+    double compile_seconds;
+    // 中间代码条数
+    uint64_t ir_insts;
+    // 执行的中间代码或 RV64 指令条数
+    uint64_t steps;
+    // 宿主机指令数，不可用时为 -1
+    int64_t instructions;
+    // 各次运行中最短的耗时，单位为秒
+    double seconds;
+    // 运行次数
+    int reps;
+};
+
+static vector<result_t> results;
+// 执行引擎，ir、rv64、a64 或 bc
+static string engine = "ir";
+
+static double now(void) {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 读取整个文件
+static bool read_file(const string &path, string &content) {
+    ifstream fin(path, ios::in | ios::binary);
+    if (fin.is_open() == false) {
+        return false;
+    }
+    ostringstream ss;
+    ss << fin.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+// 本线程在用户态执行的指令数计数器，不可用时返回 -1
+static int open_counter(void) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// 列出目录中的 .sy 文件
+static vector<string> list_kernels(const string &dir) {
+    vector<string> names;
+    DIR           *d = opendir(dir.c_str());
+    if (d == NULL) {
+        return names;
+    }
+    while (dirent *ent = readdir(d)) {
+        string name = ent->d_name;
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, ".sy") == 0) {
+            names.push_back(name.substr(0, name.size() - 3));
+        }
+    }
+    closedir(d);
+    sort(names.begin(), names.end());
+    return names;
+}
+
+// 编译并运行一个程序
+// 输出按 SysY 测试用例的格式在末尾补换行并附上退出码
+static result_t bench_kernel(const string &dir, const string &name, int level,
+                             int reps, int counter) {
+    result_t res = {name, level, false, 0, 0, 0, -1, 0, 0};
+    string   input, expect;
+    read_file(dir + "/" + name + ".in", input);
+    read_file(dir + "/" + name + ".out", expect);
+    IRModule module;
+    double   start = now();
+    if (compile_module(dir + "/" + name + ".sy", module, level) != 0) {
+        cout << name << ": compile error" << endl;
+        return res;
+    }
+    RVImage  image;
+    A64Image a64_image;
+    BCModule bc;
+    if (engine == "rv64") {
+        RVProgram prog;
+        string    err;
+        riscv_lower(module, prog);
+        if (riscv_link(prog, image, err) == false) {
+            cout << name << " -O" << level << ": " << err << endl;
+            return res;
+        }
+    }
+    else if (engine == "a64") {
+        A64Program prog;
+        string     err;
+        aarch64_lower(module, prog);
+        if (aarch64_link(prog, a64_image, err) == false) {
+            cout << name << " -O" << level << ": " << err << endl;
+            return res;
+        }
+    }
+    else if (engine == "bc") {
+        BCModule lowered;
+        string   err;
+        bc_lower(module, lowered);
+        if (bc_read(bc_write(lowered), bc, err) == false) {
+            cout << name << " -O" << level << ": " << err << endl;
+            return res;
+        }
+    }
+    res.compile_seconds = now() - start;
+    res.ir_insts        = module.inst_cnt();
+    res.ok              = true;
+    for (int i = 0; i < reps; i++) {
+        istringstream in(input);
+        ostringstream out;
+        IRInterp      interp(module, in, out);
+        RVSim         sim(image, in, out);
+        A64Sim        a64(a64_image, in, out);
+        BCVM          vm(bc, in, out);
+        if (counter >= 0) {
+            ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        start          = now();
+        int    code    = engine == "rv64"  ? sim.run()
+                         : engine == "a64" ? a64.run()
+                         : engine == "bc"  ? vm.run()
+                                           : interp.run();
+        double seconds = now() - start;
+        if (counter >= 0) {
+            ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+            int64_t count = 0;
+            if (read(counter, &count, sizeof(count)) == sizeof(count) &&
+                (res.instructions < 0 || count < res.instructions)) {
+                res.instructions = count;
+            }
+        }
+        const string &trap = engine == "rv64"  ? sim.get_trap()
+                             : engine == "a64" ? a64.get_trap()
+                             : engine == "bc"  ? vm.get_trap()
+                                               : interp.get_trap();
+        if (trap.empty() == false) {
+            cout << name << " -O" << level << ": " << trap << endl;
+            res.ok = false;
+            break;
+        }
+        string output = out.str();
+        if (output.empty() == false && output.back() != '\n') {
+            output += "\n";
+        }
+        output += to_string(code) + "\n";
+        if (output != expect) {
+            cout << name << " -O" << level << ": wrong output" << endl;
+            res.ok = false;
+            break;
+        }
+        res.steps = engine == "rv64"  ? sim.get_steps()
+                    : engine == "a64" ? a64.get_steps()
+                    : engine == "bc"  ? vm.get_steps()
+                                      : interp.get_steps();
+        if (res.reps == 0 || seconds < res.seconds) {
+            res.seconds = seconds;
+        }
+        res.reps++;
+    }
+    return res;
+}
+
+static void print_text(ostream &os) {
+    char line[256];
+    snprintf(line, sizeof(line), "%-12s %5s %6s %10s %8s %14s %14s %10s %8s\n",
+             "kernel", "level", "status", "compile(ms)", "ir",
+             engine == "rv64"  ? "rv64 insts"
+             : engine == "a64" ? "a64 insts"
+             : engine == "bc"  ? "bc insts"
+                               : "ir steps",
+             "instructions", "time(ms)", "speedup");
+    os << line;
+    for (auto &r : results) {
+        // 与同一程序的 O0 比较
+        double base = 0;
+        for (auto &b : results) {
+            if (b.kernel == r.kernel && b.level == 0 && b.ok) {
+                base = b.seconds;
+            }
+        }
+        string insts = r.instructions < 0 ? "-" : to_string(r.instructions);
+        snprintf(line, sizeof(line),
+                 "%-12s %5s %6s %10.3f %8lu %14lu %14s %10.3f %8s\n",
+                 r.kernel.c_str(), ("-O" + to_string(r.level)).c_str(),
+                 r.ok ? "ok" : "FAIL", r.compile_seconds * 1e3, r.ir_insts,
+                 r.steps, insts.c_str(), r.seconds * 1e3,
+                 base > 0 && r.ok
+                     ? (to_string(base / r.seconds).substr(0, 4) + "x").c_str()
+                     : "-");
+        os << line;
+    }
+    return;
+}
+
+static void print_json(ostream &os) {
+    char        line[512];
+    const char *steps = engine == "rv64"  ? "rv64_insts"
+                        : engine == "a64" ? "a64_insts"
+                        : engine == "bc"  ? "bc_insts"
+                                          : "ir_steps";
+    os << "{\"engine\": \""
+       << (engine == "rv64"  ? "rv64-sim"
+           : engine == "a64" ? "a64-sim"
+           : engine == "bc"  ? "bc-vm"
+                             : "ir-interp")
+       << "\", \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        auto &r = results[i];
+        snprintf(line, sizeof(line),
+                 "{\"kernel\": \"%s\", \"level\": %d, \"ok\": %s, "
+                 "\"compile_seconds\": %.9f, \"ir_insts\": %lu, \"%s\": "
+                 "%lu, \"instructions\": %ld, \"seconds\": %.9f, \"reps\": %d}",
+                 r.kernel.c_str(), r.level, r.ok ? "true" : "false",
+                 r.compile_seconds, r.ir_insts, steps, r.steps, r.instructions,
+                 r.seconds, r.reps);
+        os << line << (i + 1 == results.size() ? "\n" : ",\n");
+    }
+    os << "]}\n";
+    return;
+}
+
+int main(int argc, char **argv) {
+    string      dir    = "bench/kernels";
+    string      json   = "";
+    string      filter = "";
+    vector<int> levels = {0, 1, 2};
+    int         reps   = 3;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--kernels" && i + 1 < argc) {
+            dir = argv[++i];
+        }
+        else if (arg == "--json" && i + 1 < argc) {
+            json = argv[++i];
+        }
+        else if (arg == "--engine" && i + 1 < argc &&
+                 (string(argv[i + 1]) == "ir" || string(argv[i + 1]) == "rv64" ||
+                  string(argv[i + 1]) == "a64" || string(argv[i + 1]) == "bc")) {
+            engine = argv[++i];
+        }
+        else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        }
+        else if (arg == "--reps" && i + 1 < argc) {
+            reps = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--levels" && i + 1 < argc) {
+            levels.clear();
+            for (const char *p = argv[++i]; *p != '\0'; p++) {
+                if (*p >= '0' && *p <= '2') {
+                    levels.push_back(*p - '0');
+                }
+            }
+        }
+        else {
+            cout << "usage: runtime_bench [--kernels dir] [--levels 012] "
+                    "[--reps 3] [--filter name] [--engine ir|rv64|a64|bc] "
+                    "[--json out.json]"
+                 << endl;
+            return 1;
+        }
+    }
+    vector<string> kernels = list_kernels(dir);
+    if (kernels.empty()) {
+        cout << "No kernels found in " << dir << endl;
+        return 1;
+    }
+    int counter = open_counter();
+    if (counter < 0) {
+        cout << "perf_event_open unavailable, reporting wall time only"
+             << endl;
+    }
+    int failed = 0;
+    for (auto &name : kernels) {
+        if (filter.empty() == false && name.find(filter) == string::npos) {
+            continue;
+        }
+        for (int level : levels) {
+            results.push_back(bench_kernel(dir, name, level, reps, counter));
+            failed += results.back().ok == false;
+        }
+    }
+    if (counter >= 0) {
+        close(counter);
+    }
+    print_text(cout);
+    if (json.empty() == false) {
+        ofstream fout(json, ios::out | ios::trunc);
+        if (fout.is_open() == false) {
+            cout << "Output file not open: " << json << endl;
+            return 1;
+        }
+        print_json(fout);
+        cout << "Results written to " << json << endl;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+# This file is a part of Simple-XX/SimpleCompiler (https://github.com/Simple-XX/SimpleCompiler).
+#
+# build_id.cmake for Simple-XX/SimpleCompiler.
+
+# 以编译器源文件的摘要作为构建标识，写入 OUT 指定的头文件
+# 每次构建时运行，内容不变时不改写头文件，依赖它的源文件不会重新编译
+# 参数：SRC_DIR 为源代码目录，OUT 为生成的头文件
+
+file(GLOB_RECURSE build_id_src ${SRC_DIR}/*.cpp ${SRC_DIR}/*.h)
+list(SORT build_id_src)
+set(build_id_all "")
+foreach (f ${build_id_src})
+    file(SHA256 ${f} f_hash)
+    string(APPEND build_id_all "${f_hash}\n")
+endforeach ()
+string(SHA256 build_id "${build_id_all}")
+
+file(WRITE ${OUT}.tmp "#define SIMPLE_COMPILER_BUILD_ID \"${build_id}\"\n")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUT}.tmp ${OUT})
+file(REMOVE ${OUT}.tmp)
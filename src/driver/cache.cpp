@@ -0,0 +1,288 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// cache.cpp for Simple-XX/SimpleCompiler.
+
+#include "algorithm"
+#include "atomic"
+#include "cstdio"
+#include "filesystem"
+#include "fstream"
+#include "sstream"
+#include "vector"
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/file.h"
+#include "build_id.h"
+#include "cache.h"
+#include "init.h"
+#include "sha256.h"
+
+namespace fs = std::filesystem;
+
+// 缓存条目的扩展名
+static const char *ENTRY_EXT = ".out";
+// 统计文件名
+static const char *STATS_FILE = "/stats";
+// 累计多少次查找后写入统计文件
+static const uint64_t STATS_BATCH = 64;
+
+// 统计文件的内容
+struct stats_t {
+    uint64_t hits;
+    uint64_t misses;
+    // 条目总大小的估计
+    uint64_t size;
+    // 是否记录了条目总大小，旧版本的统计文件没有
+    bool sized;
+};
+
+// 打开并锁住统计文件，多个编译进程同时更新时不会丢失计数
+// 失败时返回 -1，关闭文件时解锁
+static int stats_open(const string &dir) {
+    int fd = open((dir + STATS_FILE).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        flock(fd, LOCK_EX);
+    }
+    return fd;
+}
+
+// 读取统计
+static stats_t stats_read(int fd) {
+    stats_t st = {0, 0, 0, false};
+    char    buf[128];
+    ssize_t n = fd < 0 ? -1 : pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) {
+        return st;
+    }
+    buf[n] = '\0';
+    unsigned long long hits   = 0;
+    unsigned long long misses = 0;
+    unsigned long long size   = 0;
+    int cnt   = sscanf(buf, "%llu %llu %llu", &hits, &misses, &size);
+    st.hits   = cnt >= 1 ? hits : 0;
+    st.misses = cnt >= 2 ? misses : 0;
+    st.size   = size;
+    st.sized  = cnt == 3;
+    return st;
+}
+
+// 写回统计，返回是否成功
+static bool stats_write(int fd, const stats_t &st) {
+    char buf[128];
+    int  n = snprintf(buf, sizeof(buf), "%llu %llu %llu\n",
+                      (unsigned long long)st.hits, (unsigned long long)st.misses,
+                      (unsigned long long)st.size);
+    return fd >= 0 && ftruncate(fd, 0) == 0 && pwrite(fd, buf, n, 0) == n;
+}
+
+Cache::Cache(const string &_dir, uint64_t _limit)
+    : dir(_dir), limit(_limit), used(0), hits(0), misses(0), grown(0) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    // 统计文件没有条目总大小时扫描一次目录
+    int     fd = stats_open(dir);
+    stats_t st = stats_read(fd);
+    if (st.sized) {
+        used = st.size;
+    }
+    else {
+        used     = sweep();
+        st.size  = used;
+        st.sized = true;
+        stats_write(fd, st);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    return;
+}
+
+Cache::~Cache(void) {
+    if (hits != 0 || misses != 0 || grown != 0) {
+        flush();
+    }
+    return;
+}
+
+// 计算缓存键
+string Cache::key(string_view src, string_view options) {
+    // 构建标识是编译器源文件的摘要，编译器改变后旧的条目不再命中
+    SHA256 sha;
+    sha.update("SimpleCompiler " SIMPLE_COMPILER_VERSION "\n");
+    sha.update(SIMPLE_COMPILER_BUILD_ID "\n");
+    sha.update(options).update("\n");
+    sha.update(std::to_string(src.size())).update("\n");
+    sha.update(src);
+    return sha.hex_digest();
+}
+
+// 条目路径
+string Cache::entry_path(const string &key) const {
+    return dir + "/" + key + ENTRY_EXT;
+}
+
+// 查找
+bool Cache::lookup(const string &key, string &out, bool record) {
+    ifstream fin(entry_path(key), ios::in | ios::binary);
+    if (fin.is_open() == false) {
+        if (record) {
+            count(false);
+        }
+        return false;
+    }
+    ostringstream ss;
+    ss << fin.rdbuf();
+    out = ss.str();
+    // 更新修改时间，淘汰时视为最近使用
+    std::error_code ec;
+    fs::last_write_time(entry_path(key), fs::file_time_type::clock::now(), ec);
+    if (record) {
+        count(true);
+    }
+    return true;
+}
+
+// 保存输出
+void Cache::store(const string &key, const string &out, bool shrink) {
+    // 先写临时文件再改名，并发编译时不会读到写了一半的条目
+    // 临时文件名带进程号与序号，同一进程的多个线程也不会冲突
+    static std::atomic<uint64_t> seq(0);
+    string   tmp = entry_path(key) + "." + std::to_string(getpid()) + "." +
+                 std::to_string(seq.fetch_add(1));
+    ofstream fout(tmp, ios::out | ios::binary | ios::trunc);
+    if (fout.is_open() == false) {
+        return;
+    }
+    fout << out;
+    fout.close();
+    std::error_code ec;
+    uint64_t        old = fs::file_size(entry_path(key), ec);
+    if (ec) {
+        old = 0;
+    }
+    fs::rename(tmp, entry_path(key), ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return;
+    }
+    grown += (int64_t)out.size() - (int64_t)old;
+    used = used + out.size() > old ? used + out.size() - old : 0;
+    if (shrink) {
+        evict();
+    }
+    return;
+}
+
+// 淘汰
+void Cache::evict(void) {
+    if (used <= limit) {
+        return;
+    }
+    uint64_t size = sweep();
+    flush(&size);
+    return;
+}
+
+// 扫描目录淘汰
+uint64_t Cache::sweep(void) {
+    struct entry_t {
+        fs::path            path;
+        uint64_t            size;
+        fs::file_time_type  time;
+    };
+    std::vector<entry_t> entries;
+    uint64_t             total = 0;
+    std::error_code      ec;
+    for (auto &e : fs::directory_iterator(dir, ec)) {
+        if (e.path().extension() != ENTRY_EXT) {
+            continue;
+        }
+        entry_t entry = {e.path(), e.file_size(ec), e.last_write_time(ec)};
+        total += entry.size;
+        entries.push_back(entry);
+    }
+    if (total <= limit) {
+        return total;
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const entry_t &a, const entry_t &b) { return a.time < b.time; });
+    for (auto &entry : entries) {
+        if (total <= limit) {
+            break;
+        }
+        fs::remove(entry.path, ec);
+        total -= entry.size;
+    }
+    return total;
+}
+
+// 记录一次查找
+void Cache::count(bool hit) {
+    if (hit) {
+        hits++;
+    }
+    else {
+        misses++;
+    }
+    if (hits + misses >= STATS_BATCH) {
+        flush();
+    }
+    return;
+}
+
+// 写入统计文件
+void Cache::flush(const uint64_t *size) {
+    int fd = stats_open(dir);
+    if (fd < 0) {
+        return;
+    }
+    stats_t st = stats_read(fd);
+    st.hits += hits;
+    st.misses += misses;
+    if (size != NULL) {
+        st.size = *size;
+    }
+    else if (st.sized) {
+        st.size = grown < 0 && (uint64_t)-grown > st.size ? 0 : st.size + grown;
+    }
+    else {
+        st.size = used;
+    }
+    stats_write(fd, st);
+    close(fd);
+    hits   = 0;
+    misses = 0;
+    grown  = 0;
+    // 其它进程保存的条目也计入估计
+    used = st.size;
+    return;
+}
+
+// 输出统计信息
+void Cache::stats(ostream &os) {
+    flush();
+    int     fd = stats_open(dir);
+    stats_t st = stats_read(fd);
+    if (fd >= 0) {
+        close(fd);
+    }
+    uint64_t        entries = 0;
+    uint64_t        total   = 0;
+    std::error_code ec;
+    for (auto &e : fs::directory_iterator(dir, ec)) {
+        if (e.path().extension() == ENTRY_EXT) {
+            entries++;
+            total += e.file_size(ec);
+        }
+    }
+    uint64_t lookups = st.hits + st.misses;
+    os << "cache directory: " << dir << "\n"
+       << "entries:         " << entries << "\n"
+       << "size:            " << total << " / " << limit << " bytes\n"
+       << "hits:            " << st.hits << "\n"
+       << "misses:          " << st.misses << "\n"
+       << "hit rate:        "
+       << (lookups == 0 ? 0.0 : 100.0 * st.hits / lookups) << "%" << endl;
+    return;
+}
@@ -0,0 +1,145 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// client.cpp for Simple-XX/SimpleCompiler.
+
+// 编译服务的协议与客户端
+// 只使用标准库与系统调用，瘦客户端直接编译本文件
+
+#include "cstdio"
+#include "cstring"
+#include "sys/socket.h"
+#include "sys/un.h"
+#include "unistd.h"
+#include "server.h"
+
+bool write_all(int fd, const void *buf, size_t len) {
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool read_all(int fd, void *buf, size_t len) {
+    char *p = (char *)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool write_str(int fd, const string &s) {
+    uint32_t len = s.size();
+    return write_all(fd, &len, sizeof(len)) && write_all(fd, s.data(), len);
+}
+
+bool read_str(int fd, string &s) {
+    uint32_t len;
+    if (read_all(fd, &len, sizeof(len)) == false || len > MAX_ARG_LEN) {
+        return false;
+    }
+    s.resize(len);
+    return read_all(fd, &s[0], len);
+}
+
+int open_socket(const string &path, bool listen) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (listen) {
+        // 清除上次遗留的套接字文件
+        unlink(path.c_str());
+        if (bind(fd, (sockaddr *)&addr, sizeof(addr)) == 0 &&
+            ::listen(fd, SOMAXCONN) == 0) {
+            return fd;
+        }
+    }
+    else if (connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0) {
+        return fd;
+    }
+    close(fd);
+    return -1;
+}
+
+vector<string> strip_client(const vector<string> &argv, string &socket) {
+    vector<string> args;
+    for (size_t i = 0; i < argv.size(); i++) {
+        if (argv[i] == "--client") {
+            if (i + 1 < argv.size()) {
+                socket = argv[++i];
+            }
+            continue;
+        }
+        if (argv[i].compare(0, 9, "--client=") == 0) {
+            socket = argv[i].substr(9);
+            continue;
+        }
+        args.push_back(argv[i]);
+    }
+    return args;
+}
+
+int request(const string &path, const vector<string> &argv) {
+    int fd = open_socket(path, false);
+    if (fd < 0) {
+        return -1;
+    }
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        close(fd);
+        return -1;
+    }
+    // 第一个参数换成工作目录，去掉 --client 选项本身
+    string         socket;
+    vector<string> args = strip_client(argv, socket);
+    if (args.empty()) {
+        args.push_back(cwd);
+    }
+    args[0]      = cwd;
+    uint32_t cnt = args.size();
+    bool     ok  = write_all(fd, &cnt, sizeof(cnt));
+    for (auto &a : args) {
+        ok = ok && write_str(fd, a);
+    }
+    if (ok == false) {
+        close(fd);
+        return -1;
+    }
+    // 输出原样转发，最后 5 字节为结束标记与退出码
+    // 服务的工作进程中途退出时应答不完整，此时不输出任何内容
+    string  reply;
+    char    buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        reply.append(buf, n);
+    }
+    close(fd);
+    if (reply.size() < 5 || reply[reply.size() - 5] != '\0') {
+        return -1;
+    }
+    int32_t ret;
+    memcpy(&ret, reply.data() + reply.size() - 4, sizeof(ret));
+    if (ret < 0) {
+        return -1;
+    }
+    // 不使用 iostream，瘦客户端启动时不需要初始化它
+    fwrite(reply.data(), 1, reply.size() - 5, stdout);
+    fflush(stdout);
+    return ret;
+}
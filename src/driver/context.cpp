@@ -0,0 +1,132 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// context.cpp for Simple-XX/SimpleCompiler.
+
+#include "sstream"
+#include "compiler.h"
+#include "driver.h"
+#include "init.h"
+#include "interner.h"
+
+// 驻留表在编译之间保留，常用的名字不必每次重新驻留
+// 超过这个个数时在下次编译前清空，限制长期运行的上下文占用的内存
+static const size_t INTERNER_TRIM = 1 << 20;
+
+CompilerContext::CompilerContext(size_t _jobs, const compile_options_t &opts)
+    : options(opts), stopping(false) {
+    if (_jobs == 0) {
+        _jobs = max(1u, thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < _jobs; i++) {
+        interners.push_back(make_unique<Interner>());
+    }
+    for (size_t i = 0; i < _jobs; i++) {
+        workers.emplace_back(&CompilerContext::work, this, i);
+    }
+    return;
+}
+
+CompilerContext::~CompilerContext(void) {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto &w : workers) {
+        w.join();
+    }
+    return;
+}
+
+// 取出任务执行，队列为空且正在退出时结束
+void CompilerContext::work(size_t id) {
+    // 本线程的编译使用自己的驻留表
+    interner = interners[id].get();
+    while (true) {
+        function<void(size_t)> task;
+        {
+            unique_lock<mutex> guard(lock);
+            ready.wait(guard, [this] { return stopping || tasks.empty() == false; });
+            if (tasks.empty()) {
+                return;
+            }
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+        task(id);
+    }
+}
+
+void CompilerContext::submit(string_view src, const string &name,
+                             const compile_options_t &opts,
+                             compile_result_t &result, size_t &remaining,
+                             condition_variable &done) {
+    {
+        lock_guard<mutex> guard(lock);
+        tasks.push_back([this, src, name, opts, &result, &remaining,
+                         &done](size_t) {
+            emit      = opts.emit;
+            opt_level = opts.opt_level;
+            // 符号表随编译结束释放，之后没有记录引用驻留表的编号，可以在编译前清空
+            if (interner->size() > INTERNER_TRIM) {
+                interner->clear();
+            }
+            ostringstream diag;
+            result.err_cnt     = compile_buffer(src, result.output, name, NULL, diag);
+            result.diagnostics = diag.str();
+            // 持有锁时通知，等待者返回并销毁 done 之前本线程不会再访问它
+            lock_guard<mutex> guard(lock);
+            remaining--;
+            done.notify_all();
+        });
+    }
+    ready.notify_one();
+    return;
+}
+
+void CompilerContext::set_options(const compile_options_t &opts) {
+    lock_guard<mutex> guard(lock);
+    options = opts;
+    return;
+}
+
+compile_options_t CompilerContext::get_options(void) {
+    lock_guard<mutex> guard(lock);
+    return options;
+}
+
+size_t CompilerContext::jobs(void) const {
+    return workers.size();
+}
+
+compile_result_t CompilerContext::compile(string_view src, const string &name) {
+    // 选项在提交时确定，之后的 set_options 不影响已提交的任务
+    return compile(src, name, get_options());
+}
+
+compile_result_t CompilerContext::compile(string_view src, const string &name,
+                                          const compile_options_t &opts) {
+    compile_result_t   result;
+    size_t             remaining = 1;
+    condition_variable done;
+    submit(src, name, opts, result, remaining, done);
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&remaining] { return remaining == 0; });
+    return result;
+}
+
+// 第 i 段源代码在错误信息中记为 <buffer i>
+vector<compile_result_t> CompilerContext::compile_all(const vector<string_view> &srcs) {
+    vector<compile_result_t> results(srcs.size());
+    size_t                   remaining = srcs.size();
+    condition_variable       done;
+    compile_options_t        opts = get_options();
+    for (size_t i = 0; i < srcs.size(); i++) {
+        submit(srcs[i], "<buffer " + to_string(i) + ">", opts, results[i],
+               remaining, done);
+    }
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [&remaining] { return remaining == 0; });
+    return results;
+}
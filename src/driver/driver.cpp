@@ -0,0 +1,496 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// driver.cpp for Simple-XX/SimpleCompiler.
+
+#include "fstream"
+#include "functional"
+#include "sstream"
+#include "aarch64.h"
+#include "bytecode.h"
+#include "common.h"
+#include "cache.h"
+#include "driver.h"
+#include "ir_opt.h"
+#include "irgen.h"
+#include "llvmgen.h"
+#include "resolver.h"
+#include "riscv.h"
+#include "snapshot.h"
+#include "timer.h"
+#include "x86.h"
+
+// 影响编译输出的选项
+string option_digest(void) {
+    return "emit=" + emit + ";O" + to_string(opt_level);
+}
+
+// 顶层单元总数，生成中间代码时只计函数
+static uint64_t unit_total = 0;
+// 复用了缓存的 AST 输出或优化后的中间代码的顶层单元个数
+static uint64_t unit_reused = 0;
+// 输出汇编的函数总数
+static uint64_t asm_total = 0;
+// 复用了缓存的汇编的函数个数
+static uint64_t asm_reused = 0;
+
+// 按顶层单元输出 AST，格式与 CompUnitAST::to_string 相同
+// 单元的缓存键由其 token 摘要与引用的全局符号签名组成，
+// 只有改动过的单元与其引用的签名改变了的单元需要重新生成
+static string emit_units(CompUnitAST &prog, const vector<string> &digests,
+                         const vector<string> &refs, Cache &cache) {
+    string     output;
+    ASTPtrList &units = prog.get_units();
+    for (size_t i = 0; i < units.size(); i++) {
+        FuncDefAST *fun = dynamic_cast<FuncDefAST *>(units[i].get());
+        Phase       phase("emit unit", fun != NULL ? fun->get_name() : "");
+        string      key = Cache::key(digests[i] + "\n" + refs[i],
+                                     option_digest() + ";unit");
+        string      text;
+        unit_total++;
+        if (cache.lookup(key, text, false)) {
+            unit_reused++;
+        }
+        else {
+            text = units[i]->to_string();
+            cache.store(key, text, false);
+        }
+        output += "\n" + text;
+    }
+    return "CompUnit: [" + output + "]\n";
+}
+
+// 读入源文件或快照，得到 AST 与各顶层单元的 token 摘要
+// 摘要只用作缓存的键，不使用缓存时 digest 为 false，不计算摘要
+static ASTPtr load_file(const string &src_file, vector<string> &digests,
+                        bool digest) {
+    // 快照直接重建 AST，跳过词法与语法分析
+    if (is_snapshot(src_file)) {
+        Phase    phase("snapshot");
+        Snapshot snapshot;
+        if (snapshot.open(src_file) == false) {
+            cout << "Invalid snapshot: " << src_file << endl;
+            return NULL;
+        }
+        return snapshot.build();
+    }
+    Phase   phase("parse");
+    Scanner scanner(src_file);
+    Lexer   lexer(scanner);
+    Parser  parser(lexer, digest);
+    ASTPtr  prog = parser.parsing();
+    digests      = parser.get_unit_digests();
+    return prog;
+}
+
+// 读入内存中的源代码
+static ASTPtr load_buffer(string_view src, vector<string> &digests,
+                          bool digest) {
+    Phase   phase("parse");
+    Scanner scanner(src.data(), src.size());
+    Lexer   lexer(scanner);
+    Parser  parser(lexer, digest);
+    ASTPtr  prog = parser.parsing();
+    digests      = parser.get_unit_digests();
+    return prog;
+}
+
+// 生成并优化中间代码
+static void lower(MetaAST &prog, SymTab &symtab, IRModule &module, int level) {
+    {
+        Phase phase("irgen");
+        IRGen irgen(symtab, module);
+        irgen.generate(prog);
+    }
+    optimize(module, level);
+    return;
+}
+
+// 按顶层单元生成并优化中间代码
+// 函数的缓存键与 emit_units 相同，命中时读回优化后的中间代码，跳过生成与优化，
+// 中间代码与输出格式无关，各种 --emit 共用；全局变量的声明总是重新生成
+// units 返回各函数所在单元的摘要与引用，按模块中的函数下标排列，外部函数为空
+static void lower_units(CompUnitAST &prog, SymTab &symtab, IRModule &module,
+                        int level, const vector<string> &digests,
+                        const vector<string> &refs, Cache &cache,
+                        vector<string> &units) {
+    IRGen       irgen(symtab, module);
+    ASTPtrList &asts = prog.get_units();
+    for (size_t i = 0; i < asts.size(); i++) {
+        FuncDefAST *fun = dynamic_cast<FuncDefAST *>(asts[i].get());
+        if (fun == NULL) {
+            Phase phase("irgen");
+            irgen.generate(*asts[i]);
+            continue;
+        }
+        string unit = digests[i] + "\n" + refs[i];
+        string key  = Cache::key(unit, "O" + to_string(level) + ";ir");
+        string data;
+        size_t idx = module.funs.size();
+        bool   hit = false;
+        unit_total++;
+        {
+            Phase phase("reuse", fun->get_name());
+            hit = cache.lookup(key, data, false) && irgen.reuse(*fun, data);
+        }
+        if (hit) {
+            unit_reused++;
+        }
+        else {
+            vector<int> externs;
+            {
+                Phase phase("irgen", fun->get_name());
+                externs = irgen.generate_unit(*fun);
+            }
+            {
+                Phase phase("optimize", fun->get_name());
+                optimize(module.funs[idx], level);
+            }
+            cache.store(key, module.save_fun(idx, externs), false);
+        }
+        units.resize(module.funs.size());
+        units[idx] = unit;
+    }
+    return;
+}
+
+// 按函数输出汇编，函数的汇编以其所在单元的摘要与引用加上选项为键缓存
+// gen 翻译并输出一个函数
+static vector<string>
+emit_functions(const IRModule &module, const vector<string> &units, Cache &cache,
+               const function<string(const IRFunction &)> &gen) {
+    vector<string> funs;
+    for (size_t i = 0; i < module.funs.size(); i++) {
+        if (module.funs[i].extern_flag) {
+            continue;
+        }
+        Phase  phase("emit unit", module.funs[i].name);
+        string key = Cache::key(units[i], option_digest() + ";asm");
+        string text;
+        asm_total++;
+        if (cache.lookup(key, text, false)) {
+            asm_reused++;
+        }
+        else {
+            text = gen(module.funs[i]);
+            cache.store(key, text, false);
+        }
+        funs.push_back(text);
+    }
+    return funs;
+}
+
+// 对读入的 AST 做语义分析并生成输出，返回错误个数
+static int compile_ast(ASTPtr prog, const vector<string> &digests, string &out,
+                       Cache *cache) {
+    if (prog == NULL) {
+        return 1;
+    }
+    // 语义分析
+    SymTab   symtab;
+    Resolver resolver(symtab);
+    int      err_cnt = 0;
+    {
+        Phase phase("resolve");
+        err_cnt = resolver.resolving(*prog);
+    }
+    CompUnitAST *unit = dynamic_cast<CompUnitAST *>(prog.get());
+    // 有错误时不缓存，快照输入没有 token 摘要
+    bool by_unit = cache != NULL && err_cnt == 0 && unit != NULL &&
+                   digests.size() == unit->get_units().size();
+    // 各函数所在单元的摘要与引用
+    vector<string> units;
+    auto lower_prog = [&](IRModule &module) {
+        if (by_unit) {
+            lower_units(*unit, symtab, module, opt_level, digests,
+                        resolver.get_unit_refs(), *cache, units);
+        }
+        else {
+            lower(*prog, symtab, module, opt_level);
+        }
+        return;
+    };
+    // 有错误时不生成中间代码
+    // 目标文件与字节码在整个模块上生成，耗时远少于生成与优化中间代码，不按函数缓存
+    if (emit == "ir") {
+        if (err_cnt == 0) {
+            IRModule module;
+            lower_prog(module);
+            Phase phase("emit");
+            out = module.to_string();
+        }
+    }
+    else if (emit == "obj") {
+        if (err_cnt == 0) {
+            IRModule module;
+            lower_prog(module);
+            Phase phase("emit");
+            out = x86_emit(module);
+        }
+    }
+    else if (emit == "riscv") {
+        if (err_cnt == 0) {
+            IRModule  module;
+            RVProgram rv;
+            lower_prog(module);
+            Phase phase("emit");
+            if (by_unit) {
+                auto gen = [&module](const IRFunction &f) {
+                    RVFunction rf;
+                    riscv_lower_function(module, f, rf);
+                    return riscv_asm_function(rf);
+                };
+                rv.globals = module.globals;
+                out = riscv_asm(rv, emit_functions(module, units, *cache, gen));
+            }
+            else {
+                riscv_lower(module, rv);
+                out = riscv_asm(rv);
+            }
+        }
+    }
+    else if (emit == "aarch64") {
+        if (err_cnt == 0) {
+            IRModule   module;
+            A64Program a64;
+            lower_prog(module);
+            Phase phase("emit");
+            if (by_unit) {
+                auto gen = [&module](const IRFunction &f) {
+                    A64Function af;
+                    aarch64_lower_function(module, f, af);
+                    return aarch64_asm_function(af);
+                };
+                a64.globals = module.globals;
+                out = aarch64_asm(a64, emit_functions(module, units, *cache, gen));
+            }
+            else {
+                aarch64_lower(module, a64);
+                out = aarch64_asm(a64);
+            }
+        }
+    }
+    else if (emit == "bytecode") {
+        if (err_cnt == 0) {
+            IRModule module;
+            BCModule bc;
+            lower_prog(module);
+            Phase phase("emit");
+            bc_lower(module, bc);
+            out = bc_write(bc);
+        }
+    }
+    // LLVM IR 直接由 AST 生成，优化交给 LLVM
+    else if (emit == "llvm") {
+        if (err_cnt == 0) {
+            Phase   phase("emit");
+            LLVMGen gen(symtab);
+            out = gen.generate(*prog);
+        }
+    }
+    else if (emit == "snapshot") {
+        Phase phase("emit");
+        out = snapshot_write(*prog);
+    }
+    else if (by_unit) {
+        Phase phase("emit");
+        out = emit_units(*unit, digests, resolver.get_unit_refs(), *cache);
+    }
+    else {
+        Phase phase("emit");
+        out = prog->to_string();
+    }
+    if (by_unit) {
+        cache->evict();
+    }
+    return err_cnt;
+}
+
+// 编译一个源文件
+int compile_file(const string &src_file, string &out, Cache *cache) {
+    error = new Error(src_file);
+    vector<string> digests;
+    ASTPtr         prog    = load_file(src_file, digests, cache != NULL);
+    int            err_cnt = compile_ast(move(prog), digests, out, cache);
+    delete error;
+    error = NULL;
+    return err_cnt;
+}
+
+// 编译内存中的源代码
+int compile_buffer(string_view src, string &out, const string &name,
+                   Cache *cache, ostream &diag) {
+    error = new Error(name, diag);
+    vector<string> digests;
+    ASTPtr         prog    = load_buffer(src, digests, cache != NULL);
+    int            err_cnt = compile_ast(move(prog), digests, out, cache);
+    delete error;
+    error = NULL;
+    return err_cnt;
+}
+
+// 编译一个源文件到中间代码
+int compile_module(const string &src_file, IRModule &module, int level) {
+    error = new Error(src_file);
+    vector<string> digests;
+    ASTPtr         prog    = load_file(src_file, digests, false);
+    int            err_cnt = 1;
+    if (prog != NULL) {
+        SymTab   symtab;
+        Resolver resolver(symtab);
+        {
+            Phase phase("resolve");
+            err_cnt = resolver.resolving(*prog);
+        }
+        if (err_cnt == 0) {
+            lower(*prog, symtab, module, level);
+        }
+    }
+    delete error;
+    error = NULL;
+    return err_cnt;
+}
+
+int compile_llvm(const string &src_file, string &out) {
+    error = new Error(src_file);
+    vector<string> digests;
+    ASTPtr         prog    = load_file(src_file, digests, false);
+    int            err_cnt = 1;
+    if (prog != NULL) {
+        SymTab   symtab;
+        Resolver resolver(symtab);
+        {
+            Phase phase("resolve");
+            err_cnt = resolver.resolving(*prog);
+        }
+        if (err_cnt == 0) {
+            Phase   phase("emit");
+            LLVMGen gen(symtab);
+            out = gen.generate(*prog);
+        }
+    }
+    delete error;
+    error = NULL;
+    return err_cnt;
+}
+
+// 读取整个文件
+static bool read_file(const string &path, string &content) {
+    ifstream fin(path, ios::in | ios::binary);
+    if (fin.is_open() == false) {
+        return false;
+    }
+    ostringstream ss;
+    ss << fin.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+// 读取标准输入，只能读一次，结果留给之后的 "-"
+static const string &read_stdin(void) {
+    static bool   loaded = false;
+    static string content;
+    if (loaded == false) {
+        ostringstream ss;
+        ss << cin.rdbuf();
+        content = ss.str();
+        loaded  = true;
+    }
+    return content;
+}
+
+// 编译全部源文件并写出结果
+static int drive_files(void) {
+    int    ret = 0;
+    string output;
+    Cache *cache = NULL;
+    if (cache_dir.empty() == false) {
+        cache = new Cache(cache_dir, cache_limit);
+    }
+    // 目标文件与字节码文件不能拼接
+    if ((emit == "obj" || emit == "bytecode") && src_files.size() > 1) {
+        cout << "--emit " << emit << " accepts only one source file" << endl;
+        delete cache;
+        return 1;
+    }
+    // 逐个打开文件
+    for (const auto &i : src_files) {
+        cout << "Open file: " << i << endl;
+        stat_add(STAT_FILES);
+        Phase  file_phase("file", i);
+        string out;
+        string key;
+        // 命中缓存时跳过编译
+        if (cache != NULL) {
+            Phase  phase("cache");
+            string src;
+            if (i == STDIN_FILE) {
+                src = read_stdin();
+            }
+            if (i == STDIN_FILE || read_file(i, src)) {
+                key = Cache::key(src, option_digest());
+                if (cache->lookup(key, out)) {
+                    output += out;
+                    continue;
+                }
+            }
+        }
+        int err_cnt = 0;
+        if (i == STDIN_FILE) {
+            err_cnt = compile_buffer(read_stdin(), out, "<stdin>", cache);
+        }
+        else {
+            err_cnt = compile_file(i, out, cache);
+        }
+        if (err_cnt != 0) {
+            ret = 1;
+        }
+        // 有错误的结果不缓存
+        else if (key.empty() == false) {
+            cache->store(key, out);
+        }
+        output += out;
+    }
+    if (dest_file.empty() == false && src_files.empty() == false) {
+        Phase    phase("write");
+        ofstream fout(dest_file, ios::out | ios::binary | ios::trunc);
+        if (fout.is_open() == false) {
+            cout << "Output file not open: " << dest_file << endl;
+            ret = 1;
+        }
+        fout << output;
+    }
+    if (cache != NULL) {
+        if (cache_stats) {
+            cache->stats(cout);
+            cout << "units reused: " << unit_reused << "/" << unit_total
+                 << endl;
+            if (asm_total != 0) {
+                cout << "functions with reused asm: " << asm_reused << "/"
+                     << asm_total << endl;
+            }
+        }
+        delete cache;
+    }
+    else if (cache_stats) {
+        cout << "compilation cache is disabled, use --cache-dir" << endl;
+    }
+    return ret;
+}
+
+// 编译全部源文件
+int drive(void) {
+    int ret = 0;
+    {
+        Phase phase("total");
+        ret = drive_files();
+    }
+    if (time_report) {
+        time_report_print(cout);
+    }
+    if (trace_file.empty() == false && trace_write() == false) {
+        cout << "Trace file not open: " << trace_file << endl;
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,264 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// server.cpp for Simple-XX/SimpleCompiler.
+
+#include "cerrno"
+#include "cstring"
+#include "ctime"
+#include "fstream"
+#include "iostream"
+#include "mutex"
+#include "sstream"
+#include "thread"
+#include "vector"
+#include "signal.h"
+#include "sys/socket.h"
+#include "sys/wait.h"
+#include "unistd.h"
+#include "cache.h"
+#include "compiler.h"
+#include "driver.h"
+#include "init.h"
+#include "server.h"
+#include "snapshot.h"
+
+// 一个请求的源文件、输出文件与选项，路径已按客户端的工作目录展开
+struct server_request_t {
+    vector<string>    src_files;
+    string            dest_file;
+    compile_options_t opts;
+};
+
+// 服务进程的选项，作为请求的默认值
+static compile_options_t defaults;
+// 工作进程的编译上下文
+static CompilerContext *context = NULL;
+// 工作进程的编译缓存，未指定缓存目录时为 NULL
+static Cache *cache = NULL;
+// 保护 cache
+static mutex cache_lock;
+
+// 相对路径按客户端的工作目录展开
+static string resolve(const string &cwd, const string &path) {
+    return path[0] == '/' ? path : cwd + "/" + path;
+}
+
+// 解析请求的参数，与 Init::init 的规则相同，第一个参数是客户端的工作目录
+// 服务只处理源文件、输出文件、--emit 与 -O，其余选项与标准输入、快照返回 false，由客户端在本地编译
+static bool parse_request(const vector<string> &args, server_request_t &req) {
+    const string &cwd = args[0];
+    vector<string> files;
+    req.opts = defaults;
+    for (size_t i = 1; i < args.size(); i++) {
+        const string &a = args[i];
+        // 选项的值可以紧跟选项，也可以是下一个参数
+        auto value = [&](const string &opt, string &val) {
+            if (a == opt && i + 1 < args.size()) {
+                val = args[++i];
+                return true;
+            }
+            if (a.compare(0, opt.size(), opt) == 0 && a.size() > opt.size()) {
+                size_t off = opt.size() + (opt[1] == '-' && a[opt.size()] == '=');
+                val        = a.substr(off);
+                return opt[1] != '-' || off > opt.size();
+            }
+            return false;
+        };
+        string val;
+        if (value("-o", val) || value("--output", val)) {
+            req.dest_file = resolve(cwd, val);
+        }
+        else if (value("--emit", val)) {
+            if (val != "ast" && val != "snapshot" && val != "ir" && val != "obj" &&
+                val != "riscv" && val != "aarch64" && val != "llvm" &&
+                val != "bytecode") {
+                return false;
+            }
+            req.opts.emit = val;
+        }
+        else if (a == "--emit-llvm") {
+            req.opts.emit = "llvm";
+        }
+        else if (value("-O", val)) {
+            if (val.size() != 1 || val[0] < '0' || val[0] > '2') {
+                return false;
+            }
+            req.opts.opt_level = val[0] - '0';
+        }
+        else if (a == STDIN_FILE || is_snapshot(a) ||
+                 (a[0] == '-' && a.size() > 1)) {
+            return false;
+        }
+        else if (a.find(".c") != string::npos) {
+            files.push_back(resolve(cwd, a));
+        }
+    }
+    // 只有给出输出文件时才编译
+    if (req.dest_file.empty() == false) {
+        req.src_files = files;
+    }
+    return true;
+}
+
+// 读取整个文件
+static bool read_file(const string &path, string &content) {
+    ifstream fin(path, ios::in | ios::binary);
+    if (fin.is_open() == false) {
+        return false;
+    }
+    ostringstream ss;
+    ss << fin.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+// 编译请求中的源文件并写出结果，输出与本地编译相同，写到 log，返回退出码
+// 源文件读不到时返回 -1，由客户端在本地编译并给出错误
+static int compile_request(const server_request_t &req, string &log) {
+    const string &e = req.opts.emit;
+    if ((e == "obj" || e == "bytecode") && req.src_files.size() > 1) {
+        log = "--emit " + e + " accepts only one source file\n";
+        return 1;
+    }
+    vector<string> srcs(req.src_files.size());
+    for (size_t i = 0; i < srcs.size(); i++) {
+        if (read_file(req.src_files[i], srcs[i]) == false) {
+            return -1;
+        }
+    }
+    // 缓存键与本地编译相同，服务与本地编译共用缓存目录
+    emit      = req.opts.emit;
+    opt_level = req.opts.opt_level;
+    int    ret = 0;
+    string output;
+    for (size_t i = 0; i < srcs.size(); i++) {
+        log += "Open file: " + req.src_files[i] + "\n";
+        string key, out;
+        if (cache != NULL) {
+            lock_guard<mutex> guard(cache_lock);
+            key = Cache::key(srcs[i], option_digest());
+            if (cache->lookup(key, out)) {
+                output += out;
+                continue;
+            }
+        }
+        compile_result_t res = context->compile(srcs[i], req.src_files[i], req.opts);
+        log += res.diagnostics;
+        if (res.err_cnt != 0) {
+            ret = 1;
+        }
+        // 有错误的结果不缓存
+        else if (cache != NULL) {
+            lock_guard<mutex> guard(cache_lock);
+            cache->store(key, res.output);
+        }
+        output += res.output;
+    }
+    if (req.dest_file.empty() == false && req.src_files.empty() == false) {
+        ofstream fout(req.dest_file, ios::out | ios::binary | ios::trunc);
+        if (fout.is_open() == false) {
+            log += "Output file not open: " + req.dest_file + "\n";
+            ret = 1;
+        }
+        fout << output;
+    }
+    return ret;
+}
+
+// 处理一个连接
+static void handle(int conn) {
+    uint32_t cnt;
+    if (read_all(conn, &cnt, sizeof(cnt)) == false || cnt == 0 ||
+        cnt > MAX_ARGS) {
+        close(conn);
+        return;
+    }
+    vector<string> args(cnt);
+    for (auto &a : args) {
+        if (read_str(conn, a) == false) {
+            close(conn);
+            return;
+        }
+    }
+    server_request_t req;
+    string           log;
+    int32_t          ret = -1;
+    try {
+        if (parse_request(args, req)) {
+            ret = compile_request(req, log);
+        }
+    }
+    // 内存不足等异常只影响本次请求，由客户端在本地编译
+    catch (const exception &) {
+        ret = -1;
+    }
+    if (ret < 0) {
+        log.clear();
+    }
+    char end = '\0';
+    write_all(conn, log.data(), log.size());
+    write_all(conn, &end, sizeof(end));
+    write_all(conn, &ret, sizeof(ret));
+    close(conn);
+    return;
+}
+
+// 工作进程，接受连接并在编译上下文中编译，不返回
+static void work(int fd) {
+    CompilerContext ctx(0, defaults);
+    context = &ctx;
+    if (cache_dir.empty() == false) {
+        cache = new Cache(cache_dir, cache_limit);
+    }
+    while (true) {
+        int conn = accept(fd, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        // 每个连接一个线程，编译在上下文的工作线程中进行，请求之间互不阻塞
+        thread(handle, conn).detach();
+    }
+    _exit(1);
+}
+
+// 启动编译服务
+int serve(const string &path) {
+    int fd = open_socket(path, true);
+    if (fd < 0) {
+        cout << "bind " << path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    // 客户端提前断开时不退出
+    signal(SIGPIPE, SIG_IGN);
+    defaults.emit      = emit;
+    defaults.opt_level = opt_level;
+    cout << "Listening on " << path << endl;
+    // 服务进程只看护工作进程，工作进程被信号结束时重新启动
+    while (true) {
+        time_t start = time(NULL);
+        pid_t  pid   = fork();
+        if (pid < 0) {
+            cout << "fork: " << strerror(errno) << endl;
+            break;
+        }
+        if (pid == 0) {
+            work(fd);
+        }
+        int status = 0;
+        if (waitpid(pid, &status, 0) != pid || WIFSIGNALED(status) == false) {
+            break;
+        }
+        cout << "Compile worker killed by signal " << WTERMSIG(status)
+             << ", restarting" << endl;
+        // 连续崩溃时放慢重启
+        if (time(NULL) - start < 1) {
+            sleep(1);
+        }
+    }
+    close(fd);
+    return 1;
+}
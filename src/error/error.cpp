@@ -6,6 +6,9 @@
 
 #include "error.h"
 
+// 当前文件的错误信息，每个线程一个
+thread_local Error *error = NULL;
+
 Pos::Pos(unsigned int l, unsigned int c) : line(l), col(c) {
     return;
 }
@@ -14,7 +17,7 @@ Pos::~Pos() {
     return;
 }
 
-Error::Error(const string &f) : filename(f) {
+Error::Error(const string &f, ostream &o) : filename(f), out(o) {
     err_no = 0;
     pos    = new Pos(1, 1);
     return;
@@ -50,8 +53,16 @@ Pos *Error::get_pos() const {
     return pos;
 }
 
+const string &Error::get_filename() const {
+    return filename;
+}
+
+ostream &Error::get_out() const {
+    return out;
+}
+
 void Error::display_err() const {
-    cout << "\033[;31mErr:\033[0m " << err_no << ", \033[;31mFile:\033[0m "
+    out << "\033[;31mErr:\033[0m " << err_no << ", \033[;31mFile:\033[0m "
          << filename << ", \033[;31mLine:\033[0m " << pos->line
          << ", \033[;31mCOL:\033[0m " << pos->col << endl;
     return;
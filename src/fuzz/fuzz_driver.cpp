@@ -0,0 +1,541 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// fuzz_driver.cpp for Simple-XX/SimpleCompiler.
+
+// 模糊测试驱动
+// 没有 libFuzzer 时与 lexer_fuzz.cpp 或 parser_fuzz.cpp 链接，提供 main：
+// 回放语料，对语料做随机变异，并检查输入规模增大时耗时与内存分配的增长是否超线性，
+// 最后按命令行的编译路径编译百万层的嵌套输入，各种输出都必须能生成，不能栈溢出
+// 这里的变异没有覆盖率反馈，覆盖率引导需要用 clang 的 libFuzzer 构建
+// 崩溃或超时的输入写到 --artifacts 目录，可以作为参数传入重现
+
+#include "algorithm"
+#include "cmath"
+#include "csignal"
+#include "cstdint"
+#include "cstdio"
+#include "cstring"
+#include "fstream"
+#include "iostream"
+#include "random"
+#include "sstream"
+#include "string"
+#include "vector"
+#include "dirent.h"
+#include "fcntl.h"
+#include "time.h"
+#include "unistd.h"
+#include "sys/stat.h"
+#include "driver.h"
+#include "init.h"
+#include "snapshot.h"
+#include "timer.h"
+
+using namespace std;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+// 一个测试输入
+struct input_t {
+    // 来源，语料的文件名或变异的序号
+    string name;
+    string data;
+};
+
+// 规模可变的输入：head + unit * k + mid + unit2 * k + tail
+struct shape_t {
+    string name;
+    string head;
+    string unit;
+    string mid;
+    string unit2;
+    string tail;
+    // 是否为嵌套结构，嵌套结构的规模由 --depth 给出并参与嵌套压力测试
+    bool nested;
+    // 基础规模，为 0 时按是否嵌套取 --depth 或 --width
+    size_t base = 0;
+};
+
+// 当前输入，崩溃或超时时写出
+static string current;
+// 崩溃与超时时写出的文件
+static string crash_file;
+static string timeout_file;
+// 崩溃处理使用的栈，栈溢出时仍可执行
+static char alt_stack[1 << 16];
+
+static double now(void) {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 写出当前输入，只使用异步信号安全的函数
+static void on_signal(int sig) {
+    const string &path = sig == SIGALRM ? timeout_file : crash_file;
+    int           fd   = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        if (write(fd, current.data(), current.size()) < 0) {
+        }
+        close(fd);
+    }
+    const char *msg = sig == SIGALRM ? "timeout, input written to "
+                                     : "crash, input written to ";
+    if (write(2, msg, strlen(msg)) < 0 ||
+        write(2, path.c_str(), path.size()) < 0 || write(2, "\n", 1) < 0) {
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+    return;
+}
+
+static void install_handlers(void) {
+    stack_t ss;
+    ss.ss_sp    = alt_stack;
+    ss.ss_size  = sizeof(alt_stack);
+    ss.ss_flags = 0;
+    sigaltstack(&ss, NULL);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sa.sa_flags   = SA_ONSTACK;
+    for (int sig : {SIGSEGV, SIGBUS, SIGABRT, SIGFPE, SIGILL, SIGALRM}) {
+        sigaction(sig, &sa, NULL);
+    }
+    return;
+}
+
+static bool read_file(const string &path, string &content) {
+    ifstream fin(path, ios::in | ios::binary);
+    if (fin.is_open() == false) {
+        return false;
+    }
+    ostringstream ss;
+    ss << fin.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+static void write_file(const string &path, const string &content) {
+    ofstream fout(path, ios::out | ios::binary | ios::trunc);
+    fout << content;
+    return;
+}
+
+// 读入语料，目录中的文件按名字排序
+static void load(const string &path, vector<input_t> &corpus) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        cout << "Corpus not found: " << path << endl;
+        return;
+    }
+    if (S_ISDIR(st.st_mode) == false) {
+        input_t input;
+        input.name = path;
+        if (read_file(path, input.data)) {
+            corpus.push_back(input);
+        }
+        return;
+    }
+    vector<string> names;
+    DIR           *d = opendir(path.c_str());
+    while (dirent *ent = readdir(d)) {
+        string name = path + "/" + ent->d_name;
+        if (stat(name.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            names.push_back(name);
+        }
+    }
+    closedir(d);
+    sort(names.begin(), names.end());
+    for (auto &name : names) {
+        load(name, corpus);
+    }
+    return;
+}
+
+// 读入 libFuzzer 格式的字典，每行为 name="value"
+static void load_dict(const string &path, vector<string> &dict) {
+    ifstream fin(path);
+    if (fin.is_open() == false) {
+        cout << "Dictionary not found: " << path << endl;
+        return;
+    }
+    string line;
+    while (getline(fin, line)) {
+        size_t l = line.find('"');
+        size_t r = line.rfind('"');
+        if (line.empty() || line[0] == '#' || l == string::npos || r <= l) {
+            continue;
+        }
+        string word;
+        for (size_t i = l + 1; i < r; i++) {
+            if (line[i] == '\\' && i + 1 < r) {
+                i++;
+            }
+            word.push_back(line[i]);
+        }
+        dict.push_back(word);
+    }
+    return;
+}
+
+// 执行一个输入，返回耗时，单位为秒
+static double run_one(const string &data, int timeout) {
+    current      = data;
+    double start = now();
+    alarm(timeout);
+    LLVMFuzzerTestOneInput((const uint8_t *)current.data(), current.size());
+    alarm(0);
+    return now() - start;
+}
+
+// 嵌套压力测试编译的输出种类
+static const char *stress_emits[] = {"ast", "snapshot", "ir", "llvm", "obj"};
+
+// 按命令行的编译路径编译一个输入，生成各种输出，快照再读回重建 AST
+// 返回耗时，单位为秒，failed 为出错的输出种类数
+static double compile_one(const string &data, int timeout, int &failed) {
+    current      = data;
+    failed       = 0;
+    double start = now();
+    alarm(timeout);
+    // 错误信息写到 diag，其余输出丢弃
+    cout.setstate(ios::badbit);
+    for (const char *e : stress_emits) {
+        emit      = e;
+        opt_level = 2;
+        string        out;
+        ostringstream diag;
+        if (compile_buffer(current, out, "<stress>", NULL, diag) != 0) {
+            failed++;
+            continue;
+        }
+        Snapshot snapshot;
+        if (emit == "snapshot" &&
+            (snapshot.load(out) == false || snapshot.build() == nullptr)) {
+            failed++;
+        }
+    }
+    cout.clear();
+    alarm(0);
+    return now() - start;
+}
+
+// 随机变异：翻转位、改写、插入、删除、复制片段、插入字典项、与其它输入拼接
+static string mutate(const string &in, const vector<input_t> &corpus,
+                     const vector<string> &dict, size_t max_len,
+                     mt19937 &rng) {
+    string s = in;
+    int    n = 1 + rng() % 4;
+    for (int i = 0; i < n; i++) {
+        size_t pos = s.empty() ? 0 : rng() % (s.size() + 1);
+        switch (rng() % 7) {
+            case 0:
+                if (pos < s.size()) {
+                    s[pos] ^= 1 << (rng() % 8);
+                }
+                break;
+            case 1:
+                if (pos < s.size()) {
+                    s[pos] = rng() % 256;
+                }
+                break;
+            case 2:
+                s.insert(pos, 1, (char)(rng() % 256));
+                break;
+            case 3:
+                if (pos < s.size()) {
+                    s.erase(pos, 1 + rng() % 16);
+                }
+                break;
+            case 4:
+                if (pos < s.size()) {
+                    string part = s.substr(pos, 1 + rng() % 64);
+                    s.insert(rng() % (s.size() + 1), part);
+                }
+                break;
+            case 5:
+                if (dict.empty() == false) {
+                    s.insert(pos, dict[rng() % dict.size()]);
+                }
+                break;
+            case 6: {
+                const string &other = corpus[rng() % corpus.size()].data;
+                s = s.substr(0, pos) + other.substr(rng() % (other.size() + 1));
+                break;
+            }
+        }
+    }
+    if (s.size() > max_len) {
+        s.resize(max_len);
+    }
+    return s;
+}
+
+static string build(const shape_t &shape, size_t k) {
+    string s = shape.head;
+    for (size_t i = 0; i < k; i++) {
+        s += shape.unit;
+    }
+    s += shape.mid;
+    for (size_t i = 0; i < k; i++) {
+        s += shape.unit2;
+    }
+    return s + shape.tail;
+}
+
+// 规模为 k 时的耗时与分配字节数，耗时取三次中最短的
+static void measure(const shape_t &shape, size_t k, int timeout,
+                    double &seconds, uint64_t &bytes) {
+    string data = build(shape, k);
+    seconds     = 0;
+    for (int i = 0; i < 3; i++) {
+        uint64_t count0, bytes0, count1, bytes1;
+        alloc_stats(count0, bytes0);
+        double t = run_one(data, timeout);
+        alloc_stats(count1, bytes1);
+        seconds = i == 0 ? t : min(seconds, t);
+        bytes   = bytes1 - bytes0;
+    }
+    return;
+}
+
+// 将各输入的规模从 base 倍增到 base * 2^steps，
+// 用最后 4 倍区间上的增长估计指数，耗时超过噪声下限且指数大于 1.5，
+// 或分配字节数的指数大于 1.25 时判为超线性，返回超线性的输入个数
+static int perf_check(const vector<shape_t> &shapes, size_t depth,
+                      size_t width, int steps, int timeout) {
+    char line[256];
+    snprintf(line, sizeof(line), "%-22s %8s %10s %12s %8s %8s %12s\n",
+             "input", "size", "time(ms)", "bytes", "t-exp", "m-exp",
+             "status");
+    cout << line;
+    int flagged = 0;
+    for (auto &shape : shapes) {
+        size_t base = shape.base != 0 ? shape.base
+                      : shape.nested   ? depth
+                                       : width;
+        vector<double>   seconds;
+        vector<uint64_t> bytes;
+        size_t           k = base;
+        for (int i = 0; i <= steps; i++, k *= 2) {
+            double   t;
+            uint64_t b;
+            measure(shape, k, timeout, t, b);
+            seconds.push_back(t);
+            bytes.push_back(b);
+        }
+        size_t top = seconds.size() - 1, mid = top >= 2 ? top - 2 : 0;
+        double span  = pow(2, top - mid);
+        double t_exp = log(max(seconds[top], 1e-9) / max(seconds[mid], 1e-9)) /
+                       log(span);
+        double m_exp = log(max(bytes[top], (uint64_t)1) /
+                           (double)max(bytes[mid], (uint64_t)1)) /
+                       log(span);
+        string status = "ok";
+        if ((seconds[top] > 0.005 && t_exp > 1.5) || m_exp > 1.25) {
+            status = "SUPERLINEAR";
+            flagged++;
+        }
+        snprintf(line, sizeof(line),
+                 "%-22s %8lu %10.3f %12lu %8.2f %8.2f %12s\n",
+                 shape.name.substr(0, 22).c_str(), build(shape, k / 2).size(),
+                 seconds[top] * 1e3, bytes[top], t_exp, m_exp,
+                 status.c_str());
+        cout << line;
+    }
+    return flagged;
+}
+
+// 内置的病态输入：深层嵌套与超长的同类结构
+static vector<shape_t> builtin_shapes(void) {
+    return {
+        {"nest paren", "int main(){return ", "(", "1", ")", ";}", true},
+        {"nest block", "int main(){", "{", "", "}", "}", true},
+        {"nest if", "int main(){", "if(1)", ";", "", "}", true},
+        {"nest while", "int main(){", "while(1)", "break;", "", "}", true},
+        {"nest else", "int main(){", "if(1);else ", ";", "", "}", true},
+        {"nest unary", "int main(){return ", "-!", "1", "", ";}", true},
+        {"nest call", "int f(int a){return a;}int main(){return ", "f(", "1", ")", ";}", true},
+        {"nest index", "int a[1];int main(){return ", "a[", "0", "]", ";}", true},
+        {"nest init", "int a[1]=", "{", "1", "}", ";int main(){return 0;}", true},
+        {"long sum", "int main(){return 1", "+1", "", "", ";}", false},
+        {"long cond", "int main(){if(1", "&&1||1", "", "", ");}", false},
+        {"long args", "int main(){return f(1", ",1", ")", "", ";}", false},
+        {"long block", "int main(){", "a=a+1;", "", "", "}", false},
+        {"long decl", "", "int a0=1,b[2][2]={{1},{2}};", "", "", "", false},
+        {"long ident", "int ", "a", ";", "", "", false},
+        {"long number", "int a=", "9", ";", "", "", false},
+        {"long comment", "/*", "*", "*/", "", "", false},
+        {"long line comment", "//", "/", "\n", "", "", false},
+        {"long string", "\"", "a", "\"", "", "", false},
+        {"bad chars", "", "@#$", "", "", "", false},
+        {"unclosed", "", "int main(){(", "", "", "", false},
+    };
+}
+
+int main(int argc, char **argv) {
+    vector<string> paths;
+    string         dict_file = "";
+    string         artifacts = ".";
+    uint32_t       seed      = 1;
+    uint64_t       runs      = 0;
+    size_t         max_len   = 4096;
+    size_t         depth     = 4096;
+    size_t         stress    = 1000000;
+    size_t         width     = 2048;
+    int            steps     = 3;
+    int            timeout   = 10;
+    double         slow      = 0.1;
+    bool           perf      = true;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--corpus" && i + 1 < argc) {
+            paths.push_back(argv[++i]);
+        }
+        else if (arg == "--dict" && i + 1 < argc) {
+            dict_file = argv[++i];
+        }
+        else if (arg == "--artifacts" && i + 1 < argc) {
+            artifacts = argv[++i];
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        }
+        else if (arg == "--runs" && i + 1 < argc) {
+            runs = strtoull(argv[++i], NULL, 10);
+        }
+        else if (arg == "--max-len" && i + 1 < argc) {
+            max_len = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--depth" && i + 1 < argc) {
+            depth = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--stress" && i + 1 < argc) {
+            stress = strtoull(argv[++i], NULL, 10);
+        }
+        else if (arg == "--width" && i + 1 < argc) {
+            width = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--steps" && i + 1 < argc) {
+            steps = max(2, atoi(argv[++i]));
+        }
+        else if (arg == "--timeout" && i + 1 < argc) {
+            timeout = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--slow-ms" && i + 1 < argc) {
+            slow = atof(argv[++i]) / 1e3;
+        }
+        else if (arg == "--no-perf") {
+            perf = false;
+        }
+        else if (arg.empty() == false && arg[0] != '-') {
+            paths.push_back(arg);
+        }
+        else {
+            cout << "usage: " << argv[0]
+                 << " [--corpus dir] [--dict file] [--runs 0] [--seed 1] "
+                    "[--max-len 4096]\n"
+                    "       [--artifacts dir] [--timeout 10] [--slow-ms 100] "
+                    "[--no-perf] [--depth 4096] [--width 2048] [--steps 3]\n"
+                    "       [--stress 1000000] [file ...]"
+                 << endl;
+            return 1;
+        }
+    }
+    string target = argv[0];
+    target        = target.substr(target.rfind('/') + 1);
+    crash_file    = artifacts + "/" + target + "-crash";
+    timeout_file  = artifacts + "/" + target + "-timeout";
+    install_handlers();
+    // 分配统计只在打开时记录
+    time_report = true;
+    vector<input_t> corpus;
+    vector<string>  dict;
+    for (auto &path : paths) {
+        load(path, corpus);
+    }
+    if (dict_file.empty() == false) {
+        load_dict(dict_file, dict);
+    }
+    if (corpus.empty()) {
+        corpus.push_back({"<empty>", ""});
+    }
+    int    slow_cnt = 0;
+    double slowest  = 0;
+    string slowest_name;
+    auto   check_slow = [&](const input_t &input, double seconds) {
+        if (seconds > slowest) {
+            slowest      = seconds;
+            slowest_name = input.name;
+        }
+        if (seconds > slow) {
+            string path = artifacts + "/" + target + "-slow-" +
+                          to_string(slow_cnt++);
+            write_file(path, input.data);
+            cout << "slow input (" << seconds * 1e3 << " ms, "
+                 << input.data.size() << " bytes) written to " << path
+                 << endl;
+        }
+    };
+    // 回放语料
+    for (auto &input : corpus) {
+        check_slow(input, run_one(input.data, timeout));
+    }
+    cout << "replayed " << corpus.size() << " inputs, slowest "
+         << slowest * 1e3 << " ms (" << slowest_name << ")" << endl;
+    // 随机变异
+    mt19937 rng(seed);
+    double  start = now();
+    for (uint64_t i = 1; i <= runs; i++) {
+        input_t input;
+        input.name = "mutation " + to_string(i);
+        input.data =
+            mutate(corpus[rng() % corpus.size()].data, corpus, dict, max_len,
+                   rng);
+        check_slow(input, run_one(input.data, timeout));
+        if (i % 10000 == 0 || i == runs) {
+            cout << "#" << i << " execs, "
+                 << (uint64_t)(i / max(now() - start, 1e-9)) << " exec/s"
+                 << endl;
+        }
+    }
+    int flagged = 0;
+    if (perf) {
+        vector<shape_t> shapes = builtin_shapes();
+        // 语料中的输入重复多次，基础规模约为 16KB
+        for (auto &input : corpus) {
+            if (input.data.empty()) {
+                continue;
+            }
+            shapes.push_back({input.name.substr(input.name.rfind('/') + 1),
+                              "", input.data, "", "", "", false,
+                              max((size_t)1, 16384 / input.data.size())});
+        }
+        flagged = perf_check(shapes, depth, width, steps, timeout);
+        if (flagged != 0) {
+            cout << flagged << " input(s) with superlinear time or memory"
+                 << endl;
+        }
+    }
+    // 嵌套压力测试，栈溢出时由信号处理写出输入
+    // --stress 层的输入各种输出都必须能生成。输入有数 MB，超时为 --timeout 的 10 倍
+    int broken = 0;
+    if (stress != 0) {
+        for (auto &shape : builtin_shapes()) {
+            if (shape.nested == false) {
+                continue;
+            }
+            int    failed;
+            double seconds = compile_one(build(shape, stress), timeout * 10, failed);
+            char   line[256];
+            snprintf(line, sizeof(line), "%-22s %8lu levels %10.3f ms %s\n",
+                     shape.name.c_str(), stress, seconds * 1e3,
+                     failed == 0 ? "ok" : "FAILED");
+            cout << line;
+            broken += failed != 0;
+        }
+    }
+    return flagged == 0 && slow_cnt == 0 && broken == 0 ? 0 : 1;
+}
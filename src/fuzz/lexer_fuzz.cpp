@@ -0,0 +1,41 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// lexer_fuzz.cpp for Simple-XX/SimpleCompiler.
+
+// 词法分析的模糊测试入口
+// 对任意输入，词法分析必须在读完输入后返回 END，
+// 每个 token 至少消耗一个字符，因此 token 数不超过输入长度
+
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "lexical.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    // 错误信息输出到 cout，测试时丢弃
+    cout.setstate(ios::badbit);
+    error = new Error("<fuzz>");
+    {
+        Scanner scanner((const char *)data, size);
+        Lexer   lexer(scanner);
+        size_t  tokens = 0;
+        while (true) {
+            Token *token = lexer.lexing();
+            Tag    tag   = token->tag;
+            token->to_string();
+            delete token;
+            if (tag == END) {
+                break;
+            }
+            // 没有前进
+            if (++tokens > size) {
+                abort();
+            }
+        }
+    }
+    delete error;
+    error = NULL;
+    cout.clear();
+    return 0;
+}
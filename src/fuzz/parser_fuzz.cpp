@@ -0,0 +1,35 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// parser_fuzz.cpp for Simple-XX/SimpleCompiler.
+
+// 语法分析的模糊测试入口
+// 对任意输入，语法分析必须正常返回：成功时得到可以输出的 AST 且没有错误，
+// 失败时返回空指针并记录错误号
+
+#include "cstdint"
+#include "cstdlib"
+#include "iostream"
+#include "parser.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    // 错误信息输出到 cout，测试时丢弃
+    cout.setstate(ios::badbit);
+    error = new Error("<fuzz>");
+    {
+        Scanner scanner((const char *)data, size);
+        Lexer   lexer(scanner);
+        Parser  parser(lexer);
+        ASTPtr  prog = parser.parsing();
+        if ((prog != NULL) != (error->get_err_no() == 0)) {
+            abort();
+        }
+        if (prog != NULL) {
+            prog->to_string();
+        }
+    }
+    delete error;
+    error = NULL;
+    cout.clear();
+    return 0;
+}
@@ -0,0 +1,73 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// a64sim.h for Simple-XX/SimpleCompiler.
+
+#ifndef _A64SIM_H_
+#define _A64SIM_H_
+
+#include "cstdint"
+#include "iostream"
+#include "string"
+#include "vector"
+#include "aarch64.h"
+
+// AArch64 子集模拟器
+// 只实现 aarch64_link 生成的指令形式，其余指令视为非法
+// svc 以 x8 为调用号，退出或调用 simrt.h 中的运行时函数
+// 统计退出前执行完的指令条数，用于比较各优化级别生成的代码
+class A64Sim {
+private:
+    // 映像与栈
+    std::vector<uint8_t> mem;
+    // mem[0] 的地址
+    uint64_t base;
+    // 入口
+    uint64_t entry;
+    // 代码结束的位置，之前的内存不可写
+    uint64_t text_end;
+    // 栈的字节数
+    size_t stack_size;
+    // 输入输出
+    std::istream &in;
+    std::ostream &out;
+    // x0-x30 与 sp
+    uint64_t x[31];
+    uint64_t sp;
+    // 条件标志
+    bool n, z, c, v;
+    // 已执行的指令条数
+    uint64_t steps;
+    // 指令条数上限，0 表示不限制
+    uint64_t step_limit;
+    // 运行时错误
+    std::string trap;
+
+    // 检查 [_addr, _addr + _size) 是否可以访问
+    bool check(uint64_t _addr, size_t _size, bool _write);
+    // 读寄存器，_sp 为 true 时 31 号为 sp，否则为 zr
+    uint64_t get(int _reg, bool _sp) const;
+    // 写寄存器，32 位写入时清零高 32 位
+    void set(int _reg, uint64_t _val, bool _sf, bool _sp);
+    // 条件码是否成立
+    bool cond(int _cond) const;
+    // 读写内存，出错时返回 false
+    bool load(uint64_t _addr, int _size, int _reg);
+    bool store(uint64_t _addr, int _size, int _reg);
+
+public:
+    A64Sim(const A64Image &_image, std::istream &_in, std::ostream &_out);
+    ~A64Sim(void);
+    // 设置指令条数上限
+    void set_step_limit(uint64_t _limit);
+    // 设置栈的字节数
+    void set_stack_size(size_t _size);
+    // 从入口开始执行，返回退出码的低 8 位，出错时返回 -1
+    int run(void);
+    // 已执行的指令条数
+    uint64_t get_steps(void) const;
+    // 运行时错误，没有错误时为空
+    const std::string &get_trap(void) const;
+};
+
+#endif /* _A64SIM_H_ */
@@ -0,0 +1,174 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// aarch64.h for Simple-XX/SimpleCompiler.
+
+#ifndef _AARCH64_H_
+#define _AARCH64_H_
+
+#include "cstdint"
+#include "string"
+#include "vector"
+#include "ir_tac.h"
+#include "simrt.h"
+
+// AArch64 后端
+// 三地址码先翻译为 A64Inst 序列，再输出为 GNU 汇编，或编码链接为供模拟器运行的映像
+// 使用次数最多的虚拟寄存器分配到 x19-x28，其余放在栈帧中
+// 整数使用 w 寄存器，指针使用 x 寄存器，按 AAPCS64 传参与返回
+// 数组元素的读写使用基址加偏移与 sxtw #2 缩放的寄存器偏移寻址，
+// 只给一个变量赋值的简单 if 语句生成 csel
+
+// 指令，A64_LA 之后为伪指令
+enum a64_op_t {
+    // rd = rn + imm，imm 为 12 位，shift 为 12 时左移 12 位
+    A64_ADDI,
+    A64_SUBI,
+    // cmp rn, imm
+    A64_CMPI,
+    // rd = rn op rm
+    A64_ADD,
+    A64_SUB,
+    A64_CMP,
+    A64_MOV,
+    // xd = xn + sxtw(wm) << shift
+    A64_ADD_SXTW,
+    A64_MUL,
+    A64_SDIV,
+    // rd = ra - rn * rm
+    A64_MSUB,
+    // rd = cond ? rn : rm
+    A64_CSEL,
+    // rd = cond ? 1 : 0
+    A64_CSET,
+    // 16 位立即数，shift 为 0、16、32、48
+    A64_MOVZ,
+    A64_MOVN,
+    A64_MOVK,
+    // [rn + imm]，imm 为访问宽度的非负整数倍
+    A64_LDR,
+    A64_STR,
+    // [rn + imm]，imm 为 9 位有符号数
+    A64_LDUR,
+    A64_STUR,
+    // [xn + sxtw(wm) << shift] 的 32 位读写，shift 为 0 或 2
+    A64_LDR_IDX,
+    A64_STR_IDX,
+    // stp x29, x30, [sp, #imm]!
+    A64_STP_PRE,
+    // ldp x29, x30, [sp], #imm
+    A64_LDP_POST,
+    A64_B,
+    A64_BL,
+    A64_BCOND,
+    A64_CBZ,
+    A64_CBNZ,
+    A64_RET,
+    A64_ADRP,
+    A64_SVC,
+    // xd = &sym
+    A64_LA,
+    // 调用 sym
+    A64_CALL,
+    // 标号
+    A64_LABEL,
+};
+
+// 寄存器编号，31 按指令为 sp 或 zr
+enum a64_reg_t {
+    A64_X0  = 0,
+    A64_X8  = 8,
+    A64_X9  = 9,
+    A64_X10 = 10,
+    A64_X11 = 11,
+    A64_X16 = 16,
+    A64_X17 = 17,
+    A64_X19 = 19,
+    A64_X28 = 28,
+    A64_FP  = 29,
+    A64_LR  = 30,
+    A64_SP  = 31,
+    A64_ZR  = 31,
+};
+
+// 条件码
+enum a64_cond_t {
+    A64_EQ = 0x0,
+    A64_NE = 0x1,
+    A64_LO = 0x3,
+    A64_GE = 0xa,
+    A64_LT = 0xb,
+    A64_GT = 0xc,
+    A64_LE = 0xd,
+};
+
+// 指令
+// x 为 true 时使用 64 位寄存器，分支的目标与标号的编号在 label 中
+class A64Inst {
+public:
+    a64_op_t    op;
+    bool        x;
+    int         rd;
+    int         rn;
+    int         rm;
+    int         ra;
+    int64_t     imm;
+    int         shift;
+    int         cond;
+    int32_t     label;
+    std::string sym;
+
+    A64Inst(a64_op_t _op, bool _x = false, int _rd = 0, int _rn = 0,
+            int _rm = 0, int64_t _imm = 0)
+        : op(_op), x(_x), rd(_rd), rn(_rn), rm(_rm), ra(0), imm(_imm),
+          shift(0), cond(0), label(-1) {
+    }
+};
+
+// 函数
+class A64Function {
+public:
+    std::string          name;
+    std::vector<A64Inst> code;
+    // 标号个数
+    int32_t label_cnt;
+};
+
+// 程序
+class A64Program {
+public:
+    std::vector<A64Function> funs;
+    std::vector<IRGlobal>    globals;
+    // 外部函数
+    std::vector<std::string> externs;
+};
+
+// 链接后的程序映像，从 base 开始依次为代码与全局变量
+class A64Image {
+public:
+    // 起始地址，之下的地址不可访问
+    uint64_t             base;
+    std::vector<uint8_t> mem;
+    // 入口，调用 main 后以其返回值退出
+    uint64_t entry;
+    // 代码结束的位置
+    uint64_t text_end;
+};
+
+// 将三地址码翻译为 AArch64 指令
+void aarch64_lower(const IRModule &_module, A64Program &_prog);
+// 只翻译一个函数，各函数的翻译互不影响
+void aarch64_lower_function(const IRModule &_module, const IRFunction &_fun,
+                            A64Function &_out);
+// 输出一个函数的汇编
+std::string aarch64_asm_function(const A64Function &_fun);
+// 输出 GNU 汇编
+std::string aarch64_asm(const A64Program &_prog);
+// 以各函数已输出的汇编代替 _prog.funs 输出 GNU 汇编
+std::string aarch64_asm(const A64Program &_prog,
+                        const std::vector<std::string> &_funs);
+// 编码并链接，外部函数只能为运行时函数，失败时返回 false 并给出原因
+// 运行时函数的桩以 x8 为调用号执行 svc
+bool aarch64_link(const A64Program &_prog, A64Image &_image, std::string &_err);
+
+#endif /* _AARCH64_H_ */
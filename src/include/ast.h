@@ -11,18 +11,118 @@
 #include <string>
 #include <vector>
 #include "type.h"
+#include "typetab.h"
+#include "pool.h"
+#include "timer.h"
 
 using namespace std;
 
 class MetaAST;
+class CompUnitAST;
+class StmtAST;
+class FuncDefAST;
+class FuncCallAST;
+class VarDeclAST;
+class VarDefAST;
+class IdAST;
+class InitValAST;
+class BlockAST;
+class BinaryAST;
+class UnaryAST;
+class NumAST;
+class IfAST;
+class WhileAST;
+class ControlAST;
+class AssignAST;
+class LValAST;
+class EmptyAST;
 
 typedef std::unique_ptr<MetaAST> ASTPtr;
 typedef std::vector<ASTPtr> ASTPtrList;
 
+// to_string 输出的一段，child 为空时输出 text，否则输出子结点
+struct ast_piece_t {
+    string text;
+    MetaAST *child;
+};
+
+// 释放结点，子结点放入待释放队列中逐个释放，嵌套再深也不会递归
+// 各结点的析构函数用它释放子结点
+void ast_drop(ASTPtr &node);
+
+// 访问者，语义分析及之后的各遍通过它遍历 AST
+class ASTVisitor {
+    public:
+        virtual ~ASTVisitor() = default;
+        virtual void visit(CompUnitAST &ast) = 0;
+        virtual void visit(StmtAST &ast) = 0;
+        virtual void visit(FuncDefAST &ast) = 0;
+        virtual void visit(FuncCallAST &ast) = 0;
+        virtual void visit(VarDeclAST &ast) = 0;
+        virtual void visit(VarDefAST &ast) = 0;
+        virtual void visit(IdAST &ast) = 0;
+        virtual void visit(InitValAST &ast) = 0;
+        virtual void visit(BlockAST &ast) = 0;
+        virtual void visit(BinaryAST &ast) = 0;
+        virtual void visit(UnaryAST &ast) = 0;
+        virtual void visit(NumAST &ast) = 0;
+        virtual void visit(IfAST &ast) = 0;
+        virtual void visit(WhileAST &ast) = 0;
+        virtual void visit(ControlAST &ast) = 0;
+        virtual void visit(AssignAST &ast) = 0;
+        virtual void visit(LValAST &ast) = 0;
+        virtual void visit(EmptyAST &ast) = 0;
+};
+
+// 用显式的栈遍历 AST 的访问者，嵌套再深也不会递归
+// walk 从根结点开始访问，visit 由 step() 得到本结点已完成的步数：
+// 调用 descend 时先访问一个子结点，之后以下一步再次访问本结点；
+// 调用 resume 时直接以下一步再次访问本结点；两者都不调用时本结点结束
+class ASTWalker : public ASTVisitor {
+    private:
+        struct frame_t {
+            MetaAST *node;
+            uint32_t step;
+            // 父结点指定的访问方式
+            uint32_t mode;
+            // 供 visit 在各步之间保存数据
+            uint32_t local;
+        };
+        vector<frame_t> frames;
+        // 本次访问之后要进入的子结点与其访问方式
+        MetaAST *child = nullptr;
+        uint32_t child_mode = 0;
+        bool again = false;
+    protected:
+        // 从 root 开始遍历，visit 中不能再调用
+        void walk(MetaAST &root, uint32_t mode = 0);
+        uint32_t step(void) const { return frames.back().step; }
+        uint32_t mode(void) const { return frames.back().mode; }
+        uint32_t &local(void) { return frames.back().local; }
+        void descend(MetaAST &node, uint32_t mode = 0) {
+            child = &node;
+            child_mode = mode;
+            again = true;
+        }
+        void resume(void) { again = true; }
+};
+
 class MetaAST {
+    protected:
+        // 在源文件中的行列，由 Parser 设置，0 表示未知
+        uint32_t line = 0;
+        uint32_t col = 0;
     public:
+        MetaAST() { stat_add(STAT_AST_NODES); }
+        void set_pos(uint32_t l, uint32_t c) { line = l; col = c; }
+        uint32_t get_line(void) const { return line; }
+        uint32_t get_col(void) const { return col; }
         virtual ~MetaAST() = default;
-        virtual string to_string(void) = 0;
+        // 按输出顺序给出本结点的文字与子结点
+        virtual void pieces(vector<ast_piece_t> &out) = 0;
+        // 输出以本结点为根的子树，用显式的栈展开，不递归
+        string to_string(void);
+        virtual void accept(ASTVisitor &v) = 0;
 };
 
 // Compile Unit 编译单元
@@ -34,17 +134,21 @@ class CompUnitAST : public MetaAST {
         // construction
         ~CompUnitAST() override {
             for (auto &unit : units) {
-                if (unit) unit.reset();
+                ast_drop(unit);
             }
         }
         // destruction
-        string to_string(void) override {
-            string output;
-            for (auto &unit : units)
-            {
-                output = output + "\n" + unit->to_string();
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"CompUnit: [", NULL});
+            for (auto &unit : units) {
+                out.push_back({"\n", NULL});
+                out.push_back({"", unit.get()});
             }
-            return "CompUnit: [" + output + "]\n";
+            out.push_back({"]\n", NULL});
+        }
+        ASTPtrList &get_units(void) { return units; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -56,11 +160,17 @@ class StmtAST : public MetaAST {
         StmtAST(ASTPtr s) : stmt(move(s)) {}
         // construction
         ~StmtAST() override {
-            if (stmt) stmt.reset();
+            ast_drop(stmt);
         }
         // destruction
-        string to_string(void) override {
-            return "Statement: {" + stmt->to_string() + "}\n";
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"Statement: {", NULL});
+            out.push_back({"", stmt.get()});
+            out.push_back({"}\n", NULL});
+        }
+        ASTPtr &get_stmt(void) { return stmt; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -75,24 +185,34 @@ class FuncDefAST : public MetaAST {
         // function params 函数参数列表
         ASTPtr body; 
         // function body 函数体
+        pool_id_t sym = POOL_NONE;
+        // resolved function 语义分析得到的函数下标
     public:
         FuncDefAST(Type t, const string &n, ASTPtrList p, ASTPtr b) : type(t), name(n), params(move(p)), body(move(b)) {}
         // construction
         ~FuncDefAST() override {
             for (auto &param : params) {
-                if (param) param.reset();
+                ast_drop(param);
             }
-            if (body) body.reset();
+            ast_drop(body);
         }
         // destruction
-        string to_string(void) override {
-            string output = "FunctionDef(" + type_to_string(type) + "): " + name + ' ';
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"FunctionDef(" + type_to_string(type) + "): " + name + ' ', NULL});
             for (auto &param : params)
             {
-                if (param) output = output + param->to_string();
+                if (param) out.push_back({"", param.get()});
             }
-            if (body) output = output + body->to_string();
-            return output;
+            if (body) out.push_back({"", body.get()});
+        }
+        Type get_type(void) const { return type; }
+        const string &get_name(void) const { return name; }
+        ASTPtrList &get_params(void) { return params; }
+        ASTPtr &get_body(void) { return body; }
+        pool_id_t get_sym(void) const { return sym; }
+        void set_sym(pool_id_t s) { sym = s; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -101,17 +221,26 @@ class FuncCallAST : public MetaAST {
     private:
         string name;
         ASTPtrList args;
+        pool_id_t sym = POOL_NONE;
+        // resolved function 语义分析得到的函数下标
     public:
         FuncCallAST(const string &n, ASTPtrList a = ASTPtrList{}) : name(n), args(move(a)) {}
         // construction
         ~FuncCallAST() override {
             for (auto &arg: args) {
-                if (arg) arg.reset();
+                ast_drop(arg);
             }
         }
         // destruction
-        string to_string(void) override {
-            return "FuncCallAST";
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"FuncCallAST", NULL});
+        }
+        const string &get_name(void) const { return name; }
+        ASTPtrList &get_args(void) { return args; }
+        pool_id_t get_sym(void) const { return sym; }
+        void set_sym(pool_id_t s) { sym = s; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -127,20 +256,23 @@ class VarDeclAST : public MetaAST {
         // construction
         ~VarDeclAST() override {
             for (auto &var: vars) {
-                if (var) var.reset();
+                ast_drop(var);
             }
         }
         // destruction
-        string to_string(void) override {
-            string output;
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({isConst ? "VarDeclAST (CONST): {" : "VarDeclAST: {", NULL});
             for (auto &unit : vars)
             {
-                output = output + "\n" + unit->to_string();
+                out.push_back({"\n", NULL});
+                out.push_back({"", unit.get()});
             }
-            if (isConst) {
-                return "VarDeclAST (CONST): {" + output + "}";
-            }
-            return "VarDeclAST: {" + output + "}";
+            out.push_back({"}", NULL});
+        }
+        ASTPtrList &get_vars(void) { return vars; }
+        bool is_const(void) const { return isConst; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -157,15 +289,26 @@ class VarDefAST : public MetaAST {
         VarDefAST(bool i, ASTPtr v, ASTPtr init = nullptr) : var(move(v)), initVal(move(init)), isConst(i) {}
         // construction
         ~VarDefAST() override {
-            if (var) var.reset();
-            if (initVal) initVal.reset();
+            ast_drop(var);
+            ast_drop(initVal);
         }
         // destruction
-        string to_string(void) override {
+        void pieces(vector<ast_piece_t> &out) override {
             if (isConst) {
-                return "VarDefAST (CONST): {" + var->to_string() + "}";
+                out.push_back({"VarDefAST (CONST): {", NULL});
+                out.push_back({"", var.get()});
+                out.push_back({"}", NULL});
+                return;
             }
-            return "VarDefAST: { " + var->to_string() + " }";
+            out.push_back({"VarDefAST: { ", NULL});
+            out.push_back({"", var.get()});
+            out.push_back({" }", NULL});
+        }
+        ASTPtr &get_var(void) { return var; }
+        ASTPtr &get_init(void) { return initVal; }
+        bool is_const(void) const { return isConst; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -176,21 +319,37 @@ class IdAST : public MetaAST {
         VarType type;
         ASTPtrList dim;
         bool isConst;
+        pool_id_t sym = POOL_NONE;
+        // resolved variable 语义分析得到的变量下标
+        type_id_t tid = TypeTab::TYPE_NONE;
+        // resolved type 语义分析得到的类型编号
 
     public:
         IdAST(const string &n, VarType t, bool i, ASTPtrList d = ASTPtrList{}) : name(n), type(t), dim(move(d)), isConst(i) {}
         // construction
         ~IdAST() override {
             for (auto &d : dim) {
-                d.reset();
+                ast_drop(d);
             }
         }
         // destruction
-        string to_string(void) override {
+        void pieces(vector<ast_piece_t> &out) override {
             if (isConst) {
-                return "IdAST (CONST) (" + vartype_to_string(type) + "): " + name;
+                out.push_back({"IdAST (CONST) (" + vartype_to_string(type) + "): " + name, NULL});
+                return;
             }
-            return "IdAST(" + vartype_to_string(type) + "): " + name;
+            out.push_back({"IdAST(" + vartype_to_string(type) + "): " + name, NULL});
+        }
+        const string &get_name(void) const { return name; }
+        VarType get_type(void) const { return type; }
+        ASTPtrList &get_dim(void) { return dim; }
+        bool is_const(void) const { return isConst; }
+        pool_id_t get_sym(void) const { return sym; }
+        void set_sym(pool_id_t s) { sym = s; }
+        type_id_t get_tid(void) const { return tid; }
+        void set_tid(type_id_t t) { tid = t; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -204,12 +363,17 @@ class InitValAST : public MetaAST {
         // construction
         ~InitValAST() override {
             for (auto &value: values) {
-                if (value) value.reset();
+                ast_drop(value);
             }
         }
         // destruction
-        string to_string(void) override {
-            return "InitValAST(" + vartype_to_string(type) + ")";
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"InitValAST(" + vartype_to_string(type) + ")", NULL});
+        }
+        VarType get_type(void) const { return type; }
+        ASTPtrList &get_values(void) { return values; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -223,17 +387,22 @@ class BlockAST : public MetaAST {
         // construction
         ~BlockAST() override {
             for (auto &s : stmts) {
-                if (s) s.reset();
+                ast_drop(s);
             }
         }
         // destruction
-        string to_string(void) override {
-            string output;
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"BlockAST: {", NULL});
             for (auto &unit : stmts)
             {
-                output = output + "\n" + unit->to_string();
+                out.push_back({"\n", NULL});
+                out.push_back({"", unit.get()});
             }
-            return "BlockAST: {" + output + "}";
+            out.push_back({"}", NULL});
+        }
+        ASTPtrList &get_stmts(void) { return stmts; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -250,12 +419,22 @@ class BinaryAST : public MetaAST {
         BinaryAST(Operator o, ASTPtr l, ASTPtr r) : op(o), left(move(l)), right(move(r)) {}
         // construction
         ~BinaryAST() override {
-            if (left) left.reset();
-            if (right) right.reset();
+            ast_drop(left);
+            ast_drop(right);
         }
         // destruction
-        string to_string(void) override {
-            return  '(' + (left->to_string()) + ' ' + op_to_string(op) + ' ' + (right->to_string()) + ')';
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"(", NULL});
+            out.push_back({"", left.get()});
+            out.push_back({' ' + op_to_string(op) + ' ', NULL});
+            out.push_back({"", right.get()});
+            out.push_back({")", NULL});
+        }
+        Operator get_op(void) const { return op; }
+        ASTPtr &get_left(void) { return left; }
+        ASTPtr &get_right(void) { return right; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -271,11 +450,18 @@ class UnaryAST : public MetaAST {
         UnaryAST(Operator o, ASTPtr e) : op(o), exp(move(e)) {}
         // construction
         ~UnaryAST() override {
-            if (exp) exp.reset();
+            ast_drop(exp);
         }
         // destruction
-        string to_string(void) override {
-            return '(' +  op_to_string(op) + ' ' + exp->to_string() + ')';
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({'(' + op_to_string(op) + ' ', NULL});
+            out.push_back({"", exp.get()});
+            out.push_back({")", NULL});
+        }
+        Operator get_op(void) const { return op; }
+        ASTPtr &get_exp(void) { return exp; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -289,8 +475,12 @@ class NumAST : public MetaAST {
         // construction
         ~NumAST() override {}
         // destruction
-        string to_string(void) override {
-            return std::to_string(val);
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({std::to_string(val), NULL});
+        }
+        int get_val(void) const { return val; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -307,15 +497,27 @@ class IfAST : public MetaAST {
         IfAST(ASTPtr c, ASTPtr t, ASTPtr e = nullptr) : conditionExp(move(c)), thenAST(move(t)), elseAST(move(e)) {}
         // construction
         ~IfAST() override {
-            if (conditionExp) conditionExp.reset();
-            if (thenAST) thenAST.reset();
-            if (elseAST) elseAST.reset();
+            ast_drop(conditionExp);
+            ast_drop(thenAST);
+            ast_drop(elseAST);
         }
         // destruction
-        string to_string(void) override {
-            if (elseAST)
-                return "IfAST: { if (" + conditionExp->to_string() + " ) then ( " + thenAST->to_string() + ") else (" + elseAST->to_string() + " ) }";
-            else return "IfAST: { if (" + conditionExp->to_string() + " ) then ( " + thenAST->to_string() + " ) }";
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"IfAST: { if (", NULL});
+            out.push_back({"", conditionExp.get()});
+            out.push_back({" ) then ( ", NULL});
+            out.push_back({"", thenAST.get()});
+            if (elseAST) {
+                out.push_back({") else (", NULL});
+                out.push_back({"", elseAST.get()});
+            }
+            out.push_back({" ) }", NULL});
+        }
+        ASTPtr &get_cond(void) { return conditionExp; }
+        ASTPtr &get_then(void) { return thenAST; }
+        ASTPtr &get_else(void) { return elseAST; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -330,12 +532,21 @@ class WhileAST : public MetaAST {
         WhileAST(ASTPtr c, ASTPtr b) : conditionExp(move(c)), body(move(b)) {}
         // construction
         ~WhileAST() override {
-            if (conditionExp) conditionExp.reset();
-            if (body) body.reset();
+            ast_drop(conditionExp);
+            ast_drop(body);
         }
         // destruction
-        string to_string(void) override {
-            return "WhileAST: { while (" + conditionExp->to_string() + " ) do ( " + body->to_string() + " ) }";
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"WhileAST: { while (", NULL});
+            out.push_back({"", conditionExp.get()});
+            out.push_back({" ) do ( ", NULL});
+            out.push_back({"", body.get()});
+            out.push_back({" ) }", NULL});
+        }
+        ASTPtr &get_cond(void) { return conditionExp; }
+        ASTPtr &get_body(void) { return body; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -350,23 +561,32 @@ class ControlAST : public MetaAST {
         ControlAST(Control t, ASTPtr r = nullptr) : type(t), returnStmt(move(r)) {}
         // construction
         ~ControlAST() override {
-            if (returnStmt) returnStmt.reset();
+            ast_drop(returnStmt);
         }
         // destruction
-        string to_string(void) override {
+        void pieces(vector<ast_piece_t> &out) override {
             if (type == Control::break_c) {
-                return "ControlAST: BREAK";
+                out.push_back({"ControlAST: BREAK", NULL});
+            }
+            else if (type == Control::continue_c) {
+                out.push_back({"ControlAST: CONTINUE", NULL});
             }
-            if (type == Control::continue_c) {
-                return "ControlAST: CONTINUE";
+            else if (type == Control::return_c && returnStmt) {
+                out.push_back({"ControlAST: RETURN (", NULL});
+                out.push_back({"", returnStmt.get()});
+                out.push_back({")", NULL});
             }
-            if (type == Control::return_c) {
-                if (returnStmt) {
-                    return "ControlAST: RETURN (" + returnStmt->to_string() + ")";
-                }
-                return "ControlAST: RETURN ";
+            else if (type == Control::return_c) {
+                out.push_back({"ControlAST: RETURN ", NULL});
             }
-            return "ERROR";
+            else {
+                out.push_back({"ERROR", NULL});
+            }
+        }
+        Control get_type(void) const { return type; }
+        ASTPtr &get_ret(void) { return returnStmt; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -381,12 +601,21 @@ class AssignAST : public MetaAST {
         AssignAST(ASTPtr l, ASTPtr r) : left(move(l)), right(move(r)) {}
         // construction
         ~AssignAST() override {
-            if (left) left.reset();
-            if (right) right.reset();
+            ast_drop(left);
+            ast_drop(right);
         }
         // destruction
-        string to_string(void) override {
-            return " AssignAST: { " + left->to_string() + " = " + right->to_string() + " }";
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({" AssignAST: { ", NULL});
+            out.push_back({"", left.get()});
+            out.push_back({" = ", NULL});
+            out.push_back({"", right.get()});
+            out.push_back({" }", NULL});
+        }
+        ASTPtr &get_left(void) { return left; }
+        ASTPtr &get_right(void) { return right; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -396,17 +625,31 @@ class LValAST : public MetaAST {
         string name;
         VarType type;
         ASTPtrList position;
+        pool_id_t sym = POOL_NONE;
+        // resolved variable 语义分析得到的变量下标
+        type_id_t tid = TypeTab::TYPE_NONE;
+        // resolved type 语义分析得到的取下标后的类型编号
     public:
         LValAST(const string &n, VarType t ,ASTPtrList p = ASTPtrList{}) : name(n), type(t), position(move(p)) {}
         // construction
         ~LValAST() override {
             for (auto &pos: position) {
-                if (pos) pos.reset();
+                ast_drop(pos);
             }
         }
         // destruction
-        string to_string(void) override {
-            return "LValAST:(" + vartype_to_string(type) + "):  { " + name + " }";
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"LValAST:(" + vartype_to_string(type) + "):  { " + name + " }", NULL});
+        }
+        const string &get_name(void) const { return name; }
+        VarType get_type(void) const { return type; }
+        ASTPtrList &get_position(void) { return position; }
+        pool_id_t get_sym(void) const { return sym; }
+        void set_sym(pool_id_t s) { sym = s; }
+        type_id_t get_tid(void) const { return tid; }
+        void set_tid(type_id_t t) { tid = t; }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -417,8 +660,11 @@ class EmptyAST : public MetaAST {
         // construction
         ~EmptyAST() override {}
         // destruction
-        string to_string(void) override {
-            return "EmptyAST";
+        void pieces(vector<ast_piece_t> &out) override {
+            out.push_back({"EmptyAST", NULL});
+        }
+        void accept(ASTVisitor &v) override {
+            v.visit(*this);
         }
 };
 
@@ -0,0 +1,199 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// bytecode.h for Simple-XX/SimpleCompiler.
+
+#ifndef _BYTECODE_H_
+#define _BYTECODE_H_
+
+#include "cstdint"
+#include "iostream"
+#include "string"
+#include "vector"
+#include "ir_tac.h"
+
+// 寄存器字节码
+// 由三地址码翻译而来，每条指令为一字节的操作码加若干操作数：
+// 寄存器与编号为 LEB128 无符号变长整数，立即数为 zigzag 编码的变长整数，
+// 跳转目标为 4 字节小端的代码偏移。文件中的多字节整数都按小端存放，与主机无关
+// 比较后跳转与按下标读写数组元素合并为一条指令
+// 每个函数在三地址码的寄存器之后另有两个临时寄存器，用于放置立即数
+
+// 操作码，注释为操作数：r 为寄存器，i 为立即数，n 为编号或大小，t 为跳转目标
+enum bc_op_t {
+    // r r
+    BC_MOV,
+    // r i
+    BC_LI,
+    // r r r
+    BC_ADD,
+    BC_SUB,
+    BC_MUL,
+    BC_DIV,
+    BC_MOD,
+    // r r i，RSUBI 为 d = i - a
+    BC_ADDI,
+    BC_MULI,
+    BC_DIVI,
+    BC_MODI,
+    BC_RSUBI,
+    // r r
+    BC_NOT,
+    // r r r
+    BC_LT,
+    BC_LE,
+    BC_GT,
+    BC_GE,
+    BC_EQ,
+    BC_NE,
+    // r r i
+    BC_LTI,
+    BC_LEI,
+    BC_GTI,
+    BC_GEI,
+    BC_EQI,
+    BC_NEI,
+    // r n，全局变量或栈上数组的地址
+    BC_LEAG,
+    BC_LEAF,
+    // r r r，d = a + b
+    BC_OFFSET,
+    // r r i
+    BC_OFFSETI,
+    // r r r，d = a + b * 4
+    BC_INDEX,
+    // r r i，读写 a + i 处的 32 位整数，STORE 的第一个操作数为写入的值
+    BC_LOAD,
+    BC_STORE,
+    // r r r，读写 a + b * 4 处的 32 位整数
+    BC_LOADX,
+    BC_STOREX,
+    // r n
+    BC_ZERO,
+    // t
+    BC_JMP,
+    // r t
+    BC_JT,
+    BC_JF,
+    // r r t，比较后跳转
+    BC_BLT,
+    BC_BLE,
+    BC_BGT,
+    BC_BGE,
+    BC_BEQ,
+    BC_BNE,
+    // r i t
+    BC_BLTI,
+    BC_BLEI,
+    BC_BGTI,
+    BC_BGEI,
+    BC_BEQI,
+    BC_BNEI,
+    // r
+    BC_ARG,
+    // i
+    BC_ARGI,
+    // r n
+    BC_CALL,
+    // n
+    BC_PROC,
+    BC_RET,
+    // r
+    BC_RETV,
+    // i
+    BC_RETI,
+    BC_CNT,
+};
+
+// 操作码的名字
+const char *bc_name(int _op);
+// 写入无符号与 zigzag 编码的有符号变长整数
+void bc_put_uint(std::vector<uint8_t> &_out, uint32_t _val);
+void bc_put_int(std::vector<uint8_t> &_out, int32_t _val);
+
+// 函数
+class BCFunction {
+public:
+    std::string name;
+    // 是否为外部函数，外部函数只能为 simrt.h 中的运行时函数
+    bool extern_flag;
+    bool void_flag;
+    uint32_t param_cnt;
+    // 寄存器个数，包括两个临时寄存器
+    uint32_t reg_cnt;
+    // 栈上数组的总字节数
+    uint32_t frame_size;
+    // 代码在模块代码中的范围
+    uint32_t entry;
+    uint32_t code_size;
+    // 运行时函数编号，读入时填写
+    int32_t runtime;
+};
+
+// 全局变量
+class BCGlobal {
+public:
+    // 字节数
+    uint32_t size;
+    // 初始值，不足的部分为 0
+    std::vector<int32_t> init;
+};
+
+// 模块，各函数的代码依次存放
+class BCModule {
+public:
+    std::vector<BCGlobal>   globals;
+    std::vector<BCFunction> funs;
+    std::vector<uint8_t>    code;
+    // main 的下标
+    uint32_t main;
+};
+
+// 将三地址码翻译为字节码
+void bc_lower(const IRModule &_module, BCModule &_bc);
+// 序列化为文件内容
+std::string bc_write(const BCModule &_bc);
+// 读入并校验文件内容，失败时返回 false 并给出原因
+// 校验通过的代码中寄存器、跳转目标与各编号都在范围内
+bool bc_read(const std::string &_data, BCModule &_bc, std::string &_err);
+// 反汇编
+std::string bc_dump(const BCModule &_bc);
+
+// 字节码虚拟机
+// 内存布局与三地址码解释器相同，指针为内存下标，整数运算按 32 位回绕
+// 以 computed goto 分派，并统计每种操作码执行的次数
+class BCVM {
+private:
+    const BCModule &bc;
+    // 输入输出
+    std::istream &in;
+    std::ostream &out;
+    // 内存
+    std::vector<uint8_t> mem;
+    // 内存上限
+    size_t mem_limit;
+    // 各操作码执行的次数
+    uint64_t counts[BC_CNT];
+    // 跳转与调用次数的上限，0 表示不限制
+    uint64_t step_limit;
+    // 运行时错误
+    std::string trap;
+
+public:
+    BCVM(const BCModule &_bc, std::istream &_in, std::ostream &_out);
+    ~BCVM(void);
+    // 设置上限，只在跳转与调用时检查，用于终止死循环
+    void set_step_limit(uint64_t _limit);
+    // 设置内存上限，单位为字节
+    void set_mem_limit(size_t _limit);
+    // 从 main 开始执行，返回 main 返回值的低 8 位，出错时返回 -1
+    int run(void);
+    // 已执行的指令条数
+    uint64_t get_steps(void) const;
+    // 操作码 _op 执行的次数
+    uint64_t get_count(int _op) const;
+    // 运行时错误，没有错误时为空
+    const std::string &get_trap(void) const;
+};
+
+#endif /* _BYTECODE_H_ */
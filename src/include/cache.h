@@ -0,0 +1,57 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// cache.h for Simple-XX/SimpleCompiler.
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include "cstdint"
+#include "iostream"
+#include "string"
+#include "string_view"
+
+using namespace std;
+
+// 编译缓存
+// 以源文件内容、编译选项与编译器构建标识的摘要为键，保存编译输出
+// 每个条目是缓存目录下的一个文件，超过大小上限时按最近使用时间淘汰
+// 统计文件记录命中次数与条目总大小的估计，估计超过上限时才扫描目录
+class Cache {
+private:
+    // 缓存目录
+    string dir;
+    // 大小上限，单位为字节
+    uint64_t limit;
+    // 条目总大小的估计
+    uint64_t used;
+    // 尚未写入统计文件的命中与未命中次数
+    uint64_t hits;
+    uint64_t misses;
+    // 尚未写入统计文件的条目大小变化
+    int64_t grown;
+    // 条目路径
+    string entry_path(const string &key) const;
+    // 扫描目录，淘汰最久未使用的条目直到不超过上限，返回剩余条目的总大小
+    uint64_t sweep(void);
+    // 记录一次查找，累计一定次数后写入统计文件
+    void count(bool hit);
+    // 将累计的统计写入统计文件，size 不为空时以它作为条目总大小
+    void flush(const uint64_t *size = NULL);
+
+public:
+    Cache(const string &_dir, uint64_t _limit);
+    ~Cache(void);
+    // 计算缓存键
+    static string key(string_view src, string_view options);
+    // 查找，命中时将输出保存到 out，record 为 false 时不计入命中统计
+    bool lookup(const string &key, string &out, bool record = true);
+    // 保存输出，连续保存多个条目时可以关闭 shrink，最后统一淘汰
+    void store(const string &key, const string &out, bool shrink = true);
+    // 条目总大小的估计超过上限时，淘汰最久未使用的条目直到不超过上限
+    void evict(void);
+    // 输出统计信息
+    void stats(ostream &os);
+};
+
+#endif /* _CACHE_H_ */
@@ -23,7 +23,7 @@ class Variable;
 class Function;
 class SymTab;
 
-extern Error *error;
+extern thread_local Error *error;
 
 extern const char *tokenName[];
 
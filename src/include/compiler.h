@@ -0,0 +1,94 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// compiler.h for Simple-XX/SimpleCompiler.
+
+#ifndef _COMPILER_H_
+#define _COMPILER_H_
+
+#include "condition_variable"
+#include "deque"
+#include "functional"
+#include "memory"
+#include "mutex"
+#include "string"
+#include "string_view"
+#include "thread"
+#include "vector"
+
+using namespace std;
+
+class Interner;
+
+// 共享库导出的接口
+#define SIMPLE_COMPILER_API __attribute__((visibility("default")))
+
+// 编译选项
+struct compile_options_t {
+    // 输出内容：ast 为 AST 文本，snapshot 为 AST 快照，ir 为三地址码
+    string emit = "ast";
+    // 优化级别，0 到 2
+    int opt_level = 0;
+};
+
+// 一次编译的结果
+struct compile_result_t {
+    // 错误个数
+    int err_cnt;
+    // 编译输出
+    string output;
+    // 错误信息
+    string diagnostics;
+};
+
+// 编译上下文，供嵌入编译器的程序使用
+// 上下文持有工作线程，每个线程有自己的驻留表、选项与错误信息，
+// 多次编译之间复用，不需要重新初始化。
+// compile 与 compile_all 可以在多个线程中同时调用，编译在工作线程中进行；
+// 源代码不会被复制，返回之前必须保持有效。
+// 阶段统计与跟踪按线程记录，可以与上下文一起使用，结果在所有线程间汇总
+class SIMPLE_COMPILER_API CompilerContext {
+private:
+    // 编译选项
+    compile_options_t options;
+    // 保护 options 与任务队列
+    mutex lock;
+    // 有新任务或需要退出时通知工作线程
+    condition_variable ready;
+    // 待执行的任务，参数为工作线程编号
+    deque<function<void(size_t)>> tasks;
+    // 是否正在退出
+    bool stopping;
+    // 各工作线程的驻留表，在编译之间保留，过大时清空
+    vector<unique_ptr<Interner>> interners;
+    // 工作线程
+    vector<thread> workers;
+    // 工作线程的主循环
+    void work(size_t id);
+    // 加入一个编译任务，完成后将结果写入 result 并减少 remaining
+    void submit(string_view src, const string &name, const compile_options_t &opts,
+                compile_result_t &result, size_t &remaining,
+                condition_variable &done);
+
+public:
+    // jobs 为工作线程数，为 0 时取处理器个数
+    CompilerContext(size_t jobs = 1,
+                    const compile_options_t &opts = compile_options_t());
+    CompilerContext(const CompilerContext &) = delete;
+    CompilerContext &operator=(const CompilerContext &) = delete;
+    ~CompilerContext(void);
+    // 设置之后提交的编译使用的选项
+    void set_options(const compile_options_t &opts);
+    compile_options_t get_options(void);
+    // 工作线程数
+    size_t jobs(void) const;
+    // 编译一段源代码，name 用于错误信息
+    compile_result_t compile(string_view src, const string &name = "<buffer>");
+    // 以 opts 编译一段源代码，不改变上下文的选项，各线程可以使用不同的选项
+    compile_result_t compile(string_view src, const string &name,
+                             const compile_options_t &opts);
+    // 并行编译多段源代码，结果与输入一一对应
+    vector<compile_result_t> compile_all(const vector<string_view> &srcs);
+};
+
+#endif /* _COMPILER_H_ */
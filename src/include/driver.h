@@ -0,0 +1,33 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// driver.h for Simple-XX/SimpleCompiler.
+
+#ifndef _DRIVER_H_
+#define _DRIVER_H_
+
+#include "iostream"
+#include "string"
+#include "string_view"
+
+using namespace std;
+
+class Cache;
+class IRModule;
+
+// 影响编译输出的选项，参与缓存键的计算
+string option_digest(void);
+// 编译一个源文件，输出保存到 out，返回错误个数
+// 给出 cache 时按顶层单元复用上次的输出
+int compile_file(const string &src_file, string &out, Cache *cache = NULL);
+// 编译内存中的源代码，name 用于错误信息，错误信息写到 diag，其余与 compile_file 相同
+int compile_buffer(string_view src, string &out, const string &name = "<buffer>",
+                   Cache *cache = NULL, ostream &diag = cout);
+// 编译一个源文件并按 level 级别优化，中间代码保存到 module，返回错误个数
+int compile_module(const string &src_file, IRModule &module, int level);
+// 编译一个源文件，LLVM IR 文本保存到 out，返回错误个数
+int compile_llvm(const string &src_file, string &out);
+// 按命令行选项编译全部源文件并写出结果，返回进程退出码
+int drive(void);
+
+#endif /* _DRIVER_H_ */
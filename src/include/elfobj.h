@@ -0,0 +1,83 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// elfobj.h for Simple-XX/SimpleCompiler.
+
+#ifndef _ELFOBJ_H_
+#define _ELFOBJ_H_
+
+#include "cstdint"
+#include "string"
+#include "unordered_map"
+#include "vector"
+
+// 可重定位 ELF64 目标文件
+// 只有 .text、.data、.rodata 与 .bss 四个节，重定位只作用于 .text
+// 重定位类型与机器类型由各后端给出，输出为小端序
+
+// 节
+enum elf_section_t {
+    SEC_UNDEF,
+    SEC_TEXT,
+    SEC_DATA,
+    SEC_RODATA,
+    SEC_BSS,
+};
+
+class ElfObject {
+private:
+    // 符号
+    struct Symbol {
+        std::string   name;
+        elf_section_t section;
+        uint64_t      value;
+        uint64_t      size;
+        // 是否为函数，否则为数据
+        bool func;
+        // 是否为全局符号
+        bool global;
+    };
+    // 重定位
+    struct Reloc {
+        uint64_t offset;
+        uint32_t sym;
+        uint32_t type;
+        int64_t  addend;
+    };
+    // 机器类型
+    uint16_t machine;
+    // ELF 头中的标志
+    uint32_t flags;
+    std::vector<Symbol> syms;
+    // 全局符号名到下标
+    std::unordered_map<std::string, uint32_t> names;
+    std::vector<Reloc>                        relocs;
+
+public:
+    // 各节内容
+    std::string text;
+    std::string data;
+    std::string rodata;
+    // .bss 的大小
+    uint64_t bss_size;
+
+    ElfObject(uint16_t _machine, uint32_t _flags = 0);
+    ~ElfObject(void);
+    // 按名字取得全局符号，不存在时添加一个未定义的符号
+    uint32_t symbol(const std::string &_name);
+    // 定义全局符号
+    void define(uint32_t _sym, elf_section_t _section, uint64_t _value,
+                uint64_t _size, bool _func);
+    // 添加局部符号，用于需要指向某条指令的重定位
+    uint32_t local(const std::string &_name, elf_section_t _section,
+                   uint64_t _value);
+    // 添加作用于 .text 的重定位
+    void reloc(uint64_t _offset, uint32_t _sym, uint32_t _type,
+               int64_t _addend);
+    // 将节的长度按 _align 对齐，代码节用 _fill 填充
+    static void align(std::string &_sec, size_t _align, char _fill = 0);
+    // 输出目标文件
+    std::string write(void) const;
+};
+
+#endif /* _ELFOBJ_H_ */
@@ -31,15 +31,19 @@ private:
     int err_no;
     // 保存错误位置
     Pos *pos;
+    // 错误信息的输出流
+    ostream &out;
 
 public:
-    Error(const string &f);
+    Error(const string &f, ostream &o = cout);
     virtual ~Error();
     void         set_line(unsigned int l);
     void         set_col(unsigned int c);
     void         set_err_no(int e);
     int          get_err_no(void) const;
     Pos *        get_pos(void) const;
+    const string &get_filename(void) const;
+    ostream &    get_out(void) const;
     virtual void display_err(void) const;
 };
 
@@ -7,15 +7,40 @@
 #ifndef _INIT_H_
 #define _INIT_H_
 
+#include "cstdint"
 #include "string"
 #include "vector"
 
 using namespace std;
 
-// 源文件
+// 版本号
+#define SIMPLE_COMPILER_VERSION "0.01"
+
+// 表示标准输入的源文件名
+#define STDIN_FILE "-"
+
+// 源文件，为 STDIN_FILE 时从标准输入读入
 extern std::vector<std::string> src_files;
 // 输出文件
 extern string dest_file;
+// 以下两项每个线程一份，编译上下文的工作线程按各自的选项设置
+// 输出内容：ast 为 AST 文本，snapshot 为 AST 快照，ir 为三地址码
+extern thread_local string emit;
+// 优化级别，0 到 2
+extern thread_local int opt_level;
+// 编译缓存目录，为空时不使用缓存
+extern string cache_dir;
+// 编译缓存大小上限，单位为字节
+extern uint64_t cache_limit;
+// 是否输出编译缓存统计
+extern bool cache_stats;
+// 编译服务监听的套接字，非空时作为服务启动
+extern string server_socket;
+// 客户端模式下连接的套接字，非空时将请求转发给编译服务
+extern string client_socket;
+
+// 解析带 K/M/G 后缀的大小，单位为字节
+uint64_t parse_size(const char *str);
 
 class Init {
 private:
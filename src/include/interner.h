@@ -0,0 +1,45 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// interner.h for Simple-XX/SimpleCompiler.
+
+#ifndef _INTERNER_H_
+#define _INTERNER_H_
+
+#include "cstdint"
+#include "deque"
+#include "string"
+#include "string_view"
+#include "unordered_map"
+
+typedef uint32_t name_id_t;
+
+// 空串的编号，驻留表创建与清空时预先驻留，用作默认名字
+static const name_id_t NAME_EMPTY = 0;
+
+// 字符串驻留表
+// 相同的字符串只保存一份，符号记录中只保存编号
+class Interner {
+private:
+    // 字符串本体，deque 追加元素时不会移动已有元素
+    std::deque<std::string> strs;
+    // 字符串到编号的索引，键指向 strs 中的内容
+    std::unordered_map<std::string_view, name_id_t> ids;
+
+public:
+    Interner(void);
+    ~Interner(void);
+    // 驻留字符串，返回编号
+    name_id_t intern(std::string_view _str);
+    // 按编号获取字符串
+    const std::string &get(name_id_t _id) const;
+    // 已驻留的字符串个数
+    size_t size(void) const;
+    // 清空，之前返回的编号全部失效，NAME_EMPTY 除外
+    void clear(void);
+};
+
+// 当前使用的驻留表，每个线程各自指定，默认为共享的驻留表
+extern thread_local Interner *interner;
+
+#endif /* _INTERNER_H_ */
@@ -0,0 +1,74 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// ir_interp.h for Simple-XX/SimpleCompiler.
+
+#ifndef _IR_INTERP_H_
+#define _IR_INTERP_H_
+
+#include "cstdint"
+#include "iostream"
+#include "string"
+#include "vector"
+#include "ir_tac.h"
+
+// 三地址码解释器
+// 全局变量与栈上数组放在同一块按字节寻址的内存中，指针为内存下标，
+// 0 号地址附近保留不用。寄存器为 64 位，整数运算按 32 位回绕
+// 支持 SysY 运行时库中的整数输入输出函数
+class IRInterp {
+private:
+    // 调用帧
+    struct Frame {
+        // 函数下标
+        int fun;
+        // 下一条指令
+        size_t pc;
+        // 寄存器在寄存器栈中的起始位置
+        size_t reg_base;
+        // 栈帧在内存中的起始位置
+        size_t sp;
+        // 返回值写入调用者的寄存器，-1 表示不需要返回值
+        int32_t ret_reg;
+    };
+    const IRModule &module;
+    // 输入输出
+    std::istream &in;
+    std::ostream &out;
+    // 内存
+    std::vector<uint8_t> mem;
+    // 内存上限
+    size_t mem_limit;
+    // 全局变量地址
+    std::vector<size_t> global_addr;
+    // 各函数中标号对应的指令下标
+    std::vector<std::vector<uint32_t>> labels;
+    // 已执行的指令条数
+    uint64_t steps;
+    // 指令条数上限，0 表示不限制
+    uint64_t step_limit;
+    // 运行时错误
+    std::string trap;
+
+    // 调用外部函数，返回值写入 _ret
+    bool call_extern(const IRFunction &_fun, const std::vector<int64_t> &_args,
+                     int64_t &_ret);
+    // 检查地址是否可以访问 _size 字节
+    bool check(int64_t _addr, size_t _size, size_t _top);
+
+public:
+    IRInterp(const IRModule &_module, std::istream &_in, std::ostream &_out);
+    ~IRInterp(void);
+    // 设置指令条数上限
+    void set_step_limit(uint64_t _limit);
+    // 设置内存上限，单位为字节
+    void set_mem_limit(size_t _limit);
+    // 从 main 开始执行，返回 main 返回值的低 8 位，出错时返回 -1
+    int run(void);
+    // 已执行的指令条数
+    uint64_t get_steps(void) const;
+    // 运行时错误，没有错误时为空
+    const std::string &get_trap(void) const;
+};
+
+#endif /* _IR_INTERP_H_ */
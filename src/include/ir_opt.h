@@ -0,0 +1,20 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// ir_opt.h for Simple-XX/SimpleCompiler.
+
+#ifndef _IR_OPT_H_
+#define _IR_OPT_H_
+
+#include "ir_tac.h"
+
+// 三地址码优化
+// O0 不做优化
+// O1 基本块内常量传播、复制传播与常量折叠，条件跳转折叠，
+//    删除不可达代码、多余标号与无用的定值
+// O2 在 O1 的基础上做基本块内公共子表达式消除与跳转串联
+void optimize(IRModule &_module, int _level);
+// 只优化一个函数，优化都在函数内进行，结果与优化整个模块时相同
+void optimize(IRFunction &_fun, int _level);
+
+#endif /* _IR_OPT_H_ */
@@ -1,4 +1,3 @@
-
 // This file is a part of Simple-XX/SimpleCompiler
 // (https://github.com/Simple-XX/SimpleCompiler).
 //
@@ -7,4 +6,141 @@
 #ifndef _IR_TAC_H_
 #define _IR_TAC_H_
 
+#include "cstdint"
+#include "string"
+#include "vector"
+#include "ir.h"
+
+// 三地址码
+// 每个函数使用无限多个虚拟寄存器，寄存器可以重复赋值
+// 标量局部变量直接分配寄存器，数组与全局变量通过地址访问
+// 值只有 32 位整数与指针两种，指针按字节寻址
+
+// 操作数种类
+enum ir_arg_kind_t {
+    // 无
+    ARG_NONE,
+    // 虚拟寄存器
+    ARG_REG,
+    // 立即数
+    ARG_IMM,
+    // 全局变量，值为全局变量下标
+    ARG_GLOBAL,
+    // 栈上数组，值为在栈帧中的字节偏移
+    ARG_FRAME,
+    // 标号
+    ARG_LABEL,
+    // 函数，值为函数下标
+    ARG_FUN,
+};
+
+// 操作数
+class IRArg {
+public:
+    ir_arg_kind_t kind;
+    int32_t       val;
+
+    IRArg(void) : kind(ARG_NONE), val(0) {
+    }
+    IRArg(ir_arg_kind_t _kind, int32_t _val) : kind(_kind), val(_val) {
+    }
+    bool operator==(const IRArg &_arg) const {
+        return kind == _arg.kind && val == _arg.val;
+    }
+    bool operator!=(const IRArg &_arg) const {
+        return !(*this == _arg);
+    }
+    bool is_reg(void) const {
+        return kind == ARG_REG;
+    }
+    bool is_imm(void) const {
+        return kind == ARG_IMM;
+    }
+};
+
+// 指令
+class IRInst {
+public:
+    IROperator op;
+    IRArg      result;
+    IRArg      arg1;
+    IRArg      arg2;
+
+    IRInst(IROperator _op, IRArg _result = IRArg(), IRArg _arg1 = IRArg(),
+           IRArg _arg2 = IRArg())
+        : op(_op), result(_result), arg1(_arg1), arg2(_arg2) {
+    }
+    // 是否写 result 寄存器
+    bool has_def(void) const;
+    // 是否没有副作用，结果不被使用时可以删除
+    bool is_pure(void) const;
+};
+
+// 函数
+class IRFunction {
+public:
+    // 函数名
+    std::string name;
+    // 是否为外部函数，外部函数没有代码
+    bool extern_flag;
+    // 是否无返回值
+    bool void_flag;
+    // 参数个数，参数依次保存在 0 号开始的寄存器中
+    uint32_t param_cnt;
+    // 各寄存器是否为指针
+    std::vector<bool> reg_ptr;
+    // 栈上数组的总字节数
+    uint32_t frame_size;
+    // 标号个数
+    uint32_t label_cnt;
+    // 指令
+    std::vector<IRInst> code;
+
+    IRFunction(void);
+    ~IRFunction(void);
+    // 分配一个寄存器
+    IRArg new_reg(bool _ptr = false);
+    // 分配一个标号
+    IRArg new_label(void);
+    // 寄存器个数
+    uint32_t reg_cnt(void) const;
+};
+
+// 全局变量
+class IRGlobal {
+public:
+    // 变量名
+    std::string name;
+    // 字节数
+    uint32_t size;
+    // 是否为常量
+    bool const_flag;
+    // 初始值，不足的部分为 0
+    std::vector<int32_t> init;
+};
+
+// 编译单元
+class IRModule {
+public:
+    std::vector<IRGlobal>   globals;
+    std::vector<IRFunction> funs;
+
+    IRModule(void);
+    ~IRModule(void);
+    // 按名字查找函数，不存在时返回 -1
+    int find_fun(const std::string &_name) const;
+    // 按名字查找全局变量，不存在时返回 -1
+    int find_global(const std::string &_name) const;
+    // 将一个函数序列化，_externs 为其中调用的外部函数，按第一次调用的顺序排列
+    // 全局变量与函数按名字引用，读回时不依赖它们在模块中的下标
+    std::string save_fun(size_t _idx, const std::vector<int> &_externs) const;
+    // 读回 save_fun 的结果，加到模块末尾，之后登记模块中还没有的外部函数
+    // 引用的全局变量与函数必须已在模块中，失败时返回 false 且不改变模块
+    bool load_fun(const std::string &_data);
+    // 指令条数
+    size_t inst_cnt(void) const;
+    // 输出三地址码
+    std::string to_string(void) const;
+};
+
 #endif /* _IR_TAC_H_ */
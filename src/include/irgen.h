@@ -1,4 +1,3 @@
-
 // This file is a part of Simple-XX/SimpleCompiler
 // (https://github.com/Simple-XX/SimpleCompiler).
 //
@@ -7,4 +6,95 @@
 #ifndef _IRGEN_H_
 #define _IRGEN_H_
 
+#include "utility"
+#include "vector"
+#include "ast.h"
+#include "ir_tac.h"
+#include "resolver.h"
+#include "symbol.h"
+#include "symtab.h"
+
+using namespace std;
+
+// 中间代码生成
+// 遍历已经过语义分析的 AST，按结点中保存的符号下标生成三地址码
+// 常量标量直接替换为立即数，逻辑与、或按短路求值生成跳转
+// 由 ASTWalker 用显式的栈遍历，子表达式的值在 step() 之间经 value 传递
+class IRGen : public ASTWalker {
+private:
+    // 以 WALK_COND 访问的表达式生成条件跳转，目标在 conds 栈顶
+    static const uint32_t WALK_COND = 1;
+    // 以 WALK_ADDRESS 访问的 LValAST 在 value 中给出地址
+    static const uint32_t WALK_ADDRESS = 2;
+    // 符号表
+    SymTab &symtab;
+    // 类型表
+    TypeTab &types;
+    // 输出
+    IRModule &module;
+    // 当前函数
+    IRFunction *fun;
+    // 变量的存储位置，按变量池下标索引
+    vector<IRArg> storage;
+    // 函数池下标到模块中函数下标
+    vector<int> fun_index;
+    // 当前单元调用的外部函数在模块中的下标，按第一次调用的顺序排列
+    vector<int> unit_externs;
+    // 最近生成的表达式的值
+    IRArg value;
+    // 循环的 continue 与 break 目标
+    vector<pair<IRArg, IRArg>> loops;
+    // 条件为真、为假时的跳转目标
+    vector<pair<IRArg, IRArg>> conds;
+    // 各结点在访问子结点期间保存的寄存器与标号
+    vector<IRArg> vals;
+    // 当前变量定义展开后的初始值
+    vector<pair<uint32_t, MetaAST *>> inits;
+    // 当前函数中各表达式是否为常量
+    const_memo_t memo;
+
+    // 变量的存储位置
+    IRArg &storage_of(pool_id_t _sym);
+    // 生成表达式，之后的一步从 value 取得其值
+    void expr(MetaAST &_exp);
+    // 生成条件跳转，为真时跳到 _true，为假时跳到 _false
+    void cond(MetaAST &_exp, IRArg _true, IRArg _false);
+    // 以 WALK_COND 访问的非逻辑运算，求值后按值跳转
+    void branch(MetaAST &_exp);
+    // 函数在模块中的下标，外部函数在第一次调用时登记
+    int fun_of(pool_id_t _sym);
+    // 生成一条指令
+    void emit(IROperator _op, IRArg _result = IRArg(), IRArg _arg1 = IRArg(),
+              IRArg _arg2 = IRArg());
+
+public:
+    IRGen(SymTab &_symtab, IRModule &_module);
+    ~IRGen(void);
+    // 生成中间代码，AST 必须已经过语义分析且没有错误
+    void generate(MetaAST &_prog);
+    // 生成一个顶层单元，返回其中调用的外部函数在模块中的下标
+    const vector<int> &generate_unit(MetaAST &_unit);
+    // 以 IRModule::save_fun 保存的结果代替生成函数，失败时返回 false 且不改变模块
+    bool reuse(FuncDefAST &_ast, const string &_data);
+
+    void visit(CompUnitAST &ast) override;
+    void visit(StmtAST &ast) override;
+    void visit(FuncDefAST &ast) override;
+    void visit(FuncCallAST &ast) override;
+    void visit(VarDeclAST &ast) override;
+    void visit(VarDefAST &ast) override;
+    void visit(IdAST &ast) override;
+    void visit(InitValAST &ast) override;
+    void visit(BlockAST &ast) override;
+    void visit(BinaryAST &ast) override;
+    void visit(UnaryAST &ast) override;
+    void visit(NumAST &ast) override;
+    void visit(IfAST &ast) override;
+    void visit(WhileAST &ast) override;
+    void visit(ControlAST &ast) override;
+    void visit(AssignAST &ast) override;
+    void visit(LValAST &ast) override;
+    void visit(EmptyAST &ast) override;
+};
+
 #endif /* _IRGEN_H_ */
@@ -13,7 +13,7 @@
 
 using namespace std;
 
-extern Error *error;
+extern thread_local Error *error;
 
 // TODO: 宏替换为函数/constexpr
 #define TAG_KW                                                                 \
@@ -97,6 +97,7 @@ public:
     Lexer(Scanner &sc);
     ~Lexer(void);
 
+    // 返回下一个 token，由调用者释放
     Token *lexing(void);
     bool   is_done(void) const;
 };
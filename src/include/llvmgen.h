@@ -0,0 +1,125 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// llvmgen.h for Simple-XX/SimpleCompiler.
+
+#ifndef _LLVMGEN_H_
+#define _LLVMGEN_H_
+
+#include "sstream"
+#include "string"
+#include "utility"
+#include "vector"
+#include "ast.h"
+#include "resolver.h"
+#include "symbol.h"
+#include "symtab.h"
+
+using namespace std;
+
+// LLVM IR 生成
+// 遍历已经过语义分析的 AST，输出文本形式的 LLVM IR，指针带有指向的类型
+// 局部变量放在入口块的 alloca 中，由 LLVM 的 mem2reg 提升为 SSA 值，
+// 临时值本身即为 SSA，短路求值的结果用 phi 合并
+// 数组保留各维的类型，元素地址由 getelementptr 计算，
+// 数组参数与 C 一样是指向第二维的指针
+// 由 ASTWalker 用显式的栈遍历，子表达式的值在 step() 之间经 value 传递
+class LLVMGen : public ASTWalker {
+private:
+    // 以 WALK_COND 访问的表达式生成条件跳转，目标在 conds 栈顶
+    static const uint32_t WALK_COND = 1;
+    // 以 WALK_ADDRESS 访问的 LValAST 在 value 中给出地址
+    static const uint32_t WALK_ADDRESS = 2;
+    // 符号表
+    SymTab &symtab;
+    // 类型表
+    TypeTab &types;
+    // 全局变量、函数定义与外部函数声明
+    ostringstream globals;
+    ostringstream funs;
+    ostringstream decls;
+    // 当前函数的 alloca 与函数体
+    ostringstream allocas;
+    ostringstream body;
+    // 是否在函数中
+    bool in_fun;
+    // 当前函数是否返回 void
+    bool void_fun;
+    // 当前基本块是否已经以跳转或返回结束
+    bool terminated;
+    // 临时值与基本块的编号
+    uint32_t tmp_cnt;
+    uint32_t label_cnt;
+    // 变量的存储位置，按变量池下标索引
+    vector<string> storage;
+    // 已声明的外部函数，按函数池下标索引
+    vector<bool> declared;
+    // 是否用到了 llvm.memset
+    bool need_memset;
+    // 最近生成的表达式的值，i32 或指针
+    string value;
+    // 循环的 continue 与 break 目标
+    vector<pair<string, string>> loops;
+    // 条件为真、为假时的跳转目标
+    vector<pair<string, string>> conds;
+    // 各结点在访问子结点期间保存的值、标号与拼接中的指令
+    vector<string> strs;
+    // 当前变量定义展开后的初始值
+    vector<pair<uint32_t, MetaAST *>> inits;
+    // 当前函数中各表达式是否为常量
+    const_memo_t memo;
+
+    string &storage_of(pool_id_t _sym);
+    string new_tmp(void);
+    string new_label(void);
+    // 输出一条指令，当前基本块已结束时先开始一个不可达的基本块
+    void inst(const string &_inst);
+    // 输出终结指令
+    void terminate(const string &_inst);
+    // 开始新的基本块，上一个基本块没有结束时跳转过来
+    void label(const string &_label);
+    // 数组从第 _level 维开始的类型，超出维数时为 i32
+    string type_of(const TypeInfo &_type, size_t _level);
+    // 参数的类型，数组参数为指向第二维的指针
+    string param_type(Variable *_param);
+    // 数组常量，_vals 为展开后的初值
+    string const_array(const TypeInfo &_type, size_t _level, uint32_t _pos,
+                       const vector<int> &_vals);
+    // 生成表达式，之后的一步从 value 取得其值
+    void expr(MetaAST &_exp);
+    // 生成条件跳转，为真时跳到 _true，为假时跳到 _false
+    void cond(MetaAST &_exp, const string &_true, const string &_false);
+    // 以 WALK_COND 访问的表达式为常量时直接跳转，返回是否已跳转
+    bool const_branch(MetaAST &_exp);
+    // 以 WALK_COND 访问的非逻辑、非关系运算，求值后与 0 比较并跳转
+    void branch(MetaAST &_exp);
+    // 关系运算的比较结果 _cmp 用于跳转或扩展为 i32
+    void compared(const string &_cmp);
+
+public:
+    LLVMGen(SymTab &_symtab);
+    ~LLVMGen(void);
+    // 生成 LLVM IR，AST 必须已经过语义分析且没有错误
+    string generate(MetaAST &_prog);
+
+    void visit(CompUnitAST &ast) override;
+    void visit(StmtAST &ast) override;
+    void visit(FuncDefAST &ast) override;
+    void visit(FuncCallAST &ast) override;
+    void visit(VarDeclAST &ast) override;
+    void visit(VarDefAST &ast) override;
+    void visit(IdAST &ast) override;
+    void visit(InitValAST &ast) override;
+    void visit(BlockAST &ast) override;
+    void visit(BinaryAST &ast) override;
+    void visit(UnaryAST &ast) override;
+    void visit(NumAST &ast) override;
+    void visit(IfAST &ast) override;
+    void visit(WhileAST &ast) override;
+    void visit(ControlAST &ast) override;
+    void visit(AssignAST &ast) override;
+    void visit(LValAST &ast) override;
+    void visit(EmptyAST &ast) override;
+};
+
+#endif /* _LLVMGEN_H_ */
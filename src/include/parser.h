@@ -9,17 +9,16 @@
 
 #include "string"
 #include "iostream"
-#include <functional>
-#include <initializer_list>
 #include <vector> 
 #include "token.h"
 #include "lexical.h"
 #include "ast.h"
 #include "error.h"
+#include "sha256.h"
 
 using namespace std;
 
-extern Error *error;
+extern thread_local Error *error;
 
 // 语法分析
 class Parser {
@@ -28,31 +27,37 @@ private:
     Lexer &lexer;
     // 超前查看的 token
     Token *token;
+    // 是否出现了语法错误
+    bool failed;
+    // 是否计算顶层单元的摘要，只在使用缓存时需要
+    bool digest;
+    // 当前顶层单元已读入 token 的摘要
+    SHA256 unit_digest;
+    // 每个顶层单元的 token 摘要，用于增量编译
+    vector<string> unit_digests;
     // 获取下一个 token
     void next(void);
     // 匹配指定 Token
     bool match_token(Tag tag);
+    // 报告语法错误并停止解析
+    ASTPtr fail(int err_no);
 
     // 程序
     ASTPtr program(void);
-    // 语句
-    ASTPtr statement(void);
+    // 语句，嵌套的块、if 与 while 用显式的栈处理
+    ASTPtr statements(bool body);
+    // 不含嵌套的语句
+    ASTPtr simple_statement(void);
+    // if 与 while 的条件
+    ASTPtr condition(void);
 
-    // 一元表达式
-    ASTPtr unary(void);
-    // 二元表达式
-    ASTPtr binary(const function<ASTPtr()> &parser, std::initializer_list<Operator> ops);
+    // 表达式，只接受优先级不低于 lowest 的二元运算符
+    ASTPtr expression(int lowest);
+    // 算术表达式
     ASTPtr binary_add(void);
-    ASTPtr binary_mul(void);
-    ASTPtr binary_relation(void);
-    ASTPtr binary_eq(void);
-    ASTPtr binary_and(void);
+    // 条件表达式
     ASTPtr binary_or(void);
 
-    // If then else
-    ASTPtr if_else(void);
-    // while loop
-    ASTPtr while_loop(void);
     // block
     ASTPtr block(void);
 
@@ -67,11 +72,25 @@ private:
     ASTPtr function_def(void);
 
 public:
-    Parser(Lexer &lex);
+    // 二元运算符的优先级
+    enum {
+        PREC_OR = 1,
+        PREC_AND,
+        PREC_EQ,
+        PREC_REL,
+        PREC_ADD,
+        PREC_MUL,
+    };
+
+    // _digest 为 true 时计算每个顶层单元的 token 摘要
+    Parser(Lexer &lex, bool _digest = false);
     ~Parser(void);
-    // 进行解析
+    // 进行解析，有语法错误时返回空指针
     ASTPtr parsing(void);
     bool is_done(void) const;
+    // 获取每个顶层单元的 token 摘要，与 CompUnitAST 中的单元一一对应
+    // 未要求计算摘要时为空
+    const vector<string> &get_unit_digests(void) const;
 };
 
 #endif /* _PARSER_H_ */
@@ -0,0 +1,73 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// pool.h for Simple-XX/SimpleCompiler.
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include "cstddef"
+#include "cstdint"
+#include "new"
+#include "utility"
+#include "vector"
+
+typedef uint32_t pool_id_t;
+// 无效下标
+static const pool_id_t POOL_NONE = UINT32_MAX;
+
+// 对象池
+// 按块分配，元素地址在整个生命周期内不变，可以用下标或指针访问
+template <class T, size_t CHUNK = 256>
+class Pool {
+private:
+    // 块列表
+    std::vector<T *> chunks;
+    // 已分配的元素个数
+    size_t count;
+
+public:
+    Pool(void) : count(0) {
+        return;
+    }
+    Pool(const Pool &) = delete;
+    Pool &operator=(const Pool &) = delete;
+    ~Pool(void) {
+        clear();
+        return;
+    }
+    // 在池中构造一个元素，返回其指针
+    template <class... Args>
+    T *alloc(Args &&...args) {
+        if (count % CHUNK == 0) {
+            chunks.push_back(
+                static_cast<T *>(::operator new(sizeof(T) * CHUNK)));
+        }
+        T *p = chunks.back() + count % CHUNK;
+        new (p) T(std::forward<Args>(args)...);
+        count++;
+        return p;
+    }
+    // 按下标访问
+    T *get(pool_id_t id) const {
+        return chunks[id / CHUNK] + id % CHUNK;
+    }
+    // 元素个数
+    size_t size(void) const {
+        return count;
+    }
+    // 析构全部元素并释放内存
+    void clear(void) {
+        for (size_t i = 0; i < count; i++) {
+            get(i)->~T();
+        }
+        for (auto chunk : chunks) {
+            ::operator delete(chunk);
+        }
+        chunks.clear();
+        count = 0;
+        return;
+    }
+};
+
+#endif /* _POOL_H_ */
@@ -0,0 +1,111 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// resolver.h for Simple-XX/SimpleCompiler.
+
+#ifndef _RESOLVER_H_
+#define _RESOLVER_H_
+
+#include "memory"
+#include "set"
+#include "string"
+#include "unordered_map"
+#include "utility"
+#include "vector"
+#include "ast.h"
+#include "error.h"
+#include "symbol.h"
+#include "symtab.h"
+
+using namespace std;
+
+extern thread_local Error *error;
+
+// 常量表达式的求值结果，按结点记录，first 为是否是常量，second 为值
+typedef unordered_map<const MetaAST *, pair<bool, int>> const_memo_t;
+
+// 计算常量表达式，不是常量时返回 false
+// 常量标量按符号表中的值替换，除数为 0 与溢出的除法不折叠
+// 给出 _memo 时记录每个子表达式的结果，逐层对嵌套的表达式求值时每个结点只计算一次
+bool eval_const(SymTab &_symtab, MetaAST *_exp, int &_val,
+                const_memo_t *_memo = nullptr);
+// 将初始化列表展开为 (下标, 表达式)，下标按元素个数计
+// 超出数组范围的初始值被丢弃，此时返回 false
+bool flatten_init(InitValAST &_init, const TypeInfo &_type, size_t _level,
+                  uint32_t &_pos, vector<pair<uint32_t, MetaAST *>> &_out);
+
+// 语义分析
+// 遍历 AST，将声明登记到符号表，并把每个 LValAST/FuncCallAST
+// 解析为符号下标保存在结点中，之后的各遍不再需要按名字查找
+class Resolver : public ASTWalker {
+private:
+    // 以 WALK_PARAM 访问的 IdAST 为形参
+    static const uint32_t WALK_PARAM = 1;
+    // FuncCallAST 在 local() 中记录的实参状态
+    static const uint32_t ARGS_MATCH = 1;
+    static const uint32_t ARGS_BAD   = 2;
+    // 符号表
+    SymTab &symtab;
+    // 类型表
+    TypeTab &types;
+    // 最近分析的表达式的类型
+    type_id_t curr_type;
+    // 错误个数
+    int err_cnt;
+    // 当前所在函数
+    Function *curr_fun;
+    // 循环嵌套深度，用于检查 break/continue
+    int loop_depth;
+    // 当前函数已登记的形参
+    paralist_t paralist;
+    // 当前函数的计时
+    unique_ptr<Phase> fun_phase;
+    // 当前顶层单元引用的全局符号的签名
+    set<string> refs;
+    // 每个顶层单元引用的全局符号的签名
+    vector<string> unit_refs;
+    // 报告语义错误，给出 at 所在的行列
+    void err(const MetaAST &at, const string &msg);
+    // 声明运行时库函数
+    void add_runtime(void);
+    // 声明一个变量，返回其在变量池中的下标
+    pool_id_t declare(IdAST &id, bool is_param);
+    // 要求刚分析完的表达式为标量
+    void check_scalar(MetaAST &exp);
+    // 检查变量的初始值，形状不对时返回 false
+    bool check_init(VarDefAST &ast);
+    // 记录对函数的引用
+    void reference(Function *fun);
+    // 记录对全局变量的引用
+    void reference(Variable *var);
+
+public:
+    Resolver(SymTab &st);
+    ~Resolver(void);
+    // 进行语义分析，返回错误个数
+    int resolving(MetaAST &prog);
+    // 获取每个顶层单元引用的全局符号的签名，与 CompUnitAST 中的单元一一对应
+    // 签名不变时单元的分析结果不变，用于增量编译
+    const vector<string> &get_unit_refs(void) const;
+
+    void visit(CompUnitAST &ast) override;
+    void visit(StmtAST &ast) override;
+    void visit(FuncDefAST &ast) override;
+    void visit(FuncCallAST &ast) override;
+    void visit(VarDeclAST &ast) override;
+    void visit(VarDefAST &ast) override;
+    void visit(IdAST &ast) override;
+    void visit(InitValAST &ast) override;
+    void visit(BlockAST &ast) override;
+    void visit(BinaryAST &ast) override;
+    void visit(UnaryAST &ast) override;
+    void visit(NumAST &ast) override;
+    void visit(IfAST &ast) override;
+    void visit(WhileAST &ast) override;
+    void visit(ControlAST &ast) override;
+    void visit(AssignAST &ast) override;
+    void visit(LValAST &ast) override;
+    void visit(EmptyAST &ast) override;
+};
+
+#endif /* _RESOLVER_H_ */
@@ -0,0 +1,148 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// riscv.h for Simple-XX/SimpleCompiler.
+
+#ifndef _RISCV_H_
+#define _RISCV_H_
+
+#include "cstdint"
+#include "string"
+#include "vector"
+#include "ir_tac.h"
+#include "simrt.h"
+
+// RV64IM 后端
+// 三地址码先翻译为 RVInst 序列，再输出为 GNU 汇编，或编码链接为供模拟器运行的映像
+// 使用次数最多的虚拟寄存器分配到 s1-s11，其余放在栈帧中
+// 整数在 64 位寄存器中保持符号扩展，按 LP64 调用约定传参与返回
+
+// 指令，RV_LI 之后为伪指令，汇编与编码时展开
+enum rv_op_t {
+    RV_ADD,
+    RV_SUB,
+    RV_SLT,
+    RV_SLTU,
+    RV_XOR,
+    RV_OR,
+    RV_AND,
+    RV_ADDW,
+    RV_SUBW,
+    RV_MULW,
+    RV_DIVW,
+    RV_REMW,
+    RV_ADDI,
+    RV_ADDIW,
+    RV_SLTI,
+    RV_SLTIU,
+    RV_XORI,
+    RV_ANDI,
+    RV_LW,
+    RV_LD,
+    RV_JALR,
+    RV_SW,
+    RV_SD,
+    RV_BEQ,
+    RV_BNE,
+    RV_BLT,
+    RV_BGE,
+    RV_BLTU,
+    RV_BGEU,
+    RV_LUI,
+    RV_AUIPC,
+    RV_JAL,
+    RV_ECALL,
+    // rd = imm
+    RV_LI,
+    // rd = &sym
+    RV_LA,
+    // 调用 sym
+    RV_CALL,
+    // 跳转到标号
+    RV_J,
+    // 标号
+    RV_LABEL,
+};
+
+// 寄存器编号
+enum rv_reg_t {
+    RV_ZERO = 0,
+    RV_RA   = 1,
+    RV_SP   = 2,
+    RV_T0   = 5,
+    RV_T1   = 6,
+    RV_T2   = 7,
+    RV_S0   = 8,
+    RV_S1   = 9,
+    RV_A0   = 10,
+    RV_A7   = 17,
+    RV_S2   = 18,
+    RV_S11  = 27,
+    RV_T6   = 31,
+};
+
+// 指令
+// 分支与 RV_J 的目标、RV_LABEL 的编号都在 label 中
+class RVInst {
+public:
+    rv_op_t     op;
+    int         rd;
+    int         rs1;
+    int         rs2;
+    int64_t     imm;
+    int32_t     label;
+    std::string sym;
+
+    RVInst(rv_op_t _op, int _rd = 0, int _rs1 = 0, int _rs2 = 0,
+           int64_t _imm = 0)
+        : op(_op), rd(_rd), rs1(_rs1), rs2(_rs2), imm(_imm), label(-1) {
+    }
+};
+
+// 函数
+class RVFunction {
+public:
+    std::string         name;
+    std::vector<RVInst> code;
+    // 标号个数
+    int32_t label_cnt;
+};
+
+// 程序
+class RVProgram {
+public:
+    std::vector<RVFunction> funs;
+    std::vector<IRGlobal>   globals;
+    // 外部函数
+    std::vector<std::string> externs;
+};
+
+// 链接后的程序映像，从 base 开始依次为代码与全局变量
+class RVImage {
+public:
+    // 起始地址，之下的地址不可访问
+    uint64_t             base;
+    std::vector<uint8_t> mem;
+    // 入口，调用 main 后以其返回值退出
+    uint64_t entry;
+    // 代码结束的位置
+    uint64_t text_end;
+};
+
+// 将三地址码翻译为 RV64IM 指令
+void riscv_lower(const IRModule &_module, RVProgram &_prog);
+// 只翻译一个函数，各函数的翻译互不影响
+void riscv_lower_function(const IRModule &_module, const IRFunction &_fun,
+                          RVFunction &_out);
+// 输出一个函数的汇编
+std::string riscv_asm_function(const RVFunction &_fun);
+// 输出 GNU 汇编
+std::string riscv_asm(const RVProgram &_prog);
+// 以各函数已输出的汇编代替 _prog.funs 输出 GNU 汇编
+std::string riscv_asm(const RVProgram &_prog,
+                      const std::vector<std::string> &_funs);
+// 编码并链接，外部函数只能为运行时函数，失败时返回 false 并给出原因
+// 运行时函数的桩以 a7 为调用号执行 ecall
+bool riscv_link(const RVProgram &_prog, RVImage &_image, std::string &_err);
+
+#endif /* _RISCV_H_ */
@@ -0,0 +1,61 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// rvsim.h for Simple-XX/SimpleCompiler.
+
+#ifndef _RVSIM_H_
+#define _RVSIM_H_
+
+#include "cstdint"
+#include "iostream"
+#include "string"
+#include "vector"
+#include "riscv.h"
+
+// RV64IM 指令集模拟器
+// 逐条取指、译码并执行 riscv_link 得到的映像，栈放在映像之后
+// ecall 以 a7 为调用号，退出或调用 simrt.h 中的运行时函数
+// 统计退出前执行完的指令条数，用于比较各优化级别生成的代码
+class RVSim {
+private:
+    // 映像与栈
+    std::vector<uint8_t> mem;
+    // mem[0] 的地址
+    uint64_t base;
+    // 入口
+    uint64_t entry;
+    // 代码结束的位置，之前的内存不可写
+    uint64_t text_end;
+    // 栈的字节数
+    size_t stack_size;
+    // 输入输出
+    std::istream &in;
+    std::ostream &out;
+    // 通用寄存器
+    uint64_t x[32];
+    // 已执行的指令条数
+    uint64_t steps;
+    // 指令条数上限，0 表示不限制
+    uint64_t step_limit;
+    // 运行时错误
+    std::string trap;
+
+    // 检查 [_addr, _addr + _size) 是否可以访问
+    bool check(uint64_t _addr, size_t _size, bool _write);
+
+public:
+    RVSim(const RVImage &_image, std::istream &_in, std::ostream &_out);
+    ~RVSim(void);
+    // 设置指令条数上限
+    void set_step_limit(uint64_t _limit);
+    // 设置栈的字节数
+    void set_stack_size(size_t _size);
+    // 从入口开始执行，返回退出码的低 8 位，出错时返回 -1
+    int run(void);
+    // 已执行的指令条数
+    uint64_t get_steps(void) const;
+    // 运行时错误，没有错误时为空
+    const std::string &get_trap(void) const;
+};
+
+#endif /* _RVSIM_H_ */
@@ -7,19 +7,28 @@
 #ifndef _SCANNER_H_
 #define _SCANNER_H_
 
+#include "cstddef"
 #include "string"
 #include "fstream"
 #include "error.h"
 
 using namespace std;
 
-extern Error *error;
+extern thread_local Error *error;
 
 // 扫描器
 class Scanner {
 private:
     // 输入流
     ifstream fin;
+    // 内存中的输入，从文件读取时为 NULL
+    const char *mem;
+    // 内存输入的长度
+    size_t mem_size;
+    // 内存输入的读取位置
+    size_t mem_pos;
+    // 输入是否结束
+    bool done;
     // 前一个读到的字符
     char prev_char;
     // 当前读到的字符
@@ -36,6 +45,8 @@ private:
 public:
     // 读一个文件
     Scanner(const std::string &filename);
+    // 读一段内存，不复制数据，扫描期间 data 必须有效
+    Scanner(const char *data, size_t size);
     ~Scanner(void);
     // 扫描并返回字符
     char scan(void);
@@ -43,6 +54,8 @@ public:
     char get_prev_char(void);
     // 文件是否结束
     bool is_done(void);
+    // 输入是否可读，文件打开失败时为 false
+    bool is_open(void);
 };
 
 #endif /* _SCANNER_H_ */
@@ -0,0 +1,47 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// server.h for Simple-XX/SimpleCompiler.
+
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include "cstdint"
+#include "string"
+#include "vector"
+
+using namespace std;
+
+// 编译服务
+// 服务进程常驻并监听 Unix 套接字，每个请求携带客户端的工作目录与命令行参数。
+// 编译在常驻的工作进程中进行，工作进程持有 CompilerContext，
+// 工作线程、驻留表与编译缓存在请求之间复用。
+// 工作进程由服务进程启动并看护，崩溃后重新启动，进行中的请求由客户端在本地重新编译。
+// 应答为编译过程的输出，末尾附加 '\0' 与 4 字节的退出码；
+// 退出码为 -1 表示服务不处理该请求，如从标准输入读入或含有服务不支持的选项，由客户端在本地编译。
+
+// 启动编译服务，不返回
+int serve(const string &path);
+// 将命令行参数转发给编译服务，返回编译的退出码
+// 连接失败、服务不处理或应答不完整时返回 -1，由调用者在本进程内编译
+// 只依赖 client.cpp，瘦客户端不链接编译器的其余部分
+int request(const string &path, const vector<string> &argv);
+// 去掉命令行中的 --client 选项，socket 返回其值
+vector<string> strip_client(const vector<string> &argv, string &socket);
+
+// 请求中参数个数的上限
+static const uint32_t MAX_ARGS = 4096;
+// 单个参数长度的上限
+static const uint32_t MAX_ARG_LEN = 1 << 16;
+
+// 写出全部数据
+bool write_all(int fd, const void *buf, size_t len);
+// 读取指定长度的数据
+bool read_all(int fd, void *buf, size_t len);
+// 字符串以 4 字节长度开头
+bool write_str(int fd, const string &s);
+bool read_str(int fd, string &s);
+// 打开一个 Unix 套接字，listen 为 true 时绑定并监听，否则连接，失败时返回 -1
+int open_socket(const string &path, bool listen);
+
+#endif /* _SERVER_H_ */
@@ -0,0 +1,36 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// sha256.h for Simple-XX/SimpleCompiler.
+
+#ifndef _SHA256_H_
+#define _SHA256_H_
+
+#include "cstdint"
+#include "string"
+#include "string_view"
+
+// SHA-256 摘要
+class SHA256 {
+private:
+    // 中间状态
+    uint32_t state[8];
+    // 未处理的数据
+    uint8_t buf[64];
+    // 缓冲区中的字节数
+    size_t buf_len;
+    // 已处理的总字节数
+    uint64_t total;
+    // 处理一个 64 字节的块
+    void block(const uint8_t *data);
+
+public:
+    SHA256(void);
+    ~SHA256(void);
+    // 追加数据
+    SHA256 &update(std::string_view data);
+    // 结束计算，返回十六进制摘要
+    std::string hex_digest(void);
+};
+
+#endif /* _SHA256_H_ */
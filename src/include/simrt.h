@@ -0,0 +1,47 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// simrt.h for Simple-XX/SimpleCompiler.
+
+#ifndef _SIMRT_H_
+#define _SIMRT_H_
+
+#include "cstdint"
+#include "iostream"
+#include "string"
+#include "vector"
+
+// 指令集模拟器共用的 SysY 运行时库
+// 后端为每个运行时函数生成一段桩代码，以系统调用交给模拟器执行，
+// 调用号为 SIM_CALL_RUNTIME 加函数编号，SIM_CALL_EXIT 以第一个参数为退出码
+
+// 运行时函数编号
+enum sim_runtime_t {
+    RT_GETINT,
+    RT_GETCH,
+    RT_GETARRAY,
+    RT_PUTINT,
+    RT_PUTCH,
+    RT_PUTARRAY,
+    RT_STARTTIME,
+    RT_STOPTIME,
+    RT_CNT,
+};
+
+// 系统调用号
+enum sim_call_t {
+    SIM_CALL_EXIT    = 93,
+    SIM_CALL_RUNTIME = 1000,
+};
+
+// 运行时函数的编号，不是运行时函数时返回 -1
+int sim_runtime_index(const std::string &_name);
+
+// 执行编号为 _idx 的运行时函数，_mem 为从地址 _base 开始的内存
+// 出错时返回 false 并给出原因
+bool sim_runtime_call(int64_t _idx, const int64_t _args[2], int64_t &_ret,
+                      std::vector<uint8_t> &_mem, uint64_t _base,
+                      std::istream &_in, std::ostream &_out,
+                      std::string &_trap);
+
+#endif /* _SIMRT_H_ */
@@ -0,0 +1,139 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// snapshot.h for Simple-XX/SimpleCompiler.
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include "cstdint"
+#include "string"
+#include "string_view"
+#include "vector"
+#include "ast.h"
+
+using namespace std;
+
+// AST 快照
+// 文件由文件头、定长结点数组、子结点下标数组与字符串表组成，
+// 各部分以相对文件开头的偏移定位，映射到内存后即可直接访问，不需要反序列化。
+// 结点按先序排列，子结点的下标总是大于父结点，保证没有环；
+// 每个结点只有一个父结点，快照不能共享子树。
+
+// 版本号，格式变化时递增
+static const uint32_t SNAPSHOT_VERSION = 1;
+// 空结点
+static const uint32_t SNAPSHOT_NONE = UINT32_MAX;
+
+// 结点类型
+enum snap_kind_t : uint8_t {
+    SNAP_COMP_UNIT,
+    SNAP_STMT,
+    SNAP_FUNC_DEF,
+    SNAP_FUNC_CALL,
+    SNAP_VAR_DECL,
+    SNAP_VAR_DEF,
+    SNAP_ID,
+    SNAP_INIT_VAL,
+    SNAP_BLOCK,
+    SNAP_BINARY,
+    SNAP_UNARY,
+    SNAP_NUM,
+    SNAP_IF,
+    SNAP_WHILE,
+    SNAP_CONTROL,
+    SNAP_ASSIGN,
+    SNAP_LVAL,
+    SNAP_EMPTY,
+    SNAP_KIND_CNT
+};
+
+// 文件头
+struct snap_header_t {
+    // "SCAST" 与结尾的 0
+    char magic[8];
+    // 字节序标记，写入 0x01020304
+    uint32_t endian;
+    uint32_t version;
+    // 根结点
+    uint32_t root;
+    // 结点数组
+    uint32_t node_off;
+    uint32_t node_cnt;
+    // 子结点下标数组
+    uint32_t kid_off;
+    uint32_t kid_cnt;
+    // 字符串表，每个字符串以 0 结尾
+    uint32_t str_off;
+    uint32_t str_size;
+    uint32_t reserved;
+};
+
+// 结点
+struct snap_node_t {
+    snap_kind_t kind;
+    // BinaryAST/UnaryAST 的运算符，ControlAST 的类型
+    uint8_t op;
+    // FuncDefAST 的 Type，IdAST/InitValAST/LValAST 的 VarType
+    uint8_t type;
+    // 第 0 位为 isConst
+    uint8_t flags;
+    // NumAST 的值
+    int32_t val;
+    // 名字在字符串表中的偏移
+    uint32_t name;
+    // 子结点在下标数组中的起始位置与个数，可选的子结点记为 SNAPSHOT_NONE
+    uint32_t kids;
+    uint32_t kid_cnt;
+    // FuncDefAST 中参数的个数，其后为函数体
+    uint32_t split;
+};
+
+// 将 AST 写为快照
+string snapshot_write(MetaAST &root);
+
+// 只读的快照
+class Snapshot {
+private:
+    // 快照数据
+    const char *data;
+    size_t      size;
+    // 映射的长度，非 0 时析构时解除映射
+    size_t mapped;
+    // 文件头
+    const snap_header_t *header;
+    // 重建结点 idx，子结点已重建在 built 中，从中取出
+    ASTPtr build(uint32_t idx, vector<ASTPtr> &built) const;
+    // 取出一组已重建的子结点
+    ASTPtrList build_list(const uint32_t *kids, uint32_t cnt,
+                          vector<ASTPtr> &built) const;
+    // 检查格式
+    bool validate(void);
+    // 检查单个结点
+    bool validate_node(const snap_node_t &n) const;
+
+public:
+    Snapshot(void);
+    ~Snapshot(void);
+    // 映射快照文件
+    bool open(const string &path);
+    // 使用内存中的快照，调用者保证 buf 在使用期间有效
+    bool load(string_view buf);
+    // 结点个数
+    uint32_t node_cnt(void) const;
+    // 根结点
+    uint32_t root(void) const;
+    // 访问结点
+    const snap_node_t &node(uint32_t idx) const;
+    // 访问子结点下标
+    const uint32_t *kids(const snap_node_t &n) const;
+    // 访问名字
+    string_view name(const snap_node_t &n) const;
+    // 重建 AST
+    ASTPtr build(void) const;
+};
+
+// 是否为快照文件
+bool is_snapshot(const string &path);
+
+#endif /* _SNAPSHOT_H_ */
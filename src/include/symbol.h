@@ -1,4 +1,3 @@
-
 // This file is a part of Simple-XX/SimpleCompiler
 // (https://github.com/Simple-XX/SimpleCompiler).
 //
@@ -7,58 +6,67 @@
 #ifndef _SYMBOL_H_
 #define _SYMBOL_H_
 
+#include "cstdint"
 #include "string"
 #include "vector"
 #include "common.h"
 #include "token.h"
+#include "interner.h"
+#include "pool.h"
+#include "typetab.h"
 
 // 作用域
 #define Scope_Global 0
 
 typedef std::vector<int> scope_t;
+typedef uint32_t         scope_id_t;
 typedef Tag              type_t;
-typedef void *           data_t;
+typedef int32_t          data_t;
 typedef std::string      name_t;
 
 // 符号定义
 // 变量
+// 标志位使用位域，名字与字符串常量保存在驻留表中，记录本身不持有堆内存
 class Variable {
 private:
     // 是否为外部变量
-    bool extern_flag;
+    bool extern_flag : 1;
     // 是否为常量
-    bool const_flag;
+    bool const_flag : 1;
     // 是否能作为左值
-    bool lv_flag;
+    bool lv_flag : 1;
     // 是否为字面量
-    bool literal_flag;
+    bool literal_flag : 1;
     // 是否初始化
-    bool init_flag;
-    // 初始化数据
-    Variable *init_data;
+    bool init_flag : 1;
     // 是否为数组
-    bool array_flag;
-    // 数组长度
-    size_t array_size;
+    bool array_flag : 1;
     // 是否为指针
-    bool ptr_flag;
-    // 作用域
-    scope_t scope;
+    bool ptr_flag : 1;
+    // 是否活跃
+    bool live_flag : 1;
     // 变量类型
-    type_t type;
+    type_t type : 8;
+    // 作用域编号
+    scope_id_t scope;
+    // 在变量池中的下标
+    pool_id_t id;
+    // 在类型表中的编号
+    type_id_t tid;
     // 变量名
-    name_t name;
+    name_id_t name;
+    // 初始化数据在变量池中的下标
+    pool_id_t init_data;
+    // 数组长度
+    uint32_t array_size;
+    // 此变量大小
+    uint32_t size;
     // 数据
     union {
-        char        char_data;
-        int         int_data;
-        void *      ptr_data;
-        std::string string_data;
+        char      char_data;
+        int32_t   int_data;
+        name_id_t string_data;
     };
-    // 此变量大小
-    size_t size;
-    // 是否活跃
-    bool live_flag;
     // 默认 flag 设置
     void set_default(void);
 
@@ -68,54 +76,62 @@ public:
     // 匿名变量
     Variable(Token *_token);
     // 数组
-    Variable(scope_t &_scope, bool _extern_flag, type_t _type, name_t _name,
-             size_t _array_size);
+    Variable(scope_id_t _scope, bool _extern_flag, type_t _type,
+             const name_t &_name, uint32_t _array_size);
     // 整数
     Variable(int _int_data);
     // 字符
     Variable(char _char_data);
     // 一般变量
-    Variable(scope_t &_scope, bool _extern_flag, type_t _type, bool _ptr_flag,
-             name_t _name, Variable *_init_data);
-    // 拷贝构造
-    Variable(scope_t &_scope, Variable *v);
+    Variable(scope_id_t _scope, bool _extern_flag, type_t _type,
+             bool _ptr_flag, const name_t &_name, pool_id_t _init_data);
     ~Variable(void);
 
     // 是否为外部
-    bool get_extern_flag(void);
+    bool get_extern_flag(void) const;
     // 设置外部标识
     void set_extern_flag(bool _is_extern);
     // 是否为常量
-    bool get_const_flag(void);
+    bool get_const_flag(void) const;
     // 设置常量标识
     void set_const_flag(bool _is_const);
     // 是否为指针
-    bool get_ptr_flag(void);
+    bool get_ptr_flag(void) const;
     // 设置指针标识
     void set_ptr_flag(bool _is_ptr);
     // 是否能作为左值
-    bool get_lv_flag(void);
+    bool get_lv_flag(void) const;
     // 设置是否能作为左值
     void set_lv_flag(bool _is_lv);
     // 是否为字面值
-    bool get_literal_flag(void);
+    bool get_literal_flag(void) const;
     // 设置是否为字面值
     void set_literal_flag(bool _is_literal);
     // 获取类型
-    type_t get_type(void);
+    type_t get_type(void) const;
     // 设置类型
     void set_type(type_t _new_type);
+    // 获取类型编号
+    type_id_t get_type_id(void) const;
+    // 设置类型编号
+    void set_type_id(type_id_t _tid);
     // 获取数据
-    data_t get_data(void);
+    data_t get_data(void) const;
     // 设置数据
     void set_data(data_t _new_data);
     // 获取变量名
-    name_t get_name(void);
+    const name_t &get_name(void) const;
+    // 获取变量名编号
+    name_id_t get_name_id(void) const;
     // 修改变量名涉及到其它组件，先不考虑
     // 获取作用域
-    scope_t get_scope(void);
+    scope_id_t get_scope(void) const;
     // 设置作用域
-    void set_scope(scope_t _new_scope);
+    void set_scope(scope_id_t _new_scope);
+    // 获取在变量池中的下标
+    pool_id_t get_id(void) const;
+    // 设置在变量池中的下标
+    void set_id(pool_id_t _id);
     // 获取变量信息
     void to_string(std::string &_str);
 };
@@ -126,13 +142,15 @@ typedef std::vector<Variable *> paralist_t;
 class Function {
 private:
     // 标识符
-    bool extern_flag;
-    // 返回值类型
-    type_t type;
+    bool extern_flag : 1;
     // 是否为指针
-    bool ptr_flag;
+    bool ptr_flag : 1;
+    // 返回值类型
+    type_t type : 8;
     // 函数名
-    name_t name;
+    name_id_t name;
+    // 在函数池中的下标
+    pool_id_t id;
     // 参数表
     paralist_t paralist;
     // 栈大小
@@ -145,7 +163,7 @@ private:
 
 public:
     // 外部标识，返回类型，函数名，参数列表
-    Function(bool _extern_flag, type_t _return_type, name_t _fun_name,
+    Function(bool _extern_flag, type_t _return_type, const name_t &_fun_name,
              paralist_t &_paralist);
     ~Function(void);
 
@@ -154,20 +172,28 @@ public:
     bool match(paralist_t &_paralist);
 
     // 是否为外部
-    bool get_extern_flag(void);
+    bool get_extern_flag(void) const;
     // 设置外部标识
     void set_extern_flag(bool _is_extern);
     // 是否为指针
-    bool get_ptr_flag(void);
+    bool get_ptr_flag(void) const;
     // 设置指针标识
     void set_ptr_flag(bool _is_ptr);
     // 获取类型
-    type_t get_type(void);
+    type_t get_type(void) const;
     // 设置类型
     void set_type(type_t _new_type);
     // 获取变量名
-    name_t get_name(void);
+    const name_t &get_name(void) const;
+    // 获取变量名编号
+    name_id_t get_name_id(void) const;
     // 修改变量名涉及到其它组件，先不考虑
+    // 获取在函数池中的下标
+    pool_id_t get_id(void) const;
+    // 设置在函数池中的下标
+    void set_id(pool_id_t _id);
+    // 获取参数表
+    const paralist_t &get_paralist(void) const;
     // 获取变量信息
     void to_string(std::string &_str);
 };
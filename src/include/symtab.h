@@ -1,4 +1,3 @@
-
 // This file is a part of Simple-XX/SimpleCompiler
 // (https://github.com/Simple-XX/SimpleCompiler).
 //
@@ -13,13 +12,17 @@
 
 typedef std::vector<std::string> varlist_t;
 typedef std::vector<std::string> funlist_t;
-typedef std::vector<Variable *>  vars_t;
-typedef std::unordered_map<std::string, vars_t *, std::hash<std::string>>
+// 同名变量的遮蔽链，按作用域深度排列，末尾为最内层
+typedef std::vector<Variable *> vars_t;
+typedef std::unordered_map<std::string, vars_t, std::hash<std::string>>
     vartab_t;
 typedef std::unordered_map<std::string, Variable *, std::hash<std::string>>
     strtab_t;
 typedef std::unordered_map<std::string, Function *, std::hash<std::string>>
     funtab_t;
+// 一个作用域内声明的变量所在的遮蔽链
+// unordered_map 的元素地址在 rehash 后不变，可以直接保存指针
+typedef std::vector<vars_t *> scopevars_t;
 
 // 符号表
 class SymTab {
@@ -34,28 +37,68 @@ private:
     strtab_t strtab;
     // 函数表
     funtab_t funtab;
+    // 作用域栈，记录每层作用域声明的变量，退出时逐个弹出
+    std::vector<scopevars_t> scopes;
+    // 变量池
+    Pool<Variable> var_pool;
+    // 函数池
+    Pool<Function> fun_pool;
+    // 类型表
+    TypeTab types;
 
     // 当前所在函数
     Function *curr_fun;
     // 当前变量/函数作用域
     scope_t curr_scope;
+    // 已分配的作用域编号
+    int scope_cnt;
 
 public:
     SymTab(void);
     ~SymTab(void);
-    // 添加变量
-    void add_var(Variable *_var);
+    // 进入作用域
+    void enter_scope(void);
+    // 退出作用域，弹出该作用域声明的全部变量
+    void leave_scope(void);
+    // 获取当前作用域
+    const scope_t &get_scope(void) const;
+    // 在变量池中创建变量
+    template <class... Args>
+    Variable *new_var(Args &&...args) {
+        Variable *var = var_pool.alloc(std::forward<Args>(args)...);
+        var->set_id(var_pool.size() - 1);
+        return var;
+    }
+    // 在函数池中创建函数
+    template <class... Args>
+    Function *new_fun(Args &&...args) {
+        Function *fun = fun_pool.alloc(std::forward<Args>(args)...);
+        fun->set_id(fun_pool.size() - 1);
+        return fun;
+    }
+    // 获取类型表
+    TypeTab &get_types(void);
+    // 按下标获取变量
+    Variable *var_at(pool_id_t _id) const;
+    // 按下标获取函数
+    Function *fun_at(pool_id_t _id) const;
+    // 添加变量，同一作用域内重复定义时返回 false，由调用者报告错误
+    bool add_var(Variable *_var);
     // 添加字符串
     void add_str(Variable *_var);
     // 获取变量
-    Variable *get_var(name_t _name);
+    Variable *get_var(const name_t &_name);
+    // 按名字查找最内层可见的变量，不存在时返回 nullptr，不报告错误
+    Variable *find_var(const name_t &_name) const;
 
     // 声明函数
     void dec_fun(Function *_fun);
-    // 定义函数
-    void def_fun(Function *_fun);
+    // 定义函数，重复定义或与声明不匹配时返回 false，由调用者报告错误
+    bool def_fun(Function *_fun);
     // 获取函数
-    Function *get_fun(name_t _name, paralist_t &_paralist);
+    Function *get_fun(const name_t &_name, paralist_t &_paralist);
+    // 按名字查找函数，不检查参数，不存在时返回 nullptr
+    Function *find_fun(const name_t &_name) const;
 };
 
 #endif /* _SYMTAB_H_ */
@@ -0,0 +1,101 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// timer.h for Simple-XX/SimpleCompiler.
+
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+#include "atomic"
+#include "cstdint"
+#include "iostream"
+#include "string"
+#include "vector"
+
+// 编译过程统计
+// 关闭时计时器与计数器只检查一个标志，不产生其它开销
+// 阶段结果与跟踪事件按线程记录，汇总时合并，可以在多个线程中同时编译
+// 打开与关闭统计、设置跟踪文件须在编译开始之前进行
+
+// 是否统计各阶段的耗时与内存
+extern bool time_report;
+// 统计结果以 JSON 输出
+extern bool time_report_json;
+// 跟踪事件的输出文件，为空时不记录
+extern std::string trace_file;
+
+// 计数器
+enum stat_t {
+    // 读入的 token 个数
+    STAT_TOKENS,
+    // 创建的 AST 结点个数
+    STAT_AST_NODES,
+    // 编译的文件个数
+    STAT_FILES,
+    STAT_NUM,
+};
+
+// 计数器的值
+extern std::atomic<uint64_t> stat_counters[STAT_NUM];
+
+// 计数
+inline void stat_add(stat_t _stat, uint64_t _n = 1) {
+    if (time_report) {
+        stat_counters[_stat].fetch_add(_n, std::memory_order_relaxed);
+    }
+    return;
+}
+
+// 阶段计时
+// 构造时开始，析构时结束并累计到同名阶段，阶段可以嵌套，时间包含子阶段
+// 统计墙上时间、本线程的 CPU 时间、最大常驻内存的增长与本线程内存分配的次数和字节数
+// 指定了跟踪文件时同时记录阶段的开始与结束事件
+class Phase {
+private:
+    // 阶段名，必须是字符串常量
+    const char *name;
+    // 是否在计时
+    bool on;
+    // 开始时的墙上时间，单位为纳秒
+    uint64_t wall;
+    // 开始时的 CPU 时间，单位为纳秒
+    uint64_t cpu;
+    // 开始时的最大常驻内存，单位为 KB
+    uint64_t rss;
+    // 开始时的分配次数
+    uint64_t allocs;
+    // 开始时的分配字节数
+    uint64_t bytes;
+
+public:
+    // detail 为任务的说明，如文件名、函数名，只出现在跟踪事件中
+    Phase(const char *_name, const std::string &_detail = "");
+    ~Phase(void);
+};
+
+// 一个阶段的累计结果，时间单位为纳秒，内存单位为 KB
+struct phase_stat_t {
+    const char *name;
+    uint64_t    calls;
+    uint64_t    wall;
+    uint64_t    cpu;
+    uint64_t    rss;
+    uint64_t    allocs;
+    uint64_t    bytes;
+};
+
+// 获取各阶段的累计结果，各线程的同名阶段相加，按第一次出现的顺序排列
+std::vector<phase_stat_t> phase_stats(void);
+// 清空各阶段的累计结果与计数器
+void time_report_reset(void);
+// 获取统计打开以来的内存分配次数与字节数
+// 只有链接了 alloc_hook.cpp 的程序才会记录，编译器库不替换宿主程序的分配器
+void alloc_stats(uint64_t &count, uint64_t &bytes);
+// 记录一次内存分配，由 alloc_hook.cpp 中替换的 operator new 调用
+void alloc_note(size_t _size);
+// 输出统计结果
+void time_report_print(std::ostream &os);
+// 以 Chrome trace-event 格式写出跟踪事件，返回是否成功
+bool trace_write(void);
+
+#endif /* _TIMER_H_ */
@@ -67,6 +67,9 @@ enum Tag {
 class Token {
 public:
     Tag tag;
+    // 在源文件中的起始行列，由 Lexer 设置，从 1 开始，0 表示未知
+    unsigned int line;
+    unsigned int col;
     Token(Tag t);
     virtual std::string to_string(void);
     virtual ~Token();
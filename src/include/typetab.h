@@ -0,0 +1,75 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// typetab.h for Simple-XX/SimpleCompiler.
+
+#ifndef _TYPETAB_H_
+#define _TYPETAB_H_
+
+#include "cstdint"
+#include "string"
+#include "unordered_map"
+#include "vector"
+#include "type.h"
+
+// 类型编号
+typedef uint32_t type_id_t;
+// 数组维度
+typedef std::vector<uint32_t> dims_t;
+
+// 类型信息
+class TypeInfo {
+public:
+    // 基本类型
+    Type base;
+    // 是否为常量
+    bool const_flag;
+    // 是否为数组参数，此时第一维长度未知，记为 0
+    bool param_flag;
+    // 各维长度
+    dims_t dims;
+    // 各维步长，以元素个数计
+    dims_t strides;
+    // 元素总数，数组参数为 0
+    uint32_t size;
+    // 去掉第一维后的类型，标量为 TYPE_NONE
+    type_id_t elem;
+};
+
+// 类型表
+// 相同的类型只登记一次，类型相等即编号相等
+class TypeTab {
+private:
+    // 类型信息
+    std::vector<TypeInfo> types;
+    // 类型编码到编号的索引
+    std::unordered_map<std::string, type_id_t> index;
+
+public:
+    // 无效类型
+    static constexpr type_id_t TYPE_NONE = UINT32_MAX;
+    // 预先登记的类型
+    static constexpr type_id_t TYPE_VOID      = 0;
+    static constexpr type_id_t TYPE_INT       = 1;
+    static constexpr type_id_t TYPE_CONST_INT = 2;
+
+    TypeTab(void);
+    ~TypeTab(void);
+    // 获取类型编号，不存在时登记
+    type_id_t get(Type _base, bool _const, const dims_t &_dims = dims_t(),
+                  bool _param = false);
+    // 获取类型信息
+    const TypeInfo &at(type_id_t _id) const;
+    // 去掉第一维后的类型
+    type_id_t elem(type_id_t _id) const;
+    // 作为实参传递时的类型：数组退化为数组参数，标量去掉 const
+    type_id_t decay(type_id_t _id);
+    // 是否为数组
+    bool is_array(type_id_t _id) const;
+    // 已登记的类型个数
+    size_t size(void) const;
+    // 输出类型
+    std::string to_string(type_id_t _id) const;
+};
+
+#endif /* _TYPETAB_H_ */
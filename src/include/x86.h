@@ -0,0 +1,18 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// x86.h for Simple-XX/SimpleCompiler.
+
+#ifndef _X86_H_
+#define _X86_H_
+
+#include "string"
+#include "ir_tac.h"
+
+// x86-64 后端
+// 将三地址码直接编码为机器码，输出可重定位的 ELF64 目标文件，不经过汇编器
+// 每个虚拟寄存器在栈帧中占 8 字节，指令逐条从栈帧读取操作数、写回结果
+// 按 System V 调用约定传参与返回，外部函数由链接时的运行时库提供
+std::string x86_emit(const IRModule &_module);
+
+#endif /* _X86_H_ */
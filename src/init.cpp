@@ -5,22 +5,84 @@
 // init.cpp for Simple-XX/SimpleCompiler.
 
 #include "iostream"
+#include "cstdlib"
 #include "cstring"
 #include "unistd.h"
 #include "getopt.h"
 #include "init.h"
+#include "snapshot.h"
+#include "timer.h"
+
+// 源文件
+std::vector<std::string> src_files;
+// 输出文件
+string dest_file = "";
+// 输出内容
+thread_local string emit = "ast";
+// 优化级别
+thread_local int opt_level = 0;
+// 编译缓存目录
+string cache_dir = "";
+// 编译缓存大小上限
+uint64_t cache_limit = 64 << 20;
+// 是否输出编译缓存统计
+bool cache_stats = false;
+// 编译服务监听的套接字
+string server_socket = "";
+// 客户端模式下连接的套接字
+string client_socket = "";
 
 // 命令行参数解析相关定义
 extern int           optind, opterr, optopt;
 extern char *        optarg;
-static const int     LEXICAL_OPT    = 256;
-static struct option long_options[] = {
+static const int     LEXICAL_OPT     = 256;
+static const int     CACHE_DIR_OPT   = 257;
+static const int     CACHE_SIZE_OPT  = 258;
+static const int     CACHE_STATS_OPT = 259;
+static const int     EMIT_OPT        = 260;
+static const int     SERVER_OPT      = 261;
+static const int     CLIENT_OPT      = 262;
+static const int     TRACE_OPT       = 263;
+static const int     EMIT_LLVM_OPT   = 264;
+static struct option long_options[]  = {
     {"help", no_argument, NULL, 'h'},
     {"version", no_argument, NULL, 'v'},
     {"output", required_argument, NULL, 'o'},
     {"lexical", optional_argument, NULL, LEXICAL_OPT},
+    {"cache-dir", required_argument, NULL, CACHE_DIR_OPT},
+    {"cache-size", required_argument, NULL, CACHE_SIZE_OPT},
+    {"cache-stats", no_argument, NULL, CACHE_STATS_OPT},
+    {"emit", required_argument, NULL, EMIT_OPT},
+    {"server", required_argument, NULL, SERVER_OPT},
+    {"client", required_argument, NULL, CLIENT_OPT},
+    {"trace", required_argument, NULL, TRACE_OPT},
+    {"emit-llvm", no_argument, NULL, EMIT_LLVM_OPT},
+    {NULL, 0, NULL, 0},
 };
 
+// 解析带 K/M/G 后缀的大小
+uint64_t parse_size(const char *str) {
+    char *   end  = NULL;
+    uint64_t size = strtoull(str, &end, 10);
+    switch (*end) {
+        case 'k':
+        case 'K':
+            size <<= 10;
+            break;
+        case 'm':
+        case 'M':
+            size <<= 20;
+            break;
+        case 'g':
+        case 'G':
+            size <<= 30;
+            break;
+        default:
+            break;
+    }
+    return size;
+}
+
 Init::Init() {
     // 初始化目录信息
     abs_path = getcwd(abs_path_buffer, 256);
@@ -35,39 +97,116 @@ Init::~Init() {
 }
 
 int Init::init(int &argc, char **&argv) {
-    while ((c = getopt_long(argc, argv, "hvo:", long_options, &index)) != EOF) {
+    // 缓存目录可以由环境变量指定
+    const char *env_cache_dir = getenv("SIMPLECOMPILER_CACHE_DIR");
+    if (env_cache_dir != NULL) {
+        cache_dir = env_cache_dir;
+    }
+    while ((c = getopt_long(argc, argv, "hvo:f:O:", long_options, &index)) != EOF) {
         switch (c) {
             // 显示帮助信息
             case 'h':
-                cout << "c-sub v0.01\nCopyright(C) Simple-XX 2020\n"
+                cout << "c-sub v" SIMPLE_COMPILER_VERSION
+                        "\nCopyright(C) Simple-XX 2020\n"
                      << "命令格式：[源文件[源文件] -o 输出文件 [选项]][-h|-v]\n"
-                     << "\t源文件\t\t必须是以.c结尾的文件\n"
+                     << "\t源文件\t\t必须是以.c结尾的文件，- 表示从标准输入读入\n"
                      << "\t-o\t\t指定输出文件\n"
                      << "\t--lexical[指定文件(可选)]\t显示词法分析过程\n"
+                     << "\t--emit 内容\t\t输出内容，ast(默认) 为 AST 文本，"
+                        "snapshot 为 AST 快照，ir 为三地址码，\n"
+                     << "\t\t\t\tobj 为 x86-64 ELF 目标文件，只能有一个源文件，\n"
+                     << "\t\t\t\triscv 为 RV64IM 汇编，aarch64 为 AArch64 汇编，\n"
+                     << "\t\t\t\tllvm 为 LLVM IR 文本，不受 -O 影响，\n"
+                     << "\t\t\t\tbytecode 为 scvm 运行的字节码，只能有一个源文件\n"
+                     << "\t\t\t\t以 .ast 结尾的源文件按快照读入\n"
+                     << "\t--emit-llvm\t\t同 --emit llvm\n"
+                     << "\t--cache-dir 目录\t使用编译缓存，也可由环境变量 "
+                        "SIMPLECOMPILER_CACHE_DIR 指定\n"
+                     << "\t--cache-size 大小\t编译缓存大小上限，可带 K/M/G "
+                        "后缀，默认 64M\n"
+                     << "\t--cache-stats\t\t显示编译缓存统计\n"
+                     << "\t--server 套接字\t作为编译服务常驻，监听指定的 Unix "
+                        "套接字\n"
+                     << "\t--client 套接字\t将本次编译转发给编译服务，"
+                        "服务不可用时在本地编译\n"
+                     << "\t-O级别\t\t优化级别，可为 0(默认)、1、2\n"
+                     << "\t-ftime-report[=json]\t显示各阶段的耗时与内存统计\n"
+                     << "\t--trace 文件\t\t以 Chrome trace-event 格式记录各阶段"
+                        "与各文件、函数的开始和结束\n"
                      << "\t-h\t\t显示帮助信息\n"
                      << "\t-v\t\t显示版本信息" << endl;
                 break;
             // 显示版本信息
             case 'v':
-                cout << "c-sub v0.01\nCopyright(C) Simple-XX 2020\n"
+                cout << "c-sub v" SIMPLE_COMPILER_VERSION
+                        "\nCopyright(C) Simple-XX 2020\n"
                      << "简单的 C 语言子集编译器" << endl;
                 break;
             case 'o':
-                // 寻找源文件，寻找区间 argv[1:-2]
-                for (int i = 1; i < argc - 2; i++) {
-                    // 添加源文件
-                    if (strstr(argv[i], ".c")) {
-                        src_files.push_back(abs_path + argv[i]);
-                    }
-                }
                 // 设置输出文件
                 dest_file = abs_path + optarg;
                 break;
 
+            // -f 开头的编译选项
+            case 'f':
+                if (strcmp(optarg, "time-report") == 0) {
+                    time_report = true;
+                }
+                else if (strcmp(optarg, "time-report=json") == 0) {
+                    time_report      = true;
+                    time_report_json = true;
+                }
+                else {
+                    cout << "unknow option: -f" << optarg << endl;
+                }
+                break;
+            // 优化级别
+            case 'O':
+                if (strlen(optarg) != 1 || optarg[0] < '0' || optarg[0] > '2') {
+                    cout << "unknow option: -O" << optarg << endl;
+                    break;
+                }
+                opt_level = optarg[0] - '0';
+                break;
             case LEXICAL_OPT:
                 cout << "输出词法分析结果，可指定输出到文件\n"
                      << "[--lexical 输出文件]" << endl;
                 break;
+            case CACHE_DIR_OPT:
+                cache_dir = optarg;
+                break;
+            case CACHE_SIZE_OPT:
+                cache_limit = parse_size(optarg);
+                break;
+            case CACHE_STATS_OPT:
+                cache_stats = true;
+                break;
+            case SERVER_OPT:
+                server_socket = optarg;
+                break;
+            case CLIENT_OPT:
+                client_socket = optarg;
+                break;
+            case TRACE_OPT:
+                trace_file = optarg;
+                break;
+            case EMIT_OPT:
+                if (strcmp(optarg, "ast") != 0 &&
+                    strcmp(optarg, "snapshot") != 0 &&
+                    strcmp(optarg, "ir") != 0 &&
+                    strcmp(optarg, "obj") != 0 &&
+                    strcmp(optarg, "riscv") != 0 &&
+                    strcmp(optarg, "aarch64") != 0 &&
+                    strcmp(optarg, "llvm") != 0 &&
+                    strcmp(optarg, "bytecode") != 0) {
+                    cout << "unknow emit: " << optarg << endl;
+                    break;
+                }
+                emit = optarg;
+                break;
+            case EMIT_LLVM_OPT:
+                emit = "llvm";
+                break;
             // 表示选项不支持
             case '?':
                 cout << "unknow option" << endl;
@@ -77,5 +216,18 @@ int Init::init(int &argc, char **&argv) {
                 break;
         }
     }
+    // 只有给出输出文件时才编译
+    // getopt_long 已将源文件移到选项之后，与它们在命令行中的位置无关
+    if (dest_file.empty() == false) {
+        for (int i = optind; i < argc; i++) {
+            // 添加源文件与快照，- 表示标准输入
+            if (strcmp(argv[i], STDIN_FILE) == 0) {
+                src_files.push_back(STDIN_FILE);
+            }
+            else if (strstr(argv[i], ".c") || is_snapshot(argv[i])) {
+                src_files.push_back(abs_path + argv[i]);
+            }
+        }
+    }
     return 0;
 }
@@ -0,0 +1,334 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// interp.cpp for Simple-XX/SimpleCompiler.
+
+#include "climits"
+#include "cstring"
+#include "ir_interp.h"
+
+using namespace std;
+
+// 保留的低地址，空指针落在其中
+static const size_t NULL_GUARD = 16;
+
+IRInterp::IRInterp(const IRModule &_module, istream &_in, ostream &_out)
+    : module(_module), in(_in), out(_out) {
+    mem_limit  = 256 << 20;
+    steps      = 0;
+    step_limit = 0;
+    return;
+}
+
+IRInterp::~IRInterp(void) {
+    return;
+}
+
+void IRInterp::set_step_limit(uint64_t _limit) {
+    step_limit = _limit;
+    return;
+}
+
+void IRInterp::set_mem_limit(size_t _limit) {
+    mem_limit = _limit;
+    return;
+}
+
+uint64_t IRInterp::get_steps(void) const {
+    return steps;
+}
+
+const string &IRInterp::get_trap(void) const {
+    return trap;
+}
+
+bool IRInterp::check(int64_t _addr, size_t _size, size_t _top) {
+    if (_addr < (int64_t)NULL_GUARD || (size_t)_addr + _size > _top) {
+        trap = "invalid memory access at " + to_string(_addr);
+        return false;
+    }
+    return true;
+}
+
+bool IRInterp::call_extern(const IRFunction &_fun, const vector<int64_t> &_args,
+                           int64_t &_ret) {
+    const string &name = _fun.name;
+    _ret               = 0;
+    if (name == "getint") {
+        int32_t v = 0;
+        in >> v;
+        _ret = v;
+    }
+    else if (name == "getch") {
+        _ret = in.get();
+    }
+    else if (name == "getarray" && _args.size() == 1) {
+        int32_t n = 0;
+        in >> n;
+        if (n > 0 && check(_args[0], (size_t)n * 4, mem.size()) == false) {
+            return false;
+        }
+        for (int32_t i = 0; i < n; i++) {
+            int32_t v = 0;
+            in >> v;
+            memcpy(&mem[_args[0] + i * 4], &v, 4);
+        }
+        _ret = n;
+    }
+    else if (name == "putint" && _args.size() == 1) {
+        out << (int32_t)_args[0];
+    }
+    else if (name == "putch" && _args.size() == 1) {
+        out.put((char)_args[0]);
+    }
+    else if (name == "putarray" && _args.size() == 2) {
+        int32_t n = _args[0];
+        out << n << ":";
+        if (n > 0 && check(_args[1], (size_t)n * 4, mem.size()) == false) {
+            return false;
+        }
+        for (int32_t i = 0; i < n; i++) {
+            int32_t v;
+            memcpy(&v, &mem[_args[1] + i * 4], 4);
+            out << " " << v;
+        }
+        out << "\n";
+    }
+    // 计时函数不影响结果
+    else if (name == "starttime" || name == "stoptime") {
+    }
+    else {
+        trap = "undefined function " + name;
+        return false;
+    }
+    return true;
+}
+
+int IRInterp::run(void) {
+    int entry = module.find_fun("main");
+    if (entry < 0 || module.funs[entry].extern_flag) {
+        trap = "undefined function main";
+        return -1;
+    }
+    // 布置全局变量
+    size_t top = NULL_GUARD;
+    for (auto &g : module.globals) {
+        global_addr.push_back(top);
+        top += (g.size + 7) & ~(size_t)7;
+    }
+    mem.assign(top, 0);
+    for (size_t i = 0; i < module.globals.size(); i++) {
+        auto &init = module.globals[i].init;
+        if (init.empty() == false) {
+            memcpy(&mem[global_addr[i]], init.data(), init.size() * 4);
+        }
+    }
+    // 标号位置
+    labels.resize(module.funs.size());
+    for (size_t f = 0; f < module.funs.size(); f++) {
+        const IRFunction &fun = module.funs[f];
+        labels[f].assign(fun.label_cnt, 0);
+        for (size_t i = 0; i < fun.code.size(); i++) {
+            if (fun.code[i].op == OP_LABEL) {
+                labels[f][fun.code[i].result.val] = i;
+            }
+        }
+    }
+    vector<Frame>   frames;
+    vector<int64_t> regs;
+    vector<int64_t> args;
+    int64_t         exit_val = 0;
+    // 进入函数，参数为 args 末尾的 param_cnt 个值
+    auto enter = [&](int f, int32_t ret_reg) {
+        const IRFunction &fun = module.funs[f];
+        Frame             frame;
+        frame.fun      = f;
+        frame.pc       = 0;
+        frame.reg_base = regs.size();
+        frame.sp       = top;
+        frame.ret_reg  = ret_reg;
+        regs.resize(regs.size() + fun.reg_cnt(), 0);
+        size_t first = args.size() - fun.param_cnt;
+        for (uint32_t i = 0; i < fun.param_cnt; i++) {
+            regs[frame.reg_base + i] = args[first + i];
+        }
+        args.resize(first);
+        top += (fun.frame_size + 7) & ~(size_t)7;
+        if (top > mem_limit) {
+            trap = "stack overflow";
+            return false;
+        }
+        if (top > mem.size()) {
+            mem.resize(max(top, mem.size() * 2), 0);
+        }
+        frames.push_back(frame);
+        return true;
+    };
+    if (enter(entry, -1) == false) {
+        return -1;
+    }
+    while (frames.empty() == false) {
+        Frame            &frame = frames.back();
+        const IRFunction &fun   = module.funs[frame.fun];
+        const IRInst     &inst  = fun.code[frame.pc++];
+        int64_t          *r     = &regs[frame.reg_base];
+        // 标号不计入执行的指令
+        if (inst.op == OP_LABEL) {
+            continue;
+        }
+        auto val = [&](const IRArg &a) -> int64_t {
+            return a.kind == ARG_REG ? r[a.val] : a.val;
+        };
+        // 整数运算的结果截断为 32 位
+        auto set = [&](int64_t v) {
+            r[inst.result.val] = (int32_t)(uint32_t)v;
+        };
+        steps++;
+        if (step_limit != 0 && steps > step_limit) {
+            trap = "step limit exceeded";
+            return -1;
+        }
+        switch (inst.op) {
+            case OP_NOP:
+            case OP_LABEL:
+                break;
+            case OP_AS:
+                r[inst.result.val] = val(inst.arg1);
+                break;
+            case OP_ADD:
+                set((uint32_t)val(inst.arg1) + (uint32_t)val(inst.arg2));
+                break;
+            case OP_SUB:
+                set((uint32_t)val(inst.arg1) - (uint32_t)val(inst.arg2));
+                break;
+            case OP_MUL:
+                set((uint32_t)val(inst.arg1) * (uint32_t)val(inst.arg2));
+                break;
+            case OP_DIV:
+            case OP_MOD: {
+                int32_t a = val(inst.arg1), b = val(inst.arg2);
+                if (b == 0 || (a == INT_MIN && b == -1)) {
+                    trap = "integer division error";
+                    return -1;
+                }
+                set(inst.op == OP_DIV ? a / b : a % b);
+                break;
+            }
+            case OP_NEG:
+                set(-(uint32_t)val(inst.arg1));
+                break;
+            case OP_GT:
+                set((int32_t)val(inst.arg1) > (int32_t)val(inst.arg2));
+                break;
+            case OP_GE:
+                set((int32_t)val(inst.arg1) >= (int32_t)val(inst.arg2));
+                break;
+            case OP_LT:
+                set((int32_t)val(inst.arg1) < (int32_t)val(inst.arg2));
+                break;
+            case OP_LE:
+                set((int32_t)val(inst.arg1) <= (int32_t)val(inst.arg2));
+                break;
+            case OP_EQU:
+                set((int32_t)val(inst.arg1) == (int32_t)val(inst.arg2));
+                break;
+            case OP_NE:
+                set((int32_t)val(inst.arg1) != (int32_t)val(inst.arg2));
+                break;
+            case OP_NOT:
+                set((int32_t)val(inst.arg1) == 0);
+                break;
+            case OP_LEA:
+                r[inst.result.val] = inst.arg1.kind == ARG_GLOBAL
+                                         ? global_addr[inst.arg1.val]
+                                         : frame.sp + inst.arg1.val;
+                break;
+            case OP_OFFSET:
+                r[inst.result.val] = val(inst.arg1) + (int32_t)val(inst.arg2);
+                break;
+            case OP_SET: {
+                int64_t addr = val(inst.arg1);
+                if (check(addr, 4, top) == false) {
+                    return -1;
+                }
+                int32_t v = val(inst.result);
+                memcpy(&mem[addr], &v, 4);
+                break;
+            }
+            case OP_GET: {
+                int64_t addr = val(inst.arg1);
+                if (check(addr, 4, top) == false) {
+                    return -1;
+                }
+                int32_t v;
+                memcpy(&v, &mem[addr], 4);
+                r[inst.result.val] = v;
+                break;
+            }
+            case OP_ZERO: {
+                int64_t addr = val(inst.arg1);
+                size_t  size = val(inst.arg2);
+                if (check(addr, size, top) == false) {
+                    return -1;
+                }
+                memset(&mem[addr], 0, size);
+                break;
+            }
+            case OP_JMP:
+                frame.pc = labels[frame.fun][inst.result.val];
+                break;
+            case OP_JT:
+                if ((int32_t)val(inst.arg1) != 0) {
+                    frame.pc = labels[frame.fun][inst.result.val];
+                }
+                break;
+            case OP_JF:
+                if ((int32_t)val(inst.arg1) == 0) {
+                    frame.pc = labels[frame.fun][inst.result.val];
+                }
+                break;
+            case OP_ARG:
+                args.push_back(val(inst.arg1));
+                break;
+            case OP_PROC:
+            case OP_CALL: {
+                int               f      = inst.arg1.val;
+                const IRFunction &callee = module.funs[f];
+                int32_t ret_reg = inst.op == OP_CALL ? inst.result.val : -1;
+                if (callee.extern_flag) {
+                    int64_t ret;
+                    if (call_extern(callee, args, ret) == false) {
+                        return -1;
+                    }
+                    args.clear();
+                    if (ret_reg >= 0) {
+                        r[ret_reg] = (int32_t)ret;
+                    }
+                    break;
+                }
+                // enter 会使 frame 与 r 失效
+                if (enter(f, ret_reg) == false) {
+                    return -1;
+                }
+                break;
+            }
+            case OP_RET:
+            case OP_RETV: {
+                int64_t ret     = inst.op == OP_RETV ? val(inst.arg1) : 0;
+                int32_t ret_reg = frame.ret_reg;
+                top             = frame.sp;
+                regs.resize(frame.reg_base);
+                frames.pop_back();
+                if (frames.empty()) {
+                    exit_val = ret;
+                }
+                else if (ret_reg >= 0) {
+                    regs[frames.back().reg_base + ret_reg] = ret;
+                }
+                break;
+            }
+        }
+    }
+    out.flush();
+    return exit_val & 0xff;
+}
@@ -0,0 +1,623 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// irgen.cpp for Simple-XX/SimpleCompiler.
+
+#include "algorithm"
+#include "irgen.h"
+
+// 元素字节数
+static const int32_t WORD = 4;
+
+IRGen::IRGen(SymTab &_symtab, IRModule &_module)
+    : symtab(_symtab), types(_symtab.get_types()), module(_module) {
+    fun = nullptr;
+    return;
+}
+
+IRGen::~IRGen(void) {
+    return;
+}
+
+void IRGen::generate(MetaAST &_prog) {
+    memo.clear();
+    walk(_prog);
+    return;
+}
+
+const vector<int> &IRGen::generate_unit(MetaAST &_unit) {
+    unit_externs.clear();
+    memo.clear();
+    walk(_unit);
+    return unit_externs;
+}
+
+bool IRGen::reuse(FuncDefAST &_ast, const string &_data) {
+    int idx = module.funs.size();
+    if (module.load_fun(_data) == false) {
+        return false;
+    }
+    if (_ast.get_sym() >= fun_index.size()) {
+        fun_index.resize(_ast.get_sym() + 1, -1);
+    }
+    fun_index[_ast.get_sym()] = idx;
+    return true;
+}
+
+void IRGen::emit(IROperator _op, IRArg _result, IRArg _arg1, IRArg _arg2) {
+    fun->code.push_back(IRInst(_op, _result, _arg1, _arg2));
+    return;
+}
+
+IRArg &IRGen::storage_of(pool_id_t _sym) {
+    if (_sym >= storage.size()) {
+        storage.resize(_sym + 1);
+    }
+    return storage[_sym];
+}
+
+int IRGen::fun_of(pool_id_t _sym) {
+    if (_sym >= fun_index.size()) {
+        fun_index.resize(_sym + 1, -1);
+    }
+    // 复用的函数可能已经登记了外部函数
+    if (fun_index[_sym] < 0) {
+        fun_index[_sym] = module.find_fun(symtab.fun_at(_sym)->get_name());
+    }
+    if (fun_index[_sym] < 0) {
+        Function  *f = symtab.fun_at(_sym);
+        IRFunction ext;
+        ext.name        = f->get_name();
+        ext.extern_flag = true;
+        ext.void_flag   = f->get_type() == KW_VOID;
+        ext.param_cnt   = f->get_paralist().size();
+        for (auto p : f->get_paralist()) {
+            ext.reg_ptr.push_back(types.is_array(p->get_type_id()));
+        }
+        // 登记可能使 module.funs 扩容，重新取得当前函数
+        size_t cur      = fun - module.funs.data();
+        fun_index[_sym] = module.funs.size();
+        module.funs.push_back(ext);
+        fun = &module.funs[cur];
+    }
+    int idx = fun_index[_sym];
+    if (module.funs[idx].extern_flag &&
+        find(unit_externs.begin(), unit_externs.end(), idx) == unit_externs.end()) {
+        unit_externs.push_back(idx);
+    }
+    return idx;
+}
+
+// 求值前先查常量，常量直接得到立即数，不进入子结点
+void IRGen::expr(MetaAST &_exp) {
+    int val;
+    if (eval_const(symtab, &_exp, val, &memo)) {
+        value = IRArg(ARG_IMM, val);
+        resume();
+        return;
+    }
+    value = IRArg();
+    descend(_exp);
+    return;
+}
+
+// 生成条件跳转，目标由访问的结点取出
+void IRGen::cond(MetaAST &_exp, IRArg _true, IRArg _false) {
+    conds.push_back({_true, _false});
+    descend(_exp, WALK_COND);
+    return;
+}
+
+void IRGen::branch(MetaAST &_exp) {
+    if (step() == 0) {
+        expr(_exp);
+        return;
+    }
+    auto [t, f] = conds.back();
+    conds.pop_back();
+    if (value.is_imm()) {
+        emit(OP_JMP, value.val ? t : f);
+        return;
+    }
+    emit(OP_JT, t, value);
+    emit(OP_JMP, f);
+    return;
+}
+
+void IRGen::visit(CompUnitAST &ast) {
+    if (step() < ast.get_units().size()) {
+        descend(*ast.get_units()[step()]);
+    }
+    return;
+}
+
+void IRGen::visit(StmtAST &ast) {
+    if (step() == 0) {
+        descend(*ast.get_stmt());
+    }
+    return;
+}
+
+void IRGen::visit(FuncDefAST &ast) {
+    auto &stmts = static_cast<BlockAST &>(*ast.get_body()).get_stmts();
+    if (step() == 0) {
+        if (ast.get_sym() >= fun_index.size()) {
+            fun_index.resize(ast.get_sym() + 1, -1);
+        }
+        fun_index[ast.get_sym()] = module.funs.size();
+        module.funs.push_back(IRFunction());
+        fun            = &module.funs.back();
+        fun->name      = ast.get_name();
+        fun->void_flag = ast.get_type() == Type::void_t;
+        fun->param_cnt = ast.get_params().size();
+        // 参数依次占用前面的寄存器
+        for (auto &param : ast.get_params()) {
+            IdAST &id = static_cast<IdAST &>(*param);
+            storage_of(id.get_sym()) = fun->new_reg(types.is_array(id.get_tid()));
+        }
+    }
+    if (step() < stmts.size()) {
+        descend(*stmts[step()]);
+        return;
+    }
+    // 补上返回语句
+    if (fun->void_flag) {
+        emit(OP_RET);
+    }
+    else {
+        emit(OP_RETV, IRArg(), IRArg(ARG_IMM, 0));
+    }
+    fun = nullptr;
+    memo.clear();
+    return;
+}
+
+// 函数下标与各实参的值依次放在 vals 中
+void IRGen::visit(FuncCallAST &ast) {
+    if (mode() == WALK_COND) {
+        branch(ast);
+        return;
+    }
+    auto &args = ast.get_args();
+    if (step() == 0) {
+        vals.push_back(IRArg(ARG_FUN, fun_of(ast.get_sym())));
+    }
+    else {
+        vals.push_back(value);
+    }
+    if (step() < args.size()) {
+        expr(*args[step()]);
+        return;
+    }
+    size_t first = vals.size() - args.size();
+    int    idx   = vals[first - 1].val;
+    for (size_t i = first; i < vals.size(); i++) {
+        emit(OP_ARG, IRArg(), vals[i]);
+    }
+    vals.resize(first - 1);
+    if (module.funs[idx].void_flag) {
+        emit(OP_PROC, IRArg(), IRArg(ARG_FUN, idx));
+        value = IRArg(ARG_IMM, 0);
+    }
+    else {
+        value = fun->new_reg();
+        emit(OP_CALL, value, IRArg(ARG_FUN, idx));
+    }
+    return;
+}
+
+void IRGen::visit(VarDeclAST &ast) {
+    if (step() < ast.get_vars().size()) {
+        descend(*ast.get_vars()[step()]);
+    }
+    return;
+}
+
+// 初始值由 expr 逐个生成，局部数组的基址放在 vals 中
+void IRGen::visit(VarDefAST &ast) {
+    IdAST          &id   = static_cast<IdAST &>(*ast.get_var());
+    const TypeInfo &type = types.at(id.get_tid());
+    bool            is_array = types.is_array(id.get_tid());
+    // 常量标量在使用处直接替换为值
+    if (ast.is_const() && is_array == false) {
+        return;
+    }
+    // 局部标量
+    if (step() > 0 && is_array == false) {
+        emit(OP_AS, storage_of(id.get_sym()), value);
+        return;
+    }
+    // 局部数组的一个初始值，0 已由清零得到
+    if (step() > 0) {
+        IRArg v = value;
+        if (v.is_imm() == false || v.val != 0) {
+            IRArg addr = fun->new_reg(true);
+            emit(OP_OFFSET, addr, vals.back(),
+                 IRArg(ARG_IMM, inits[step() - 1].first * WORD));
+            emit(OP_SET, v, addr);
+        }
+        if (step() < inits.size()) {
+            expr(*inits[step()].second);
+            return;
+        }
+        vals.pop_back();
+        return;
+    }
+    inits.clear();
+    if (ast.get_init()) {
+        InitValAST &init = static_cast<InitValAST &>(*ast.get_init());
+        uint32_t    pos  = 0;
+        if (is_array) {
+            flatten_init(init, type, 0, pos, inits);
+        }
+        else if (init.get_values().empty() == false) {
+            inits.push_back({0, init.get_values()[0].get()});
+        }
+    }
+    // 全局变量
+    if (fun == nullptr) {
+        IRGlobal g;
+        g.name       = id.get_name();
+        g.size       = (is_array ? type.size : 1) * WORD;
+        g.const_flag = ast.is_const();
+        for (auto &i : inits) {
+            int val = 0;
+            eval_const(symtab, i.second, val);
+            if (i.first >= g.init.size()) {
+                g.init.resize(i.first + 1, 0);
+            }
+            g.init[i.first] = val;
+        }
+        storage_of(id.get_sym()) = IRArg(ARG_GLOBAL, module.globals.size());
+        module.globals.push_back(g);
+        return;
+    }
+    // 局部标量
+    if (is_array == false) {
+        IRArg reg                = fun->new_reg();
+        storage_of(id.get_sym()) = reg;
+        if (inits.empty()) {
+            emit(OP_AS, reg, IRArg(ARG_IMM, 0));
+            return;
+        }
+        expr(*inits[0].second);
+        return;
+    }
+    // 局部数组，有初始化列表时先清零再逐个赋值
+    IRArg slot(ARG_FRAME, fun->frame_size);
+    fun->frame_size += type.size * WORD;
+    storage_of(id.get_sym()) = slot;
+    if (ast.get_init() == nullptr) {
+        return;
+    }
+    IRArg base = fun->new_reg(true);
+    emit(OP_LEA, base, slot);
+    emit(OP_ZERO, IRArg(), base, IRArg(ARG_IMM, type.size * WORD));
+    if (inits.empty()) {
+        return;
+    }
+    vals.push_back(base);
+    expr(*inits[0].second);
+    return;
+}
+
+void IRGen::visit(IdAST &) {
+    return;
+}
+
+void IRGen::visit(InitValAST &) {
+    return;
+}
+
+void IRGen::visit(BlockAST &ast) {
+    if (step() < ast.get_stmts().size()) {
+        descend(*ast.get_stmts()[step()]);
+    }
+    return;
+}
+
+void IRGen::visit(BinaryAST &ast) {
+    bool logic =
+        ast.get_op() == Operator::and_op || ast.get_op() == Operator::or_op;
+    // 条件中的逻辑与、或直接跳转，右侧沿用本结点的目标
+    if (mode() == WALK_COND && logic) {
+        if (step() == 0) {
+            IRArg next = fun->new_label();
+            vals.push_back(next);
+            if (ast.get_op() == Operator::and_op) {
+                cond(*ast.get_left(), next, conds.back().second);
+            }
+            else {
+                cond(*ast.get_left(), conds.back().first, next);
+            }
+            return;
+        }
+        if (step() == 1) {
+            emit(OP_LABEL, vals.back());
+            vals.pop_back();
+            descend(*ast.get_right(), WALK_COND);
+        }
+        return;
+    }
+    if (mode() == WALK_COND) {
+        branch(ast);
+        return;
+    }
+    // 在表达式中出现的逻辑运算按短路求值得到 0 或 1
+    if (logic) {
+        if (step() == 0) {
+            IRArg res = fun->new_reg();
+            IRArg t = fun->new_label(), f = fun->new_label(),
+                  end = fun->new_label();
+            vals.insert(vals.end(), {res, t, f, end});
+            cond(ast, t, f);
+            return;
+        }
+        IRArg res = vals[vals.size() - 4], t = vals[vals.size() - 3],
+              f = vals[vals.size() - 2], end = vals[vals.size() - 1];
+        vals.resize(vals.size() - 4);
+        emit(OP_LABEL, t);
+        emit(OP_AS, res, IRArg(ARG_IMM, 1));
+        emit(OP_JMP, end);
+        emit(OP_LABEL, f);
+        emit(OP_AS, res, IRArg(ARG_IMM, 0));
+        emit(OP_LABEL, end);
+        value = res;
+        return;
+    }
+    if (step() == 0) {
+        expr(*ast.get_left());
+        return;
+    }
+    if (step() == 1) {
+        vals.push_back(value);
+        expr(*ast.get_right());
+        return;
+    }
+    IROperator op;
+    switch (ast.get_op()) {
+        case Operator::add_op:
+            op = OP_ADD;
+            break;
+        case Operator::sub_op:
+            op = OP_SUB;
+            break;
+        case Operator::mul_op:
+            op = OP_MUL;
+            break;
+        case Operator::div_op:
+            op = OP_DIV;
+            break;
+        case Operator::mod_op:
+            op = OP_MOD;
+            break;
+        case Operator::gt_op:
+            op = OP_GT;
+            break;
+        case Operator::ge_op:
+            op = OP_GE;
+            break;
+        case Operator::lt_op:
+            op = OP_LT;
+            break;
+        case Operator::le_op:
+            op = OP_LE;
+            break;
+        case Operator::equ_op:
+            op = OP_EQU;
+            break;
+        case Operator::nequ_op:
+            op = OP_NE;
+            break;
+        default:
+            op = OP_NOP;
+            break;
+    }
+    IRArg l = vals.back();
+    vals.pop_back();
+    IRArg res = fun->new_reg();
+    emit(op, res, l, value);
+    value = res;
+    return;
+}
+
+void IRGen::visit(UnaryAST &ast) {
+    // 条件中的逻辑非交换本结点的目标
+    if (mode() == WALK_COND && ast.get_op() == Operator::not_op) {
+        if (step() == 0) {
+            swap(conds.back().first, conds.back().second);
+            descend(*ast.get_exp(), WALK_COND);
+        }
+        return;
+    }
+    if (mode() == WALK_COND) {
+        branch(ast);
+        return;
+    }
+    if (step() == 0) {
+        expr(*ast.get_exp());
+        return;
+    }
+    if (ast.get_op() == Operator::add_op) {
+        return;
+    }
+    IRArg res = fun->new_reg();
+    emit(ast.get_op() == Operator::sub_op ? OP_NEG : OP_NOT, res, value);
+    value = res;
+    return;
+}
+
+void IRGen::visit(NumAST &ast) {
+    if (mode() == WALK_COND) {
+        branch(ast);
+        return;
+    }
+    value = IRArg(ARG_IMM, ast.get_val());
+    return;
+}
+
+// 条件的标号放在 vals 中，有 else 时再加上结尾的标号
+void IRGen::visit(IfAST &ast) {
+    switch (step()) {
+        case 0: {
+            IRArg t = fun->new_label(), f = fun->new_label();
+            vals.insert(vals.end(), {t, f});
+            cond(*ast.get_cond(), t, f);
+            return;
+        }
+        case 1:
+            emit(OP_LABEL, vals[vals.size() - 2]);
+            descend(*ast.get_then());
+            return;
+        case 2:
+            if (ast.get_else()) {
+                IRArg end = fun->new_label();
+                emit(OP_JMP, end);
+                emit(OP_LABEL, vals.back());
+                vals.push_back(end);
+                descend(*ast.get_else());
+                return;
+            }
+            emit(OP_LABEL, vals.back());
+            vals.resize(vals.size() - 2);
+            return;
+    }
+    emit(OP_LABEL, vals.back());
+    vals.resize(vals.size() - 3);
+    return;
+}
+
+void IRGen::visit(WhileAST &ast) {
+    switch (step()) {
+        case 0: {
+            IRArg head = fun->new_label(), body = fun->new_label(),
+                  end = fun->new_label();
+            emit(OP_LABEL, head);
+            vals.insert(vals.end(), {head, body, end});
+            cond(*ast.get_cond(), body, end);
+            return;
+        }
+        case 1:
+            emit(OP_LABEL, vals[vals.size() - 2]);
+            loops.push_back({vals[vals.size() - 3], vals.back()});
+            descend(*ast.get_body());
+            return;
+    }
+    loops.pop_back();
+    emit(OP_JMP, vals[vals.size() - 3]);
+    emit(OP_LABEL, vals.back());
+    vals.resize(vals.size() - 3);
+    return;
+}
+
+void IRGen::visit(ControlAST &ast) {
+    switch (ast.get_type()) {
+        case Control::break_c:
+            emit(OP_JMP, loops.back().second);
+            break;
+        case Control::continue_c:
+            emit(OP_JMP, loops.back().first);
+            break;
+        case Control::return_c:
+            if (ast.get_ret() && step() == 0) {
+                expr(*ast.get_ret());
+                return;
+            }
+            if (ast.get_ret()) {
+                emit(OP_RETV, IRArg(), value);
+            }
+            else if (fun->void_flag) {
+                emit(OP_RET);
+            }
+            else {
+                emit(OP_RETV, IRArg(), IRArg(ARG_IMM, 0));
+            }
+            break;
+    }
+    // 之后的语句不可达，放到新的标号下
+    emit(OP_LABEL, fun->new_label());
+    return;
+}
+
+// 先求右侧的值，存入数组元素或全局变量时再以 WALK_ADDRESS 计算地址
+void IRGen::visit(AssignAST &ast) {
+    LValAST &lval = static_cast<LValAST &>(*ast.get_left());
+    if (step() == 0) {
+        expr(*ast.get_right());
+        return;
+    }
+    if (step() == 2) {
+        emit(OP_SET, vals.back(), value);
+        vals.pop_back();
+        return;
+    }
+    IRArg dst = storage_of(lval.get_sym());
+    if (dst.kind == ARG_REG && lval.get_position().empty()) {
+        emit(OP_AS, dst, value);
+        return;
+    }
+    vals.push_back(value);
+    descend(lval, WALK_ADDRESS);
+    return;
+}
+
+// 地址在计算各维下标期间放在 vals 中
+void IRGen::visit(LValAST &ast) {
+    if (mode() == WALK_COND) {
+        branch(ast);
+        return;
+    }
+    Variable       *var  = symtab.var_at(ast.get_sym());
+    const TypeInfo &type = types.at(var->get_type_id());
+    auto           &pos  = ast.get_position();
+    if (step() == 0) {
+        IRArg loc = storage_of(ast.get_sym());
+        // 标量局部变量与数组参数本身
+        if (mode() != WALK_ADDRESS && loc.kind == ARG_REG && pos.empty()) {
+            value = loc;
+            return;
+        }
+        IRArg addr = loc;
+        if (loc.kind != ARG_REG) {
+            addr = fun->new_reg(true);
+            emit(OP_LEA, addr, loc);
+        }
+        vals.push_back(addr);
+    }
+    else {
+        // 加上第 step() - 1 维的偏移
+        IRArg   idx    = value;
+        int32_t stride = type.strides[step() - 1] * WORD;
+        IRArg   off;
+        if (idx.is_imm()) {
+            off = IRArg(ARG_IMM, (uint32_t)idx.val * stride);
+        }
+        else {
+            off = fun->new_reg();
+            emit(OP_MUL, off, idx, IRArg(ARG_IMM, stride));
+        }
+        if (off.is_imm() == false || off.val != 0) {
+            IRArg next = fun->new_reg(true);
+            emit(OP_OFFSET, next, vals.back(), off);
+            vals.back() = next;
+        }
+    }
+    if (step() < pos.size()) {
+        expr(*pos[step()]);
+        return;
+    }
+    IRArg addr = vals.back();
+    vals.pop_back();
+    // 部分下标得到子数组的地址
+    if (mode() == WALK_ADDRESS || pos.size() < type.dims.size()) {
+        value = addr;
+        return;
+    }
+    value = fun->new_reg();
+    emit(OP_GET, value, addr);
+    return;
+}
+
+void IRGen::visit(EmptyAST &) {
+    return;
+}
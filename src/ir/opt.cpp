@@ -0,0 +1,530 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// opt.cpp for Simple-XX/SimpleCompiler.
+
+#include "algorithm"
+#include "climits"
+#include "cstdint"
+#include "cstring"
+#include "unordered_map"
+#include "ir_opt.h"
+#include "timer.h"
+
+using namespace std;
+
+// 最多迭代的轮数
+static const int MAX_ROUNDS = 16;
+
+// 指令读取的操作数，SET 的 result 也是读取
+static int uses_of(IRInst &inst, IRArg *uses[3]) {
+    int n = 0;
+    if (inst.has_def() == false && inst.result.is_reg()) {
+        uses[n++] = &inst.result;
+    }
+    if (inst.arg1.is_reg()) {
+        uses[n++] = &inst.arg1;
+    }
+    if (inst.arg2.is_reg()) {
+        uses[n++] = &inst.arg2;
+    }
+    return n;
+}
+
+// 折叠两个立即数的运算，除数为 0 或溢出的除法留到运行时
+static bool fold(IROperator op, int32_t a, int32_t b, int32_t &res) {
+    uint32_t ua = a, ub = b;
+    switch (op) {
+        case OP_ADD:
+            res = ua + ub;
+            return true;
+        case OP_SUB:
+            res = ua - ub;
+            return true;
+        case OP_MUL:
+            res = ua * ub;
+            return true;
+        case OP_DIV:
+        case OP_MOD:
+            if (b == 0 || (a == INT_MIN && b == -1)) {
+                return false;
+            }
+            res = op == OP_DIV ? a / b : a % b;
+            return true;
+        case OP_GT:
+            res = a > b;
+            return true;
+        case OP_GE:
+            res = a >= b;
+            return true;
+        case OP_LT:
+            res = a < b;
+            return true;
+        case OP_LE:
+            res = a <= b;
+            return true;
+        case OP_EQU:
+            res = a == b;
+            return true;
+        case OP_NE:
+            res = a != b;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_binary(IROperator op) {
+    return op >= OP_ADD && op <= OP_NE && op != OP_NEG;
+}
+
+// 化简一条指令，返回是否改变
+static bool simplify(IRInst &inst) {
+    IRArg &a = inst.arg1, &b = inst.arg2;
+    if (is_binary(inst.op) && a.is_imm() && b.is_imm()) {
+        int32_t res;
+        if (fold(inst.op, a.val, b.val, res)) {
+            inst = IRInst(OP_AS, inst.result, IRArg(ARG_IMM, res));
+            return true;
+        }
+        return false;
+    }
+    switch (inst.op) {
+        case OP_NEG:
+        case OP_NOT:
+            if (a.is_imm()) {
+                int32_t res = inst.op == OP_NEG ? -(uint32_t)a.val : !a.val;
+                inst        = IRInst(OP_AS, inst.result, IRArg(ARG_IMM, res));
+                return true;
+            }
+            return false;
+        case OP_ADD:
+            if (b.is_imm() && b.val == 0) {
+                inst = IRInst(OP_AS, inst.result, a);
+                return true;
+            }
+            if (a.is_imm() && a.val == 0) {
+                inst = IRInst(OP_AS, inst.result, b);
+                return true;
+            }
+            return false;
+        case OP_SUB:
+        case OP_OFFSET:
+            if (b.is_imm() && b.val == 0) {
+                inst = IRInst(OP_AS, inst.result, a);
+                return true;
+            }
+            return false;
+        case OP_MUL:
+            if (b.is_imm() && (b.val == 0 || b.val == 1)) {
+                inst = IRInst(OP_AS, inst.result, b.val ? a : b);
+                return true;
+            }
+            if (a.is_imm() && (a.val == 0 || a.val == 1)) {
+                inst = IRInst(OP_AS, inst.result, a.val ? b : a);
+                return true;
+            }
+            return false;
+        case OP_DIV:
+            if (b.is_imm() && b.val == 1) {
+                inst = IRInst(OP_AS, inst.result, a);
+                return true;
+            }
+            return false;
+        case OP_JT:
+        case OP_JF:
+            if (a.is_imm()) {
+                bool taken = (a.val != 0) == (inst.op == OP_JT);
+                inst = taken ? IRInst(OP_JMP, inst.result) : IRInst(OP_NOP);
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+// 基本块内的常量传播与复制传播
+// 寄存器可以重复赋值，被重新定值时失效所有依赖它的复制关系
+static bool propagate(IRFunction &fun) {
+    bool                   changed = false;
+    vector<IRArg>          copy(fun.reg_cnt());
+    vector<vector<int32_t>> deps(fun.reg_cnt());
+    vector<int32_t>        touched;
+    auto kill = [&](int32_t r) {
+        copy[r] = IRArg();
+        for (auto d : deps[r]) {
+            if (copy[d] == IRArg(ARG_REG, r)) {
+                copy[d] = IRArg();
+            }
+        }
+        deps[r].clear();
+    };
+    for (auto &inst : fun.code) {
+        if (inst.op == OP_LABEL) {
+            for (auto r : touched) {
+                copy[r] = IRArg();
+                deps[r].clear();
+            }
+            touched.clear();
+            continue;
+        }
+        IRArg *uses[3];
+        int    n = uses_of(inst, uses);
+        for (int i = 0; i < n; i++) {
+            IRArg c = copy[uses[i]->val];
+            // 指针操作数不能替换为立即数
+            if (c.kind != ARG_NONE &&
+                (c.is_reg() || fun.reg_ptr[uses[i]->val] == false)) {
+                *uses[i] = c;
+                changed  = true;
+            }
+        }
+        if (simplify(inst)) {
+            changed = true;
+        }
+        if (inst.has_def() == false) {
+            continue;
+        }
+        int32_t r = inst.result.val;
+        kill(r);
+        if (inst.op == OP_AS && inst.arg1 != inst.result &&
+            (inst.arg1.is_imm() || inst.arg1.is_reg())) {
+            copy[r] = inst.arg1;
+            touched.push_back(r);
+            if (inst.arg1.is_reg()) {
+                deps[inst.arg1.val].push_back(r);
+                touched.push_back(inst.arg1.val);
+            }
+        }
+    }
+    return changed;
+}
+
+// 基本块内的公共子表达式消除
+// 按局部值编号，寄存器每次定值后版本加一，操作数的版本相同的运算才能复用
+struct expr_key_t {
+    int32_t  op, a_kind, a_val, b_kind, b_val;
+    uint32_t a_ver, b_ver, block;
+    bool     operator==(const expr_key_t &k) const {
+        return memcmp(this, &k, sizeof(k)) == 0;
+    }
+};
+
+struct expr_hash_t {
+    size_t operator()(const expr_key_t &k) const {
+        const uint32_t *p = (const uint32_t *)&k;
+        uint64_t        h = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(k) / 4; i++) {
+            h = (h ^ p[i]) * 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+static bool cse(IRFunction &fun) {
+    bool             changed = false;
+    uint32_t         block   = 0;
+    vector<uint32_t> version(fun.reg_cnt(), 0);
+    // 表达式到保存其值的寄存器与当时的版本
+    unordered_map<expr_key_t, pair<int32_t, uint32_t>, expr_hash_t> avail;
+    for (auto &inst : fun.code) {
+        if (inst.op == OP_LABEL) {
+            block++;
+            continue;
+        }
+        if (inst.has_def() == false) {
+            continue;
+        }
+        int32_t r = inst.result.val;
+        // 读内存与调用的结果不能复用，除法第一次没有出错则第二次也不会
+        if (inst.op == OP_AS || inst.op == OP_GET || inst.op == OP_CALL) {
+            version[r]++;
+            continue;
+        }
+        IRArg a = inst.arg1, b = inst.arg2;
+        if (inst.op == OP_ADD || inst.op == OP_MUL || inst.op == OP_EQU ||
+            inst.op == OP_NE) {
+            if (make_pair(b.kind, b.val) < make_pair(a.kind, a.val)) {
+                swap(a, b);
+            }
+        }
+        expr_key_t key;
+        memset(&key, 0, sizeof(key));
+        key.op     = inst.op;
+        key.a_kind = a.kind;
+        key.a_val  = a.val;
+        key.a_ver  = a.is_reg() ? version[a.val] : 0;
+        key.b_kind = b.kind;
+        key.b_val  = b.val;
+        key.b_ver  = b.is_reg() ? version[b.val] : 0;
+        key.block  = block;
+        auto it    = avail.find(key);
+        version[r]++;
+        if (it != avail.end() && it->second.first != r &&
+            version[it->second.first] == it->second.second) {
+            inst    = IRInst(OP_AS, inst.result, IRArg(ARG_REG, it->second.first));
+            changed = true;
+            continue;
+        }
+        avail[key] = {r, version[r]};
+    }
+    return changed;
+}
+
+// 跳转串联的最终目标：从每个标号出发沿 target 走 label_cnt 步，
+// 遇到没有后继或以自身为目标的标号时停止
+// target 构成函数图，每个标号只经过一次：链上的标号共用链尾的结果，
+// 进入环的标号按剩余步数取环上的位置，与逐步跟随的结果相同
+static vector<IRArg> thread_targets(const vector<IRArg> &target,
+                                    uint32_t label_cnt) {
+    // 标号在 ring 中所在环的起点与长度，len 为 0 时不在环上也不通向环，
+    // dist 为到环的步数，pos 为进入环时在环上的位置
+    struct node_t {
+        uint32_t dist, base, len, pos;
+    };
+    vector<IRArg>    res(label_cnt);
+    vector<node_t>   nodes(label_cnt, {0, 0, 0, 0});
+    vector<uint8_t>  state(label_cnt, 0);
+    vector<uint32_t> ring, path;
+    auto             next = [&](uint32_t l) {
+        IRArg t = target[l];
+        return t.kind == ARG_NONE || t.val == (int32_t)l ? UINT32_MAX
+                                                         : (uint32_t)t.val;
+    };
+    auto on_ring = [&](const node_t &n) {
+        return IRArg(ARG_LABEL,
+                     ring[n.base + (n.pos + label_cnt - n.dist) % n.len]);
+    };
+    for (uint32_t l = 0; l < label_cnt; l++) {
+        if (state[l] != 0) {
+            continue;
+        }
+        // 走到链尾、已处理的标号或本次路径上的标号为止
+        path.clear();
+        uint32_t x = l;
+        while (x != UINT32_MAX && state[x] == 0) {
+            state[x] = 1;
+            path.push_back(x);
+            x = next(x);
+        }
+        size_t tail = path.size();
+        if (x != UINT32_MAX && state[x] == 1) {
+            // 成环，环上的标号从 x 开始
+            tail          = find(path.begin(), path.end(), x) - path.begin();
+            uint32_t base = ring.size(), len = path.size() - tail;
+            for (size_t i = tail; i < path.size(); i++) {
+                ring.push_back(path[i]);
+                nodes[path[i]] = {0, base, len, (uint32_t)(i - tail)};
+                res[path[i]]   = on_ring(nodes[path[i]]);
+                state[path[i]] = 2;
+            }
+            x = path[tail];
+        }
+        // 链上其余的标号倒序处理，x 为后继
+        for (size_t i = tail; i-- > 0;) {
+            uint32_t p = path[i];
+            if (x == UINT32_MAX) {
+                res[p] = IRArg(ARG_LABEL, p);
+            }
+            else if (nodes[x].len == 0) {
+                res[p] = res[x];
+            }
+            else {
+                nodes[p] = nodes[x];
+                nodes[p].dist++;
+                res[p] = on_ring(nodes[p]);
+            }
+            state[p] = 2;
+            x        = p;
+        }
+    }
+    return res;
+}
+
+// 删除不可达代码、多余的跳转与无引用的标号
+static bool cleanup(IRFunction &fun, bool thread) {
+    bool           changed = false;
+    vector<IRInst> code;
+    // 跳转、返回之后到下一个标号之前的代码不可达
+    bool dead = false;
+    for (auto &inst : fun.code) {
+        if (inst.op == OP_LABEL) {
+            dead = false;
+        }
+        if (dead || inst.op == OP_NOP) {
+            changed = true;
+            continue;
+        }
+        code.push_back(inst);
+        if (inst.op == OP_JMP || inst.op == OP_RET || inst.op == OP_RETV) {
+            dead = true;
+        }
+    }
+    // 标号所在的下标，run_end[i] 为从 i 开始的一串标号之后的下标
+    // 跳转的目标在紧随其后的一串标号中时可以删除
+    vector<size_t> label_at(fun.label_cnt, SIZE_MAX);
+    vector<size_t> run_end(code.size() + 1, code.size());
+    for (size_t i = code.size(); i-- > 0;) {
+        if (code[i].op == OP_LABEL) {
+            label_at[code[i].result.val] = i;
+            run_end[i]                   = run_end[i + 1];
+        }
+        else {
+            run_end[i] = i;
+        }
+    }
+    auto next_label = [&](size_t i, IRArg label) {
+        size_t at = label_at[label.val];
+        return at != SIZE_MAX && at > i && at < run_end[i + 1];
+    };
+    for (size_t i = 0; i < code.size(); i++) {
+        IRInst &inst = code[i];
+        if ((inst.op == OP_JMP || inst.op == OP_JT || inst.op == OP_JF) &&
+            next_label(i, inst.result)) {
+            inst    = IRInst(OP_NOP);
+            changed = true;
+            continue;
+        }
+        // JT L1; JMP L2; L1: 改为 JF L2; L1:
+        if ((inst.op == OP_JT || inst.op == OP_JF) && i + 1 < code.size() &&
+            code[i + 1].op == OP_JMP && next_label(i + 1, inst.result)) {
+            inst.op     = inst.op == OP_JT ? OP_JF : OP_JT;
+            inst.result = code[i + 1].result;
+            code[i + 1] = IRInst(OP_NOP);
+            changed     = true;
+        }
+    }
+    // 跳转串联：目标标号后紧跟无条件跳转时直接跳到最终目标
+    if (thread) {
+        vector<IRArg> target(fun.label_cnt);
+        for (size_t i = 0; i < code.size(); i++) {
+            size_t j = run_end[i];
+            if (code[i].op == OP_LABEL && j < code.size() &&
+                code[j].op == OP_JMP) {
+                target[code[i].result.val] = code[j].result;
+            }
+        }
+        // 成环时走 label_cnt 步后停止
+        vector<IRArg> dest = thread_targets(target, fun.label_cnt);
+        for (auto &inst : code) {
+            if (inst.op != OP_JMP && inst.op != OP_JT && inst.op != OP_JF) {
+                continue;
+            }
+            IRArg t = target[inst.result.val];
+            if (t.kind != ARG_NONE && t != inst.result) {
+                inst.result = dest[inst.result.val];
+                changed     = true;
+            }
+        }
+    }
+    vector<uint32_t> refs(fun.label_cnt, 0);
+    for (auto &inst : code) {
+        if (inst.op == OP_JMP || inst.op == OP_JT || inst.op == OP_JF) {
+            refs[inst.result.val]++;
+        }
+    }
+    fun.code.clear();
+    for (auto &inst : code) {
+        if (inst.op == OP_NOP ||
+            (inst.op == OP_LABEL && refs[inst.result.val] == 0)) {
+            changed = true;
+            continue;
+        }
+        fun.code.push_back(inst);
+    }
+    return changed;
+}
+
+// 合并只被紧随其后的赋值使用一次的临时寄存器
+// t = ADD a, b; x = AS t 改为 x = ADD a, b
+static bool coalesce(IRFunction &fun) {
+    bool             changed = false;
+    vector<uint32_t> refs(fun.reg_cnt(), 0);
+    for (auto &inst : fun.code) {
+        IRArg *uses[3];
+        int    n = uses_of(inst, uses);
+        for (int i = 0; i < n; i++) {
+            refs[uses[i]->val]++;
+        }
+    }
+    for (size_t i = 0; i + 1 < fun.code.size(); i++) {
+        IRInst &def = fun.code[i], &as = fun.code[i + 1];
+        if (def.has_def() && as.op == OP_AS && as.arg1 == def.result &&
+            refs[def.result.val] == 1 &&
+            fun.reg_ptr[def.result.val] == fun.reg_ptr[as.result.val]) {
+            def.result = as.result;
+            as         = IRInst(OP_NOP);
+            changed    = true;
+        }
+    }
+    if (changed) {
+        auto end = remove_if(fun.code.begin(), fun.code.end(),
+                             [](const IRInst &inst) { return inst.op == OP_NOP; });
+        fun.code.erase(end, fun.code.end());
+    }
+    return changed;
+}
+
+// 删除结果未被使用的无副作用指令
+static bool dce(IRFunction &fun) {
+    bool changed = false;
+    while (true) {
+        vector<uint32_t> refs(fun.reg_cnt(), 0);
+        for (auto &inst : fun.code) {
+            IRArg *uses[3];
+            int    n = uses_of(inst, uses);
+            for (int i = 0; i < n; i++) {
+                refs[uses[i]->val]++;
+            }
+        }
+        size_t old = fun.code.size();
+        size_t k   = 0;
+        for (auto &inst : fun.code) {
+            if (inst.is_pure() && refs[inst.result.val] == 0) {
+                continue;
+            }
+            // 自身赋值
+            if (inst.op == OP_AS && inst.arg1 == inst.result) {
+                continue;
+            }
+            fun.code[k++] = inst;
+        }
+        fun.code.erase(fun.code.begin() + k, fun.code.end());
+        if (k == old) {
+            break;
+        }
+        changed = true;
+    }
+    return changed;
+}
+
+void optimize(IRFunction &_fun, int _level) {
+    if (_level <= 0 || _fun.extern_flag) {
+        return;
+    }
+    for (int i = 0; i < MAX_ROUNDS; i++) {
+        bool changed = propagate(_fun);
+        if (_level >= 2) {
+            changed |= cse(_fun);
+        }
+        changed |= cleanup(_fun, _level >= 2);
+        changed |= dce(_fun);
+        changed |= coalesce(_fun);
+        if (changed == false) {
+            break;
+        }
+    }
+    return;
+}
+
+void optimize(IRModule &_module, int _level) {
+    if (_level <= 0) {
+        return;
+    }
+    Phase phase("optimize");
+    for (auto &fun : _module.funs) {
+        optimize(fun, _level);
+    }
+    return;
+}
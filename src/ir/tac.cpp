@@ -0,0 +1,373 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// tac.cpp for Simple-XX/SimpleCompiler.
+
+#include "cctype"
+#include "charconv"
+#include "sstream"
+#include "string_view"
+#include "unordered_map"
+#include "ir_tac.h"
+
+using namespace std;
+
+// 指令名
+static const char *op_names[] = {
+    "NOP",    "LABEL", "AS",  "ADD",  "SUB", "MUL", "DIV",  "MOD",
+    "NEG",    "GT",    "GE",  "LT",   "LE",  "EQU", "NE",   "NOT",
+    "LEA",    "OFFSET", "SET", "GET", "ZERO", "JMP", "JT",  "JF",
+    "ARG",    "PROC",  "CALL", "RET", "RETV",
+};
+
+bool IRInst::has_def(void) const {
+    switch (op) {
+        case OP_AS:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_NEG:
+        case OP_GT:
+        case OP_GE:
+        case OP_LT:
+        case OP_LE:
+        case OP_EQU:
+        case OP_NE:
+        case OP_NOT:
+        case OP_LEA:
+        case OP_OFFSET:
+        case OP_GET:
+        case OP_CALL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool IRInst::is_pure(void) const {
+    // 除法可能因除数为 0 出错，读内存可能越界，调用可能有副作用
+    switch (op) {
+        case OP_DIV:
+        case OP_MOD:
+            return arg2.is_imm() && arg2.val != 0;
+        case OP_GET:
+        case OP_CALL:
+            return false;
+        default:
+            return has_def();
+    }
+}
+
+IRFunction::IRFunction(void) {
+    extern_flag = false;
+    void_flag   = false;
+    param_cnt   = 0;
+    frame_size  = 0;
+    label_cnt   = 0;
+    return;
+}
+
+IRFunction::~IRFunction(void) {
+    return;
+}
+
+IRArg IRFunction::new_reg(bool _ptr) {
+    reg_ptr.push_back(_ptr);
+    return IRArg(ARG_REG, reg_ptr.size() - 1);
+}
+
+IRArg IRFunction::new_label(void) {
+    return IRArg(ARG_LABEL, label_cnt++);
+}
+
+uint32_t IRFunction::reg_cnt(void) const {
+    return reg_ptr.size();
+}
+
+IRModule::IRModule(void) {
+    return;
+}
+
+IRModule::~IRModule(void) {
+    return;
+}
+
+int IRModule::find_fun(const string &_name) const {
+    for (size_t i = 0; i < funs.size(); i++) {
+        if (funs[i].name == _name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+size_t IRModule::inst_cnt(void) const {
+    size_t cnt = 0;
+    for (auto &f : funs) {
+        cnt += f.code.size();
+    }
+    return cnt;
+}
+
+static string arg_to_string(const IRModule &mod, const IRFunction &fun,
+                            const IRArg &arg) {
+    switch (arg.kind) {
+        case ARG_REG:
+            return "%" + std::to_string(arg.val) +
+                   (fun.reg_ptr[arg.val] ? "*" : "");
+        case ARG_IMM:
+            return std::to_string(arg.val);
+        case ARG_GLOBAL:
+            return "@" + mod.globals[arg.val].name;
+        case ARG_FRAME:
+            return "$" + std::to_string(arg.val);
+        case ARG_LABEL:
+            return "L" + std::to_string(arg.val);
+        case ARG_FUN:
+            return mod.funs[arg.val].name;
+        default:
+            return "";
+    }
+}
+
+// 输出三地址码
+string IRModule::to_string(void) const {
+    string res;
+    for (auto &g : globals) {
+        res += string(g.const_flag ? "const" : "global") + " @" + g.name +
+               " [" + std::to_string(g.size) + "]";
+        if (g.init.empty() == false) {
+            res += " = {";
+            for (size_t i = 0; i < g.init.size(); i++) {
+                res += (i ? ", " : "") + std::to_string(g.init[i]);
+            }
+            res += "}";
+        }
+        res += "\n";
+    }
+    for (auto &f : funs) {
+        if (f.extern_flag) {
+            res += "extern " + f.name + "\n";
+            continue;
+        }
+        res += string("\nfunction ") + (f.void_flag ? "void " : "int ") +
+               f.name + "(";
+        for (uint32_t i = 0; i < f.param_cnt; i++) {
+            res += (i ? ", " : "") + arg_to_string(*this, f, IRArg(ARG_REG, i));
+        }
+        res += ") frame " + std::to_string(f.frame_size) + "\n";
+        for (auto &inst : f.code) {
+            if (inst.op == OP_LABEL) {
+                res += arg_to_string(*this, f, inst.result) + ":\n";
+                continue;
+            }
+            res += "    ";
+            if (inst.has_def()) {
+                res += arg_to_string(*this, f, inst.result) + " = ";
+            }
+            res += op_names[inst.op];
+            string args;
+            if (inst.has_def() == false && inst.result.kind != ARG_NONE) {
+                args += arg_to_string(*this, f, inst.result);
+            }
+            for (auto a : {&inst.arg1, &inst.arg2}) {
+                if (a->kind != ARG_NONE) {
+                    args += (args.empty() ? "" : ", ") +
+                            arg_to_string(*this, f, *a);
+                }
+            }
+            res += (args.empty() ? "" : " ") + args + "\n";
+        }
+    }
+    return res;
+}
+
+int IRModule::find_global(const string &_name) const {
+    for (size_t i = 0; i < globals.size(); i++) {
+        if (globals[i].name == _name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 函数签名：名字、是否无返回值、参数个数，frame 为 true 时还有栈帧与标号
+static void write_sig(ostringstream &_os, const IRFunction &_fun, bool _frame) {
+    _os << (_frame ? "fun " : "extern ") << _fun.name << " " << _fun.void_flag
+        << " " << _fun.param_cnt;
+    if (_frame) {
+        _os << " " << _fun.frame_size << " " << _fun.label_cnt;
+    }
+    // 各寄存器是否为指针，以 p 开头，寄存器为 0 个时不为空
+    _os << " p";
+    for (bool ptr : _fun.reg_ptr) {
+        _os << ptr;
+    }
+    _os << "\n";
+    return;
+}
+
+// 读回 save_fun 结果时的游标，各项以空白分隔
+class FunReader {
+private:
+    const char *pos;
+    const char *end;
+
+public:
+    // 出现格式错误后为 false
+    bool ok;
+
+    FunReader(const string &_data)
+        : pos(_data.c_str()), end(_data.c_str() + _data.size()), ok(true) {
+        return;
+    }
+    // 是否已读完
+    bool done(void) {
+        while (pos < end && isspace((unsigned char)*pos)) {
+            pos++;
+        }
+        return pos == end;
+    }
+    // 读一项
+    string_view word(void) {
+        done();
+        const char *begin = pos;
+        while (pos < end && isspace((unsigned char)*pos) == false) {
+            pos++;
+        }
+        ok = ok && pos != begin;
+        return string_view(begin, pos - begin);
+    }
+    // 读一个整数
+    int64_t num(void) {
+        string_view w = word();
+        int64_t     v = 0;
+        ok = ok && from_chars(w.data(), w.data() + w.size(), v).ptr ==
+                       w.data() + w.size();
+        return v;
+    }
+};
+
+// _name 返回函数名在数据中的位置
+static bool read_sig(FunReader &_rd, IRFunction &_fun, string_view &_name,
+                     bool _frame) {
+    _name          = _rd.word();
+    _fun.name      = _name;
+    _fun.void_flag = _rd.num();
+    _fun.param_cnt = _rd.num();
+    if (_frame) {
+        _fun.frame_size = _rd.num();
+        _fun.label_cnt  = _rd.num();
+    }
+    string_view ptrs = _rd.word();
+    if (_rd.ok == false || ptrs[0] != 'p') {
+        return false;
+    }
+    for (size_t i = 1; i < ptrs.size(); i++) {
+        _fun.reg_ptr.push_back(ptrs[i] == '1');
+    }
+    return _fun.param_cnt <= _fun.reg_ptr.size();
+}
+
+// 先写函数与其调用的外部函数的签名，再逐条写指令
+// 每个操作数为种类与值，全局变量与函数的值为名字
+string IRModule::save_fun(size_t _idx, const vector<int> &_externs) const {
+    ostringstream     os;
+    const IRFunction &fun = funs[_idx];
+    write_sig(os, fun, true);
+    for (int i : _externs) {
+        write_sig(os, funs[i], false);
+    }
+    for (auto &inst : fun.code) {
+        os << "inst " << inst.op;
+        for (auto a : {&inst.result, &inst.arg1, &inst.arg2}) {
+            os << " " << a->kind << " ";
+            if (a->kind == ARG_GLOBAL) {
+                os << globals[a->val].name;
+            }
+            else if (a->kind == ARG_FUN) {
+                os << funs[a->val].name;
+            }
+            else {
+                os << a->val;
+            }
+        }
+        os << "\n";
+    }
+    // 以指令条数结尾，被截断的数据不会被当作较短的函数读回
+    os << "end " << fun.code.size() << "\n";
+    return os.str();
+}
+
+bool IRModule::load_fun(const string &_data) {
+    FunReader          rd(_data);
+    string_view        tag, name;
+    IRFunction         fun;
+    vector<IRFunction> exts;
+    // 按名字引用的全局变量与函数在模块中的下标，名字指向 _data
+    unordered_map<string_view, int> globals_of, funs_of;
+    if (rd.word() != "fun" || read_sig(rd, fun, name, true) == false) {
+        return false;
+    }
+    // 函数自身排在模块末尾，之后是第一次登记的外部函数
+    funs_of[name] = funs.size();
+    while ((tag = rd.word()) == "extern") {
+        exts.push_back(IRFunction());
+        IRFunction &ext = exts.back();
+        ext.extern_flag = true;
+        if (read_sig(rd, ext, name, false) == false) {
+            return false;
+        }
+        int idx = find_fun(ext.name);
+        if (idx >= 0) {
+            exts.pop_back();
+        }
+        else {
+            idx = funs.size() + exts.size();
+        }
+        funs_of[name] = idx;
+    }
+    while (tag == "inst") {
+        int64_t op = rd.num();
+        if (op < OP_NOP || op > OP_RETV) {
+            return false;
+        }
+        IRInst inst((IROperator)op);
+        for (auto a : {&inst.result, &inst.arg1, &inst.arg2}) {
+            int64_t kind = rd.num();
+            int64_t val  = 0;
+            if (kind == ARG_GLOBAL || kind == ARG_FUN) {
+                auto &index = kind == ARG_GLOBAL ? globals_of : funs_of;
+                name        = rd.word();
+                auto  it    = index.find(name);
+                if (it == index.end()) {
+                    int idx = kind == ARG_GLOBAL ? find_global(string(name))
+                                                 : find_fun(string(name));
+                    it      = index.insert({name, idx}).first;
+                }
+                val = it->second;
+            }
+            else {
+                val = rd.num();
+            }
+            if (rd.ok == false || kind < ARG_NONE || kind > ARG_FUN ||
+                (kind != ARG_IMM && val < 0) ||
+                (kind == ARG_REG && val >= fun.reg_cnt()) ||
+                (kind == ARG_LABEL && val >= fun.label_cnt)) {
+                return false;
+            }
+            *a = IRArg((ir_arg_kind_t)kind, val);
+        }
+        fun.code.push_back(inst);
+        tag = rd.word();
+    }
+    if (tag != "end" || rd.num() != (int64_t)fun.code.size() || rd.ok == false ||
+        rd.done() == false) {
+        return false;
+    }
+    funs.push_back(move(fun));
+    funs.insert(funs.end(), exts.begin(), exts.end());
+    return true;
+}
@@ -91,8 +91,11 @@ void Lexer::character() {
         if (ch == '\'') {
             continue;
         }
+        // 多个字符时只保留最后一个
+        delete t;
+        t = NULL;
         // 文件结束或换行
-        else if ((ch == '\n') || (ch == EOF) ) {
+        if ((ch == '\n') || (ch == EOF) ) {
             t = new Token(ERR);
             error->set_err_no(ERR);
             error->display_err();
@@ -269,7 +272,7 @@ void Lexer::operation() {
                 }
                 // 没有闭合
                 if (ch == EOF) {
-                    cout << "多行注释未正常结束" << endl;
+                    error->get_out() << "多行注释未正常结束" << endl;
                 }
             }
             // 否则为除号
@@ -310,9 +313,13 @@ void Lexer::operation() {
     return;
 }
 
+// 错误的词法记号同样返回，由语法分析报告
 Token *Lexer::lexing() {
     // 字符不为空且没有出错时
     while ((is_done() == false)) {
+        // Scanner 读入 ch 后列号已指向下一列
+        unsigned int line = error->get_pos()->line;
+        unsigned int col  = error->get_pos()->col - 1;
         if (COND_BLANK)
             blank();
         else if (COND_IDENTIFIER)
@@ -336,15 +343,18 @@ Token *Lexer::lexing() {
             token = new Token(ERR);
             error->set_err_no(ERR);
             error->display_err();
-            return token;
+            scan();
         }
-        // 更新 token 内容
-        if (token != NULL && token->tag != ERR) {
-            return token;
+        // 返回的 token 归调用者所有
+        if (token != NULL) {
+            Token *t = token;
+            token    = NULL;
+            t->line  = line;
+            t->col   = col;
+            return t;
         }
     }
-    token = new Token(END);
-    return token;
+    return new Token(END);
 }
 
 bool Lexer::is_done() const {
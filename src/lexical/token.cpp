@@ -22,7 +22,8 @@ Keywords::Keywords() {
 }
 
 Tag Keywords::get_tag(std::string name) {
-    return keywords.find(name) != keywords.end() ? keywords[name] : ID;
+    auto it = keywords.find(name);
+    return it != keywords.end() ? it->second : ID;
 }
 
 const char *tokenName[] = {
@@ -34,11 +35,18 @@ const char *tokenName[] = {
     "RBRACE", "LBRACKET", "RBRACKET","COMMA",  "COLON",  "SEMICON",
 };
 
-Token::Token(Tag t) : tag(t) {
+Token::Token(Tag t) : tag(t), line(0), col(0) {
     return;
 }
 
 std::string Token::to_string() {
+    // ERR 与 END 为负数，不在 tokenName 中
+    if (tag == ERR) {
+        return "ERR";
+    }
+    if (tag == END) {
+        return "END";
+    }
     return tokenName[tag];
 }
 
@@ -4,50 +4,37 @@
 //
 // main.cpp for Simple-XX/SimpleCompiler.
 
+#include "algorithm"
 #include "iostream"
 #include "string"
 #include "vector"
 #include "common.h"
+#include "driver.h"
+#include "server.h"
 
 using namespace std;
 
-// TODO: 由 init 处理
-// 源文件
-std::vector<std::string> src_files;
-// 输出文件
-string dest_file = "";
-
-Error *error = NULL;
-
 int main(int argc, char **argv) {
     // 初始化
     // 包括与命令行的交互、获取要操作的文件等
-    Init initer;
+    // getopt 会重排 argv，转发给编译服务的是原始参数
+    vector<string> args(argv, argv + argc);
+    Init           initer;
     initer.init(argc, argv);
-    // 逐个打开文件
-    for (const auto &i : src_files) {
-        cout << "Open file: " << i << endl;
-        error = new Error(i);
-        Scanner scanner(i);
-        Lexer   lexer(scanner);
-        SymTab  symtab(void);
-        Parser parser(lexer);
-        ASTPtr prog = parser.parsing();
-        cout << prog->to_string();
-        // while (lexer.is_done() == false) {
-        //     auto ch = lexer.lexing();
-        //     if (ch->tag < 0) {
-        //         if (ch->tag == EOF) {
-        //             cout << "File done: " << i << endl;
-        //         }
-        //     }
-        //     else {
-        //         // 输出到控制台
-        //         TOKEN_CAST(ch);
-        //         cout << ch->to_string() << endl;
-        //     }
-        // }
+    // 常驻为编译服务
+    if (server_socket.empty() == false) {
+        return serve(server_socket);
     }
-
-    return 0;
+    // 转发给编译服务，连接失败或服务不处理时在本地编译
+    // 服务读不到客户端的标准输入，从标准输入读入时也在本地编译
+    bool from_stdin =
+        find(src_files.begin(), src_files.end(), STDIN_FILE) != src_files.end();
+    if (client_socket.empty() == false && from_stdin == false) {
+        int ret = request(client_socket, args);
+        if (ret >= 0) {
+            return ret;
+        }
+    }
+    // 编译全部源文件
+    return drive();
 }
@@ -0,0 +1,72 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// ast.cpp for Simple-XX/SimpleCompiler.
+
+#include "ast.h"
+
+// 待释放的结点，每个线程一个
+static thread_local ASTPtrList drop_queue;
+// 是否正在释放队列中的结点
+static thread_local bool dropping = false;
+
+// 结点的析构函数再调用 ast_drop 时只入队，由最外层的调用逐个释放
+void ast_drop(ASTPtr &node) {
+    if (node == NULL) {
+        return;
+    }
+    drop_queue.push_back(move(node));
+    if (dropping) {
+        return;
+    }
+    dropping = true;
+    while (drop_queue.empty() == false) {
+        ASTPtr next = move(drop_queue.back());
+        drop_queue.pop_back();
+        next.reset();
+    }
+    dropping = false;
+    return;
+}
+
+// 栈顶为正在访问的结点，visit 返回后按其要求进入子结点、进行下一步或出栈
+void ASTWalker::walk(MetaAST &root, uint32_t mode) {
+    frames.clear();
+    frames.push_back({&root, 0, mode, 0});
+    while (frames.empty() == false) {
+        child = nullptr;
+        again = false;
+        frames.back().node->accept(*this);
+        if (again == false) {
+            frames.pop_back();
+            continue;
+        }
+        frames.back().step++;
+        if (child != nullptr) {
+            frames.push_back({child, 0, child_mode, 0});
+        }
+    }
+    return;
+}
+
+// 栈中的片段逆序存放，子结点出栈时展开为它的片段
+string MetaAST::to_string(void) {
+    string              output;
+    vector<ast_piece_t> stack;
+    vector<ast_piece_t> parts;
+    stack.push_back({"", this});
+    while (stack.empty() == false) {
+        ast_piece_t piece = move(stack.back());
+        stack.pop_back();
+        if (piece.child == NULL) {
+            output += piece.text;
+            continue;
+        }
+        parts.clear();
+        piece.child->pieces(parts);
+        for (auto it = parts.rbegin(); it != parts.rend(); ++it) {
+            stack.push_back(move(*it));
+        }
+    }
+    return output;
+}
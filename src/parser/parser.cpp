@@ -6,17 +6,29 @@
 
 #include "parser.h"
 
-Parser::Parser(Lexer &lex) : lexer(lex) {
+Parser::Parser(Lexer &lex, bool _digest)
+    : lexer(lex), token(NULL), failed(false), digest(_digest) {
     return;
 }
 
 Parser::~Parser() {
+    if (token != NULL) {
+        delete token;
+    }
     return;
 }
 
 // 获取下一个 token
 void Parser::next(void) {
+    // 被消耗的 token 计入当前单元的摘要
+    if (token != NULL) {
+        if (digest) {
+            unit_digest.update(token->to_string()).update(" ");
+        }
+        delete token;
+    }
     token = lexer.lexing();
+    stat_add(STAT_TOKENS);
     return;
 }
 
@@ -35,35 +47,49 @@ ASTPtr Parser::parsing(void) {
     this->next(); // 读入第一个token
 
     ASTPtr prog = program();
+    // 出错时不返回不完整的 AST
+    if (failed) {
+        return NULL;
+    }
     return prog;
 }
 
+// 报告语法错误，只报告第一个错误
+// 返回空指针，调用者逐层返回，解析随之停止
+ASTPtr Parser::fail(int err_no) {
+    if (failed == false) {
+        failed = true;
+        error->set_err_no(err_no);
+        error->display_err();
+    }
+    return NULL;
+}
+
 // 程序由代码片段组成，代码片段由声明与定义组成
 ASTPtr Parser::program(void) {
     ASTPtrList nodes;
-    while (is_done() == false) {
+    // 输入结束前不能有剩余的 token
+    while (match_token(Tag::END) == false) {
         if (match_token(Tag::KW_CONST)) {
             ASTPtr variable_decl = var_decl();
             if (!variable_decl) {
-                error->display_err();
-                exit(1);
+                return fail(1);
             }
             nodes.push_back(move(variable_decl));
         } else if (match_token(Tag::KW_VOID)) {
             ASTPtr func = function_def();
             if (!func) {
-                error->display_err();
-                exit(2);
+                return fail(2);
             }
             nodes.push_back(move(func));
         } else if (match_token(Tag::KW_INT)){ // var or func
             next(); // int
             if (!match_token(Tag::ID)) {
-                error->display_err();
-                exit(3);
+                return fail(3);
             }
             Id* token_casted = (Id*)token;
             string name = token_casted->name;
+            unsigned int line = token->line, col = token->col;
             next(); // id
 
             //function def
@@ -74,17 +100,16 @@ ASTPtr Parser::program(void) {
                     while (true) {
                         // TODO: only support int
                         if ((!match_token(Tag::KW_INT))) {
-                            error->display_err();
-                            exit(996);
+                            return fail(996);
                         }
                         next(); // type
                         if (!match_token(Tag::ID)) {
-                            error->display_err();
-                            exit(998);
+                            return fail(998);
                         }
                         // arg name
                         Id* token_casted = (Id*)token;
                         string arg_name = token_casted->name;
+                        unsigned int arg_line = token->line, arg_col = token->col;
                         next(); // id
                         if (match_token(Tag::LBRACKET)) // [
                         {
@@ -93,7 +118,7 @@ ASTPtr Parser::program(void) {
                             next(); // [
                             if (!match_token(Tag::RBRACKET))
                             {
-                                exit(997);
+                                return fail(997);
                             }
                             next(); // ]
                             while (match_token(Tag::LBRACKET))
@@ -102,14 +127,12 @@ ASTPtr Parser::program(void) {
                                 ASTPtr _dim = binary_add();
                                 if (!_dim)
                                 {
-                                    error->display_err();
-                                    exit(995);
+                                    return fail(995);
                                 }
                                 dim.push_back(move(_dim));
                                 if (!match_token(Tag::RBRACKET))
                                 {
-                                    error->display_err();
-                                    exit(994);
+                                    return fail(994);
                                 }
                                 next(); // ]
                             }
@@ -117,18 +140,25 @@ ASTPtr Parser::program(void) {
                         } else {
                             args.push_back(make_unique<IdAST>(arg_name, VarType::var_t, false));
                         }
+                        args.back()->set_pos(arg_line, arg_col);
                         if (!match_token(Tag::COMMA))
                             break;
                         next(); // ,
                     }
                     if (!match_token(Tag::RPAREN)) {
-                        error->display_err();
-                        exit(993);
+                        return fail(993);
                     }
                 }
                 next(); // )
+                if (!match_token(Tag::LBRACE)) {
+                    return fail(992);
+                }
                 ASTPtr body = block();
+                if (!body) {
+                    return fail(991);
+                }
                 ASTPtr func = make_unique<FuncDefAST>(Type::int_t, name, move(args), move(body));
+                func->set_pos(line, col);
                 nodes.push_back(move(func));
             } else { // var def
                 ASTPtrList varDefs;
@@ -138,11 +168,11 @@ ASTPtr Parser::program(void) {
                     next(); // [
                     ASTPtr exp = binary_add();
                     if (!exp) {
-                        exit(453);
+                        return fail(453);
                     }
                     dims.push_back(move(exp));
                     if (!match_token(Tag::RBRACKET)) {
-                        exit(454);
+                        return fail(454);
                     }
                     next(); // ]
                 }
@@ -152,11 +182,12 @@ ASTPtr Parser::program(void) {
                     var = make_unique<IdAST>(name, VarType::var_t, false);
                 else 
                     var = make_unique<IdAST>(name, VarType::array_t, false, move(dims));
+                var->set_pos(line, col);
                 if (match_token(Tag::ASSIGN)) {
                     next(); // =
                     ASTPtr init = init_val();
                     if (!init) {
-                        exit(456);
+                        return fail(456);
                     }
                     varDef = make_unique<VarDefAST>(false, move(var), move(init));
                 } else {
@@ -168,196 +199,354 @@ ASTPtr Parser::program(void) {
                     next(); // ,
                     varDef = var_def(false);
                     if (!varDef) {
-                        exit(133);
+                        return fail(133);
                     }
                     varDefs.push_back(move(varDef));
                 }
                 if (!match_token(Tag::SEMICON)) {
-                    exit(134);
+                    return fail(134);
                 }
                 ASTPtr decl = make_unique<VarDeclAST>(false, move(varDefs));
                 nodes.push_back(move(decl));
                 next(); // ;
             }
         } else {
-            error->display_err();
-            exit(233);
+            return fail(233);
         }
-    }
-    return make_unique<CompUnitAST>(move(nodes));
-}
-
-// 二元表达式
-ASTPtr Parser::binary(const function<ASTPtr()> &parser, initializer_list<Operator> ops) {
-    auto lhs = parser();
-    if (!lhs) {
-        cout << "error 100" << endl;
-        exit(100);
-    }
-    while (find(ops.begin(), ops.end(), tag_to_op(token->tag)) != ops.end()) {
-        Operator op = tag_to_op(token->tag);
-        next();
-        auto rhs = parser();
-        if (!rhs) {
-            cout << "error 101" << endl;
-            exit(101);
+        // 一个顶层单元结束
+        if (digest) {
+            unit_digests.push_back(unit_digest.hex_digest());
+            unit_digest = SHA256();
         }
-        lhs = make_unique<BinaryAST>(op, move(lhs), move(rhs));
     }
-    return lhs;
-}
-
-ASTPtr Parser::binary_relation(void){
-    return binary([this]
-                  { return binary_add(); }, {Operator::gt_op, Operator::ge_op,  Operator::le_op, Operator::le_op});
-}
-
-ASTPtr Parser::binary_eq(void){
-    return binary([this]
-                  { return binary_relation(); }, {Operator::equ_op, Operator::nequ_op});
-}
-
-ASTPtr Parser::binary_add(void){
-    return binary([this]
-                  { return binary_mul(); }, {Operator::add_op, Operator::sub_op});
-}
-
-ASTPtr Parser::binary_mul(void){
-    return binary([this]
-                  { return unary(); }, {Operator::mul_op, Operator::div_op, Operator::mod_op});
+    return make_unique<CompUnitAST>(move(nodes));
 }
 
-ASTPtr Parser::binary_and(void){
-    return binary([this]
-                  { return binary_eq(); }, {Operator::and_op});
-}
+// 表达式栈中的一项
+struct expr_item_t {
+    enum {
+        // 等待右操作数的二元运算符
+        BINARY,
+        // 等待操作数的一元运算符
+        UNARY,
+        // 左括号
+        PAREN,
+        // 函数调用，正在读实参
+        CALL,
+        // 数组下标，正在读下标
+        INDEX,
+    } kind;
+    Operator op;
+    // 二元运算符的优先级
+    int prec;
+    // 函数名或数组名
+    string name;
+    // 已读入的实参或下标
+    ASTPtrList list;
+    // 运算符、函数名或数组名所在的行列
+    unsigned int line;
+    unsigned int col;
+};
 
-ASTPtr Parser::binary_or(void){
-    return binary([this]
-                  { return binary_and(); }, {Operator::or_op});
+// 二元运算符的优先级，越大结合越紧，不是二元运算符时为 0
+static int binary_prec(Tag tag) {
+    switch (tag_to_op(tag)) {
+        case or_op:
+            return Parser::PREC_OR;
+        case and_op:
+            return Parser::PREC_AND;
+        case equ_op:
+        case nequ_op:
+            return Parser::PREC_EQ;
+        case gt_op:
+        case ge_op:
+        case lt_op:
+        case le_op:
+            return Parser::PREC_REL;
+        case add_op:
+        case sub_op:
+            return Parser::PREC_ADD;
+        case mul_op:
+        case div_op:
+        case mod_op:
+            return Parser::PREC_MUL;
+        default:
+            return 0;
+    }
 }
 
-// 一元表达式
-ASTPtr Parser::unary(void)
-{
-    if (match_token(Tag::LPAREN)) {
-        // (  EXP  )
-        next(); // 消耗左括号
-        ASTPtr exp = binary_add();
-        if (token->tag != Tag::RPAREN){
-            cout << "error 102" << endl;
-            exit(102);
-        }
-        next(); // 消耗右括号
-        return exp;
-    } else if (match_token(Tag::NUM)){
-        // NUM
-        Num* token_casted = (Num*)token;
-        ASTPtr num = make_unique<NumAST>(token_casted->val);
-        next();
-        return num;
-    } else if (match_token(Tag::ADD)){
-        // + EXP
-        next();
-        ASTPtr exp = unary();
-        if (!exp) {
-            exit(103);
+// 表达式
+// 运算符与尚未闭合的括号、函数调用、下标放在 items 中，操作数放在 operands 中，
+// 嵌套再深也不会递归。括号、实参与下标中只接受加减乘除模
+ASTPtr Parser::expression(int lowest) {
+    vector<expr_item_t> items;
+    ASTPtrList          operands;
+    // 尚未闭合的括号、函数调用与下标个数
+    size_t open = 0;
+    while (true) {
+        // 读一个操作数，之前的一元运算符、左括号、函数名与数组名入栈
+        if (match_token(Tag::LPAREN)) {
+            next(); // (
+            items.push_back({expr_item_t::PAREN, ERROR, 0, "", {}, token->line, token->col});
+            open++;
+            continue;
         }
-        return make_unique<UnaryAST>(Operator::add_op, move(exp));
-    } else if (match_token(Tag::SUB)){
-        // - EXP
-        next();
-        ASTPtr exp = unary();
-        if (!exp) {
-            exit(104);
+        else if (match_token(Tag::ADD) || match_token(Tag::SUB) ||
+                 match_token(Tag::NOT)) {
+            items.push_back({expr_item_t::UNARY, tag_to_op(token->tag), 0, "", {}, token->line, token->col});
+            next();
+            continue;
         }
-        return make_unique<UnaryAST>(Operator::sub_op, move(exp));
-    } else if (match_token(Tag::NOT)){
-        // ! EXP
-        next();
-        ASTPtr exp = unary();
-        if (!exp) {
-            exit(105);
+        else if (match_token(Tag::NUM)) {
+            Num* token_casted = (Num*)token;
+            operands.push_back(make_unique<NumAST>(token_casted->val));
+            operands.back()->set_pos(token->line, token->col);
+            next();
         }
-        return make_unique<UnaryAST>(Operator::not_op, move(exp));
-    } else if (match_token(Tag::ID)){
-        Id* token_casted = (Id*)token;
-        string id_name = token_casted->name;
-        next();
-        // Function call: Id (params)
-        if (match_token(Tag::LPAREN)) {
+        else if (match_token(Tag::ID)) {
+            Id* token_casted = (Id*)token;
+            string id_name = token_casted->name;
+            unsigned int line = token->line, col = token->col;
             next();
-            // id(): no params
-            if (match_token(Tag::RPAREN)) {
-                ASTPtr function_call = make_unique<FuncCallAST>(id_name);
-                next(); // 消耗右括号
-                return function_call;
-            } else {
-                ASTPtrList params;
-                while (true) {
-                    ASTPtr param = binary_add();
-                    if (!param) {
-                        exit(106);
-                    }
-                    params.push_back(move(param));
-                    // id(a,b,c)
-                    if (match_token(Tag::COMMA) == false) break;
+            if (match_token(Tag::LPAREN)) {
+                next(); // (
+                // id(): no params
+                if (match_token(Tag::RPAREN) == false) {
+                    items.push_back({expr_item_t::CALL, ERROR, 0, id_name, {}, line, col});
+                    open++;
+                    continue;
+                }
+                next(); // )
+                operands.push_back(make_unique<FuncCallAST>(id_name));
+            }
+            else if (match_token(Tag::LBRACKET)) {
+                next(); // [
+                items.push_back({expr_item_t::INDEX, ERROR, 0, id_name, {}, line, col});
+                open++;
+                continue;
+            }
+            else {
+                operands.push_back(make_unique<LValAST>(id_name, var_t));
+            }
+            operands.back()->set_pos(line, col);
+        }
+        else {
+            return fail(55);
+        }
+        // 得到一个操作数后归约，直到需要读下一个操作数
+        while (true) {
+            // 一元运算符只作用于紧随其后的操作数
+            while (items.empty() == false && items.back().kind == expr_item_t::UNARY) {
+                ASTPtr exp = move(operands.back());
+                operands.back() = make_unique<UnaryAST>(items.back().op, move(exp));
+                operands.back()->set_pos(items.back().line, items.back().col);
+                items.pop_back();
+            }
+            int prec = binary_prec(token->tag);
+            if (prec != 0 && prec >= (open != 0 ? PREC_ADD : lowest)) {
+                // 左结合，先归约优先级不低于它的运算符
+                while (items.empty() == false && items.back().kind == expr_item_t::BINARY &&
+                       items.back().prec >= prec) {
+                    ASTPtr rhs = move(operands.back());
+                    operands.pop_back();
+                    ASTPtr lhs = move(operands.back());
+                    operands.back() = make_unique<BinaryAST>(items.back().op, move(lhs), move(rhs));
+                    operands.back()->set_pos(items.back().line, items.back().col);
+                    items.pop_back();
+                }
+                items.push_back({expr_item_t::BINARY, tag_to_op(token->tag), prec, "", {}, token->line, token->col});
+                next();
+                break;
+            }
+            // 当前这一层结束
+            while (items.empty() == false && items.back().kind == expr_item_t::BINARY) {
+                ASTPtr rhs = move(operands.back());
+                operands.pop_back();
+                ASTPtr lhs = move(operands.back());
+                operands.back() = make_unique<BinaryAST>(items.back().op, move(lhs), move(rhs));
+                operands.back()->set_pos(items.back().line, items.back().col);
+                items.pop_back();
+            }
+            if (items.empty()) {
+                return move(operands.back());
+            }
+            expr_item_t &item = items.back();
+            if (item.kind == expr_item_t::PAREN) {
+                if (match_token(Tag::RPAREN) == false) {
+                    return fail(102);
+                }
+                next(); // )
+            }
+            else if (item.kind == expr_item_t::CALL) {
+                item.list.push_back(move(operands.back()));
+                operands.pop_back();
+                // id(a,b,c)
+                if (match_token(Tag::COMMA)) {
                     next(); // ,
+                    break;
                 }
                 if (match_token(Tag::RPAREN) == false) {
-                    exit(107);
+                    return fail(107);
                 }
                 next(); // )
-                return make_unique<FuncCallAST>(id_name, move(params));
+                operands.push_back(make_unique<FuncCallAST>(item.name, move(item.list)));
+                operands.back()->set_pos(item.line, item.col);
             }
-        } else if (match_token(Tag::LBRACKET)) { // LVal: array (id[exp])
-            ASTPtrList position;
-            while (match_token(Tag::LBRACKET)) {
-                next(); // [
-                ASTPtr sub_position = binary_add();
-                position.push_back(move(sub_position));
+            else {
+                // LVal: array (id[exp])
+                item.list.push_back(move(operands.back()));
+                operands.pop_back();
                 if (match_token(Tag::RBRACKET) == false) {
-                    exit(108);
+                    return fail(108);
                 }
-                next();
+                next(); // ]
+                if (match_token(Tag::LBRACKET)) {
+                    next(); // [
+                    break;
+                }
+                operands.push_back(make_unique<LValAST>(item.name, array_t, move(item.list)));
+                operands.back()->set_pos(item.line, item.col);
             }
-            return make_unique<LValAST>(id_name, array_t, move(position));
-        } else { // LVal: var (id)
-            return make_unique<LValAST>(id_name, var_t);
+            items.pop_back();
+            open--;
         }
     }
-    cout << "error 55" << endl;
-    exit(55);
 }
 
-ASTPtr Parser::statement(void) {
-    if (match_token(Tag::SEMICON)) {
-        next(); // ;
-        return make_unique<StmtAST>(make_unique<EmptyAST>());
+ASTPtr Parser::binary_add(void){
+    return expression(PREC_ADD);
+}
+
+ASTPtr Parser::binary_or(void){
+    return expression(PREC_OR);
+}
+
+// 语句中尚未结束的块、if 与 while
+struct stmt_frame_t {
+    enum {
+        // 块，正在读其中的语句
+        BLOCK,
+        // 正在读 then 分支
+        IF,
+        // 正在读 else 分支
+        ELSE,
+        // 正在读循环体
+        WHILE,
+    } kind;
+    // 条件
+    ASTPtr cond;
+    // then 分支
+    ASTPtr then;
+    // 块中已读入的声明与语句
+    ASTPtrList stmts;
+};
+
+// if 与 while 的条件: ( EXP )
+ASTPtr Parser::condition(void) {
+    next(); // if / while
+    if (!match_token(Tag::LPAREN)) {
+        return fail(116);
     }
-    else if (match_token(Tag::LBRACE)) {
-        ASTPtr body = block();
-        if (!body) {
-            exit(106);
-        }
-        return make_unique<StmtAST>(move(body));
+    next(); // (
+    ASTPtr cond = binary_or();
+    if (!cond) {
+        return fail(117);
     }
-    else if (match_token(Tag::KW_WHILE)) {
-        ASTPtr stmt = while_loop();
-        if (!stmt) {
-            exit(107);
-        }
-        return make_unique<StmtAST>(move(stmt));
+    if (!match_token(Tag::RPAREN)) {
+        return fail(118);
     }
-    else if (match_token(Tag::KW_IF)) {
-        ASTPtr stmt = if_else();
+    next(); // )
+    return cond;
+}
+
+// 语句
+// 块、if 与 while 的嵌套放在 frames 中，不递归；
+// body 为 true 时解析函数体，最外层的块不包装为语句
+ASTPtr Parser::statements(bool body) {
+    vector<stmt_frame_t> frames;
+    if (body) {
+        next(); // {
+        frames.push_back({stmt_frame_t::BLOCK, NULL, NULL, {}});
+    }
+    // 刚解析完的语句
+    ASTPtr stmt;
+    while (true) {
+        if (!stmt && frames.empty() == false && frames.back().kind == stmt_frame_t::BLOCK) {
+            if (match_token(Tag::RBRACE)) {
+                next(); // }
+                stmt = make_unique<BlockAST>(move(frames.back().stmts));
+                frames.pop_back();
+                if (body == false || frames.empty() == false) {
+                    stmt = make_unique<StmtAST>(move(stmt));
+                }
+            }
+            else if (match_token(Tag::KW_CONST) || match_token(Tag::KW_INT)) {
+                ASTPtr var = var_decl();
+                if (!var) {
+                    return fail(460);
+                }
+                frames.back().stmts.push_back(move(var));
+                continue;
+            }
+        }
         if (!stmt) {
-            exit(108);
+            if (match_token(Tag::LBRACE)) {
+                next(); // {
+                frames.push_back({stmt_frame_t::BLOCK, NULL, NULL, {}});
+                continue;
+            }
+            if (match_token(Tag::KW_IF) || match_token(Tag::KW_WHILE)) {
+                bool   loop = match_token(Tag::KW_WHILE);
+                ASTPtr cond = condition();
+                if (!cond) {
+                    return fail(loop ? 107 : 108);
+                }
+                frames.push_back({loop ? stmt_frame_t::WHILE : stmt_frame_t::IF, move(cond), NULL, {}});
+                continue;
+            }
+            stmt = simple_statement();
+            if (!stmt) {
+                return fail(461);
+            }
         }
-        return make_unique<StmtAST>(move(stmt));
+        // 一条语句结束，交给外层
+        if (frames.empty()) {
+            return stmt;
+        }
+        stmt_frame_t &frame = frames.back();
+        if (frame.kind == stmt_frame_t::BLOCK) {
+            frame.stmts.push_back(move(stmt));
+            continue;
+        }
+        if (frame.kind == stmt_frame_t::IF && match_token(Tag::KW_ELSE)) {
+            next(); // else
+            frame.kind = stmt_frame_t::ELSE;
+            frame.then = move(stmt);
+            continue;
+        }
+        if (frame.kind == stmt_frame_t::WHILE) {
+            stmt = make_unique<WhileAST>(move(frame.cond), move(stmt));
+        }
+        else if (frame.kind == stmt_frame_t::IF) {
+            stmt = make_unique<IfAST>(move(frame.cond), move(stmt));
+        }
+        else {
+            stmt = make_unique<IfAST>(move(frame.cond), move(frame.then), move(stmt));
+        }
+        stmt = make_unique<StmtAST>(move(stmt));
+        frames.pop_back();
+    }
+}
+
+// 不含嵌套的语句：空语句、控制语句、赋值与表达式
+ASTPtr Parser::simple_statement(void) {
+    if (match_token(Tag::SEMICON)) {
+        next(); // ;
+        return make_unique<StmtAST>(make_unique<EmptyAST>());
     }
     else if (match_token(Tag::KW_BREAK) || match_token(Tag::KW_CONTINUE) || match_token(Tag::KW_RETURN)) {
         Tag temp = token->tag;
+        unsigned int line = token->line, col = token->col;
         next();
         ASTPtr stmt;
         if (token->tag == Tag::SEMICON)
@@ -382,19 +571,20 @@ ASTPtr Parser::statement(void) {
         } else { // return exp;
             ASTPtr return_exp = binary_add();
             if (!return_exp) {
-                exit(109);
+                return fail(109);
             }
             if (!match_token(Tag::SEMICON)) {
-                exit(110);
+                return fail(110);
             }
             stmt = make_unique<ControlAST>(Control::return_c, move(return_exp));
         }
+        stmt->set_pos(line, col);
         next(); // ;
         return make_unique<StmtAST>(move(stmt));
     } else {
         ASTPtr exp = binary_add();
         if (!exp) {
-            exit(111);
+            return fail(111);
         }
         if (dynamic_cast<LValAST *>(exp.get())) {
             // LVal = exp;
@@ -402,11 +592,13 @@ ASTPtr Parser::statement(void) {
                 next(); // =
                 ASTPtr rhs = binary_add();
                 if (!rhs) {
-                    exit(112);
+                    return fail(112);
                 }
+                unsigned int line = exp->get_line(), col = exp->get_col();
                 ASTPtr stmt = make_unique<AssignAST>(move(exp), move(rhs));
+                stmt->set_pos(line, col);
                 if (!match_token(Tag::SEMICON)) {
-                    exit(113);
+                    return fail(113);
                 }
                 next(); // ;
                 return make_unique<StmtAST>(move(stmt));
@@ -415,106 +607,61 @@ ASTPtr Parser::statement(void) {
                 next(); // ;
                 return make_unique<StmtAST>(move(exp));
             } else {
-                exit(114);
+                return fail(114);
             }
         } else {
             // exp;
             if (!match_token(Tag::SEMICON)) {
-                exit(115);
+                return fail(115);
             }
             next(); // ;
             return make_unique<StmtAST>(move(exp));
         }
     }
-    exit(56);
-}
-
-ASTPtr Parser::if_else(void) {
-    next(); // if () then else
-    if (!match_token(Tag::LPAREN)) {
-        exit(116);
-    }
-    next(); // (
-    ASTPtr condition = binary_or();
-    if (!condition) {
-        exit(117);
-    }
-    if (!match_token(Tag::RPAREN)) {
-        exit(118);
-    }
-    next(); // )
-    ASTPtr thenStatement = statement();
-    if (!thenStatement) {
-        exit(118);
-    }
-    if (match_token(Tag::KW_ELSE)) {
-        next(); // else
-        ASTPtr elseStatement = statement();
-        if (!elseStatement) {
-            exit(119);
-        }
-        return make_unique<IfAST>(move(condition), move(thenStatement), move(elseStatement));
-    } else {
-        return make_unique<IfAST>(move(condition), move(thenStatement));
-    }
-    exit(57);
-}
-
-ASTPtr Parser::while_loop(void) {
-    next(); // while () stmt
-    if (!match_token(Tag::LPAREN)) {
-        exit(116);
-    }
-    next(); // (
-    ASTPtr condition = binary_or();
-    if (!condition) {
-        exit(117);
-    }
-    if (!match_token(Tag::RPAREN)) {
-        exit(118);
-    }
-    next(); // )
-    ASTPtr stmt = statement();
-    if (!stmt) {
-        exit(119);
-    }
-    return make_unique<WhileAST>(move(condition), move(stmt));
+    return fail(56);
 }
 
+// 初始值
+// 尚未闭合的 { 中已读入的初始值放在 lists 中，不递归
 ASTPtr Parser::init_val(void) {
-    if (match_token(Tag::LBRACE)) {
-        next();
-        if (match_token(Tag::RBRACE)) {
-            next();
-            return make_unique<InitValAST>(VarType::array_t, ASTPtrList{});
-        } else {
-            ASTPtrList inits;
-            while (true) {
-                ASTPtr init = init_val();
-                if (!init) {
-                    cout << "error 999" << endl;
-                    exit(999);
-                }
-                inits.push_back(move(init));
-                if (!match_token(Tag::COMMA))
-                    break;
+    vector<ASTPtrList> lists;
+    while (true) {
+        ASTPtr init;
+        if (match_token(Tag::LBRACE)) {
+            next(); // {
+            if (match_token(Tag::RBRACE) == false) {
+                lists.push_back({});
+                continue;
+            }
+            next(); // }
+            init = make_unique<InitValAST>(VarType::array_t, ASTPtrList{});
+        }
+        else {
+            ASTPtr exp = binary_add();
+            if (!exp) {
+                return fail(1000);
+            }
+            ASTPtrList expList;
+            expList.push_back(move(exp));
+            init = make_unique<InitValAST>(VarType::var_t, move(expList));
+        }
+        // 交给外层的 {}，遇到 , 时读下一个初始值
+        while (true) {
+            if (lists.empty()) {
+                return init;
+            }
+            lists.back().push_back(move(init));
+            if (match_token(Tag::COMMA)) {
                 next(); // ,
+                break;
             }
             if (!match_token(RBRACE)) {
-                exit(998);
+                return fail(998);
             }
             next(); // }
-            return make_unique<InitValAST>(VarType::array_t, move(inits));
+            init = make_unique<InitValAST>(VarType::array_t, move(lists.back()));
+            lists.pop_back();
         }
-    } else {
-        ASTPtr exp = binary_add();
-        if (!exp) {
-            cout << "error 1000" << endl;
-            exit(1000);
-        }
-        ASTPtrList expList;
-        expList.push_back(move(exp));
-        return make_unique<InitValAST>(VarType::var_t, move(expList));
     }
 }
 
@@ -527,15 +674,15 @@ ASTPtr Parser::var_decl() {
     
     // TODO: only support int here
     if (!match_token(Tag::KW_INT)) {
-        cout << "Only Support Type 'int'." << endl;
-        exit(450);
+        error->get_out() << "Only Support Type 'int'." << endl;
+        return fail(450);
     }
     next();
 
     ASTPtrList vars;
     ASTPtr varDef = var_def(isConst);
     if (!varDef) {
-        exit(451);
+        return fail(451);
     }
     vars.push_back(move(varDef));
 
@@ -543,13 +690,13 @@ ASTPtr Parser::var_decl() {
         next(); // ,
         ASTPtr varDef = var_def(isConst);
         if (!varDef) {
-            exit(451);
+            return fail(451);
         }
         vars.push_back(move(varDef));
     }
     
     if (!match_token(Tag::SEMICON)) {
-        exit(452);
+        return fail(452);
     }
     next();
     return make_unique<VarDeclAST>(isConst, move(vars));
@@ -557,21 +704,22 @@ ASTPtr Parser::var_decl() {
 
 ASTPtr Parser::var_def(bool isConst) {
     if (!match_token(Tag::ID)) {
-        exit(452);
+        return fail(452);
     }
     Id* token_casted = (Id*)token;
     string id_name = token_casted->name;
+    unsigned int line = token->line, col = token->col;
     ASTPtrList dims;
     next(); // id
     while (match_token(Tag::LBRACKET)) {
         next(); // [
         ASTPtr exp = binary_add();
         if (!exp) {
-            exit(453);
+            return fail(453);
         }
         dims.push_back(move(exp));
         if (!match_token(Tag::RBRACKET)) {
-            exit(454);
+            return fail(454);
         }
         next(); // ]
     }
@@ -580,46 +728,25 @@ ASTPtr Parser::var_def(bool isConst) {
         var = make_unique<IdAST>(id_name, VarType::var_t, isConst);
     else 
         var = make_unique<IdAST>(id_name, VarType::array_t, isConst, move(dims));
+    var->set_pos(line, col);
     if (match_token(Tag::ASSIGN)) {
         next(); // =
         ASTPtr init = init_val();
         if (!init) {
-            exit(456);
+            return fail(456);
         }
         return make_unique<VarDefAST>(isConst, move(var), move(init));
     } else {
         if (isConst) {
-            exit(457);
+            return fail(457);
         }
         return make_unique<VarDefAST>(isConst, move(var));
     }
 }
 
+// 函数体
 ASTPtr Parser::block(void) {
-    next(); // {
-    if (match_token(Tag::RBRACE)) {
-        next(); // }
-        return make_unique<BlockAST>(ASTPtrList{});
-    } else {
-        ASTPtrList stmts;
-        while (!match_token(Tag::RBRACE)) {
-            if (match_token(Tag::KW_CONST) || match_token(Tag::KW_INT)) {
-                ASTPtr var = var_decl();
-                if (!var) {
-                    exit(460);
-                }
-                stmts.push_back(move(var));
-            } else {
-                ASTPtr stmt = statement();
-                if (!stmt) {
-                    exit(461);
-                }
-                stmts.push_back(move(stmt));
-            }
-        }
-        next(); // }
-        return make_unique<BlockAST>(move(stmts));
-    }
+    return statements(true);
 }
 
 ASTPtr Parser::function_def(void) {
@@ -630,14 +757,15 @@ ASTPtr Parser::function_def(void) {
     if (match_token(Tag::KW_VOID)) type = Type::void_t;
     next(); // type
     if (!match_token(Tag::ID)) {
-        exit(999);
+        return fail(999);
     }
     // function name
     Id* token_casted = (Id*)token;
     string id_name = token_casted->name;
+    unsigned int line = token->line, col = token->col;
     next(); // id
     if (!match_token(Tag::LPAREN)) {
-        exit(998);
+        return fail(998);
     }
     next(); // (
     ASTPtrList args;
@@ -645,15 +773,16 @@ ASTPtr Parser::function_def(void) {
         while (true) {
             // TODO: only support int
             if ((!match_token(Tag::KW_INT))) {
-                exit(996);
+                return fail(996);
             }
             next(); // type
             if (!match_token(Tag::ID)) {
-                exit(998);
+                return fail(998);
             }
             // arg name
             Id* token_casted = (Id*)token;
             string arg_name = token_casted->name;
+            unsigned int arg_line = token->line, arg_col = token->col;
             next(); // id
             if (match_token(Tag::LBRACKET)) // [
             {
@@ -662,7 +791,7 @@ ASTPtr Parser::function_def(void) {
                 next(); // [
                 if (!match_token(Tag::RBRACKET))
                 {
-                    exit(997);
+                    return fail(997);
                 }
                 next(); // ]
                 while (match_token(Tag::LBRACKET))
@@ -671,12 +800,12 @@ ASTPtr Parser::function_def(void) {
                     ASTPtr _dim = binary_add();
                     if (!_dim)
                     {
-                        exit(995);
+                        return fail(995);
                     }
                     dim.push_back(move(_dim));
                     if (!match_token(Tag::RBRACKET))
                     {
-                        exit(994);
+                        return fail(994);
                     }
                     next(); // ]
                 }
@@ -684,19 +813,32 @@ ASTPtr Parser::function_def(void) {
             } else {
                 args.push_back(make_unique<IdAST>(arg_name, VarType::var_t, false));
             }
+            args.back()->set_pos(arg_line, arg_col);
             if (!match_token(Tag::COMMA))
                 break;
             next(); // ,
         }
         if (!match_token(Tag::RPAREN)) {
-            exit(993);
+            return fail(993);
         }
     }
     next(); // )
+    if (!match_token(Tag::LBRACE)) {
+        return fail(992);
+    }
     ASTPtr body = block();
-    return make_unique<FuncDefAST>(type, id_name, move(args), move(body));
+    if (!body) {
+        return fail(991);
+    }
+    ASTPtr func = make_unique<FuncDefAST>(type, id_name, move(args), move(body));
+    func->set_pos(line, col);
+    return func;
 }
 
 bool Parser::is_done(void) const {
-    return lexer.is_done();
+    return failed || lexer.is_done();
+}
+
+const vector<string> &Parser::get_unit_digests(void) const {
+    return unit_digests;
 }
\ No newline at end of file
@@ -0,0 +1,581 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// snapshot.cpp for Simple-XX/SimpleCompiler.
+
+#include "cstring"
+#include "unordered_map"
+#include "vector"
+#include "fcntl.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "unistd.h"
+#include "snapshot.h"
+
+static const char     SNAPSHOT_MAGIC[8] = "SCAST";
+static const uint32_t SNAPSHOT_ENDIAN   = 0x01020304;
+// 快照文件的扩展名
+static const string SNAPSHOT_EXT = ".ast";
+
+// 将 AST 写为快照
+// 结点按前序编号，子结点的下标在其全部写出后连续地放入下标数组
+class SnapshotWriter : public ASTWalker {
+private:
+    vector<snap_node_t> nodes;
+    vector<uint32_t>    kids;
+    string              strs;
+    // 相同的名字只保存一次
+    unordered_map<string, uint32_t> str_index;
+    // 最近写完的结点下标
+    uint32_t last;
+    // 已写出的子结点的下标，父结点结束时取出
+    vector<uint32_t> pending;
+
+    // 新建结点，下标由 local() 保存到本结点结束
+    uint32_t add(snap_kind_t kind) {
+        snap_node_t n;
+        memset(&n, 0, sizeof(n));
+        n.kind = kind;
+        n.name = SNAPSHOT_NONE;
+        nodes.push_back(n);
+        local() = nodes.size() - 1;
+        return local();
+    }
+    // 保存名字
+    uint32_t str(const string &s) {
+        auto it = str_index.find(s);
+        if (it != str_index.end()) {
+            return it->second;
+        }
+        uint32_t off = strs.size();
+        strs.append(s);
+        strs.push_back('\0');
+        str_index.emplace(s, off);
+        return off;
+    }
+    // 写出一个子结点，空指针记为 SNAPSHOT_NONE
+    // 子结点进入时才新建，下标即为当前的结点个数
+    void sub(ASTPtr &p) {
+        if (!p) {
+            pending.push_back(SNAPSHOT_NONE);
+            resume();
+            return;
+        }
+        pending.push_back(nodes.size());
+        descend(*p);
+        return;
+    }
+    // 全部 cnt 个子结点都已写出，把它们的下标连续地放入下标数组
+    void set_kids(size_t cnt) {
+        uint32_t idx       = local();
+        nodes[idx].kids    = kids.size();
+        nodes[idx].kid_cnt = cnt;
+        kids.insert(kids.end(), pending.end() - cnt, pending.end());
+        pending.resize(pending.size() - cnt);
+        last = idx;
+        return;
+    }
+    // 依次写出一组子结点
+    void list(ASTPtrList &l) {
+        if (step() < l.size()) {
+            sub(l[step()]);
+            return;
+        }
+        set_kids(l.size());
+        return;
+    }
+
+public:
+    SnapshotWriter(void) : last(SNAPSHOT_NONE) {
+        return;
+    }
+
+    void write(MetaAST &root) {
+        walk(root);
+        return;
+    }
+
+    // 按文件格式拼接
+    string finish(void) {
+        snap_header_t h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+        h.endian   = SNAPSHOT_ENDIAN;
+        h.version  = SNAPSHOT_VERSION;
+        h.root     = last;
+        h.node_off = sizeof(h);
+        h.node_cnt = nodes.size();
+        h.kid_off  = h.node_off + nodes.size() * sizeof(snap_node_t);
+        h.kid_cnt  = kids.size();
+        h.str_off  = h.kid_off + kids.size() * sizeof(uint32_t);
+        h.str_size = strs.size();
+        string out;
+        out.reserve(h.str_off + h.str_size);
+        out.append((const char *)&h, sizeof(h));
+        out.append((const char *)nodes.data(),
+                   nodes.size() * sizeof(snap_node_t));
+        out.append((const char *)kids.data(), kids.size() * sizeof(uint32_t));
+        out.append(strs);
+        return out;
+    }
+
+    void visit(CompUnitAST &ast) override {
+        if (step() == 0) {
+            add(SNAP_COMP_UNIT);
+        }
+        list(ast.get_units());
+    }
+    void visit(StmtAST &ast) override {
+        if (step() == 0) {
+            add(SNAP_STMT);
+            sub(ast.get_stmt());
+            return;
+        }
+        set_kids(1);
+    }
+    void visit(FuncDefAST &ast) override {
+        size_t cnt = ast.get_params().size();
+        if (step() == 0) {
+            uint32_t idx     = add(SNAP_FUNC_DEF);
+            nodes[idx].type  = ast.get_type();
+            nodes[idx].name  = str(ast.get_name());
+            nodes[idx].split = cnt;
+        }
+        if (step() < cnt) {
+            sub(ast.get_params()[step()]);
+        }
+        else if (step() == cnt) {
+            sub(ast.get_body());
+        }
+        else {
+            set_kids(cnt + 1);
+        }
+    }
+    void visit(FuncCallAST &ast) override {
+        if (step() == 0) {
+            nodes[add(SNAP_FUNC_CALL)].name = str(ast.get_name());
+        }
+        list(ast.get_args());
+    }
+    void visit(VarDeclAST &ast) override {
+        if (step() == 0) {
+            nodes[add(SNAP_VAR_DECL)].flags = ast.is_const();
+        }
+        list(ast.get_vars());
+    }
+    void visit(VarDefAST &ast) override {
+        switch (step()) {
+            case 0:
+                nodes[add(SNAP_VAR_DEF)].flags = ast.is_const();
+                sub(ast.get_var());
+                break;
+            case 1:
+                sub(ast.get_init());
+                break;
+            default:
+                set_kids(2);
+                break;
+        }
+    }
+    void visit(IdAST &ast) override {
+        if (step() == 0) {
+            uint32_t idx     = add(SNAP_ID);
+            nodes[idx].type  = ast.get_type();
+            nodes[idx].flags = ast.is_const();
+            nodes[idx].name  = str(ast.get_name());
+        }
+        list(ast.get_dim());
+    }
+    void visit(InitValAST &ast) override {
+        if (step() == 0) {
+            nodes[add(SNAP_INIT_VAL)].type = ast.get_type();
+        }
+        list(ast.get_values());
+    }
+    void visit(BlockAST &ast) override {
+        if (step() == 0) {
+            add(SNAP_BLOCK);
+        }
+        list(ast.get_stmts());
+    }
+    void visit(BinaryAST &ast) override {
+        switch (step()) {
+            case 0:
+                nodes[add(SNAP_BINARY)].op = ast.get_op();
+                sub(ast.get_left());
+                break;
+            case 1:
+                sub(ast.get_right());
+                break;
+            default:
+                set_kids(2);
+                break;
+        }
+    }
+    void visit(UnaryAST &ast) override {
+        if (step() == 0) {
+            nodes[add(SNAP_UNARY)].op = ast.get_op();
+            sub(ast.get_exp());
+            return;
+        }
+        set_kids(1);
+    }
+    void visit(NumAST &ast) override {
+        nodes[add(SNAP_NUM)].val = ast.get_val();
+        set_kids(0);
+    }
+    void visit(IfAST &ast) override {
+        switch (step()) {
+            case 0:
+                add(SNAP_IF);
+                sub(ast.get_cond());
+                break;
+            case 1:
+                sub(ast.get_then());
+                break;
+            case 2:
+                sub(ast.get_else());
+                break;
+            default:
+                set_kids(3);
+                break;
+        }
+    }
+    void visit(WhileAST &ast) override {
+        switch (step()) {
+            case 0:
+                add(SNAP_WHILE);
+                sub(ast.get_cond());
+                break;
+            case 1:
+                sub(ast.get_body());
+                break;
+            default:
+                set_kids(2);
+                break;
+        }
+    }
+    void visit(ControlAST &ast) override {
+        if (step() == 0) {
+            nodes[add(SNAP_CONTROL)].op = ast.get_type();
+            sub(ast.get_ret());
+            return;
+        }
+        set_kids(1);
+    }
+    void visit(AssignAST &ast) override {
+        switch (step()) {
+            case 0:
+                add(SNAP_ASSIGN);
+                sub(ast.get_left());
+                break;
+            case 1:
+                sub(ast.get_right());
+                break;
+            default:
+                set_kids(2);
+                break;
+        }
+    }
+    void visit(LValAST &ast) override {
+        if (step() == 0) {
+            uint32_t idx    = add(SNAP_LVAL);
+            nodes[idx].type = ast.get_type();
+            nodes[idx].name = str(ast.get_name());
+        }
+        list(ast.get_position());
+    }
+    void visit(EmptyAST &) override {
+        add(SNAP_EMPTY);
+        set_kids(0);
+    }
+};
+
+string snapshot_write(MetaAST &root) {
+    SnapshotWriter writer;
+    writer.write(root);
+    return writer.finish();
+}
+
+Snapshot::Snapshot(void) {
+    data   = NULL;
+    size   = 0;
+    mapped = 0;
+    header = NULL;
+    return;
+}
+
+Snapshot::~Snapshot(void) {
+    if (mapped != 0) {
+        munmap((void *)data, mapped);
+    }
+    return;
+}
+
+// 映射快照文件
+bool Snapshot::open(const string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    mapped = st.st_size;
+    return load(string_view((const char *)p, st.st_size));
+}
+
+// 使用内存中的快照
+bool Snapshot::load(string_view buf) {
+    data   = buf.data();
+    size   = buf.size();
+    header = (const snap_header_t *)data;
+    if (validate() == false) {
+        header = NULL;
+        return false;
+    }
+    return true;
+}
+
+// 检查格式，通过后访问结点时不再检查边界
+bool Snapshot::validate(void) {
+    if (size < sizeof(snap_header_t) || ((uintptr_t)data & 3) != 0) {
+        return false;
+    }
+    const snap_header_t &h = *header;
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0 ||
+        h.endian != SNAPSHOT_ENDIAN || h.version != SNAPSHOT_VERSION) {
+        return false;
+    }
+    if ((h.node_off & 3) != 0 || (h.kid_off & 3) != 0 ||
+        (uint64_t)h.node_off + (uint64_t)h.node_cnt * sizeof(snap_node_t) >
+            size ||
+        (uint64_t)h.kid_off + (uint64_t)h.kid_cnt * sizeof(uint32_t) > size ||
+        (uint64_t)h.str_off + h.str_size > size ||
+        (h.str_size != 0 && data[h.str_off + h.str_size - 1] != '\0') ||
+        h.root >= h.node_cnt) {
+        return false;
+    }
+    const uint32_t *k = (const uint32_t *)(data + h.kid_off);
+    // 每个结点最多被引用一次，根结点不被引用，否则 build 会重复展开共享的子树
+    vector<bool> referenced(h.node_cnt, false);
+    referenced[h.root] = true;
+    for (uint32_t i = 0; i < h.node_cnt; i++) {
+        const snap_node_t &n = node(i);
+        if (n.kind >= SNAP_KIND_CNT ||
+            (n.name != SNAPSHOT_NONE && n.name >= h.str_size) ||
+            (uint64_t)n.kids + n.kid_cnt > h.kid_cnt ||
+            n.split > n.kid_cnt) {
+            return false;
+        }
+        // 子结点必须在父结点之后
+        for (uint32_t j = 0; j < n.kid_cnt; j++) {
+            uint32_t kid = k[n.kids + j];
+            if (kid == SNAPSHOT_NONE) {
+                continue;
+            }
+            if (kid <= i || kid >= h.node_cnt || referenced[kid]) {
+                return false;
+            }
+            referenced[kid] = true;
+        }
+        if (validate_node(n) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 检查结点的字段与子结点是否符合对应 AST 的要求
+bool Snapshot::validate_node(const snap_node_t &n) const {
+    const uint32_t *k = kids(n);
+    // 第 i 个子结点存在且类型为 kind
+    auto is = [&](uint32_t i, snap_kind_t kind) {
+        return i < n.kid_cnt && k[i] != SNAPSHOT_NONE && node(k[i]).kind == kind;
+    };
+    // 第 i 个子结点存在
+    auto has = [&](uint32_t i) {
+        return i < n.kid_cnt && k[i] != SNAPSHOT_NONE;
+    };
+    // 全部子结点存在
+    auto all = [&](void) {
+        for (uint32_t i = 0; i < n.kid_cnt; i++) {
+            if (k[i] == SNAPSHOT_NONE) {
+                return false;
+            }
+        }
+        return true;
+    };
+    bool var_type = n.type <= VarType::var_t;
+    switch (n.kind) {
+        case SNAP_STMT:
+        case SNAP_UNARY:
+            return n.kid_cnt == 1 && has(0) &&
+                   (n.kind == SNAP_STMT || n.op <= Operator::nequ_op);
+        case SNAP_FUNC_DEF:
+            for (uint32_t i = 0; i < n.split; i++) {
+                if (is(i, SNAP_ID) == false) {
+                    return false;
+                }
+            }
+            return n.type <= Type::void_t && n.name != SNAPSHOT_NONE &&
+                   n.kid_cnt == n.split + 1 && is(n.split, SNAP_BLOCK);
+        case SNAP_VAR_DECL:
+            for (uint32_t i = 0; i < n.kid_cnt; i++) {
+                if (is(i, SNAP_VAR_DEF) == false) {
+                    return false;
+                }
+            }
+            return true;
+        case SNAP_VAR_DEF:
+            return n.kid_cnt == 2 && is(0, SNAP_ID) &&
+                   (has(1) == false || is(1, SNAP_INIT_VAL));
+        case SNAP_BINARY:
+            return n.kid_cnt == 2 && has(0) && has(1) &&
+                   n.op <= Operator::nequ_op;
+        case SNAP_WHILE:
+            return n.kid_cnt == 2 && has(0) && has(1);
+        case SNAP_ASSIGN:
+            return n.kid_cnt == 2 && is(0, SNAP_LVAL) && has(1);
+        case SNAP_IF:
+            return n.kid_cnt == 3 && has(0) && has(1);
+        case SNAP_CONTROL:
+            return n.kid_cnt == 1 && n.op <= Control::return_c;
+        case SNAP_NUM:
+        case SNAP_EMPTY:
+            return n.kid_cnt == 0;
+        case SNAP_ID:
+        case SNAP_LVAL:
+        case SNAP_FUNC_CALL:
+            return n.name != SNAPSHOT_NONE && var_type && all();
+        case SNAP_INIT_VAL:
+            return var_type && all();
+        default:
+            return all();
+    }
+}
+
+uint32_t Snapshot::node_cnt(void) const {
+    return header->node_cnt;
+}
+
+uint32_t Snapshot::root(void) const {
+    return header->root;
+}
+
+const snap_node_t &Snapshot::node(uint32_t idx) const {
+    return ((const snap_node_t *)(data + header->node_off))[idx];
+}
+
+const uint32_t *Snapshot::kids(const snap_node_t &n) const {
+    return (const uint32_t *)(data + header->kid_off) + n.kids;
+}
+
+string_view Snapshot::name(const snap_node_t &n) const {
+    if (n.name == SNAPSHOT_NONE) {
+        return string_view();
+    }
+    return string_view(data + header->str_off + n.name);
+}
+
+// 重建 AST
+// 子结点的下标大于父结点，从后向前逐个重建，不递归
+// 根结点之前的结点不在树中
+ASTPtr Snapshot::build(void) const {
+    vector<ASTPtr> built(header->node_cnt);
+    for (uint32_t i = header->node_cnt; i-- > header->root;) {
+        built[i] = build(i, built);
+    }
+    return move(built[header->root]);
+}
+
+ASTPtrList Snapshot::build_list(const uint32_t *k, uint32_t cnt,
+                                vector<ASTPtr> &built) const {
+    ASTPtrList l;
+    for (uint32_t i = 0; i < cnt; i++) {
+        l.push_back(k[i] == SNAPSHOT_NONE ? nullptr : move(built[k[i]]));
+    }
+    return l;
+}
+
+ASTPtr Snapshot::build(uint32_t idx, vector<ASTPtr> &built) const {
+    const snap_node_t &n = node(idx);
+    const uint32_t *   k = kids(n);
+    string             nm(name(n));
+    bool               is_const = n.flags & 1;
+    // 固定个数的子结点，缺少时视为空
+    auto kid = [&](uint32_t i) {
+        return i < n.kid_cnt && k[i] != SNAPSHOT_NONE ? move(built[k[i]])
+                                                      : nullptr;
+    };
+    switch (n.kind) {
+        case SNAP_COMP_UNIT:
+            return make_unique<CompUnitAST>(build_list(k, n.kid_cnt, built));
+        case SNAP_STMT:
+            return make_unique<StmtAST>(kid(0));
+        case SNAP_FUNC_DEF:
+            return make_unique<FuncDefAST>((Type)n.type, nm,
+                                           build_list(k, n.split, built),
+                                           kid(n.split));
+        case SNAP_FUNC_CALL:
+            return make_unique<FuncCallAST>(nm,
+                                            build_list(k, n.kid_cnt, built));
+        case SNAP_VAR_DECL:
+            return make_unique<VarDeclAST>(is_const,
+                                           build_list(k, n.kid_cnt, built));
+        case SNAP_VAR_DEF: {
+            ASTPtr var = kid(0);
+            return make_unique<VarDefAST>(is_const, move(var), kid(1));
+        }
+        case SNAP_ID:
+            return make_unique<IdAST>(nm, (VarType)n.type, is_const,
+                                      build_list(k, n.kid_cnt, built));
+        case SNAP_INIT_VAL:
+            return make_unique<InitValAST>((VarType)n.type,
+                                           build_list(k, n.kid_cnt, built));
+        case SNAP_BLOCK:
+            return make_unique<BlockAST>(build_list(k, n.kid_cnt, built));
+        case SNAP_BINARY: {
+            ASTPtr l = kid(0);
+            return make_unique<BinaryAST>((Operator)n.op, move(l), kid(1));
+        }
+        case SNAP_UNARY:
+            return make_unique<UnaryAST>((Operator)n.op, kid(0));
+        case SNAP_NUM:
+            return make_unique<NumAST>(n.val);
+        case SNAP_IF: {
+            ASTPtr c = kid(0);
+            ASTPtr t = kid(1);
+            return make_unique<IfAST>(move(c), move(t), kid(2));
+        }
+        case SNAP_WHILE: {
+            ASTPtr c = kid(0);
+            return make_unique<WhileAST>(move(c), kid(1));
+        }
+        case SNAP_CONTROL:
+            return make_unique<ControlAST>((Control)n.op, kid(0));
+        case SNAP_ASSIGN: {
+            ASTPtr l = kid(0);
+            return make_unique<AssignAST>(move(l), kid(1));
+        }
+        case SNAP_LVAL:
+            return make_unique<LValAST>(nm, (VarType)n.type,
+                                        build_list(k, n.kid_cnt, built));
+        default:
+            return make_unique<EmptyAST>();
+    }
+}
+
+// 是否为快照文件
+bool is_snapshot(const string &path) {
+    return path.size() > SNAPSHOT_EXT.size() &&
+           path.compare(path.size() - SNAPSHOT_EXT.size(), SNAPSHOT_EXT.size(),
+                        SNAPSHOT_EXT) == 0;
+}
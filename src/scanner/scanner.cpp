@@ -4,6 +4,8 @@
 //
 // scanner.cpp for Simple-XX/SimpleCompiler.
 
+#include "algorithm"
+#include "cstring"
 #include "scanner.h"
 #include "iostream"
 
@@ -12,6 +14,22 @@ Scanner::Scanner(const std::string &f) {
     if (fin.is_open() == false) {
         std::cout << "File not open!" << endl;
     }
+    mem          = NULL;
+    mem_size     = 0;
+    mem_pos      = 0;
+    done         = !fin.is_open();
+    prev_char    = ' ';
+    curr_char    = ' ';
+    real_buf_len = 0;
+    pos_read_buf = -1;
+    return;
+}
+
+Scanner::Scanner(const char *data, size_t size) {
+    mem          = data;
+    mem_size     = size;
+    mem_pos      = 0;
+    done         = false;
     prev_char    = ' ';
     curr_char    = ' ';
     real_buf_len = 0;
@@ -31,11 +49,22 @@ char Scanner::scan() {
     // 缓冲区已经读取完
     if (pos_read_buf == real_buf_len - 1) {
         // 重新读取
-        fin.read(scan_buf, SCAN_BUFFER);
-        // 读到了多少数据
-        real_buf_len = fin.gcount();
+        if (mem != NULL) {
+            real_buf_len = min((size_t)SCAN_BUFFER, mem_size - mem_pos);
+            memcpy(scan_buf, mem + mem_pos, real_buf_len);
+            mem_pos += real_buf_len;
+        }
+        else if (done == false) {
+            fin.read(scan_buf, SCAN_BUFFER);
+            // 读到了多少数据
+            real_buf_len = fin.gcount();
+        }
+        else {
+            real_buf_len = 0;
+        }
         // 文件读完了
         if (real_buf_len == 0) {
+            done = true;
             fin.close();
             // 重置读取位置
             pos_read_buf = -1;
@@ -50,6 +79,7 @@ char Scanner::scan() {
     curr_char = scan_buf[pos_read_buf];
     // 如果为结束符则返回
     if (curr_char == EOF) {
+        done = true;
         fin.close();
         return EOF;
     }
@@ -72,8 +102,12 @@ char Scanner::get_prev_char() {
     return prev_char;
 }
 
-// 若文件关闭则视为已完成
+// 输入读完或遇到结束符则视为已完成
 // 已完成返回 true
 bool Scanner::is_done() {
-    return !fin.is_open();
+    return done;
+}
+
+bool Scanner::is_open(void) {
+    return mem != NULL || fin.is_open();
 }
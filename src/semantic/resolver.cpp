@@ -0,0 +1,704 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// resolver.cpp for Simple-XX/SimpleCompiler.
+
+#include "resolver.h"
+
+// AST 中的类型转换为符号表中的类型
+static type_t type_to_tag(Type t) {
+    switch (t) {
+        case Type::int_t:
+            return KW_INT;
+        case Type::char_t:
+            return KW_CHAR;
+        default:
+            return KW_VOID;
+    }
+}
+
+Resolver::Resolver(SymTab &st) : symtab(st), types(st.get_types()) {
+    curr_type  = TypeTab::TYPE_NONE;
+    err_cnt    = 0;
+    curr_fun   = nullptr;
+    loop_depth = 0;
+    return;
+}
+
+Resolver::~Resolver(void) {
+    return;
+}
+
+// 报告语义错误，at 为出错的结点，给出其所在的文件与行列
+void Resolver::err(const MetaAST &at, const string &msg) {
+    error->set_err_no(ERR);
+    error->get_out() << "\033[;31mSemantic:\033[0m " << error->get_filename();
+    // 快照重建的 AST 没有位置
+    if (at.get_line() != 0) {
+        error->get_out() << ":" << at.get_line() << ":" << at.get_col();
+    }
+    error->get_out() << ": " << msg << endl;
+    err_cnt++;
+    return;
+}
+
+// 声明 SysY 运行时库函数
+void Resolver::add_runtime(void) {
+    struct runtime_fun_t {
+        const char *name;
+        type_t      type;
+        // 参数，'i' 为 int，'p' 为 int 数组
+        const char *params;
+    };
+    static const runtime_fun_t runtime[] = {
+        {"getint", KW_INT, ""},      {"getch", KW_INT, ""},
+        {"getarray", KW_INT, "p"},   {"putint", KW_VOID, "i"},
+        {"putch", KW_VOID, "i"},     {"putarray", KW_VOID, "ip"},
+        {"starttime", KW_VOID, ""},  {"stoptime", KW_VOID, ""},
+    };
+    type_id_t ptr = types.get(Type::int_t, false, {0}, true);
+    for (const auto &r : runtime) {
+        paralist_t paralist;
+        for (const char *p = r.params; *p != '\0'; p++) {
+            Variable *var = symtab.new_var(Scope_Global, true, KW_INT,
+                                           *p == 'p', "<param>", POOL_NONE);
+            var->set_type_id(*p == 'p' ? ptr : TypeTab::TYPE_INT);
+            paralist.push_back(var);
+        }
+        symtab.dec_fun(symtab.new_fun(true, r.type, r.name, paralist));
+    }
+    return;
+}
+
+// 声明一个变量
+pool_id_t Resolver::declare(IdAST &id, bool is_param) {
+    // 各维长度必须是常量，数组参数的第一维为 0
+    dims_t dims;
+    for (auto &d : id.get_dim()) {
+        int len = 0;
+        if (eval_const(symtab, d.get(), len) == false ||
+            (len <= 0 && (is_param == false || dims.empty() == false))) {
+            err(id, "array size of '" + id.get_name() +
+                "' is not a positive constant");
+            len = 1;
+        }
+        dims.push_back(len);
+    }
+    type_id_t tid = types.get(Type::int_t, id.is_const(), dims, is_param);
+    Variable *var;
+    if (id.get_type() == VarType::array_t) {
+        var = symtab.new_var(Scope_Global, false, KW_INT, id.get_name(),
+                             types.at(tid).size);
+        // 数组参数退化为指针
+        var->set_ptr_flag(is_param);
+    }
+    else {
+        var = symtab.new_var(Scope_Global, false, KW_INT, false, id.get_name(),
+                             POOL_NONE);
+    }
+    var->set_type_id(tid);
+    var->set_const_flag(id.is_const());
+    var->set_lv_flag(id.is_const() == false);
+    id.set_tid(tid);
+    if (symtab.add_var(var) == false) {
+        err(id, "redefinition of '" + id.get_name() + "'");
+        return POOL_NONE;
+    }
+    id.set_sym(var->get_id());
+    return var->get_id();
+}
+
+// 计算一个结点的值，子表达式的值已按求值顺序放在 vals 的末尾，从中取出
+// 整数运算按 32 位回绕
+static pair<bool, int> eval_node(SymTab &_symtab, MetaAST *_exp,
+                                 vector<pair<bool, int>> &_vals) {
+    if (auto num = dynamic_cast<NumAST *>(_exp)) {
+        return {true, num->get_val()};
+    }
+    if (auto unary = dynamic_cast<UnaryAST *>(_exp)) {
+        auto v = _vals.back();
+        _vals.pop_back();
+        if (v.first == false) {
+            return {false, 0};
+        }
+        switch (unary->get_op()) {
+            case Operator::sub_op:
+                return {true, (int)-(uint32_t)v.second};
+            case Operator::not_op:
+                return {true, !v.second};
+            default:
+                return v;
+        }
+    }
+    if (auto binary = dynamic_cast<BinaryAST *>(_exp)) {
+        auto rv = _vals.back();
+        _vals.pop_back();
+        auto lv = _vals.back();
+        _vals.pop_back();
+        if (lv.first == false || rv.first == false) {
+            return {false, 0};
+        }
+        int l = lv.second, r = rv.second;
+        switch (binary->get_op()) {
+            case Operator::add_op:
+                return {true, (int)((uint32_t)l + (uint32_t)r)};
+            case Operator::sub_op:
+                return {true, (int)((uint32_t)l - (uint32_t)r)};
+            case Operator::mul_op:
+                return {true, (int)((uint32_t)l * (uint32_t)r)};
+            case Operator::div_op:
+            case Operator::mod_op:
+                if (r == 0 || (l == INT32_MIN && r == -1)) {
+                    return {false, 0};
+                }
+                return {true, binary->get_op() == Operator::div_op ? l / r
+                                                                   : l % r};
+            case Operator::and_op:
+                return {true, l && r};
+            case Operator::or_op:
+                return {true, l || r};
+            case Operator::gt_op:
+                return {true, l > r};
+            case Operator::ge_op:
+                return {true, l >= r};
+            case Operator::lt_op:
+                return {true, l < r};
+            case Operator::le_op:
+                return {true, l <= r};
+            case Operator::equ_op:
+                return {true, l == r};
+            case Operator::nequ_op:
+                return {true, l != r};
+            default:
+                return {false, 0};
+        }
+    }
+    // 只有常量标量可以参与常量表达式
+    if (auto lval = dynamic_cast<LValAST *>(_exp)) {
+        if (lval->get_sym() == POOL_NONE ||
+            lval->get_position().empty() == false) {
+            return {false, 0};
+        }
+        Variable *var = _symtab.var_at(lval->get_sym());
+        if (var->get_const_flag() == false ||
+            _symtab.get_types().is_array(var->get_type_id())) {
+            return {false, 0};
+        }
+        return {true, var->get_data()};
+    }
+    return {false, 0};
+}
+
+// 用显式的栈按后序求值，子表达式先于父结点
+bool eval_const(SymTab &_symtab, MetaAST *_exp, int &_val,
+                const_memo_t *_memo) {
+    if (_memo != nullptr) {
+        auto it = _memo->find(_exp);
+        if (it != _memo->end()) {
+            _val = it->second.second;
+            return it->second.first;
+        }
+    }
+    // second 为 true 时子表达式都已求值
+    vector<pair<MetaAST *, bool>> work = {{_exp, false}};
+    vector<pair<bool, int>>       vals;
+    while (work.empty() == false) {
+        auto [exp, ready] = work.back();
+        work.pop_back();
+        if (ready == false) {
+            if (_memo != nullptr) {
+                auto hit = _memo->find(exp);
+                if (hit != _memo->end()) {
+                    vals.push_back(hit->second);
+                    continue;
+                }
+            }
+            auto unary  = dynamic_cast<UnaryAST *>(exp);
+            auto binary = dynamic_cast<BinaryAST *>(exp);
+            if (unary != nullptr || binary != nullptr) {
+                work.push_back({exp, true});
+                if (binary != nullptr) {
+                    work.push_back({binary->get_right().get(), false});
+                    work.push_back({binary->get_left().get(), false});
+                }
+                else {
+                    work.push_back({unary->get_exp().get(), false});
+                }
+                continue;
+            }
+        }
+        auto res = eval_node(_symtab, exp, vals);
+        if (_memo != nullptr) {
+            (*_memo)[exp] = res;
+        }
+        vals.push_back(res);
+    }
+    _val = vals.back().second;
+    return vals.back().first;
+}
+
+// 花括号对齐到当前层元素的边界，初始化下一层的一个子数组
+// 嵌套的花括号用显式的栈展开，resume 为子列表结束后本层继续的位置
+bool flatten_init(InitValAST &_init, const TypeInfo &_type, size_t _level,
+                  uint32_t &_pos, vector<pair<uint32_t, MetaAST *>> &_out) {
+    struct frame_t {
+        InitValAST *init;
+        size_t      level;
+        uint32_t    begin, pos, resume;
+        size_t      next;
+        bool        fit;
+    };
+    vector<frame_t> frames = {{&_init, _level, _pos, _pos, 0, 0, true}};
+    while (true) {
+        frame_t &f      = frames.back();
+        auto    &values = f.init->get_values();
+        // 本层的大小
+        uint32_t total =
+            f.level == 0 ? _type.size : _type.strides[f.level - 1];
+        bool over = f.next < values.size() && f.pos >= f.begin + total;
+        if (f.next == values.size() || over) {
+            bool     fit = f.fit && over == false;
+            uint32_t pos = f.pos;
+            frames.pop_back();
+            if (frames.empty()) {
+                _pos = pos;
+                return fit;
+            }
+            frames.back().fit = fit && frames.back().fit;
+            frames.back().pos = frames.back().resume;
+            continue;
+        }
+        auto       &v   = values[f.next++];
+        InitValAST *sub = dynamic_cast<InitValAST *>(v.get());
+        if (sub == nullptr || sub->get_type() == VarType::var_t) {
+            MetaAST *exp = sub == nullptr ? v.get() : sub->get_values()[0].get();
+            _out.push_back({f.pos++, exp});
+            continue;
+        }
+        // 标量外多余的花括号
+        if (f.level >= _type.dims.size()) {
+            f.resume = f.pos + 1;
+            frames.push_back({sub, f.level, f.pos, f.pos, 0, 0, true});
+            continue;
+        }
+        uint32_t stride = _type.strides[f.level];
+        f.pos    = f.begin + (f.pos - f.begin + stride - 1) / stride * stride;
+        f.resume = f.pos + stride;
+        frames.push_back({sub, f.level + 1, f.pos, f.pos, 0, 0, true});
+    }
+}
+
+// 要求刚分析完的表达式为标量
+void Resolver::check_scalar(MetaAST &exp) {
+    if (curr_type == TypeTab::TYPE_VOID) {
+        err(exp, "void value used as a scalar value");
+    }
+    else if (curr_type != TypeTab::TYPE_NONE && types.is_array(curr_type)) {
+        err(exp, "array '" + types.to_string(curr_type) +
+            "' used as a scalar value");
+    }
+    return;
+}
+
+// 记录对函数的引用，签名为参数与返回值的类型
+void Resolver::reference(Function *fun) {
+    string sig = "fun " + fun->get_name() + "(";
+    for (auto para : fun->get_paralist()) {
+        sig += types.to_string(para->get_type_id()) + ",";
+    }
+    sig += ")" + std::to_string(fun->get_type());
+    refs.insert(sig);
+    return;
+}
+
+// 记录对全局变量的引用，常量标量的值也是签名的一部分
+void Resolver::reference(Variable *var) {
+    if (var->get_scope() != Scope_Global) {
+        return;
+    }
+    string sig = "var " + var->get_name() + ":" +
+                 types.to_string(var->get_type_id());
+    if (var->get_const_flag() && types.is_array(var->get_type_id()) == false) {
+        sig += "=" + std::to_string(var->get_data());
+    }
+    refs.insert(sig);
+    return;
+}
+
+// 进行语义分析
+int Resolver::resolving(MetaAST &prog) {
+    add_runtime();
+    walk(prog);
+    return err_cnt;
+}
+
+const vector<string> &Resolver::get_unit_refs(void) const {
+    return unit_refs;
+}
+
+// 以下各结点按 step() 分步分析，子结点由 walk 访问
+// 表达式的子结点分析完后由 check_scalar 检查其类型
+
+void Resolver::visit(CompUnitAST &ast) {
+    auto &units = ast.get_units();
+    // 上一个单元分析完毕
+    if (step() > 0) {
+        string sig;
+        for (auto &r : refs) {
+            sig += r + ";";
+        }
+        unit_refs.push_back(sig);
+    }
+    if (step() < units.size()) {
+        refs.clear();
+        descend(*units[step()]);
+    }
+    return;
+}
+
+void Resolver::visit(StmtAST &ast) {
+    if (step() == 0) {
+        descend(*ast.get_stmt());
+    }
+    return;
+}
+
+void Resolver::visit(FuncDefAST &ast) {
+    auto  &params = ast.get_params();
+    auto  &stmts  = static_cast<BlockAST &>(*ast.get_body()).get_stmts();
+    size_t s      = step();
+    // 参数与函数体最外层的语句处于同一作用域
+    if (s == 0) {
+        fun_phase = make_unique<Phase>("resolve function", ast.get_name());
+        symtab.enter_scope();
+        paralist.clear();
+    }
+    if (s < params.size()) {
+        descend(*params[s], WALK_PARAM);
+        return;
+    }
+    if (s == params.size()) {
+        Function *fun = symtab.new_fun(false, type_to_tag(ast.get_type()),
+                                       ast.get_name(), paralist);
+        // 先登记再分析函数体，以支持递归调用
+        if (symtab.def_fun(fun) == false) {
+            err(ast, "redefinition of function '" + ast.get_name() + "'");
+        }
+        curr_fun = symtab.find_fun(ast.get_name());
+        ast.set_sym(curr_fun->get_id());
+    }
+    if (s - params.size() < stmts.size()) {
+        descend(*stmts[s - params.size()]);
+        return;
+    }
+    curr_fun = nullptr;
+    symtab.leave_scope();
+    fun_phase.reset();
+    return;
+}
+
+void Resolver::visit(FuncCallAST &ast) {
+    // 实参以传递时的类型与形参比较，类型表中相同类型的编号相同
+    // local() 记录实参与形参是否仍然匹配、实参本身是否有错误
+    Function   *fun   = symtab.find_fun(ast.get_name());
+    const auto &args  = ast.get_args();
+    uint32_t   &flags = local();
+    size_t      i     = step();
+    if (i == 0 && fun != nullptr &&
+        fun->get_paralist().size() == args.size()) {
+        flags = ARGS_MATCH;
+    }
+    // 实参本身有错误时已经报告过，不再比较参数
+    if (i > 0) {
+        if (curr_type == TypeTab::TYPE_VOID) {
+            err(*args[i - 1], "void value passed as an argument of '" +
+                                  ast.get_name() + "'");
+            flags |= ARGS_BAD;
+        }
+        else if (curr_type == TypeTab::TYPE_NONE) {
+            flags |= ARGS_BAD;
+        }
+        else if ((flags & ARGS_MATCH) &&
+                 fun->get_paralist()[i - 1]->get_type_id() !=
+                     types.decay(curr_type)) {
+            flags &= ~ARGS_MATCH;
+        }
+    }
+    if (i < args.size()) {
+        descend(*args[i]);
+        return;
+    }
+    curr_type = TypeTab::TYPE_INT;
+    if (fun == nullptr) {
+        err(ast, "undefined function '" + ast.get_name() + "'");
+        return;
+    }
+    if (fun->get_type() == KW_VOID) {
+        curr_type = TypeTab::TYPE_VOID;
+    }
+    if ((flags & ARGS_BAD) == 0 && (flags & ARGS_MATCH) == 0) {
+        err(ast, "arguments do not match parameters of '" + ast.get_name() +
+                     "'");
+        return;
+    }
+    ast.set_sym(fun->get_id());
+    reference(fun);
+    return;
+}
+
+void Resolver::visit(VarDeclAST &ast) {
+    if (step() < ast.get_vars().size()) {
+        descend(*ast.get_vars()[step()]);
+    }
+    return;
+}
+
+void Resolver::visit(VarDefAST &ast) {
+    // 变量在声明符结束后即可见，初始值中可以引用自身
+    IdAST &id = static_cast<IdAST &>(*ast.get_var());
+    if (step() == 0) {
+        descend(id);
+        return;
+    }
+    if (step() == 1 && ast.get_init()) {
+        descend(*ast.get_init());
+        return;
+    }
+    bool valid = ast.get_init() == nullptr || check_init(ast);
+    // 常量标量的值在此时折叠，供数组长度等常量表达式使用
+    if (valid && ast.is_const() && id.get_sym() != POOL_NONE &&
+        types.is_array(id.get_tid()) == false) {
+        InitValAST &init = static_cast<InitValAST &>(*ast.get_init());
+        int         val  = 0;
+        if (init.get_values().size() != 1 ||
+            eval_const(symtab, init.get_values()[0].get(), val) == false) {
+            err(id, "initializer of const '" + id.get_name() +
+                "' is not a constant");
+        }
+        symtab.var_at(id.get_sym())->set_data(val);
+    }
+    return;
+}
+
+// 检查初始化列表的形状，全局变量与常量数组的初始值还必须是常量
+// 形状不对时返回 false
+bool Resolver::check_init(VarDefAST &ast) {
+    IdAST      &id       = static_cast<IdAST &>(*ast.get_var());
+    InitValAST &init     = static_cast<InitValAST &>(*ast.get_init());
+    bool        is_array = types.is_array(id.get_tid());
+    if (is_array != (init.get_type() == VarType::array_t)) {
+        err(id, "invalid initializer of '" + id.get_name() + "'");
+        return false;
+    }
+    vector<pair<uint32_t, MetaAST *>> inits;
+    if (is_array) {
+        uint32_t pos = 0;
+        if (flatten_init(init, types.at(id.get_tid()), 0, pos, inits) ==
+            false) {
+            err(id, "excess elements in initializer of '" + id.get_name() +
+                        "'");
+        }
+    }
+    // 常量标量由调用者折叠，局部变量只有常量数组的初始值必须是常量
+    if ((ast.is_const() && is_array == false) ||
+        (curr_fun != nullptr && ast.is_const() == false)) {
+        return true;
+    }
+    if (is_array == false) {
+        inits.push_back({0, init.get_values()[0].get()});
+    }
+    for (auto &i : inits) {
+        int val = 0;
+        if (eval_const(symtab, i.second, val) == false) {
+            err(*i.second,
+                "initializer of '" + id.get_name() + "' is not a constant");
+            return true;
+        }
+    }
+    return true;
+}
+
+// 形参由 FuncDefAST 以 WALK_PARAM 访问，登记后加入参数表
+void Resolver::visit(IdAST &ast) {
+    if (step() < ast.get_dim().size()) {
+        descend(*ast.get_dim()[step()]);
+        return;
+    }
+    bool      is_param = mode() == WALK_PARAM;
+    pool_id_t sym      = declare(ast, is_param);
+    if (is_param && sym != POOL_NONE) {
+        paralist.push_back(symtab.var_at(sym));
+    }
+    return;
+}
+
+void Resolver::visit(InitValAST &ast) {
+    auto &values = ast.get_values();
+    if (step() > 0 && ast.get_type() == VarType::var_t) {
+        check_scalar(*values[step() - 1]);
+    }
+    if (step() < values.size()) {
+        descend(*values[step()]);
+    }
+    return;
+}
+
+void Resolver::visit(BlockAST &ast) {
+    if (step() == 0) {
+        symtab.enter_scope();
+    }
+    if (step() < ast.get_stmts().size()) {
+        descend(*ast.get_stmts()[step()]);
+        return;
+    }
+    symtab.leave_scope();
+    return;
+}
+
+void Resolver::visit(BinaryAST &ast) {
+    switch (step()) {
+        case 0:
+            descend(*ast.get_left());
+            break;
+        case 1:
+            check_scalar(*ast.get_left());
+            descend(*ast.get_right());
+            break;
+        default:
+            check_scalar(*ast.get_right());
+            curr_type = TypeTab::TYPE_INT;
+            break;
+    }
+    return;
+}
+
+void Resolver::visit(UnaryAST &ast) {
+    if (step() == 0) {
+        descend(*ast.get_exp());
+        return;
+    }
+    check_scalar(*ast.get_exp());
+    curr_type = TypeTab::TYPE_INT;
+    return;
+}
+
+void Resolver::visit(NumAST &) {
+    curr_type = TypeTab::TYPE_INT;
+    return;
+}
+
+void Resolver::visit(IfAST &ast) {
+    switch (step()) {
+        case 0:
+            descend(*ast.get_cond());
+            break;
+        case 1:
+            check_scalar(*ast.get_cond());
+            descend(*ast.get_then());
+            break;
+        case 2:
+            if (ast.get_else()) {
+                descend(*ast.get_else());
+            }
+            break;
+    }
+    return;
+}
+
+void Resolver::visit(WhileAST &ast) {
+    switch (step()) {
+        case 0:
+            descend(*ast.get_cond());
+            break;
+        case 1:
+            check_scalar(*ast.get_cond());
+            loop_depth++;
+            descend(*ast.get_body());
+            break;
+        default:
+            loop_depth--;
+            break;
+    }
+    return;
+}
+
+void Resolver::visit(ControlAST &ast) {
+    switch (ast.get_type()) {
+        case Control::break_c:
+        case Control::continue_c:
+            if (loop_depth == 0) {
+                err(ast, "break/continue outside of a loop");
+            }
+            break;
+        case Control::return_c:
+            if (ast.get_ret() == nullptr) {
+                break;
+            }
+            if (step() == 0) {
+                descend(*ast.get_ret());
+                break;
+            }
+            check_scalar(*ast.get_ret());
+            if (curr_fun != nullptr && curr_fun->get_type() == KW_VOID) {
+                err(ast, "void function '" + curr_fun->get_name() +
+                    "' returns a value");
+            }
+            break;
+    }
+    return;
+}
+
+void Resolver::visit(AssignAST &ast) {
+    switch (step()) {
+        case 0:
+            descend(*ast.get_left());
+            return;
+        case 1:
+            check_scalar(*ast.get_left());
+            descend(*ast.get_right());
+            return;
+    }
+    check_scalar(*ast.get_right());
+    LValAST &lval = static_cast<LValAST &>(*ast.get_left());
+    if (lval.get_sym() != POOL_NONE &&
+        symtab.var_at(lval.get_sym())->get_const_flag()) {
+        err(ast, "assignment to const '" + lval.get_name() + "'");
+    }
+    return;
+}
+
+void Resolver::visit(LValAST &ast) {
+    auto &pos = ast.get_position();
+    if (step() > 0) {
+        check_scalar(*pos[step() - 1]);
+    }
+    if (step() < pos.size()) {
+        descend(*pos[step()]);
+        return;
+    }
+    curr_type     = TypeTab::TYPE_NONE;
+    Variable *var = symtab.find_var(ast.get_name());
+    if (var == nullptr) {
+        err(ast, "undefined variable '" + ast.get_name() + "'");
+        return;
+    }
+    ast.set_sym(var->get_id());
+    reference(var);
+    // 每个下标去掉一维
+    type_id_t tid = var->get_type_id();
+    for (size_t i = 0; i < pos.size(); i++) {
+        if (types.is_array(tid) == false) {
+            err(ast,
+                "subscripted value '" + ast.get_name() + "' is not an array");
+            return;
+        }
+        tid = types.elem(tid);
+    }
+    ast.set_tid(tid);
+    curr_type = tid;
+    return;
+}
+
+void Resolver::visit(EmptyAST &) {
+    return;
+}
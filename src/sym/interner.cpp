@@ -0,0 +1,47 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// interner.cpp for Simple-XX/SimpleCompiler.
+
+#include "interner.h"
+
+static Interner default_interner;
+thread_local Interner *interner = &default_interner;
+
+Interner::Interner(void) {
+    intern("");
+    return;
+}
+
+Interner::~Interner(void) {
+    return;
+}
+
+// 驻留字符串
+name_id_t Interner::intern(std::string_view _str) {
+    auto it = ids.find(_str);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    name_id_t id = strs.size();
+    strs.emplace_back(_str);
+    ids.emplace(strs.back(), id);
+    return id;
+}
+
+// 按编号获取字符串
+const std::string &Interner::get(name_id_t _id) const {
+    return strs[_id];
+}
+
+size_t Interner::size(void) const {
+    return strs.size();
+}
+
+// 清空，之前返回的编号全部失效，NAME_EMPTY 除外
+void Interner::clear(void) {
+    ids.clear();
+    strs.clear();
+    intern("");
+    return;
+}
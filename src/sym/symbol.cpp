@@ -13,19 +13,18 @@ void Variable::set_default(void) {
     lv_flag      = true;
     literal_flag = false;
     init_flag    = false;
-    init_data    = nullptr;
+    init_data    = POOL_NONE;
     array_flag   = false;
     array_size   = 0;
     ptr_flag     = false;
-    scope.push_back(Scope_Global);
-    type        = KW_VOID;
-    name        = "default";
-    string_data = "";
-    ptr_data    = nullptr;
-    int_data    = 0;
-    char_data   = '\0';
-    size        = 0;
-    live_flag   = true;
+    scope        = Scope_Global;
+    id           = POOL_NONE;
+    tid          = TypeTab::TYPE_NONE;
+    type         = KW_VOID;
+    name         = NAME_EMPTY;
+    int_data     = 0;
+    size         = 0;
+    live_flag    = true;
     return;
 }
 
@@ -36,7 +35,7 @@ Variable::Variable(void) {
     literal_flag = false;
     ptr_flag     = true;
     type         = KW_VOID;
-    name         = "<void>";
+    name         = interner->intern("<void>");
     return;
 }
 
@@ -48,22 +47,22 @@ Variable::Variable(Token *_token) {
     switch (_token->tag) {
         case NUM:
             type     = KW_INT;
-            name     = "<int>";
+            name     = interner->intern("<int>");
             int_data = ((Num *)_token)->val;
             break;
         case CHAR:
             type      = KW_CHAR;
-            name      = "<char>";
+            name      = interner->intern("<char>");
             char_data = ((Char *)_token)->ch;
             break;
         case STR:
             type = KW_CHAR;
             // 需要由 symtab 生成一个名字以供索引
-            name        = "";
-            string_data = ((Str *)_token)->str;
+            name        = NAME_EMPTY;
+            string_data = interner->intern(((Str *)_token)->str);
             ptr_flag    = true;
             array_flag  = true;
-            array_size  = string_data.size() + 1;
+            array_size  = ((Str *)_token)->str.size() + 1;
             break;
         default:
             break;
@@ -72,13 +71,13 @@ Variable::Variable(Token *_token) {
 }
 
 // 数组
-Variable::Variable(scope_t &_scope, bool _extern_flag, type_t _type,
-                   name_t _name, size_t _array_size) {
+Variable::Variable(scope_id_t _scope, bool _extern_flag, type_t _type,
+                   const name_t &_name, uint32_t _array_size) {
     set_default();
     scope       = _scope;
     extern_flag = _extern_flag;
     type        = _type;
-    name        = _name;
+    name        = interner->intern(_name);
     array_flag  = true;
     array_size  = _array_size;
     return;
@@ -87,7 +86,7 @@ Variable::Variable(scope_t &_scope, bool _extern_flag, type_t _type,
 // 整数
 Variable::Variable(int _int_data) {
     set_default();
-    name         = "<int>";
+    name         = interner->intern("<int>");
     literal_flag = true;
     lv_flag      = false;
     type         = KW_INT;
@@ -98,7 +97,7 @@ Variable::Variable(int _int_data) {
 // 字符
 Variable::Variable(char _char_data) {
     set_default();
-    name         = "<char>";
+    name         = interner->intern("<char>");
     literal_flag = true;
     lv_flag      = false;
     type         = KW_CHAR;
@@ -107,15 +106,16 @@ Variable::Variable(char _char_data) {
 }
 
 // 一般变量
-Variable::Variable(scope_t &_scope, bool _extern_flag, type_t _type,
-                   bool _ptr_flag, name_t _name, Variable *_init_data) {
+Variable::Variable(scope_id_t _scope, bool _extern_flag, type_t _type,
+                   bool _ptr_flag, const name_t &_name, pool_id_t _init_data) {
     set_default();
     scope       = _scope;
     extern_flag = _extern_flag;
     type        = _type;
     ptr_flag    = _ptr_flag;
-    name        = _name;
+    name        = interner->intern(_name);
     init_data   = _init_data;
+    init_flag   = (_init_data != POOL_NONE);
     return;
 }
 
@@ -124,7 +124,7 @@ Variable::~Variable(void) {
 }
 
 // 是否为外部
-bool Variable::get_extern_flag(void) {
+bool Variable::get_extern_flag(void) const {
     return extern_flag;
 }
 
@@ -135,7 +135,7 @@ void Variable::set_extern_flag(bool _extern_flag) {
 }
 
 // 是否为常量
-bool Variable::get_const_flag(void) {
+bool Variable::get_const_flag(void) const {
     return const_flag;
 }
 
@@ -146,7 +146,7 @@ void Variable::set_const_flag(bool _const_flag) {
 }
 
 // 是否为指针
-bool Variable::get_ptr_flag(void) {
+bool Variable::get_ptr_flag(void) const {
     return ptr_flag;
 }
 
@@ -157,7 +157,7 @@ void Variable::set_ptr_flag(bool _ptr_flag) {
 }
 
 // 是否能作为左值
-bool Variable::get_lv_flag(void) {
+bool Variable::get_lv_flag(void) const {
     return lv_flag;
 }
 
@@ -168,7 +168,7 @@ void Variable::set_lv_flag(bool _lv_flag) {
 }
 
 // 是否为字面值
-bool Variable::get_literal_flag(void) {
+bool Variable::get_literal_flag(void) const {
     return literal_flag;
 }
 
@@ -179,7 +179,7 @@ void Variable::set_literal_flag(bool _literal_flag) {
 }
 
 // 获取类型
-type_t Variable::get_type(void) {
+type_t Variable::get_type(void) const {
     return type;
 }
 
@@ -189,22 +189,60 @@ void Variable::set_type(type_t _new_type) {
     return;
 }
 
+// 获取类型编号
+type_id_t Variable::get_type_id(void) const {
+    return tid;
+}
+
+// 设置类型编号
+void Variable::set_type_id(type_id_t _tid) {
+    tid = _tid;
+    return;
+}
+
+// 获取数据
+data_t Variable::get_data(void) const {
+    return int_data;
+}
+
+// 设置数据
+void Variable::set_data(data_t _new_data) {
+    int_data = _new_data;
+    return;
+}
+
 // 获取变量名
-name_t Variable::get_name(void) {
+const name_t &Variable::get_name(void) const {
+    return interner->get(name);
+}
+
+// 获取变量名编号
+name_id_t Variable::get_name_id(void) const {
     return name;
 }
 
 // 获取作用域
-scope_t Variable::get_scope(void) {
+scope_id_t Variable::get_scope(void) const {
     return scope;
 }
 
 // 设置作用域
-void Variable::set_scope(scope_t _new_scope) {
+void Variable::set_scope(scope_id_t _new_scope) {
     scope = _new_scope;
     return;
 }
 
+// 获取在变量池中的下标
+pool_id_t Variable::get_id(void) const {
+    return id;
+}
+
+// 设置在变量池中的下标
+void Variable::set_id(pool_id_t _id) {
+    id = _id;
+    return;
+}
+
 // 输出变量信息
 void Variable::to_string(std::string &_str) {
     if (extern_flag) {
@@ -214,7 +252,7 @@ void Variable::to_string(std::string &_str) {
     if (ptr_flag) {
         _str += " * ";
     }
-    _str += name;
+    _str += get_name();
     if (array_flag) {
         _str += " [";
         _str += std::to_string(array_size);
@@ -228,7 +266,7 @@ void Variable::to_string(std::string &_str) {
                 break;
             case KW_CHAR:
                 if (ptr_flag) {
-                    _str += string_data;
+                    _str += interner->get(string_data);
                 }
                 else {
                     _str += std::to_string(char_data);
@@ -240,23 +278,24 @@ void Variable::to_string(std::string &_str) {
     }
     _str += ";";
     _str += " size = ";
-    _str += size;
+    _str += std::to_string(size);
     _str += " scope = ";
-    for (auto i : scope) {
-        _str += i;
-        _str += "/";
-    }
+    _str += std::to_string(scope);
 
     return;
 }
 
 // 外部标识，返回类型，函数名，参数列表
-Function::Function(bool _extern_flag, type_t _type, name_t _name,
+Function::Function(bool _extern_flag, type_t _type, const name_t &_name,
                    paralist_t &_paralist) {
     extern_flag = _extern_flag;
+    ptr_flag    = false;
     type        = _type;
-    name        = _name;
+    name        = interner->intern(_name);
+    id          = POOL_NONE;
     paralist    = _paralist;
+    stack_size  = 0;
+    esp         = 0;
     return;
 }
 
@@ -282,7 +321,7 @@ bool Function::match(Function *_fun) {
     // 参数类型匹配
     size_t len = paralist.size();
     for (size_t i = 0; i < len; i++) {
-        if (0) {
+        if (paralist[i]->get_type_id() != _fun->paralist[i]->get_type_id()) {
             return false;
         }
     }
@@ -299,10 +338,10 @@ bool Function::match(paralist_t &_paralist) {
     if (paralist.size() != _paralist.size()) {
         return false;
     }
-    // 检查参数类型
+    // 检查参数类型，类型表中相同类型的编号相同
     size_t len = paralist.size();
     for (size_t i = 0; i < len; i++) {
-        if (0) {
+        if (paralist[i]->get_type_id() != _paralist[i]->get_type_id()) {
             return false;
         }
     }
@@ -310,7 +349,7 @@ bool Function::match(paralist_t &_paralist) {
 }
 
 // 是否为外部
-bool Function::get_extern_flag(void) {
+bool Function::get_extern_flag(void) const {
     return extern_flag;
 }
 
@@ -321,7 +360,7 @@ void Function::set_extern_flag(bool _extern_flag) {
 }
 
 // 是否为指针
-bool Function::get_ptr_flag(void) {
+bool Function::get_ptr_flag(void) const {
     return ptr_flag;
 }
 
@@ -332,21 +371,48 @@ void Function::set_ptr_flag(bool _ptr_flag) {
 }
 
 // 获取类型
-type_t Function::get_type(void) {
+type_t Function::get_type(void) const {
     return type;
 }
 
+// 设置类型
+void Function::set_type(type_t _new_type) {
+    type = _new_type;
+    return;
+}
+
 // 获取变量名
-name_t Function::get_name(void) {
+const name_t &Function::get_name(void) const {
+    return interner->get(name);
+}
+
+// 获取变量名编号
+name_id_t Function::get_name_id(void) const {
     return name;
 }
 
+// 获取在函数池中的下标
+pool_id_t Function::get_id(void) const {
+    return id;
+}
+
+// 设置在函数池中的下标
+void Function::set_id(pool_id_t _id) {
+    id = _id;
+    return;
+}
+
+// 获取参数表
+const paralist_t &Function::get_paralist(void) const {
+    return paralist;
+}
+
 void Function::to_string(std::string &_str) {
     if (extern_flag) {
         _str += "extern ";
     }
     _str += tokenName[type];
-    _str += name;
+    _str += get_name();
     _str += "(";
     for (size_t i = 0; i < paralist.size(); i++) {
         _str += paralist[i]->get_name();
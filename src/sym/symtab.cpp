@@ -8,8 +8,10 @@
 #include "symtab.h"
 
 SymTab::SymTab(void) {
-    curr_fun = nullptr;
+    curr_fun  = nullptr;
+    scope_cnt = Scope_Global;
     curr_scope.push_back(Scope_Global);
+    scopes.push_back(scopevars_t());
     return;
 }
 
@@ -17,39 +19,69 @@ SymTab::~SymTab(void) {
     return;
 }
 
+// 进入作用域
+void SymTab::enter_scope(void) {
+    curr_scope.push_back(++scope_cnt);
+    scopes.push_back(scopevars_t());
+    return;
+}
+
+// 退出作用域
+void SymTab::leave_scope(void) {
+    // 全局作用域不能退出
+    if (scopes.size() <= 1) {
+        error->set_err_no(ERR);
+        error->display_err();
+        return;
+    }
+    // 本作用域声明的变量一定位于各自遮蔽链的末尾
+    for (auto list : scopes.back()) {
+        list->pop_back();
+    }
+    scopes.pop_back();
+    curr_scope.pop_back();
+    return;
+}
+
+// 获取当前作用域
+const scope_t &SymTab::get_scope(void) const {
+    return curr_scope;
+}
+
+// 获取类型表
+TypeTab &SymTab::get_types(void) {
+    return types;
+}
+
+// 按下标获取变量
+Variable *SymTab::var_at(pool_id_t _id) const {
+    return var_pool.get(_id);
+}
+
+// 按下标获取函数
+Function *SymTab::fun_at(pool_id_t _id) const {
+    return fun_pool.get(_id);
+}
+
 // 添加变量
-void SymTab::add_var(Variable *_var) {
-    // 如果当前变量表中没有同名变量
-    if (vartab.find(_var->get_name()) == vartab.end()) {
-        // 添加链表
-        vartab[_var->get_name()] = new vars_t;
-        // 添加链表元素
-        vartab[_var->get_name()]->push_back(_var);
-        // 添加顺序
+bool SymTab::add_var(Variable *_var) {
+    auto res = vartab.emplace(_var->get_name(), vars_t());
+    // 如果当前变量表中没有同名变量，添加顺序
+    if (res.second) {
         varlist.push_back(_var->get_name());
     }
-    // 如果有
-    else {
-        // 先判断同作用域下有无冲突
-        vars_t &list = *vartab[_var->get_name()];
-        size_t  i    = 0;
-        for (; i < list.size(); i++) {
-            // 有冲突
-            if (list[i]->get_scope().back() == _var->get_scope().back()) {
-                break;
-            }
-        }
-        // 查完了或者 _var 为匿名对象，则没有冲突
-        if (i == list.size() || _var->get_name()[0] == '<') {
-            list.push_back(_var);
-        }
-        // 出现冲突
-        else {
-            error->set_err_no(ERR);
-            error->display_err();
-        }
+    vars_t &list = res.first->second;
+    // 作用域编号唯一，与链末尾的编号相同即为同一作用域内的重复定义
+    // _var 为匿名对象时没有冲突
+    if (list.empty() == false &&
+        list.back()->get_scope() == (scope_id_t)curr_scope.back() &&
+        _var->get_name()[0] != '<') {
+        return false;
     }
-    return;
+    _var->set_scope(curr_scope.back());
+    list.push_back(_var);
+    scopes.back().push_back(&list);
+    return true;
 }
 
 // 添加字符串
@@ -59,29 +91,24 @@ void SymTab::add_str(Variable *_var) {
 }
 
 // 获取变量
-Variable *SymTab::get_var(name_t _name) {
-    Variable *var = nullptr;
-    // 首先寻找有没有
-    if (vartab.find(_name) != vartab.end()) {
-        vars_t &list        = *vartab[_name];
-        size_t  scope_depth = curr_scope.size();
-        size_t  maxlen      = 0;
-        for (size_t i = 0; i < list.size(); i++) {
-            size_t len = list[i]->get_scope().size();
-            if ((len <= scope_depth) &&
-                (list[i]->get_scope()[len - 1] == curr_scope[len - 1])) {
-                if (len > maxlen) {
-                    maxlen = len;
-                    var    = list[i];
-                }
-            }
-        }
+Variable *SymTab::get_var(const name_t &_name) {
+    auto it = vartab.find(_name);
+    // 遮蔽链末尾即为最内层可见的变量
+    if (it != vartab.end() && it->second.empty() == false) {
+        return it->second.back();
     }
-    else {
-        error->set_err_no(ERR);
-        error->display_err();
+    error->set_err_no(ERR);
+    error->display_err();
+    return nullptr;
+}
+
+// 按名字查找变量
+Variable *SymTab::find_var(const name_t &_name) const {
+    auto it = vartab.find(_name);
+    if (it == vartab.end() || it->second.empty()) {
+        return nullptr;
     }
-    return var;
+    return it->second.back();
 }
 
 // 声明函数
@@ -101,11 +128,10 @@ void SymTab::dec_fun(Function *_fun) {
 }
 
 // 定义函数
-void SymTab::def_fun(Function *_fun) {
+bool SymTab::def_fun(Function *_fun) {
     // 定义不能有 extern
     if (_fun->get_extern_flag()) {
-        error->set_err_no(ERR);
-        error->display_err();
+        return false;
     }
     // 没有同名函数
     if (funtab.find(_fun->get_name()) == funtab.end()) {
@@ -118,17 +144,20 @@ void SymTab::def_fun(Function *_fun) {
         if (fun->get_extern_flag()) {
             // 声明与定义不匹配
             if (fun->match(_fun) == false) {
-                error->set_err_no(ERR);
-                error->display_err();
+                return false;
             }
             fun->define(_fun);
         }
+        // 重复定义
+        else {
+            return false;
+        }
     }
-    return;
+    return true;
 }
 
 // 获取函数
-Function *SymTab::get_fun(name_t _name, paralist_t &_paralist) {
+Function *SymTab::get_fun(const name_t &_name, paralist_t &_paralist) {
     Function *fun = nullptr;
     if (funtab.find(_name) != funtab.end()) {
         fun = funtab[_name];
@@ -144,3 +173,9 @@ Function *SymTab::get_fun(name_t _name, paralist_t &_paralist) {
     }
     return fun;
 }
+
+// 按名字查找函数
+Function *SymTab::find_fun(const name_t &_name) const {
+    auto it = funtab.find(_name);
+    return it == funtab.end() ? nullptr : it->second;
+}
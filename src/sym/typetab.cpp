@@ -0,0 +1,98 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// typetab.cpp for Simple-XX/SimpleCompiler.
+
+#include "typetab.h"
+
+TypeTab::TypeTab(void) {
+    // 编号与 TYPE_VOID/TYPE_INT/TYPE_CONST_INT 对应
+    get(Type::void_t, false);
+    get(Type::int_t, false);
+    get(Type::int_t, true);
+    return;
+}
+
+TypeTab::~TypeTab(void) {
+    return;
+}
+
+// 获取类型编号
+type_id_t TypeTab::get(Type _base, bool _const, const dims_t &_dims,
+                       bool _param) {
+    // 标量不区分是否为参数
+    _param = _param && (_dims.empty() == false);
+    // 编码：基本类型、标志位、各维长度
+    std::string key;
+    key.push_back((char)_base);
+    key.push_back((char)(_const | (_param << 1)));
+    key.append((const char *)_dims.data(), _dims.size() * sizeof(uint32_t));
+    auto it = index.find(key);
+    if (it != index.end()) {
+        return it->second;
+    }
+    TypeInfo info;
+    info.base       = _base;
+    info.const_flag = _const;
+    info.param_flag = _param;
+    info.dims       = _dims;
+    info.strides.resize(_dims.size());
+    uint32_t stride = 1;
+    for (size_t i = _dims.size(); i > 0; i--) {
+        info.strides[i - 1] = stride;
+        stride *= _dims[i - 1];
+    }
+    info.size = info.param_flag ? 0 : stride;
+    info.elem = TYPE_NONE;
+    if (_dims.empty() == false) {
+        info.elem = get(_base, _const, dims_t(_dims.begin() + 1, _dims.end()));
+    }
+    type_id_t id = types.size();
+    types.push_back(std::move(info));
+    index.emplace(std::move(key), id);
+    return id;
+}
+
+// 获取类型信息
+const TypeInfo &TypeTab::at(type_id_t _id) const {
+    return types[_id];
+}
+
+// 去掉第一维后的类型
+type_id_t TypeTab::elem(type_id_t _id) const {
+    return types[_id].elem;
+}
+
+// 作为实参传递时的类型
+type_id_t TypeTab::decay(type_id_t _id) {
+    const TypeInfo &info = types[_id];
+    if (info.dims.empty()) {
+        return get(info.base, false);
+    }
+    dims_t dims = info.dims;
+    dims[0]     = 0;
+    return get(info.base, false, dims, true);
+}
+
+// 是否为数组
+bool TypeTab::is_array(type_id_t _id) const {
+    return types[_id].dims.empty() == false;
+}
+
+size_t TypeTab::size(void) const {
+    return types.size();
+}
+
+// 输出类型
+std::string TypeTab::to_string(type_id_t _id) const {
+    if (_id == TYPE_NONE) {
+        return "ERROR";
+    }
+    const TypeInfo &info = types[_id];
+    std::string     str  = info.const_flag ? "const " : "";
+    str += type_to_string(info.base);
+    for (auto d : info.dims) {
+        str += d == 0 ? "[]" : "[" + std::to_string(d) + "]";
+    }
+    return str;
+}
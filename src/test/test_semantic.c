@@ -0,0 +1,47 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// test_semantic.c for Simple-XX/SimpleCompiler.
+
+// 全局常量与变量
+const int N = 4;
+int buf[4][4];
+int count;
+
+// 数组参数与递归
+int sum(int a[], int n) {
+    if (n == 0)
+        return 0;
+    return a[n - 1] + sum(a, n - 1);
+}
+
+void fill(int a[][4], int v) {
+    int i = 0;
+    while (N > i) {
+        int j = 0;
+        while (N > j) {
+            a[i][j] = v + i * N + j;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+}
+
+int main() {
+    int count = 0;
+    fill(buf, 1);
+    {
+        // 遮蔽外层的 count
+        int count = sum(buf[1], N);
+        putint(count);
+        putch(10);
+    }
+    while (count >= 0) {
+        count = count - 1;
+        if (count == -1)
+            break;
+    }
+    putint(count);
+    putch(10);
+    return 0;
+}
@@ -0,0 +1,646 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// difftest.cpp for Simple-XX/SimpleCompiler.
+
+// 差分测试
+// 用 sysygen 按种子生成程序，在每个执行引擎与优化级别下编译运行，
+// 比较输出与退出码。与第一个引擎不一致的程序保存到输出目录，
+// 并按行做 delta debugging，得到仍然不一致的最小程序
+// 每个程序在子进程中编译运行，编译器崩溃、超时都不会影响测试本身
+
+#include "algorithm"
+#include "cstdio"
+#include "cstdlib"
+#include "cstring"
+#include "fstream"
+#include "functional"
+#include "iostream"
+#include "sstream"
+#include "string"
+#include "vector"
+#include "fcntl.h"
+#include "signal.h"
+#include "unistd.h"
+#include "sys/stat.h"
+#include "sys/wait.h"
+#include "a64sim.h"
+#include "bytecode.h"
+#include "driver.h"
+#include "ir_interp.h"
+#include "rvsim.h"
+#include "x86.h"
+
+using namespace std;
+
+// 运行结果
+struct outcome_t {
+    // 0 为正常结束，1 为编译错误，2 为运行时错误，3 为超时或崩溃
+    int    status;
+    int    code;
+    string output;
+    bool   operator==(const outcome_t &o) const {
+        return status == o.status && code == o.code && output == o.output;
+    }
+};
+
+static const char *status_names[] = {"ok", "compile error", "trap", "crash"};
+
+// 执行引擎
+struct engine_t {
+    const char *name;
+    // 编译并运行 src，返回结果
+    outcome_t (*run)(const string &src, int level);
+    // 传给 run 的优化级别
+    int level;
+};
+
+// 解释器执行的指令条数上限，防止约简时产生死循环
+static uint64_t step_limit = 50000000;
+// 宿主 C 编译器，--engines 中给出 cc 而未指定时使用 cc
+static string host_cc = "";
+// 工作目录
+static string work_dir = "/tmp/difftest";
+// LLVM 工具所在目录，为空时从 PATH 中查找
+static string llvm_bin = "";
+// 传给 opt 与 llc 的选项，LLVM 15 与 16 需要 -opaque-pointers=0 才能读入带类型的指针
+static string llvm_flags = "";
+
+// 三地址码解释器
+static outcome_t run_ir(const string &src, int level) {
+    outcome_t res = {1, 0, ""};
+    IRModule  module;
+    if (compile_module(src, module, level) != 0) {
+        return res;
+    }
+    istringstream in("");
+    ostringstream out;
+    IRInterp      interp(module, in, out);
+    interp.set_step_limit(step_limit);
+    res.code   = interp.run();
+    res.output = out.str();
+    res.status = interp.get_trap().empty() ? 0 : 2;
+    return res;
+}
+
+// SysY 运行时库，供宿主编译器使用
+static const char *prelude =
+    "#include <stdio.h>\n"
+    "int getint(){int x=0;scanf(\"%d\",&x);return x;}\n"
+    "int getch(){return getchar();}\n"
+    "int getarray(int a[]){int n=0;scanf(\"%d\",&n);"
+    "for(int i=0;i<n;i++)scanf(\"%d\",&a[i]);return n;}\n"
+    "void putint(int x){printf(\"%d\",x);}\n"
+    "void putch(int c){putchar(c);}\n"
+    "void putarray(int n,int a[]){printf(\"%d:\",n);"
+    "for(int i=0;i<n;i++)printf(\" %d\",a[i]);printf(\"\\n\");}\n"
+    "void starttime(){}\n"
+    "void stoptime(){}\n"
+    "#line 1\n";
+
+// 运行链接好的程序，结果的判定与 cc 引擎相同
+static outcome_t run_binary(const string &bin, const string &base) {
+    outcome_t     res    = {2, 0, ""};
+    int           status = system((bin + " </dev/null >" + base + ".out").c_str());
+    ifstream      fin(base + ".out");
+    ostringstream ss;
+    ss << fin.rdbuf();
+    res.output = ss.str();
+    if (WIFEXITED(status) && WEXITSTATUS(status) < 128) {
+        res.status = 0;
+        res.code   = WEXITSTATUS(status);
+    }
+    remove((base + ".out").c_str());
+    return res;
+}
+
+// 宿主 C 编译器，作为参考实现
+static outcome_t run_cc(const string &src, int level) {
+    outcome_t res  = {1, 0, ""};
+    string    base = work_dir + "/cc_" + to_string(getpid());
+    {
+        ifstream      fin(src);
+        ofstream      fout(base + ".cpp");
+        ostringstream ss;
+        ss << fin.rdbuf();
+        fout << prelude << ss.str();
+    }
+    string cmd = host_cc + " -x c++ -w -fwrapv -O" + to_string(level) + " -o " +
+                 base + ".bin " + base + ".cpp >/dev/null 2>&1";
+    if (system(cmd.c_str()) != 0) {
+        return res;
+    }
+    res = run_binary(base + ".bin", base);
+    remove((base + ".cpp").c_str());
+    remove((base + ".bin").c_str());
+    return res;
+}
+
+// x86-64 后端，目标文件与 C 写的运行时库链接
+static outcome_t run_x86(const string &src, int level) {
+    outcome_t res  = {1, 0, ""};
+    string    base = work_dir + "/x86_" + to_string(getpid());
+    IRModule  module;
+    if (compile_module(src, module, level) != 0) {
+        return res;
+    }
+    {
+        ofstream fobj(base + ".o", ios::out | ios::binary | ios::trunc);
+        fobj << x86_emit(module);
+        ofstream frt(base + ".rt.c");
+        frt << prelude;
+    }
+    string cc  = host_cc.empty() ? "cc" : host_cc;
+    string cmd = cc + " -w -o " + base + ".bin " + base + ".o -x c " + base +
+                 ".rt.c >/dev/null 2>&1";
+    if (system(cmd.c_str()) == 0) {
+        res = run_binary(base + ".bin", base);
+    }
+    else {
+        res.status = 3;
+    }
+    remove((base + ".o").c_str());
+    remove((base + ".rt.c").c_str());
+    remove((base + ".bin").c_str());
+    return res;
+}
+
+// RV64IM 后端，在内置的模拟器中运行
+static outcome_t run_rv64(const string &src, int level) {
+    outcome_t res = {1, 0, ""};
+    IRModule  module;
+    RVProgram prog;
+    RVImage   image;
+    string    err;
+    if (compile_module(src, module, level) != 0) {
+        return res;
+    }
+    riscv_lower(module, prog);
+    if (riscv_link(prog, image, err) == false) {
+        return res;
+    }
+    istringstream in("");
+    ostringstream out;
+    RVSim         sim(image, in, out);
+    sim.set_step_limit(step_limit);
+    res.code   = sim.run();
+    res.output = out.str();
+    res.status = sim.get_trap().empty() ? 0 : 2;
+    return res;
+}
+
+// AArch64 后端，在内置的模拟器中运行
+static outcome_t run_a64(const string &src, int level) {
+    outcome_t  res = {1, 0, ""};
+    IRModule   module;
+    A64Program prog;
+    A64Image   image;
+    string     err;
+    if (compile_module(src, module, level) != 0) {
+        return res;
+    }
+    aarch64_lower(module, prog);
+    if (aarch64_link(prog, image, err) == false) {
+        return res;
+    }
+    istringstream in("");
+    ostringstream out;
+    A64Sim        sim(image, in, out);
+    sim.set_step_limit(step_limit);
+    res.code   = sim.run();
+    res.output = out.str();
+    res.status = sim.get_trap().empty() ? 0 : 2;
+    return res;
+}
+
+// 字节码，写出后重新读入，在虚拟机中运行
+static outcome_t run_bc(const string &src, int level) {
+    outcome_t res = {1, 0, ""};
+    IRModule  module;
+    BCModule  bc;
+    BCModule  loaded;
+    string    err;
+    if (compile_module(src, module, level) != 0) {
+        return res;
+    }
+    bc_lower(module, bc);
+    if (bc_read(bc_write(bc), loaded, err) == false) {
+        return res;
+    }
+    istringstream in("");
+    ostringstream out;
+    BCVM          vm(loaded, in, out);
+    vm.set_step_limit(step_limit);
+    res.code   = vm.run();
+    res.output = out.str();
+    res.status = vm.get_trap().empty() ? 0 : 2;
+    return res;
+}
+
+// LLVM IR 后端，由 opt 优化、llc 生成目标文件后与 C 写的运行时库链接
+static outcome_t run_llvm(const string &src, int level) {
+    outcome_t res  = {1, 0, ""};
+    string    base = work_dir + "/llvm_" + to_string(getpid());
+    string    ir;
+    if (compile_llvm(src, ir) != 0) {
+        return res;
+    }
+    {
+        ofstream fll(base + ".ll");
+        fll << ir;
+        ofstream frt(base + ".rt.c");
+        frt << prelude;
+    }
+    string bin = llvm_bin.empty() ? "" : llvm_bin + "/";
+    string lvl = " -O" + to_string(level) + " ";
+    string in  = base + ".ll";
+    string cmd = "";
+    if (level > 0) {
+        cmd = bin + "opt " + llvm_flags + lvl + in + " -o " + base + ".bc && ";
+        in  = base + ".bc";
+    }
+    string cc = host_cc.empty() ? "cc" : host_cc;
+    cmd += bin + "llc " + llvm_flags + lvl +
+           "-relocation-model=pic -filetype=obj -o " + base + ".o " + in +
+           " && " + cc + " -w -o " + base + ".bin " + base + ".o -x c " + base +
+           ".rt.c >/dev/null 2>&1";
+    if (system(cmd.c_str()) == 0) {
+        res = run_binary(base + ".bin", base);
+    }
+    else {
+        res.status = 3;
+    }
+    remove((base + ".ll").c_str());
+    remove((base + ".bc").c_str());
+    remove((base + ".o").c_str());
+    remove((base + ".rt.c").c_str());
+    remove((base + ".bin").c_str());
+    return res;
+}
+
+// 全部引擎，第一个为参考
+// 原生后端加入后在此登记
+static const engine_t all_engines[] = {
+    {"ir-O0", run_ir, 0},
+    {"ir-O1", run_ir, 1},
+    {"ir-O2", run_ir, 2},
+    {"x86-O0", run_x86, 0},
+    {"x86-O2", run_x86, 2},
+    {"rv64-O0", run_rv64, 0},
+    {"rv64-O2", run_rv64, 2},
+    {"a64-O0", run_a64, 0},
+    {"a64-O2", run_a64, 2},
+    {"bc-O0", run_bc, 0},
+    {"bc-O2", run_bc, 2},
+    {"llvm-O0", run_llvm, 0},
+    {"llvm-O2", run_llvm, 2},
+    {"cc", run_cc, 1},
+};
+
+// 参与测试的引擎
+static vector<const engine_t *> engines;
+// 每个程序的时间上限，单位为秒
+static unsigned time_limit = 20;
+
+static bool write_all(int fd, const string &data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+// 在子进程中运行全部引擎
+static vector<outcome_t> evaluate(const string &src) {
+    vector<outcome_t> res(engines.size(), outcome_t{3, 0, ""});
+    int               fds[2];
+    if (pipe(fds) != 0) {
+        return res;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        // 编译器的诊断信息不需要
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, 1);
+        alarm(time_limit);
+        for (auto e : engines) {
+            outcome_t o = e->run(src, e->level);
+            string    head = to_string(o.status) + " " + to_string(o.code) +
+                          " " + to_string(o.output.size()) + "\n";
+            write_all(fds[1], head + o.output);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    string data;
+    char   buf[4096];
+    for (ssize_t n; (n = read(fds[0], buf, sizeof(buf))) > 0;) {
+        data.append(buf, n);
+    }
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    // 子进程中途退出时，之后的引擎记为崩溃
+    size_t pos = 0;
+    for (size_t i = 0; i < engines.size(); i++) {
+        size_t eol = data.find('\n', pos);
+        if (eol == string::npos) {
+            break;
+        }
+        int    status, code;
+        size_t len;
+        if (sscanf(data.c_str() + pos, "%d %d %zu", &status, &code, &len) !=
+                3 ||
+            eol + 1 + len > data.size()) {
+            break;
+        }
+        res[i] = {status, code, data.substr(eol + 1, len)};
+        pos    = eol + 1 + len;
+    }
+    return res;
+}
+
+// 与参考不一致的引擎，参考本身必须正常结束
+static vector<size_t> mismatches(const vector<outcome_t> &res) {
+    vector<size_t> bad;
+    if (res[0].status != 0) {
+        return bad;
+    }
+    for (size_t i = 1; i < res.size(); i++) {
+        if ((res[i] == res[0]) == false) {
+            bad.push_back(i);
+        }
+    }
+    return bad;
+}
+
+static void write_file(const string &path, const vector<string> &lines) {
+    ofstream fout(path, ios::out | ios::trunc);
+    for (auto &l : lines) {
+        fout << l << "\n";
+    }
+    return;
+}
+
+// 删除整个花括号块：函数、循环、分支与语句块
+static bool reduce_blocks(vector<string> &cur,
+                          const function<bool(const vector<string> &)> &test) {
+    bool reduced = false;
+    for (size_t i = 0; i < cur.size(); i++) {
+        if (cur[i].empty() || cur[i].back() != '{') {
+            continue;
+        }
+        size_t j     = i;
+        long   depth = 0;
+        for (; j < cur.size(); j++) {
+            depth += count(cur[j].begin(), cur[j].end(), '{');
+            depth -= count(cur[j].begin(), cur[j].end(), '}');
+            if (depth == 0) {
+                break;
+            }
+        }
+        if (j == cur.size()) {
+            continue;
+        }
+        vector<string> cand(cur.begin(), cur.begin() + i);
+        cand.insert(cand.end(), cur.begin() + j + 1, cur.end());
+        if (test(cand)) {
+            cur     = cand;
+            reduced = true;
+            i--;
+        }
+    }
+    return reduced;
+}
+
+// 按行做 delta debugging，删除的行数从一半逐步减到一行
+static bool reduce_lines(vector<string> &cur,
+                         const function<bool(const vector<string> &)> &test) {
+    bool reduced = false;
+    for (size_t chunk = max<size_t>(cur.size() / 2, 1);; chunk /= 2) {
+        for (size_t i = 0; i < cur.size();) {
+            vector<string> cand(cur.begin(), cur.begin() + i);
+            cand.insert(cand.end(), cur.begin() + min(i + chunk, cur.size()),
+                        cur.end());
+            if (cand.empty() == false && test(cand)) {
+                cur     = cand;
+                reduced = true;
+            }
+            else {
+                i += chunk;
+            }
+        }
+        if (chunk <= 1) {
+            break;
+        }
+    }
+    return reduced;
+}
+
+// 约简程序，保持引擎 target 与参考不一致
+// 删除调用之后被调用的函数才能删除，两种方法交替进行直到不再变小
+static vector<string> reduce(const vector<string> &lines, size_t target,
+                             const string &path) {
+    vector<string> cur  = lines;
+    auto           test = [&](const vector<string> &cand) {
+        write_file(path, cand);
+        vector<size_t> bad = mismatches(evaluate(path));
+        return find(bad.begin(), bad.end(), target) != bad.end();
+    };
+    while (true) {
+        bool reduced = reduce_blocks(cur, test);
+        reduced |= reduce_lines(cur, test);
+        if (reduced == false) {
+            break;
+        }
+    }
+    write_file(path, cur);
+    return cur;
+}
+
+// 用 sysygen 生成一个程序
+static bool generate(const string &sysygen, const string &args, uint64_t seed,
+                     const string &path) {
+    string cmd = sysygen + " " + args + " --seed " + to_string(seed) + " -o " +
+                 path + " >/dev/null 2>&1";
+    return system(cmd.c_str()) == 0;
+}
+
+static void usage(void) {
+    cout << "usage: difftest [--seed 1] [--count 100] [--jobs 1] "
+            "[--engines ir-O0,ir-O1,ir-O2] [--cc cc]\n"
+            "                [--gen \"sysygen 参数\"] [--sysygen 路径] "
+            "[--out /tmp/difftest] [--no-reduce]\n"
+            "                [--llvm-bin 目录] [--llvm-flags 选项]\n"
+            "                [--time-limit 20] [--steps 50000000] [文件...]\n"
+            "engines:";
+    for (auto &e : all_engines) {
+        cout << " " << e.name;
+    }
+    cout << endl;
+    return;
+}
+
+int main(int argc, char **argv) {
+    uint64_t       seed     = 1;
+    uint64_t       count    = 100;
+    int            jobs     = 1;
+    bool           no_red   = false;
+    string         names    = "ir-O0,ir-O1,ir-O2";
+    string         gen_args = "";
+    string         sysygen  = string(argv[0]);
+    vector<string> files;
+    sysygen = sysygen.substr(0, sysygen.rfind('/') + 1) + "sysygen";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   has = i + 1 < argc;
+        if (arg == "--seed" && has) {
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (arg == "--count" && has) {
+            count = strtoull(argv[++i], NULL, 10);
+        }
+        else if (arg == "--jobs" && has) {
+            jobs = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--engines" && has) {
+            names = argv[++i];
+        }
+        else if (arg == "--cc" && has) {
+            host_cc = argv[++i];
+        }
+        else if (arg == "--gen" && has) {
+            gen_args = argv[++i];
+        }
+        else if (arg == "--sysygen" && has) {
+            sysygen = argv[++i];
+        }
+        else if (arg == "--out" && has) {
+            work_dir = argv[++i];
+        }
+        else if (arg == "--time-limit" && has) {
+            time_limit = atoi(argv[++i]);
+        }
+        else if (arg == "--steps" && has) {
+            step_limit = strtoull(argv[++i], NULL, 10);
+        }
+        else if (arg == "--llvm-bin" && has) {
+            llvm_bin = argv[++i];
+        }
+        else if (arg == "--llvm-flags" && has) {
+            llvm_flags = argv[++i];
+        }
+        else if (arg == "--no-reduce") {
+            no_red = true;
+        }
+        else if (arg[0] != '-') {
+            files.push_back(arg);
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    // 指定了宿主编译器时加入 cc 引擎
+    if (host_cc.empty() == false && names.find("cc") == string::npos) {
+        names += ",cc";
+    }
+    stringstream ss(names);
+    for (string name; getline(ss, name, ',');) {
+        const engine_t *found = NULL;
+        for (auto &e : all_engines) {
+            if (name == e.name) {
+                found = &e;
+            }
+        }
+        if (found == NULL) {
+            cout << "unknown engine: " << name << endl;
+            usage();
+            return 1;
+        }
+        if (string(found->name) == "cc" && host_cc.empty()) {
+            host_cc = "cc";
+        }
+        engines.push_back(found);
+    }
+    if (engines.size() < 2) {
+        cout << "at least two engines are needed" << endl;
+        return 1;
+    }
+    mkdir(work_dir.c_str(), 0755);
+    // 给出文件时测试这些文件，否则按种子生成
+    uint64_t total = files.empty() ? count : files.size();
+    // 按下标分给各个工作进程
+    int worker = 0;
+    for (int j = 1; j < jobs; j++) {
+        if (fork() == 0) {
+            worker = j;
+            break;
+        }
+    }
+    uint64_t failed = 0;
+    for (uint64_t k = worker; k < total; k += jobs) {
+        string name = files.empty() ? "seed_" + to_string(seed + k)
+                                    : "file_" + to_string(k);
+        string path = work_dir + "/" + name + ".sy";
+        if (files.empty()) {
+            if (generate(sysygen, gen_args, seed + k, path) == false) {
+                cout << name << ": sysygen failed" << endl;
+                return 1;
+            }
+        }
+        else {
+            ifstream fin(files[k]);
+            ofstream fout(path, ios::out | ios::trunc);
+            fout << fin.rdbuf();
+        }
+        vector<outcome_t> res = evaluate(path);
+        vector<size_t>    bad = mismatches(res);
+        if (res[0].status != 0) {
+            cout << name << ": reference " << engines[0]->name << " "
+                 << status_names[res[0].status] << endl;
+            failed++;
+            continue;
+        }
+        if (bad.empty()) {
+            remove(path.c_str());
+            continue;
+        }
+        failed++;
+        for (auto i : bad) {
+            cout << name << ": " << engines[i]->name << " differs from "
+                 << engines[0]->name << " (" << status_names[res[i].status]
+                 << ", exit " << res[i].code << " vs " << res[0].code << ")"
+                 << endl;
+        }
+        if (no_red) {
+            continue;
+        }
+        // 保留原程序，约简结果写入 .min.sy
+        ifstream       fin(path);
+        vector<string> lines;
+        for (string l; getline(fin, l);) {
+            lines.push_back(l);
+        }
+        string min_path = work_dir + "/" + name + ".min.sy";
+        auto   reduced  = reduce(lines, bad[0], min_path);
+        cout << name << ": reduced " << lines.size() << " -> "
+             << reduced.size() << " lines: " << min_path << endl;
+    }
+    if (worker != 0) {
+        _exit(failed == 0 ? 0 : 1);
+    }
+    int ret = failed == 0 ? 0 : 1;
+    for (int status; wait(&status) > 0;) {
+        if (WIFEXITED(status) == false || WEXITSTATUS(status) != 0) {
+            ret = 1;
+        }
+    }
+    cout << total << " programs, " << engines.size() << " engines"
+         << (ret == 0 ? ", no differences" : ", differences found") << endl;
+    return ret;
+}
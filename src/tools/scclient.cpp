@@ -0,0 +1,49 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// scclient.cpp for Simple-XX/SimpleCompiler.
+
+// 编译服务的瘦客户端
+// 命令行与 SimpleCompiler 相同，由 --client 给出服务的套接字，只转发参数与输出，
+// 不做编译器的初始化；服务不可用或不处理该请求时执行同一目录下的 SimpleCompiler
+
+#include "cerrno"
+#include "climits"
+#include "cstdio"
+#include "cstring"
+#include "string"
+#include "vector"
+#include "unistd.h"
+#include "server.h"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    vector<string> args(argv, argv + argc);
+    string         socket;
+    vector<string> local = strip_client(args, socket);
+    if (socket.empty() == false) {
+        int ret = request(socket, args);
+        if (ret >= 0) {
+            return ret;
+        }
+    }
+    // 在本地编译，去掉 --client，不再连接服务
+    char    self[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len < 0) {
+        printf("Cannot locate " SIMPLE_COMPILER_NAME ": %s\n", strerror(errno));
+        return 1;
+    }
+    string dir      = string(self, len);
+    string compiler = dir.substr(0, dir.rfind('/') + 1) + SIMPLE_COMPILER_NAME;
+    vector<char *> cargv;
+    local[0] = compiler;
+    for (auto &a : local) {
+        cargv.push_back(&a[0]);
+    }
+    cargv.push_back(NULL);
+    execv(compiler.c_str(), cargv.data());
+    printf("Cannot run %s: %s\n", compiler.c_str(), strerror(errno));
+    return 1;
+}
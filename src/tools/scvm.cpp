@@ -0,0 +1,95 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// scvm.cpp for Simple-XX/SimpleCompiler.
+
+// 字节码虚拟机
+// 运行 --emit bytecode 生成的文件，标准输入输出交给程序，退出码为 main 的返回值
+// --stats 在标准错误输出执行的指令条数与各操作码的次数，--dump 只输出反汇编
+
+#include "algorithm"
+#include "cstdint"
+#include "cstdlib"
+#include "fstream"
+#include "iostream"
+#include "sstream"
+#include "string"
+#include "vector"
+#include "bytecode.h"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    bool     stats = false;
+    bool     dump  = false;
+    uint64_t steps = 0;
+    string   input = "";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--stats") {
+            stats = true;
+        }
+        else if (arg == "--dump") {
+            dump = true;
+        }
+        else if (arg == "--steps" && i + 1 < argc) {
+            steps = strtoull(argv[++i], NULL, 10);
+        }
+        else if (arg.empty() == false && arg[0] != '-' && input.empty()) {
+            input = arg;
+        }
+        else {
+            input = "";
+            break;
+        }
+    }
+    if (input.empty()) {
+        cerr << "usage: scvm [--stats] [--dump] [--steps 0] 字节码文件" << endl;
+        return 1;
+    }
+    ifstream fin(input, ios::in | ios::binary);
+    if (fin.is_open() == false) {
+        cerr << "Input file not open: " << input << endl;
+        return 1;
+    }
+    ostringstream data;
+    data << fin.rdbuf();
+    BCModule bc;
+    string   err;
+    if (bc_read(data.str(), bc, err) == false) {
+        cerr << input << ": " << err << endl;
+        return 1;
+    }
+    if (dump) {
+        cout << bc_dump(bc);
+        return 0;
+    }
+    BCVM vm(bc, cin, cout);
+    vm.set_step_limit(steps);
+    int ret = vm.run();
+    if (ret < 0) {
+        cerr << input << ": " << vm.get_trap() << endl;
+    }
+    if (stats) {
+        // 按次数从多到少输出
+        vector<int> ops;
+        for (int i = 0; i < BC_CNT; i++) {
+            if (vm.get_count(i) != 0) {
+                ops.push_back(i);
+            }
+        }
+        stable_sort(ops.begin(), ops.end(), [&vm](int _a, int _b) {
+            return vm.get_count(_a) > vm.get_count(_b);
+        });
+        uint64_t total = vm.get_steps();
+        cerr << "steps " << total << endl;
+        for (auto op : ops) {
+            char pct[16];
+            snprintf(pct, sizeof(pct), "%6.2f%%",
+                     100.0 * vm.get_count(op) / total);
+            cerr << "  " << bc_name(op) << "\t" << vm.get_count(op) << "\t"
+                 << pct << endl;
+        }
+    }
+    return ret < 0 ? 1 : ret;
+}
@@ -0,0 +1,181 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// snapshot_test.cpp for Simple-XX/SimpleCompiler.
+
+// AST 快照的往返测试
+// 解析语料中的每个程序，写出快照并映射回来重建 AST，输出须与原 AST 的 to_string 相同；
+// 另外检查共享子树等非法快照会被拒绝。有失败时返回 1，由 ctest 运行
+
+#include "algorithm"
+#include "cstdio"
+#include "cstring"
+#include "fstream"
+#include "iostream"
+#include "string"
+#include "vector"
+#include "dirent.h"
+#include "sys/stat.h"
+#include "unistd.h"
+#include "parser.h"
+#include "snapshot.h"
+
+using namespace std;
+
+// 收集语料，目录中的 .sy 与 .c 文件按名字排序
+static void collect(const string &path, vector<string> &files) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        cout << "Corpus not found: " << path << endl;
+        return;
+    }
+    if (S_ISDIR(st.st_mode) == false) {
+        files.push_back(path);
+        return;
+    }
+    vector<string> names;
+    DIR           *d = opendir(path.c_str());
+    while (dirent *ent = readdir(d)) {
+        string name = ent->d_name;
+        size_t dot  = name.rfind('.');
+        if (dot != string::npos &&
+            (name.substr(dot) == ".sy" || name.substr(dot) == ".c")) {
+            names.push_back(path + "/" + name);
+        }
+    }
+    closedir(d);
+    sort(names.begin(), names.end());
+    files.insert(files.end(), names.begin(), names.end());
+    return;
+}
+
+// 解析源文件，有语法错误时返回空指针
+static ASTPtr parse(const string &path) {
+    error = new Error(path);
+    ASTPtr prog;
+    {
+        Scanner scanner(path);
+        Lexer   lexer(scanner);
+        Parser  parser(lexer);
+        prog = parser.parsing();
+    }
+    delete error;
+    error = NULL;
+    return prog;
+}
+
+// 写出快照再映射回来，比较重建前后的输出
+static bool round_trip(const string &path, const string &snap_path) {
+    ASTPtr prog = parse(path);
+    if (prog == NULL) {
+        cout << "skip (syntax error): " << path << endl;
+        return true;
+    }
+    string   expect = prog->to_string();
+    ofstream fout(snap_path, ios::out | ios::binary | ios::trunc);
+    if (fout.is_open() == false) {
+        cout << "FAIL cannot write " << snap_path << endl;
+        return false;
+    }
+    fout << snapshot_write(*prog);
+    fout.close();
+    Snapshot snapshot;
+    if (snapshot.open(snap_path) == false) {
+        cout << "FAIL snapshot rejected: " << path << endl;
+        return false;
+    }
+    ASTPtr built = snapshot.build();
+    if (built == NULL || built->to_string() != expect) {
+        cout << "FAIL round trip differs: " << path << endl;
+        return false;
+    }
+    cout << "ok " << path << endl;
+    return true;
+}
+
+// 把一个合法快照的第一个 BinaryAST 的两个子结点都指向左子结点，得到共享子树的快照，
+// 它必须被拒绝
+static bool reject_shared(void) {
+    error = new Error("<shared>");
+    string src = "int main() { return 1 + 2; }";
+    ASTPtr prog;
+    {
+        Scanner scanner(src.data(), src.size());
+        Lexer   lexer(scanner);
+        Parser  parser(lexer);
+        prog = parser.parsing();
+    }
+    delete error;
+    error = NULL;
+    if (prog == NULL) {
+        cout << "FAIL cannot parse the shared-subtree sample" << endl;
+        return false;
+    }
+    // 快照的各部分按 4 字节对齐访问，复制到 uint32_t 数组中
+    string           snap = snapshot_write(*prog);
+    vector<uint32_t> buf((snap.size() + 3) / 4);
+    memcpy(buf.data(), snap.data(), snap.size());
+    char          *base = (char *)buf.data();
+    snap_header_t *h    = (snap_header_t *)base;
+    snap_node_t   *n    = (snap_node_t *)(base + h->node_off);
+    uint32_t      *k    = (uint32_t *)(base + h->kid_off);
+    {
+        Snapshot good;
+        if (good.load(string_view(base, snap.size())) == false) {
+            cout << "FAIL valid snapshot rejected" << endl;
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h->node_cnt; i++) {
+        if (n[i].kind == SNAP_BINARY) {
+            k[n[i].kids + 1] = k[n[i].kids];
+            Snapshot bad;
+            if (bad.load(string_view(base, snap.size()))) {
+                cout << "FAIL snapshot with a shared subtree accepted" << endl;
+                return false;
+            }
+            cout << "ok shared subtree rejected" << endl;
+            return true;
+        }
+    }
+    cout << "FAIL no BinaryAST in the shared-subtree sample" << endl;
+    return false;
+}
+
+int main(int argc, char **argv) {
+    vector<string> corpus;
+    string         dir = "/tmp";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--corpus" && i + 1 < argc) {
+            corpus.push_back(argv[++i]);
+        }
+        else if (arg == "--dir" && i + 1 < argc) {
+            dir = argv[++i];
+        }
+        else {
+            cout << "usage: snapshot_test --corpus path [--corpus path ...] "
+                    "[--dir /tmp]"
+                 << endl;
+            return 1;
+        }
+    }
+    vector<string> files;
+    for (auto &c : corpus) {
+        collect(c, files);
+    }
+    if (files.empty()) {
+        cout << "No input files" << endl;
+        return 1;
+    }
+    string snap_path =
+        dir + "/snapshot_test_" + std::to_string(getpid()) + ".ast";
+    int failed = 0;
+    for (auto &f : files) {
+        failed += round_trip(f, snap_path) == false;
+    }
+    remove(snap_path.c_str());
+    failed += reject_shared() == false;
+    cout << files.size() << " files, " << failed << " failed" << endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,632 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// sysygen.cpp for Simple-XX/SimpleCompiler.
+
+// SysY 程序生成器
+// 按函数个数、嵌套深度、表达式大小、数组维数与常量表大小生成合法的 SysY 程序，
+// 相同的参数与种子总是生成相同的程序
+// 生成的程序覆盖 Parser 接受的全部结构：常量声明、多维数组、嵌套的初始化列表、
+// while、if/else、break/continue、函数调用与数组参数
+// 程序总会结束：循环次数有上界，函数只调用编号更小的函数且每个函数只调用一次，
+// 数组下标不越界，除数是非零常数
+
+#include "cstdint"
+#include "cstdlib"
+#include "cstring"
+#include "fstream"
+#include "iostream"
+#include "string"
+#include "vector"
+
+using namespace std;
+
+// 生成参数
+struct config_t {
+    // 函数个数
+    int functions = 10;
+    // 语句的最大嵌套深度
+    int depth = 3;
+    // 表达式中操作数的个数
+    int expr = 8;
+    // 数组的最大维数
+    int dims = 2;
+    // 全局常量个数
+    int consts = 16;
+    // 每个块中的语句数
+    int stmts = 4;
+    // 随机数种子
+    uint64_t seed = 1;
+};
+
+// 数组
+struct array_info_t {
+    string      name;
+    vector<int> dims;
+};
+
+// 函数
+struct fun_info_t {
+    string name;
+    bool   is_void;
+    // 标量参数个数
+    int scalars;
+    // 数组参数的形状，为空时没有数组参数
+    vector<int> array;
+};
+
+class Generator {
+private:
+    config_t cfg;
+    // splitmix64 状态，不依赖标准库的分布实现，不同平台结果相同
+    uint64_t state;
+    // 输出
+    string out;
+    // 全局常量名及其值
+    vector<pair<string, int>> consts;
+    // 全局数组
+    vector<array_info_t> arrays;
+    // 全局标量
+    vector<string> globals;
+    // 已生成的函数
+    vector<fun_info_t> funs;
+    // 当前函数中可读写的标量
+    vector<string> scalars;
+    // 当前函数中只读的标量：循环变量与局部常量，值都不小于 0
+    vector<string> readonly;
+    // 当前函数中可见的数组
+    vector<array_info_t> local_arrays;
+    // 当前函数的名字计数
+    int name_cnt;
+    // 当前函数还能否生成调用
+    bool can_call;
+
+    uint64_t next(void) {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z          = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    // [0, n) 中的随机数
+    int rand(int n) {
+        return n <= 0 ? 0 : next() % n;
+    }
+    // 概率为 percent% 的事件
+    bool chance(int percent) {
+        return rand(100) < percent;
+    }
+    void indent(int level) {
+        out.append(level * 4, ' ');
+        return;
+    }
+    string fresh(const char *prefix) {
+        return prefix + std::to_string(name_cnt++);
+    }
+
+    // 随机的数组形状，每维 2 到 4
+    vector<int> shape(void) {
+        vector<int> dims(1 + rand(cfg.dims));
+        for (auto &d : dims) {
+            d = 2 + rand(3);
+        }
+        return dims;
+    }
+    // 数组维数，部分维度用常量表示
+    string dim_text(int d) {
+        for (auto &c : consts) {
+            if (c.second == d && chance(30)) {
+                return c.first;
+            }
+        }
+        return std::to_string(d);
+    }
+    string decl_dims(const vector<int> &dims) {
+        string res;
+        for (auto d : dims) {
+            res += "[" + dim_text(d) + "]";
+        }
+        return res;
+    }
+    // 嵌套的初始化列表，可以省略元素或展开子列表
+    string init_list(const vector<int> &dims, size_t level) {
+        if (level == dims.size()) {
+            return std::to_string(rand(100));
+        }
+        string res = "{";
+        int    cnt = chance(20) ? 0 : 1 + rand(dims[level]);
+        for (int i = 0; i < cnt; i++) {
+            res += (i ? ", " : "") + init_list(dims, level + 1);
+        }
+        return res + "}";
+    }
+    // 数组元素，下标一定在范围内
+    string element(const array_info_t &arr) {
+        string res = arr.name;
+        for (auto d : arr.dims) {
+            if (readonly.empty() == false && chance(50)) {
+                res += "[" + readonly[rand(readonly.size())] + " % " +
+                       std::to_string(d) + "]";
+            }
+            else {
+                res += "[" + std::to_string(rand(d)) + "]";
+            }
+        }
+        return res;
+    }
+    // 可读的数组
+    const array_info_t *any_array(void) {
+        size_t total = arrays.size() + local_arrays.size();
+        if (total == 0) {
+            return NULL;
+        }
+        size_t i = rand(total);
+        return i < arrays.size() ? &arrays[i]
+                                 : &local_arrays[i - arrays.size()];
+    }
+
+    // 表达式的叶子
+    string leaf(void) {
+        switch (rand(6)) {
+            case 0:
+                if (consts.empty() == false) {
+                    return consts[rand(consts.size())].first;
+                }
+                break;
+            case 1:
+                if (scalars.empty() == false) {
+                    return scalars[rand(scalars.size())];
+                }
+                break;
+            case 2:
+                if (readonly.empty() == false) {
+                    return readonly[rand(readonly.size())];
+                }
+                break;
+            case 3: {
+                const array_info_t *arr = any_array();
+                if (arr != NULL) {
+                    return element(*arr);
+                }
+                break;
+            }
+            case 4:
+                if (globals.empty() == false) {
+                    return globals[rand(globals.size())];
+                }
+                break;
+            default:
+                break;
+        }
+        return std::to_string(rand(20));
+    }
+
+    // 调用一个编号更小的函数，target 为 -1 时随机选择
+    // 没有可调用的函数时返回空串
+    string call(bool need_value, int target = -1) {
+        if (can_call == false || funs.empty()) {
+            return "";
+        }
+        const fun_info_t &fun = funs[target < 0 ? rand(funs.size()) : target];
+        if (need_value && fun.is_void) {
+            return "";
+        }
+        const array_info_t *arr = NULL;
+        if (fun.array.empty() == false) {
+            // 常量数组不能作为实参
+            for (auto &a : arrays) {
+                if (a.dims == fun.array && a.name[0] != 'T') {
+                    arr = &a;
+                }
+            }
+            for (auto &a : local_arrays) {
+                if (a.dims == fun.array) {
+                    arr = &a;
+                }
+            }
+            if (arr == NULL) {
+                return "";
+            }
+        }
+        can_call   = false;
+        string res = fun.name + "(";
+        for (int i = 0; i < fun.scalars; i++) {
+            res += (i ? ", " : "") + expr(1 + rand(cfg.expr / 2 + 1));
+        }
+        if (arr != NULL) {
+            res += string(fun.scalars ? ", " : "") + arr->name;
+        }
+        return res + ")";
+    }
+
+    // 含 size 个操作数的算术表达式
+    string expr(int size) {
+        if (size <= 1) {
+            switch (rand(8)) {
+                case 0:
+                    return "-" + leaf();
+                case 1:
+                    return "+" + leaf();
+                case 2:
+                    return "!" + leaf();
+                case 3: {
+                    string c = call(true);
+                    if (c.empty() == false) {
+                        return c;
+                    }
+                    return leaf();
+                }
+                default:
+                    return leaf();
+            }
+        }
+        int left = 1 + rand(size - 1);
+        // 除数与模数是非零常数
+        switch (rand(6)) {
+            case 0:
+                return expr(size - 1) + " / " + std::to_string(1 + rand(9));
+            case 1:
+                return expr(size - 1) + " % " + std::to_string(1 + rand(9));
+            case 2:
+                return "(" + expr(left) + " - " + expr(size - left) + ")";
+            case 3:
+                return expr(left) + " * " + expr(size - left);
+            default:
+                return expr(left) + " + " + expr(size - left);
+        }
+    }
+
+    // 条件表达式
+    string cond(void) {
+        static const char *rel[] = {"<", "<=", ">", ">=", "==", "!="};
+        string             res   = expr(1 + rand(cfg.expr / 2 + 1)) + " " +
+                       rel[rand(6)] + " " + expr(1 + rand(cfg.expr / 2 + 1));
+        if (chance(30)) {
+            res += (chance(50) ? " && " : " || ") + cond();
+        }
+        return res;
+    }
+
+    // 局部声明
+    void local_decl(int level) {
+        indent(level);
+        if (chance(25)) {
+            // 局部常量引用全局常量
+            string name = fresh("c");
+            int    val  = rand(50);
+            out += "const int " + name + " = " + std::to_string(val);
+            if (consts.empty() == false) {
+                out += " + " + consts[rand(consts.size())].first + " * 0";
+            }
+            out += ";\n";
+            readonly.push_back(name);
+            return;
+        }
+        if (chance(30)) {
+            array_info_t arr = {fresh("a"), shape()};
+            out += "int " + arr.name + decl_dims(arr.dims);
+            if (chance(70)) {
+                out += " = " + init_list(arr.dims, 0);
+            }
+            out += ";\n";
+            local_arrays.push_back(arr);
+            return;
+        }
+        string a = fresh("v"), b = fresh("v");
+        out += "int " + a + " = " + expr(1 + rand(cfg.expr)) + ", " + b + ";\n";
+        indent(level);
+        out += b + " = " + expr(1 + rand(cfg.expr)) + ";\n";
+        scalars.push_back(a);
+        scalars.push_back(b);
+        return;
+    }
+
+    // 赋值语句
+    void assign(int level) {
+        indent(level);
+        const array_info_t *arr = any_array();
+        if (arr != NULL && arr->name[0] != 'T' && chance(30)) {
+            out += element(*arr);
+        }
+        else if (scalars.empty() == false) {
+            out += scalars[rand(scalars.size())];
+        }
+        else {
+            out += ";\n";
+            return;
+        }
+        out += " = " + expr(1 + rand(cfg.expr)) + ";\n";
+        return;
+    }
+
+    // 块内的语句
+    void block_body(int level, int depth) {
+        size_t nscalars  = scalars.size();
+        size_t nreadonly = readonly.size();
+        size_t narrays   = local_arrays.size();
+        int    cnt      = 1 + rand(cfg.stmts);
+        for (int i = 0; i < cnt; i++) {
+            int kind = rand(10);
+            if (depth >= cfg.depth && kind >= 6) {
+                kind = rand(6);
+            }
+            switch (kind) {
+                case 0:
+                case 1:
+                    local_decl(level);
+                    break;
+                case 2:
+                case 3:
+                case 4:
+                    assign(level);
+                    break;
+                case 5: {
+                    string c = call(false);
+                    indent(level);
+                    out += (c.empty() ? (chance(50) ? "{}" : "") : c) + ";\n";
+                    break;
+                }
+                case 6:
+                case 7:
+                    if_stmt(level, depth + 1);
+                    break;
+                default:
+                    while_stmt(level, depth + 1);
+                    break;
+            }
+        }
+        scalars.resize(nscalars);
+        readonly.resize(nreadonly);
+        local_arrays.resize(narrays);
+        return;
+    }
+
+    // 语句，可能是块也可能是单条语句
+    void sub_stmt(int level, int depth) {
+        if (chance(20)) {
+            assign(level + 1);
+            return;
+        }
+        indent(level);
+        out += "{\n";
+        block_body(level + 1, depth);
+        indent(level);
+        out += "}\n";
+        return;
+    }
+
+    void if_stmt(int level, int depth) {
+        indent(level);
+        out += "if (" + cond() + ")\n";
+        sub_stmt(level, depth);
+        if (chance(50)) {
+            indent(level);
+            out += "else\n";
+            sub_stmt(level, depth);
+        }
+        return;
+    }
+
+    // 循环变量只在循环末尾递增，循环次数不超过 bound
+    void while_stmt(int level, int depth) {
+        string i     = fresh("i");
+        int    bound = 1 + rand(4);
+        indent(level);
+        out += "int " + i + " = 0;\n";
+        indent(level);
+        out += "while (" + i + " < " + std::to_string(bound) + ") {\n";
+        readonly.push_back(i);
+        if (chance(30)) {
+            indent(level + 1);
+            out += "if (" + i + " == " + std::to_string(rand(bound)) +
+                   ") {\n";
+            indent(level + 2);
+            out += i + " = " + i + " + 1;\n";
+            indent(level + 2);
+            out += "continue;\n";
+            indent(level + 1);
+            out += "}\n";
+        }
+        bool c   = can_call;
+        can_call = false;
+        block_body(level + 1, depth);
+        can_call = c;
+        if (chance(20)) {
+            indent(level + 1);
+            out += "if (" + cond() + ") break;\n";
+        }
+        indent(level + 1);
+        out += i + " = " + i + " + 1;\n";
+        readonly.pop_back();
+        indent(level);
+        out += "}\n";
+        return;
+    }
+
+    // 全局常量表，后面的常量引用前面的常量
+    void gen_consts(void) {
+        for (int i = 0; i < cfg.consts;) {
+            out += "const int ";
+            int cnt = 1 + rand(4);
+            for (int j = 0; j < cnt && i < cfg.consts; j++, i++) {
+                string name = "K" + std::to_string(i);
+                int    val  = rand(10);
+                out += (j ? ", " : "") + name + " = ";
+                if (consts.empty() == false && chance(50)) {
+                    auto &c = consts[rand(consts.size())];
+                    out += c.first + " + " + std::to_string(val);
+                    val += c.second;
+                }
+                else {
+                    out += std::to_string(val);
+                }
+                consts.push_back({name, val});
+            }
+            out += ";\n";
+        }
+        // 常量数组
+        array_info_t t = {"T0", shape()};
+        out += "const int T0" + decl_dims(t.dims) + " = " +
+               init_list(t.dims, 0) + ";\n";
+        arrays.push_back(t);
+        return;
+    }
+
+    void gen_globals(void) {
+        int cnt = 1 + rand(3);
+        for (int i = 0; i < cnt; i++) {
+            array_info_t arr = {"g" + std::to_string(i), shape()};
+            out += "int " + arr.name + decl_dims(arr.dims);
+            if (chance(50)) {
+                out += " = " + init_list(arr.dims, 0);
+            }
+            out += ";\n";
+            arrays.push_back(arr);
+        }
+        out += "int G0 = " + std::to_string(rand(10)) + ", G1;\n";
+        globals = {"G0", "G1"};
+        return;
+    }
+
+    void gen_function(int idx) {
+        fun_info_t fun;
+        fun.name    = "f" + std::to_string(idx);
+        fun.is_void = chance(20);
+        fun.scalars = rand(4);
+        // 数组参数与某个全局数组形状相同，调用时传入该数组
+        if (chance(50)) {
+            fun.array = arrays[1 + rand(arrays.size() - 1)].dims;
+        }
+        name_cnt = 0;
+        scalars.clear();
+        readonly.clear();
+        local_arrays.clear();
+        out += "\n" + string(fun.is_void ? "void " : "int ") + fun.name + "(";
+        for (int i = 0; i < fun.scalars; i++) {
+            string p = "p" + std::to_string(i);
+            out += (i ? ", " : "") + string("int ") + p;
+            scalars.push_back(p);
+        }
+        if (fun.array.empty() == false) {
+            array_info_t arr = {"q", fun.array};
+            out += string(fun.scalars ? ", " : "") + "int q[]";
+            for (size_t i = 1; i < arr.dims.size(); i++) {
+                out += "[" + dim_text(arr.dims[i]) + "]";
+            }
+            local_arrays.push_back(arr);
+        }
+        out += ") {\n";
+        can_call = true;
+        block_body(1, 0);
+        indent(1);
+        out += fun.is_void ? "return;\n" : "return " + expr(cfg.expr) + ";\n";
+        out += "}\n";
+        funs.push_back(fun);
+        return;
+    }
+
+    void gen_main(void) {
+        name_cnt = 0;
+        scalars.clear();
+        readonly.clear();
+        local_arrays.clear();
+        out += "\nint main() {\n";
+        out += "    int r = 0;\n";
+        scalars.push_back("r");
+        // 依次调用最后几个函数并输出结果
+        size_t first = funs.size() > 4 ? funs.size() - 4 : 0;
+        for (size_t i = first; i < funs.size(); i++) {
+            can_call = true;
+            string c = call(false, i);
+            if (c.empty() == false) {
+                out += "    " + c + ";\n";
+            }
+        }
+        can_call = false;
+        out += "    r = " + expr(cfg.expr) + ";\n";
+        out += "    putint(r);\n";
+        out += "    putch(10);\n";
+        out += "    return 0;\n}\n";
+        return;
+    }
+
+public:
+    Generator(const config_t &_cfg) : cfg(_cfg), state(_cfg.seed) {
+        name_cnt = 0;
+        can_call = false;
+        return;
+    }
+    ~Generator(void) {
+        return;
+    }
+    // 生成整个程序
+    const string &generate(void) {
+        out = "// generated by sysygen, seed " + std::to_string(cfg.seed) +
+              "\n";
+        gen_consts();
+        gen_globals();
+        for (int i = 0; i < cfg.functions; i++) {
+            gen_function(i);
+        }
+        gen_main();
+        return out;
+    }
+};
+
+int main(int argc, char **argv) {
+    config_t cfg;
+    string   output = "";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            arg = "";
+        }
+        if (arg == "--functions") {
+            cfg.functions = atoi(argv[++i]);
+        }
+        else if (arg == "--depth") {
+            cfg.depth = atoi(argv[++i]);
+        }
+        else if (arg == "--expr") {
+            cfg.expr = atoi(argv[++i]);
+        }
+        else if (arg == "--dims") {
+            cfg.dims = atoi(argv[++i]);
+        }
+        else if (arg == "--consts") {
+            cfg.consts = atoi(argv[++i]);
+        }
+        else if (arg == "--stmts") {
+            cfg.stmts = atoi(argv[++i]);
+        }
+        else if (arg == "--seed") {
+            cfg.seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (arg == "-o") {
+            output = argv[++i];
+        }
+        else {
+            cout << "usage: sysygen [--functions 10] [--depth 3] [--expr 8] "
+                    "[--dims 2] [--consts 16] [--stmts 4] [--seed 1] "
+                    "[-o 输出文件]"
+                 << endl;
+            return 1;
+        }
+    }
+    if (cfg.functions < 0 || cfg.depth < 0 || cfg.expr < 1 || cfg.dims < 1 ||
+        cfg.consts < 0 || cfg.stmts < 1) {
+        cout << "invalid parameter" << endl;
+        return 1;
+    }
+    Generator gen(cfg);
+    if (output.empty()) {
+        cout << gen.generate();
+        return 0;
+    }
+    ofstream fout(output, ios::out | ios::trunc);
+    if (fout.is_open() == false) {
+        cout << "Output file not open: " << output << endl;
+        return 1;
+    }
+    fout << gen.generate();
+    return 0;
+}
@@ -0,0 +1,47 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// alloc_hook.cpp for Simple-XX/SimpleCompiler.
+
+// 替换全局的 operator new，统计打开时记录分配
+// 只链接进编译器与基准测试等可执行文件，不进入 compiler_core，
+// 嵌入编译器库的程序仍使用自己的分配器
+
+#include "cstdlib"
+#include "new"
+#include "timer.h"
+
+void *operator new(size_t size) {
+    if (time_report) {
+        alloc_note(size);
+    }
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+    return;
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+    return;
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+    return;
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    free(p);
+    return;
+}
@@ -0,0 +1,324 @@
+// This file is a part of Simple-XX/SimpleCompiler
+// (https://github.com/Simple-XX/SimpleCompiler).
+//
+// timer.cpp for Simple-XX/SimpleCompiler.
+
+#include "cinttypes"
+#include "cstdio"
+#include "cstring"
+#include "algorithm"
+#include "fstream"
+#include "memory"
+#include "mutex"
+#include "vector"
+#include "time.h"
+#include "unistd.h"
+#include "sys/resource.h"
+#include "sys/syscall.h"
+#include "timer.h"
+
+bool                  time_report             = false;
+bool                  time_report_json        = false;
+std::atomic<uint64_t> stat_counters[STAT_NUM] = {};
+std::string           trace_file              = "";
+
+// 计数器名
+static const char *stat_names[STAT_NUM] = {"tokens", "ast_nodes", "files"};
+
+// 进程的分配次数
+static std::atomic<uint64_t> alloc_count(0);
+// 进程的分配字节数
+static std::atomic<uint64_t> alloc_bytes(0);
+// 本线程的分配次数与字节数，阶段只统计自己线程中的分配
+static thread_local uint64_t thread_allocs = 0;
+static thread_local uint64_t thread_bytes  = 0;
+
+// 记录一次内存分配
+void alloc_note(size_t _size) {
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(_size, std::memory_order_relaxed);
+    thread_allocs++;
+    thread_bytes += _size;
+    return;
+}
+
+// 跟踪事件
+struct trace_event_t {
+    const char *name;
+    std::string detail;
+    // B 为开始，E 为结束
+    char     ph;
+    uint64_t ts;
+};
+
+// 一个线程的阶段结果与跟踪事件
+// 线程只写自己的缓冲区，锁只在汇总时才有竞争
+struct thread_buf_t {
+    std::mutex lock;
+    long       tid;
+    // 按第一次出现的顺序保存各阶段
+    std::vector<phase_stat_t> phases;
+    // 按发生顺序保存跟踪事件
+    std::vector<trace_event_t> events;
+};
+
+// 各线程的缓冲区，按线程第一次记录的顺序排列
+// 线程退出后缓冲区仍然保留，直到结果被清空
+static std::mutex                                 bufs_lock;
+static std::vector<std::shared_ptr<thread_buf_t>> bufs;
+
+// 本线程的缓冲区，第一次使用时登记
+static thread_buf_t &local_buf(void) {
+    static thread_local std::shared_ptr<thread_buf_t> buf;
+    if (buf == nullptr) {
+        buf      = std::make_shared<thread_buf_t>();
+        buf->tid = syscall(SYS_gettid);
+        std::lock_guard<std::mutex> guard(bufs_lock);
+        // 顺便移除已退出且没有内容的线程，反复创建上下文时不会持续增长
+        bufs.erase(std::remove_if(bufs.begin(), bufs.end(),
+                                  [](const std::shared_ptr<thread_buf_t> &b) {
+                                      std::lock_guard<std::mutex> g(b->lock);
+                                      return b.use_count() == 1 &&
+                                             b->phases.empty() &&
+                                             b->events.empty();
+                                  }),
+                   bufs.end());
+        bufs.push_back(buf);
+    }
+    return *buf;
+}
+
+static uint64_t now(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t max_rss(void) {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// 记录一个跟踪事件
+static void trace(const char *name, const std::string &detail, char ph) {
+    thread_buf_t               &buf = local_buf();
+    std::lock_guard<std::mutex> guard(buf.lock);
+    buf.events.push_back({name, detail, ph, now(CLOCK_MONOTONIC)});
+    return;
+}
+
+Phase::Phase(const char *_name, const std::string &_detail)
+    : name(_name), on(time_report || trace_file.empty() == false) {
+    if (on == false) {
+        return;
+    }
+    if (trace_file.empty() == false) {
+        trace(name, _detail, 'B');
+    }
+    allocs = thread_allocs;
+    bytes  = thread_bytes;
+    rss    = max_rss();
+    cpu    = now(CLOCK_THREAD_CPUTIME_ID);
+    wall   = now(CLOCK_MONOTONIC);
+    return;
+}
+
+Phase::~Phase(void) {
+    if (on == false) {
+        return;
+    }
+    uint64_t end_wall = now(CLOCK_MONOTONIC);
+    uint64_t end_cpu  = now(CLOCK_THREAD_CPUTIME_ID);
+    if (trace_file.empty() == false) {
+        trace(name, "", 'E');
+    }
+    if (time_report == false) {
+        return;
+    }
+    thread_buf_t               &buf = local_buf();
+    std::lock_guard<std::mutex> guard(buf.lock);
+    phase_stat_t               *stat = NULL;
+    for (auto &p : buf.phases) {
+        if (strcmp(p.name, name) == 0) {
+            stat = &p;
+            break;
+        }
+    }
+    if (stat == NULL) {
+        buf.phases.push_back({name, 0, 0, 0, 0, 0, 0});
+        stat = &buf.phases.back();
+    }
+    stat->calls++;
+    stat->wall += end_wall - wall;
+    stat->cpu += end_cpu - cpu;
+    stat->rss += max_rss() - rss;
+    stat->allocs += thread_allocs - allocs;
+    stat->bytes += thread_bytes - bytes;
+    return;
+}
+
+// 获取内存分配次数与字节数
+void alloc_stats(uint64_t &count, uint64_t &bytes) {
+    count = alloc_count.load(std::memory_order_relaxed);
+    bytes = alloc_bytes.load(std::memory_order_relaxed);
+    return;
+}
+
+// 汇总各线程的阶段结果，同名阶段相加
+std::vector<phase_stat_t> phase_stats(void) {
+    std::vector<phase_stat_t>   res;
+    std::lock_guard<std::mutex> guard(bufs_lock);
+    for (auto &buf : bufs) {
+        std::lock_guard<std::mutex> g(buf->lock);
+        for (auto &p : buf->phases) {
+            phase_stat_t *stat = NULL;
+            for (auto &r : res) {
+                if (strcmp(r.name, p.name) == 0) {
+                    stat = &r;
+                    break;
+                }
+            }
+            if (stat == NULL) {
+                res.push_back(p);
+                continue;
+            }
+            stat->calls += p.calls;
+            stat->wall += p.wall;
+            stat->cpu += p.cpu;
+            stat->rss += p.rss;
+            stat->allocs += p.allocs;
+            stat->bytes += p.bytes;
+        }
+    }
+    return res;
+}
+
+// 清空各阶段的累计结果与计数器
+void time_report_reset(void) {
+    {
+        std::lock_guard<std::mutex> guard(bufs_lock);
+        for (auto &buf : bufs) {
+            std::lock_guard<std::mutex> g(buf->lock);
+            buf->phases.clear();
+        }
+    }
+    for (int i = 0; i < STAT_NUM; i++) {
+        stat_counters[i].store(0, std::memory_order_relaxed);
+    }
+    return;
+}
+
+// 输出统计结果
+void time_report_print(std::ostream &os) {
+    char                      line[256];
+    std::vector<phase_stat_t> phases = phase_stats();
+    if (time_report_json) {
+        os << "{\"phases\": [";
+        for (size_t i = 0; i < phases.size(); i++) {
+            auto &p = phases[i];
+            snprintf(line, sizeof(line),
+                     "%s{\"name\": \"%s\", \"calls\": %" PRIu64
+                     ", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"rss_kb\": %" PRIu64
+                     ", \"allocs\": %" PRIu64 ", \"bytes\": %" PRIu64 "}",
+                     i == 0 ? "" : ", ", p.name, p.calls, p.wall / 1e6,
+                     p.cpu / 1e6, p.rss, p.allocs, p.bytes);
+            os << line;
+        }
+        os << "], \"counters\": {";
+        for (int i = 0; i < STAT_NUM; i++) {
+            os << (i == 0 ? "" : ", ") << "\"" << stat_names[i]
+               << "\": " << stat_counters[i].load();
+        }
+        os << "}, \"max_rss_kb\": " << max_rss() << "}" << std::endl;
+        return;
+    }
+    os << "Time report:" << std::endl;
+    // 阶段名一列按最长的阶段名对齐
+    int width = strlen("phase");
+    for (auto &p : phases) {
+        width = std::max(width, (int)strlen(p.name));
+    }
+    snprintf(line, sizeof(line), "  %-*s %8s %10s %10s %8s %10s %12s\n",
+             width, "phase", "calls", "wall(ms)", "cpu(ms)", "rss(KB)",
+             "allocs", "bytes");
+    os << line;
+    for (auto &p : phases) {
+        snprintf(line, sizeof(line),
+                 "  %-*s %8" PRIu64 " %10.3f %10.3f %8" PRIu64 " %10" PRIu64
+                 " %12" PRIu64 "\n",
+                 width, p.name, p.calls, p.wall / 1e6, p.cpu / 1e6, p.rss,
+                 p.allocs, p.bytes);
+        os << line;
+    }
+    for (int i = 0; i < STAT_NUM; i++) {
+        os << "  " << stat_names[i] << ": " << stat_counters[i].load()
+           << std::endl;
+    }
+    os << "  max rss: " << max_rss() << " KB" << std::endl;
+    return;
+}
+
+// JSON 字符串转义
+static std::string json_escape(const std::string &str) {
+    std::string res;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+            res += c;
+        }
+        else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            res += buf;
+        }
+        else {
+            res += c;
+        }
+    }
+    return res;
+}
+
+// 以 Chrome trace-event 格式写出跟踪事件
+// 各线程的事件合并后按时间排序，时间戳单位为微秒，可以用 chrome://tracing 或 Perfetto 打开
+bool trace_write(void) {
+    std::ofstream fout(trace_file, std::ios::out | std::ios::trunc);
+    if (fout.is_open() == false) {
+        return false;
+    }
+    std::vector<std::pair<trace_event_t, long>> events;
+    {
+        std::lock_guard<std::mutex> guard(bufs_lock);
+        for (auto &buf : bufs) {
+            std::lock_guard<std::mutex> g(buf->lock);
+            for (auto &e : buf->events) {
+                events.push_back({e, buf->tid});
+            }
+        }
+    }
+    // 同一线程内的事件已按时间排列，稳定排序保持同一时刻的开始与结束顺序
+    std::stable_sort(events.begin(), events.end(),
+                     [](const std::pair<trace_event_t, long> &a,
+                        const std::pair<trace_event_t, long> &b) {
+                         return a.first.ts < b.first.ts;
+                     });
+    long pid = getpid();
+    fout << "{\"traceEvents\": [\n";
+    for (size_t i = 0; i < events.size(); i++) {
+        auto &e   = events[i].first;
+        long  tid = events[i].second;
+        char  line[256];
+        snprintf(line, sizeof(line),
+                 "{\"name\": \"%s\", \"cat\": \"compiler\", \"ph\": \"%c\", "
+                 "\"ts\": %.3f, \"pid\": %ld, \"tid\": %ld",
+                 e.name, e.ph, e.ts / 1e3, pid, tid);
+        fout << line;
+        if (e.detail.empty() == false) {
+            fout << ", \"args\": {\"detail\": \"" << json_escape(e.detail)
+                 << "\"}";
+        }
+        fout << (i + 1 == events.size() ? "}\n" : "},\n");
+    }
+    fout << "], \"displayTimeUnit\": \"ms\"}\n";
+    return true;
+}